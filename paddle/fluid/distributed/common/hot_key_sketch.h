@@ -0,0 +1,106 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_set>
+#include <vector>
+
+namespace paddle {
+namespace distributed {
+
+// Detects the hot keys of a stream with a count-min sketch. The counters
+// are cleared every window of counts, and a key is hot when its count in a
+// window reaches the threshold. The hot keys of the current and the last
+// window are reported, at most max_hot_num of each. Add is lock free
+// except when a key turns hot or a window ends.
+class HotKeySketch {
+ public:
+  HotKeySketch(int width_bits, uint32_t threshold, uint64_t window,
+               size_t max_hot_num)
+      : _width_bits(width_bits),
+        _threshold(threshold),
+        _window(window),
+        _max_hot_num(max_hot_num),
+        _counters(new std::atomic<uint32_t>[kDepth << width_bits]()) {}
+  HotKeySketch(const HotKeySketch&) = delete;
+
+  void Add(uint64_t key, uint32_t count) {
+    uint32_t estimate = UINT32_MAX;
+    for (int row = 0; row < kDepth; ++row) {
+      auto& counter = _counters[(row << _width_bits) + Index(row, key)];
+      uint32_t value =
+          counter.fetch_add(count, std::memory_order_relaxed) + count;
+      estimate = std::min(estimate, value);
+    }
+    // only the count crossing the threshold inserts the key
+    if (estimate >= _threshold && estimate - count < _threshold) {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if (_hot_keys.size() < _max_hot_num) {
+        _hot_keys.insert(key);
+      }
+    }
+    if (_added.fetch_add(count, std::memory_order_relaxed) + count >=
+        _window) {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if (_added.load(std::memory_order_relaxed) >= _window) {
+        for (size_t i = 0; i < (kDepth << _width_bits); ++i) {
+          _counters[i].store(0, std::memory_order_relaxed);
+        }
+        _added.store(0, std::memory_order_relaxed);
+        _last_hot_keys.swap(_hot_keys);
+        _hot_keys.clear();
+      }
+    }
+  }
+
+  std::vector<uint64_t> HotKeys() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    std::vector<uint64_t> keys(_hot_keys.begin(), _hot_keys.end());
+    for (auto key : _last_hot_keys) {
+      if (_hot_keys.count(key) == 0) {
+        keys.push_back(key);
+      }
+    }
+    return keys;
+  }
+
+ private:
+  static const int kDepth = 4;
+
+  // multiply-shift hashing with an odd multiplier per row
+  size_t Index(int row, uint64_t key) const {
+    static const uint64_t kSeeds[kDepth] = {
+        0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL,
+        0xD6E8FEB86659FD93ULL};
+    return static_cast<size_t>((key * kSeeds[row]) >> (64 - _width_bits));
+  }
+
+  int _width_bits;
+  uint32_t _threshold;
+  uint64_t _window;
+  size_t _max_hot_num;
+  std::unique_ptr<std::atomic<uint32_t>[]> _counters;
+  std::atomic<uint64_t> _added{0};
+  std::mutex _mutex;
+  std::unordered_set<uint64_t> _hot_keys;
+  std::unordered_set<uint64_t> _last_hot_keys;
+};
+
+}  // namespace distributed
+}  // namespace paddle
@@ -12,9 +12,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <thread>  // NOLINT
 
 #include "paddle/fluid/distributed/ps/service/brpc_ps_client.h"
 #include "paddle/fluid/framework/archive.h"
@@ -57,6 +59,10 @@ DEFINE_int32(pserver_sparse_table_shard_num, 1000,
 
 DEFINE_int32(heter_world_size, 100, "group size");  // 可配置
 
+DEFINE_int32(pserver_hot_key_cache_steps, 0,
+             "the sparse pulls of a table between the refreshes of its hot "
+             "keys cached on a worker, 0 to disable the cache");
+
 namespace paddle {
 namespace framework {
 class Scope;
@@ -209,6 +215,9 @@ int32_t BrpcPsClient::Initialize() {
       _push_sparse_task_queue_map[table_id] =
           paddle::framework::MakeChannel<SparseAsyncTask *>();
       _push_sparse_merge_count_map[table_id] = 0;
+      if (FLAGS_pserver_hot_key_cache_steps > 0) {
+        _hot_key_caches[table_id].reset(new HotKeyCache());
+      }
     }
   }
 
@@ -327,6 +336,78 @@ std::future<int32_t> BrpcPsClient::PrintTableStat(uint32_t table_id) {
   }
   return fut;
 }
+std::future<int32_t> BrpcPsClient::Reshard(
+    uint32_t table_id, const std::vector<std::string> &endpoints) {
+  return std::async(std::launch::async, [this, table_id,
+                                         endpoints]() -> int32_t {
+    size_t old_server_num = _server_channels.size();
+    size_t server_num = std::max(old_server_num, endpoints.size());
+    // the servers joining are connected here only
+    std::vector<std::shared_ptr<brpc::Channel>> new_channels;
+    std::vector<brpc::Channel *> channels;
+    for (size_t i = 0; i < server_num; ++i) {
+      if (i < old_server_num) {
+        channels.push_back(GetCmdChannel(i));
+        continue;
+      }
+      brpc::ChannelOptions options;
+      options.protocol = "baidu_std";
+      options.connect_timeout_ms = FLAGS_pserver_connect_timeout_ms;
+      new_channels.emplace_back(new brpc::Channel());
+      if (new_channels.back()->Init(endpoints[i].c_str(), "", &options) != 0) {
+        LOG(ERROR) << "BrpcPsClient connect to server " << endpoints[i]
+                   << " failed";
+        return -1;
+      }
+      channels.push_back(new_channels.back().get());
+    }
+
+    // Runs a phase of PS_RESHARD_TABLE on the first num servers.
+    auto run_phase = [&](size_t num,
+                         const std::vector<std::string> &params) -> int32_t {
+      std::vector<int32_t> rets(num, 0);
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < num; ++i) {
+        threads.emplace_back([&, i]() {
+          PsRequestMessage request;
+          PsResponseMessage response;
+          brpc::Controller cntl;
+          request.set_cmd_id(PS_RESHARD_TABLE);
+          request.set_table_id(table_id);
+          request.set_client_id(_client_id);
+          for (const auto &param : params) {
+            request.add_params(param);
+          }
+          cntl.set_timeout_ms(-1);  // migrating the shards may take hours
+          PsService_Stub rpc_stub(channels[i]);
+          rpc_stub.service(&cntl, &request, &response, NULL);
+          if (cntl.Failed() || response.err_code() != 0) {
+            LOG(ERROR) << "BrpcPsClient reshard " << params[0]
+                       << " failed on server " << i;
+            rets[i] = -1;
+          }
+        });
+      }
+      for (auto &t : threads) {
+        t.join();
+      }
+      return *std::min_element(rets.begin(), rets.end());
+    };
+
+    std::vector<std::string> params = {"begin",
+                                       std::to_string(old_server_num)};
+    params.insert(params.end(), endpoints.begin(), endpoints.end());
+    if (run_phase(server_num, params) != 0 ||
+        run_phase(old_server_num, {"migrate"}) != 0 ||
+        run_phase(server_num, {"commit"}) != 0) {
+      // rolls back the servers not committed, the others fail to abort
+      run_phase(server_num, {"abort"});
+      return -1;
+    }
+    return 0;
+  });
+}
+
 std::future<int32_t> BrpcPsClient::SendCmd(
     uint32_t table_id, int cmd_id, const std::vector<std::string> &params) {
   size_t request_call_num = _server_channels.size();
@@ -438,6 +519,9 @@ std::future<int32_t> BrpcPsClient::Clear(uint32_t table_id) {
 
 std::future<int32_t> BrpcPsClient::Flush() {
   VLOG(0) << "BrpcPsClient::flush begin";
+  for (auto &itr : _hot_key_caches) {
+    FlushHotKeyPushes(itr.first, itr.second.get());
+  }
   _flushing = true;
   std::promise<int> promise;
   std::future<int32_t> fut = promise.get_future();
@@ -764,6 +848,16 @@ std::future<int32_t> BrpcPsClient::PushSparseRawGradient(
   closure->add_promise(promise);
   std::future<int> fut = promise->get_future();
 
+  // the pushes of the hot keys are merged as the ones of PushSparse
+  std::vector<uint64_t> push_keys;
+  std::vector<const float *> push_values;
+  if (MergeHotKeyPushes(table_id, keys, update_values, num, &push_keys,
+                        &push_values)) {
+    keys = push_keys.data();
+    update_values = push_values.data();
+    num = push_keys.size();
+  }
+
   size_t request_call_num = _server_channels.size();
   std::vector<std::vector<uint64_t>> ids;
   std::vector<std::vector<const float *>> value_ptrs;
@@ -900,17 +994,52 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
     }
   }
 
-  for (size_t i = 0; i < num; ++i) {
-    size_t shard_id = get_sparse_shard(shard_num, request_call_num, keys[i]);
-    shard_sorted_kvs->at(shard_id).push_back({keys[i], select_values[i]});
-  }
-
   auto *accessor = GetTableAccessor(table_id);
 
   size_t value_size = accessor->GetAccessorInfo().select_size;
 
+  // the hot keys are read from the cache, and read through when missed
+  std::shared_ptr<HotKeyCache> cache;
+  auto missed_hot_kvs =
+      std::make_shared<std::vector<std::pair<uint64_t, float *>>>();
+  auto cache_itr = _hot_key_caches.find(table_id);
+  if (cache_itr != _hot_key_caches.end()) {
+    cache = cache_itr->second;
+    bool refresh = false;
+    {
+      std::lock_guard<std::mutex> guard(cache->mutex);
+      refresh = cache->steps++ % FLAGS_pserver_hot_key_cache_steps == 0 &&
+                !cache->refreshing;
+      cache->refreshing |= refresh;
+    }
+    if (refresh) {
+      RefreshHotKeyCache(table_id, cache);
+    }
+  }
+
+  {
+    std::unique_lock<std::mutex> lock;
+    if (cache) {
+      lock = std::unique_lock<std::mutex>(cache->mutex);
+    }
+    for (size_t i = 0; i < num; ++i) {
+      if (cache && cache->keys.count(keys[i]) != 0) {
+        auto itr = cache->values.find(keys[i]);
+        if (itr != cache->values.end()) {
+          memcpy(select_values[i], itr->second.data(), value_size);
+          ++cache->hits[keys[i]];
+          continue;
+        }
+        missed_hot_kvs->push_back({keys[i], select_values[i]});
+      }
+      size_t shard_id = get_sparse_shard(shard_num, request_call_num, keys[i]);
+      shard_sorted_kvs->at(shard_id).push_back({keys[i], select_values[i]});
+    }
+  }
+
   DownpourBrpcClosure *closure = new DownpourBrpcClosure(
-      request_call_num, [shard_sorted_kvs, value_size](void *done) {
+      request_call_num,
+      [shard_sorted_kvs, value_size, cache, missed_hot_kvs](void *done) {
         int ret = 0;
         auto *closure = reinterpret_cast<DownpourBrpcClosure *>(done);
         for (size_t i = 0; i < shard_sorted_kvs->size(); ++i) {
@@ -943,6 +1072,16 @@ std::future<int32_t> BrpcPsClient::PullSparse(float **select_values,
             }
           }
         }
+        if (ret == 0 && !missed_hot_kvs->empty()) {
+          std::lock_guard<std::mutex> guard(cache->mutex);
+          for (auto &kv : *missed_hot_kvs) {
+            // the keys may have cooled down since a refresh
+            if (cache->keys.count(kv.first) != 0) {
+              cache->values[kv.first].assign(
+                  kv.second, kv.second + value_size / sizeof(float));
+            }
+          }
+        }
         closure->set_promise_value(ret);
       });
   closure->add_timer(timer);
@@ -1251,10 +1390,9 @@ int32_t BrpcPsClient::RecvAndSaveTable(const uint64_t table_id,
   return 0;
 }
 
-std::future<int32_t> BrpcPsClient::PushSparse(size_t table_id,
-                                              const uint64_t *keys,
-                                              const float **update_values,
-                                              size_t num) {
+std::future<int32_t> BrpcPsClient::PushSparseToServers(
+    size_t table_id, const uint64_t *keys, const float **update_values,
+    size_t num) {
   auto push_timer = std::make_shared<CostTimer>("pserver_client_push_sparse");
   CostTimer parse_timer("pserver_client_push_sparse_parse");
   int push_sparse_async_num = _push_sparse_task_queue_map[table_id]->Size();
@@ -1459,6 +1597,164 @@ void sparse_local_merge(ValueAccessor *accessor, float *merge_data,
   accessor->Merge(merge_data_shell, another_data_shell, 1);
 }
 
+std::future<int32_t> BrpcPsClient::PushSparse(size_t table_id,
+                                              const uint64_t *keys,
+                                              const float **update_values,
+                                              size_t num) {
+  std::vector<uint64_t> push_keys;
+  std::vector<const float *> push_values;
+  if (!MergeHotKeyPushes(table_id, keys, update_values, num, &push_keys,
+                         &push_values)) {
+    return PushSparseToServers(table_id, keys, update_values, num);
+  }
+  return PushSparseToServers(table_id, push_keys.data(), push_values.data(),
+                             push_keys.size());
+}
+
+bool BrpcPsClient::MergeHotKeyPushes(size_t table_id, const uint64_t *keys,
+                                     const float **update_values, size_t num,
+                                     std::vector<uint64_t> *push_keys,
+                                     std::vector<const float *> *push_values) {
+  auto cache_itr = _hot_key_caches.find(table_id);
+  if (cache_itr == _hot_key_caches.end()) {
+    return false;
+  }
+  // the pushes of the hot keys are merged until the cache refreshes
+  auto *cache = cache_itr->second.get();
+  auto *accessor = GetTableAccessor(table_id);
+  size_t update_dim = accessor->GetAccessorInfo().update_dim;
+  push_keys->reserve(num);
+  push_values->reserve(num);
+  std::lock_guard<std::mutex> guard(cache->mutex);
+  for (size_t i = 0; i < num; ++i) {
+    if (cache->keys.count(keys[i]) == 0) {
+      push_keys->push_back(keys[i]);
+      push_values->push_back(update_values[i]);
+      continue;
+    }
+    auto itr = cache->pushes.find(keys[i]);
+    if (itr == cache->pushes.end()) {
+      cache->pushes[keys[i]].assign(update_values[i],
+                                    update_values[i] + update_dim);
+    } else {
+      sparse_local_merge(accessor, itr->second.data(), update_values[i]);
+    }
+  }
+  return true;
+}
+
+std::future<int32_t> BrpcPsClient::FlushHotKeyPushes(uint32_t table_id,
+                                                     HotKeyCache *cache) {
+  std::unordered_map<uint64_t, std::vector<float>> pushes;
+  {
+    std::lock_guard<std::mutex> guard(cache->mutex);
+    pushes.swap(cache->pushes);
+  }
+  if (pushes.empty()) {
+    std::promise<int32_t> promise;
+    promise.set_value(0);
+    return promise.get_future();
+  }
+  std::vector<uint64_t> push_keys;
+  std::vector<const float *> push_values;
+  push_keys.reserve(pushes.size());
+  push_values.reserve(pushes.size());
+  for (auto &kv : pushes) {
+    push_keys.push_back(kv.first);
+    push_values.push_back(kv.second.data());
+  }
+  // the values are copied into the push task before this returns
+  return PushSparseToServers(table_id, push_keys.data(), push_values.data(),
+                             push_keys.size());
+}
+
+std::future<int32_t> BrpcPsClient::RefreshHotKeyCache(
+    uint32_t table_id, std::shared_ptr<HotKeyCache> cache) {
+  FlushHotKeyPushes(table_id, cache.get());
+  std::unordered_map<uint64_t, uint32_t> hits;
+  {
+    std::lock_guard<std::mutex> guard(cache->mutex);
+    hits.swap(cache->hits);
+  }
+
+  // the hits of the cache count to the hot keys on their servers
+  size_t request_call_num = _server_channels.size();
+  const auto &server_param = _config.server_param().downpour_server_param();
+  uint64_t shard_num = FLAGS_pserver_sparse_table_shard_num;
+  for (int i = 0; i < server_param.downpour_table_param_size(); ++i) {
+    const auto &table_param = server_param.downpour_table_param(i);
+    if (table_param.table_id() == table_id) {
+      shard_num = table_param.shard_num();
+      break;
+    }
+  }
+  std::vector<std::vector<uint64_t>> hit_keys(request_call_num);
+  std::vector<std::vector<uint32_t>> hit_counts(request_call_num);
+  for (auto &kv : hits) {
+    size_t shard_id = get_sparse_shard(shard_num, request_call_num, kv.first);
+    hit_keys[shard_id].push_back(kv.first);
+    hit_counts[shard_id].push_back(kv.second);
+  }
+
+  // the pulls go on with the keys cached until the hot keys are swapped in
+  ++_async_call_num;
+  DownpourBrpcClosure *closure = new DownpourBrpcClosure(
+      request_call_num,
+      [this, request_call_num, table_id, cache](void *done) {
+        int ret = 0;
+        auto *closure = reinterpret_cast<DownpourBrpcClosure *>(done);
+        std::unordered_set<uint64_t> hot_keys;
+        for (size_t i = 0; i < request_call_num; ++i) {
+          if (closure->check_response(i, PS_PULL_HOT_KEYS) != 0) {
+            ret = -1;
+            break;
+          }
+          auto &res_io_buffer = closure->cntl(i)->response_attachment();
+          butil::IOBufBytesIterator io_buffer_itr(res_io_buffer);
+          uint64_t key = 0;
+          while (io_buffer_itr.copy_and_forward(reinterpret_cast<void *>(&key),
+                                                sizeof(uint64_t)) ==
+                 sizeof(uint64_t)) {
+            hot_keys.insert(key);
+          }
+        }
+        {
+          std::lock_guard<std::mutex> guard(cache->mutex);
+          cache->values.clear();
+          if (ret != 0) {
+            LOG(WARNING) << "pull hot keys of table " << table_id
+                         << " failed, caching no key until the next refresh";
+            cache->keys.clear();
+          } else {
+            cache->keys.swap(hot_keys);
+          }
+          cache->refreshing = false;
+        }
+        closure->set_promise_value(ret);
+        --_async_call_num;
+      });
+  auto promise = std::make_shared<std::promise<int32_t>>();
+  closure->add_promise(promise);
+  std::future<int> fut = promise->get_future();
+  for (size_t i = 0; i < request_call_num; ++i) {
+    uint32_t hit_num = hit_keys[i].size();
+    closure->request(i)->set_cmd_id(PS_PULL_HOT_KEYS);
+    closure->request(i)->set_table_id(table_id);
+    closure->request(i)->set_client_id(_client_id);
+    closure->request(i)->add_params((char *)&hit_num,  // NOLINT
+                                    sizeof(uint32_t));
+    auto &request_buffer = closure->cntl(i)->request_attachment();
+    request_buffer.append(reinterpret_cast<void *>(hit_keys[i].data()),
+                          sizeof(uint64_t) * hit_num);
+    request_buffer.append(reinterpret_cast<void *>(hit_counts[i].data()),
+                          sizeof(uint32_t) * hit_num);
+    PsService_Stub rpc_stub(GetCmdChannel(i));
+    rpc_stub.service(closure->cntl(i), closure->request(i),
+                     closure->response(i), closure);
+  }
+  return fut;
+}
+
 int BrpcPsClient::PushSparseAsyncShardMerge(
     std::vector<std::shared_ptr<SparseAsyncTask>> &task_list,
     std::vector<int> &request_kv_num, int table_id, int shard_idx,
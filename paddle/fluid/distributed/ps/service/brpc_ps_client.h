@@ -16,7 +16,10 @@
 
 #include <ThreadPool.h>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "brpc/channel.h"
@@ -201,6 +204,13 @@ class BrpcPsClient : public PSClient {
 
   virtual std::future<int32_t> PrintTableStat(uint32_t table_id);
 
+  // Reshards a sparse table online to the servers of endpoints, the current
+  // servers first, see MemorySparseTable::BeginReshard. The workers keep
+  // sending to the current servers, which forward the keys moved out. The
+  // reshard is aborted on all the servers when it fails on any of them.
+  virtual std::future<int32_t> Reshard(
+      uint32_t table_id, const std::vector<std::string> &endpoints);
+
   virtual std::future<int32_t> Barrier(size_t table_id, uint32_t barrier_type);
 
   virtual std::future<int32_t> PullGeoParam(size_t table_id,
@@ -263,6 +273,38 @@ class BrpcPsClient : public PSClient {
       _push_sparse_task_queue_map;
   std::unordered_map<uint32_t, uint32_t> _push_sparse_merge_count_map;
 
+  // The hot keys of a sparse table reported by the servers, with their
+  // values cached on pulls and their pushes merged here. Both are dropped
+  // every FLAGS_pserver_hot_key_cache_steps pulls, which bounds how stale a
+  // cached value is.
+  struct HotKeyCache {
+    std::mutex mutex;
+    uint64_t steps = 0;
+    bool refreshing = false;  // a refresh in flight
+    std::unordered_set<uint64_t> keys;
+    std::unordered_map<uint64_t, std::vector<float>> values;
+    // the pulls served by the cache, to count to the hot keys on the servers
+    std::unordered_map<uint64_t, uint32_t> hits;
+    std::unordered_map<uint64_t, std::vector<float>> pushes;
+  };
+  // by table id, built on initialize
+  std::unordered_map<uint32_t, std::shared_ptr<HotKeyCache>> _hot_key_caches;
+  // Pushes the merged pushes of the hot keys, then sends the hits of the
+  // cache to the servers and pulls the hot keys asynchronously. They are
+  // swapped in with the cached values dropped when the pull completes, and
+  // Flush waits for it.
+  std::future<int32_t> RefreshHotKeyCache(uint32_t table_id,
+                                          std::shared_ptr<HotKeyCache> cache);
+  std::future<int32_t> FlushHotKeyPushes(uint32_t table_id,
+                                         HotKeyCache *cache);
+  // Merges the pushes of the hot keys into the cache of the table, and
+  // returns the other ones in push_keys and push_values. Returns false if
+  // the table has no hot key cache.
+  bool MergeHotKeyPushes(size_t table_id, const uint64_t *keys,
+                         const float **update_values, size_t num,
+                         std::vector<uint64_t> *push_keys,
+                         std::vector<const float *> *push_values);
+
   std::thread _print_thread;
 
   int PushSparseAsyncShardMerge(
@@ -303,6 +345,11 @@ class BrpcPsClient : public PSClient {
   std::future<int32_t> PushSparse(size_t table_id, const uint64_t *keys,
                                   const float **update_values,
                                   size_t num) override;
+  // PushSparse without merging the hot keys.
+  std::future<int32_t> PushSparseToServers(size_t table_id,
+                                           const uint64_t *keys,
+                                           const float **update_values,
+                                           size_t num);
   void PushSparseTaskConsume();
 
  private:
@@ -13,10 +13,13 @@
 // limitations under the License.
 
 #include "paddle/fluid/distributed/ps/service/brpc_ps_server.h"
+#include <map>
 #include <thread>  // NOLINT
+#include "bthread/bthread.h"
 #include "butil/object_pool.h"
 #include "paddle/fluid/distributed/common/cost_timer.h"
 #include "paddle/fluid/distributed/ps/table/depends/sparse_utils.h"
+#include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
 #include "paddle/fluid/distributed/ps/table/table.h"
 #include "paddle/fluid/framework/archive.h"
 #include "paddle/fluid/platform/profiler.h"
@@ -28,6 +31,22 @@ class RpcController;
 }  // namespace protobuf
 }  // namespace google
 
+DEFINE_int32(pserver_reshard_bandwidth_mb, 100,
+             "the MB per second a pserver streams its shards to the others "
+             "while resharding, 0 for unlimited");
+DEFINE_int32(pserver_reshard_chunk_kb, 4096,
+             "the KB of a chunk of the shards streamed while resharding");
+DEFINE_int32(pserver_reshard_wait_ms, 600000,
+             "the ms a pserver waits for the shards in flight, and for the "
+             "other pservers, while resharding");
+DEFINE_int32(pserver_hot_key_threshold, 0,
+             "the pulls of a sparse key in a window for it to be hot and "
+             "cached by the workers, 0 to disable hot key detection");
+DEFINE_int32(pserver_hot_key_window, 10000000,
+             "the sparse key pulls of a window of hot key detection");
+DEFINE_int32(pserver_hot_key_max_num, 10000,
+             "the max number of hot keys of a sparse table in a window");
+
 namespace paddle {
 namespace distributed {
 
@@ -117,6 +136,9 @@ int32_t BrpcPsService::Initialize() {
   _service_handler_map[PS_START_PROFILER] = &BrpcPsService::StartProfiler;
   _service_handler_map[PS_STOP_PROFILER] = &BrpcPsService::StopProfiler;
   _service_handler_map[PS_PUSH_GLOBAL_STEP] = &BrpcPsService::PushGlobalStep;
+  _service_handler_map[PS_RESHARD_TABLE] = &BrpcPsService::ReshardTable;
+  _service_handler_map[PS_IMPORT_SHARD] = &BrpcPsService::ImportShard;
+  _service_handler_map[PS_PULL_HOT_KEYS] = &BrpcPsService::PullHotKeys;
   auto &profiler = CostProfiler::instance();
   profiler.register_profiler("pserver_server_pull_dense");
   profiler.register_profiler("pserver_server_push_dense");
@@ -126,6 +148,15 @@ int32_t BrpcPsService::Initialize() {
   // shard初始化,server启动后才可从env获取到server_list的shard信息
   InitializeShardInfo();
 
+  if (FLAGS_pserver_hot_key_threshold > 0) {
+    for (auto &itr : *(_server->GetTable())) {
+      if (dynamic_cast<MemorySparseTable *>(itr.second.get()) != NULL) {
+        _hot_key_sketches[itr.first].reset(new HotKeySketch(
+            16, FLAGS_pserver_hot_key_threshold, FLAGS_pserver_hot_key_window,
+            FLAGS_pserver_hot_key_max_num));
+      }
+    }
+  }
   return 0;
 }
 
@@ -344,9 +375,15 @@ int32_t BrpcPsService::PushSparseParam(Table *table,
   table_context.push_context.values = values;
   table_context.push_context.is_param = true;
   table_context.num = num;
+  std::vector<size_t> unserved;
+  table_context.unserved_keys = &unserved;
   //  if (table->PushSparseParam(keys, values, num) != 0) {
   if (table->Push(table_context) != 0) {
     set_response_code(response, -1, "PushSparseParam error");
+  } else if (!unserved.empty() &&
+             ForwardPushSparse(table, request.table_id(), keys, values,
+                               std::move(unserved), true) != 0) {
+    set_response_code(response, -1, "PushSparseParam forward error");
   }
   return 0;
 }
@@ -418,14 +455,32 @@ int32_t BrpcPsService::PullSparse(Table *table, const PsRequestMessage &request,
 
   value.DeserializeFromBytes(const_cast<void *>(data));
 
+  // the pulls forwarded by another server were counted there
+  bool forwarded = request.params_size() > 1 && request.params(1) == "1";
+  auto sketch_itr = _hot_key_sketches.find(request.table_id());
+  if (sketch_itr != _hot_key_sketches.end() && !forwarded) {
+    for (uint32_t i = 0; i < num; ++i) {
+      sketch_itr->second->Add(value.feasigns_[i], value.frequencies_[i]);
+    }
+  }
+
   auto res_data = butil::get_object<std::vector<float>>();
   res_data->resize(num * dim);
+  std::vector<size_t> unserved;
   TableContext table_context;
   table_context.value_type = Sparse;
   table_context.pull_context.pull_value = value;
   table_context.pull_context.values = res_data->data();
+  table_context.unserved_keys = &unserved;
   table->Pull(table_context);
   // table->PullSparse(res_data->data(), value);
+  if (!unserved.empty() &&
+      ForwardPullSparse(table, request.table_id(), value, std::move(unserved),
+                        res_data->data()) != 0) {
+    butil::return_object(res_data);
+    set_response_code(response, -1, "PullSparse forward error");
+    return 0;
+  }
 
   cntl->response_attachment().append((char *)(res_data->data()),
                                      res_data->size() * sizeof(float));
@@ -463,12 +518,20 @@ int32_t BrpcPsService::PushSparse(Table *table, const PsRequestMessage &request,
   table_context.push_context.values =
       (const float *)(push_data.data() + sizeof(uint64_t) * num);
   table_context.num = num;
+  std::vector<size_t> unserved;
+  table_context.unserved_keys = &unserved;
   // const uint64_t *keys = (const uint64_t *)push_data.data();
   // const float *values = (const float *)(push_data.data() + sizeof(uint64_t) *
   // num);
   if (table->Push(table_context) != 0) {
     // if (table->PushSparse(keys, values, num) != 0) {
     set_response_code(response, -1, "PushSparse error");
+  } else if (!unserved.empty() &&
+             ForwardPushSparse(table, request.table_id(),
+                               table_context.push_context.keys,
+                               table_context.push_context.values,
+                               std::move(unserved)) != 0) {
+    set_response_code(response, -1, "PushSparse forward error");
   }
   return 0;
 }
@@ -660,5 +723,401 @@ int32_t BrpcPsService::PushGlobalStep(Table *table,
   return 0;
 }
 
+int32_t BrpcPsService::ReshardTable(Table *table,
+                                    const PsRequestMessage &request,
+                                    PsResponseMessage &response,
+                                    brpc::Controller *cntl) {
+  CHECK_TABLE_EXIST(table, request, response)
+  auto *sparse_table = dynamic_cast<MemorySparseTable *>(table);
+  if (sparse_table == NULL) {
+    set_response_code(response, -1, "table does not support resharding");
+    return -1;
+  }
+  if (request.params_size() < 1) {
+    set_response_code(response, -1,
+                      "PsRequestMessage.params is requeired at least 1 for "
+                      "reshard phase");
+    return -1;
+  }
+  const std::string &phase = request.params(0);
+  int32_t ret = -1;
+  if (phase == "begin") {
+    // params: begin, the old number of servers, the endpoints of the new ones
+    if (request.params_size() < 3) {
+      set_response_code(response, -1,
+                        "PsRequestMessage.params is requeired at least 3 for "
+                        "reshard begin");
+      return -1;
+    }
+    brpc::ChannelOptions options;
+    options.protocol = "baidu_std";
+    options.timeout_ms = FLAGS_pserver_reshard_wait_ms;
+    std::vector<std::shared_ptr<brpc::Channel>> channels;
+    for (int i = 2; i < request.params_size(); ++i) {
+      channels.emplace_back(new brpc::Channel());
+      if (channels.back()->Init(request.params(i).c_str(), "", &options) !=
+          0) {
+        LOG(ERROR) << "BrpcPsService connect to server " << request.params(i)
+                   << " failed";
+        set_response_code(response, -1, "connect to new server failed");
+        return -1;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> guard(_reshard_mutex);
+      _reshard_channels = channels;
+    }
+    ret = sparse_table->BeginReshard(std::stoul(request.params(1)),
+                                     channels.size());
+  } else if (phase == "migrate") {
+    ret = MigrateShards(sparse_table, request.table_id());
+  } else if (phase == "commit") {
+    ret = sparse_table->CommitReshard();
+  } else if (phase == "abort") {
+    ret = sparse_table->AbortReshard();
+  }
+  if (ret != 0) {
+    set_response_code(response, -1, ("reshard " + phase + " failed").c_str());
+    return -1;
+  }
+  return 0;
+}
+
+int32_t BrpcPsService::ImportShard(Table *table,
+                                   const PsRequestMessage &request,
+                                   PsResponseMessage &response,
+                                   brpc::Controller *cntl) {
+  CHECK_TABLE_EXIST(table, request, response)
+  auto *sparse_table = dynamic_cast<MemorySparseTable *>(table);
+  if (sparse_table == NULL) {
+    set_response_code(response, -1, "table does not support resharding");
+    return -1;
+  }
+  if (request.params_size() < 2) {
+    set_response_code(response, -1,
+                      "PsRequestMessage.params is requeired at least 2 for "
+                      "shard & last");
+    return -1;
+  }
+  if (request.params(0).size() != sizeof(uint32_t)) {
+    set_response_code(response, -1, "shard of import shard not in format");
+    return -1;
+  }
+  uint32_t shard = *(const uint32_t *)(request.params(0).c_str());
+  bool last = request.params(1) == "1";
+  std::string data = cntl->request_attachment().to_string();
+  if (sparse_table->ImportShard(shard, data.data(), data.size(), last) != 0) {
+    set_response_code(response, -1, "import shard failed");
+    return -1;
+  }
+  return 0;
+}
+
+int32_t BrpcPsService::PullHotKeys(Table *table,
+                                   const PsRequestMessage &request,
+                                   PsResponseMessage &response,
+                                   brpc::Controller *cntl) {
+  CHECK_TABLE_EXIST(table, request, response)
+  auto itr = _hot_key_sketches.find(request.table_id());
+  if (itr == _hot_key_sketches.end()) {
+    return 0;
+  }
+  // params: the number of keys in the attachment, which are the keys the
+  // cache of the worker served then their hits
+  if (request.params_size() > 0) {
+    if (request.params(0).size() != sizeof(uint32_t)) {
+      set_response_code(response, -1, "hot key hits not in format");
+      return 0;
+    }
+    uint32_t num = *(const uint32_t *)(request.params(0).c_str());
+    if (cntl->request_attachment().size() !=
+        num * (sizeof(uint64_t) + sizeof(uint32_t))) {
+      set_response_code(response, -1, "hot key hits not in format");
+      return 0;
+    }
+    std::string data = cntl->request_attachment().to_string();
+    const uint64_t *keys = reinterpret_cast<const uint64_t *>(data.data());
+    const uint32_t *hits = reinterpret_cast<const uint32_t *>(
+        data.data() + num * sizeof(uint64_t));
+    for (uint32_t i = 0; i < num; ++i) {
+      itr->second->Add(keys[i], hits[i]);
+    }
+  }
+  auto keys = itr->second->HotKeys();
+  cntl->response_attachment().append((char *)(keys.data()),  // NOLINT
+                                     keys.size() * sizeof(uint64_t));
+  return 0;
+}
+
+int32_t BrpcPsService::MigrateShards(MemorySparseTable *table,
+                                     uint32_t table_id) {
+  size_t max_bytes = FLAGS_pserver_reshard_chunk_kb * 1024L;
+  int64_t start_us = butil::gettimeofday_us();
+  int64_t sent_bytes = 0;
+  auto send_chunk = [&](size_t shard, size_t dest, const std::string &chunk,
+                        bool last) -> int32_t {
+    // wait while the bytes sent are ahead of the bandwidth
+    if (FLAGS_pserver_reshard_bandwidth_mb > 0) {
+      int64_t wait_us = start_us +
+                        sent_bytes / FLAGS_pserver_reshard_bandwidth_mb -
+                        butil::gettimeofday_us();
+      if (wait_us > 0) {
+        bthread_usleep(wait_us);
+      }
+    }
+    sent_bytes += chunk.size();
+    PsRequestMessage request;
+    request.set_cmd_id(PS_IMPORT_SHARD);
+    request.set_table_id(table_id);
+    uint32_t shard_idx = shard;
+    request.add_params((char *)&shard_idx, sizeof(uint32_t));  // NOLINT
+    request.add_params(last ? "1" : "0");
+    brpc::Controller cntl;
+    cntl.request_attachment().append(chunk);
+    return SendToServer(dest, &request, &cntl);
+  };
+
+  for (auto &item : table->OutgoingShards()) {
+    size_t shard = item.first;
+    size_t dest = item.second;
+    std::vector<std::string> chunks;
+    // Streams the buckets of the shard, and the ones changed meanwhile,
+    // until they are all sent or the pushes keep changing them.
+    size_t exported = 0;
+    while (exported < 3 * CTR_SPARSE_SHARD_BUCKET_NUM) {
+      chunks.clear();
+      int ret = table->ExportShard(shard, false, max_bytes, &chunks);
+      if (ret < 0) {
+        return -1;
+      }
+      if (ret == 0) {
+        break;
+      }
+      for (auto &chunk : chunks) {
+        if (send_chunk(shard, dest, chunk, false) != 0) {
+          return -1;
+        }
+      }
+      exported += ret;
+    }
+    // Hands off the shard with the buckets left, its keys are forwarded to
+    // the new owner since then.
+    chunks.clear();
+    if (table->ExportShard(shard, true, max_bytes, &chunks) < 0) {
+      return -1;
+    }
+    if (chunks.empty()) {
+      chunks.emplace_back();
+    }
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      if (send_chunk(shard, dest, chunks[i], i + 1 == chunks.size()) != 0) {
+        LOG(ERROR) << "BrpcPsService shard " << shard
+                   << " is handed off but not imported by server " << dest;
+        return -1;
+      }
+    }
+    VLOG(0) << "BrpcPsService shard " << shard << " of table " << table_id
+            << " moved to server " << dest;
+  }
+  return 0;
+}
+
+int32_t BrpcPsService::ForwardPullSparse(Table *table, uint32_t table_id,
+                                         const PullSparseValue &value,
+                                         std::vector<size_t> unserved,
+                                         float *values) {
+  auto dim = table->ValueAccesor()->GetAccessorInfo().select_dim;
+  // the request buffer is thread local, copied before waiting
+  std::vector<uint64_t> keys(value.feasigns_, value.feasigns_ + value.numel_);
+  std::vector<uint32_t> frequencies(value.frequencies_,
+                                    value.frequencies_ + value.numel_);
+  bool is_training = value.is_training_;
+  auto serve_local = [&](const std::vector<size_t> &offsets,
+                         std::vector<size_t> *still_unserved) -> int32_t {
+    std::vector<uint64_t> sub_keys;
+    std::vector<uint32_t> sub_frequencies;
+    for (auto offset : offsets) {
+      sub_keys.push_back(keys[offset]);
+      sub_frequencies.push_back(frequencies[offset]);
+    }
+    std::vector<float> sub_values(offsets.size() * dim);
+    std::vector<size_t> sub_unserved;
+    TableContext table_context;
+    table_context.value_type = Sparse;
+    table_context.pull_context.pull_value =
+        PullSparseValue(sub_keys, sub_frequencies, dim);
+    table_context.pull_context.pull_value.is_training_ = is_training;
+    table_context.pull_context.values = sub_values.data();
+    table_context.unserved_keys = &sub_unserved;
+    table->Pull(table_context);
+    std::vector<bool> served(offsets.size(), true);
+    for (auto i : sub_unserved) {
+      served[i] = false;
+      still_unserved->push_back(offsets[i]);
+    }
+    for (size_t i = 0; i < offsets.size(); ++i) {
+      if (served[i]) {
+        memcpy(values + offsets[i] * dim, sub_values.data() + i * dim,
+               sizeof(float) * dim);
+      }
+    }
+    return 0;
+  };
+  auto send = [&](size_t rank, const std::vector<size_t> &offsets) -> int32_t {
+    PsRequestMessage request;
+    request.set_cmd_id(PS_PULL_SPARSE_TABLE);
+    request.set_table_id(table_id);
+    uint32_t num = offsets.size();
+    request.add_params((char *)&num, sizeof(uint32_t));  // NOLINT
+    // not counted to the hot keys again by the owner
+    request.add_params("1");
+    brpc::Controller cntl;
+    auto &request_buffer = cntl.request_attachment();
+    request_buffer.append(&is_training, sizeof(bool));
+    for (auto offset : offsets) {
+      request_buffer.append(&keys[offset], sizeof(uint64_t));
+    }
+    for (auto offset : offsets) {
+      request_buffer.append(&frequencies[offset], sizeof(uint32_t));
+    }
+    if (SendToServer(rank, &request, &cntl) != 0) {
+      return -1;
+    }
+    butil::IOBufBytesIterator io_buffer_itr(cntl.response_attachment());
+    for (auto offset : offsets) {
+      if (io_buffer_itr.copy_and_forward(values + offset * dim,
+                                         sizeof(float) * dim) !=
+          sizeof(float) * dim) {
+        LOG(WARNING) << "forwarded pull sparse res data is lack";
+        return -1;
+      }
+    }
+    return 0;
+  };
+  return ServeUnservedKeys(table, keys.data(), std::move(unserved),
+                           serve_local, send);
+}
+
+int32_t BrpcPsService::ForwardPushSparse(Table *table, uint32_t table_id,
+                                         const uint64_t *keys,
+                                         const float *values,
+                                         std::vector<size_t> unserved,
+                                         bool is_param) {
+  size_t dim = table->ValueAccesor()->GetAccessorInfo().update_size /
+               sizeof(float);
+  auto serve_local = [&](const std::vector<size_t> &offsets,
+                         std::vector<size_t> *still_unserved) -> int32_t {
+    std::vector<uint64_t> sub_keys;
+    std::vector<float> sub_values;
+    for (auto offset : offsets) {
+      sub_keys.push_back(keys[offset]);
+      sub_values.insert(sub_values.end(), values + offset * dim,
+                        values + (offset + 1) * dim);
+    }
+    std::vector<size_t> sub_unserved;
+    TableContext table_context;
+    table_context.value_type = Sparse;
+    table_context.push_context.keys = sub_keys.data();
+    table_context.push_context.values = sub_values.data();
+    table_context.push_context.is_param = is_param;
+    table_context.num = sub_keys.size();
+    table_context.unserved_keys = &sub_unserved;
+    if (table->Push(table_context) != 0) {
+      return -1;
+    }
+    for (auto i : sub_unserved) {
+      still_unserved->push_back(offsets[i]);
+    }
+    return 0;
+  };
+  auto send = [&](size_t rank, const std::vector<size_t> &offsets) -> int32_t {
+    PsRequestMessage request;
+    request.set_cmd_id(is_param ? PS_PUSH_SPARSE_PARAM
+                                : PS_PUSH_SPARSE_TABLE);
+    request.set_table_id(table_id);
+    uint32_t num = offsets.size();
+    request.add_params((char *)&num, sizeof(uint32_t));  // NOLINT
+    std::string *push_data = request.mutable_data();
+    for (auto offset : offsets) {
+      push_data->append((const char *)(keys + offset),  // NOLINT
+                        sizeof(uint64_t));
+    }
+    for (auto offset : offsets) {
+      push_data->append((const char *)(values + offset * dim),  // NOLINT
+                        sizeof(float) * dim);
+    }
+    brpc::Controller cntl;
+    return SendToServer(rank, &request, &cntl);
+  };
+  return ServeUnservedKeys(table, keys, std::move(unserved), serve_local,
+                           send);
+}
+
+// The keys of the shards not imported yet by this server are served again a
+// while later, the others are sent to their owners, until all of them are
+// served or FLAGS_pserver_reshard_wait_ms passed.
+int32_t BrpcPsService::ServeUnservedKeys(
+    Table *table, const uint64_t *keys, std::vector<size_t> unserved,
+    std::function<int32_t(const std::vector<size_t> &, std::vector<size_t> *)>
+        serve_local,
+    std::function<int32_t(size_t, const std::vector<size_t> &)> send) {
+  auto *sparse_table = dynamic_cast<MemorySparseTable *>(table);
+  if (sparse_table == NULL) {
+    LOG(WARNING) << "BrpcPsService keys not served by table";
+    return -1;
+  }
+  int64_t deadline_ms =
+      butil::gettimeofday_ms() + FLAGS_pserver_reshard_wait_ms;
+  while (!unserved.empty()) {
+    std::map<size_t, std::vector<size_t>> rank_offsets;
+    for (auto offset : unserved) {
+      rank_offsets[sparse_table->ReshardOwner(keys[offset])].push_back(offset);
+    }
+    unserved.clear();
+    for (auto &item : rank_offsets) {
+      if (item.first != _rank && send(item.first, item.second) != 0) {
+        return -1;
+      }
+    }
+    auto itr = rank_offsets.find(_rank);
+    if (itr != rank_offsets.end()) {
+      if (butil::gettimeofday_ms() > deadline_ms) {
+        LOG(WARNING) << "BrpcPsService wait for the shards in flight timeout";
+        return -1;
+      }
+      bthread_usleep(1000);
+      if (serve_local(itr->second, &unserved) != 0) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+int32_t BrpcPsService::SendToServer(size_t rank, PsRequestMessage *request,
+                                    brpc::Controller *cntl) {
+  std::shared_ptr<brpc::Channel> channel;
+  {
+    std::lock_guard<std::mutex> guard(_reshard_mutex);
+    if (rank < _reshard_channels.size()) {
+      channel = _reshard_channels[rank];
+    }
+  }
+  if (channel == nullptr) {
+    LOG(WARNING) << "BrpcPsService no channel to server " << rank;
+    return -1;
+  }
+  PsResponseMessage response;
+  PsService_Stub rpc_stub(channel.get());
+  rpc_stub.service(cntl, request, &response, NULL);
+  if (cntl->Failed() || response.err_code() != 0) {
+    LOG(WARNING) << "BrpcPsService request cmd_id " << request->cmd_id()
+                 << " to server " << rank << " failed: "
+                 << (cntl->Failed() ? cntl->ErrorText() : response.err_msg());
+    return -1;
+  }
+  return 0;
+}
+
 }  // namespace distributed
 }  // namespace paddle
@@ -14,9 +14,15 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 #include "brpc/channel.h"
 #include "brpc/controller.h"
 #include "brpc/server.h"
+#include "paddle/fluid/distributed/common/hot_key_sketch.h"
 #include "paddle/fluid/distributed/ps/service/brpc_utils.h"
 #include "paddle/fluid/distributed/ps/service/server.h"
 
@@ -33,8 +39,10 @@ class RpcController;
 namespace paddle {
 namespace distributed {
 
+class MemorySparseTable;
 class PsRequestMessage;
 class PsResponseMessage;
+struct PullSparseValue;
 class Table;
 
 class BrpcPsServer : public PSServer {
@@ -123,11 +131,46 @@ class BrpcPsService : public PsBaseService {
   int32_t PushGlobalStep(Table *table, const PsRequestMessage &request,
                          PsResponseMessage &response, brpc::Controller *cntl);
 
+  int32_t ReshardTable(Table *table, const PsRequestMessage &request,
+                       PsResponseMessage &response, brpc::Controller *cntl);
+  int32_t ImportShard(Table *table, const PsRequestMessage &request,
+                      PsResponseMessage &response, brpc::Controller *cntl);
+  int32_t PullHotKeys(Table *table, const PsRequestMessage &request,
+                      PsResponseMessage &response, brpc::Controller *cntl);
+
+  // Streams the shards moving out of this server to their new owners.
+  int32_t MigrateShards(MemorySparseTable *table, uint32_t table_id);
+  // Serves the keys a sparse table left unserved while resharding, see
+  // ServeUnservedKeys.
+  int32_t ForwardPullSparse(Table *table, uint32_t table_id,
+                            const PullSparseValue &value,
+                            std::vector<size_t> unserved, float *values);
+  int32_t ForwardPushSparse(Table *table, uint32_t table_id,
+                            const uint64_t *keys, const float *values,
+                            std::vector<size_t> unserved,
+                            bool is_param = false);
+  int32_t ServeUnservedKeys(
+      Table *table, const uint64_t *keys, std::vector<size_t> unserved,
+      std::function<int32_t(const std::vector<size_t> &,
+                            std::vector<size_t> *)>
+          serve_local,
+      std::function<int32_t(size_t, const std::vector<size_t> &)> send);
+  // Sends a request to the server of rank with the servers resharded to, and
+  // waits for its response.
+  int32_t SendToServer(size_t rank, PsRequestMessage *request,
+                       brpc::Controller *cntl);
+
   bool _is_initialize_shard_info;
   std::mutex _initialize_shard_mutex;
   std::unordered_map<int32_t, serviceHandlerFunc> _service_handler_map;
   std::unordered_map<int32_t, serviceHandlerFunc> _msg_handler_map;
   std::vector<float> _ori_values;
+  std::mutex _reshard_mutex;
+  // by rank, the servers resharded to
+  std::vector<std::shared_ptr<brpc::Channel>> _reshard_channels;
+  // by table id, the keys pulled most, built on initialize
+  std::unordered_map<uint32_t, std::shared_ptr<HotKeySketch>>
+      _hot_key_sketches;
 };
 
 class DownpourPServerBrpcClosure : public PServerClosure {
@@ -218,7 +218,20 @@ int32_t CtrCommonAccessor::Merge(float** update_values,
 // second dim: field num
 int32_t CtrCommonAccessor::Update(float** update_values,
                                   const float** push_values, size_t num) {
-  auto embedx_dim = _config.embedx_dim();
+  // the embeddings of a batch are updated by a call to each rule, with the
+  // pointers kept for the pushes of a thread
+  thread_local std::vector<float*> value_ptrs;
+  thread_local std::vector<const float*> grad_ptrs;
+  thread_local std::vector<float> push_shows;
+  value_ptrs.resize(num * 4);
+  grad_ptrs.resize(num * 2);
+  push_shows.resize(num);
+  float** embed_w = value_ptrs.data();
+  float** embed_g2sum = embed_w + num;
+  float** embedx_w = embed_g2sum + num;
+  float** embedx_g2sum = embedx_w + num;
+  const float** embed_g = grad_ptrs.data();
+  const float** embedx_g = embed_g + num;
   for (size_t value_item = 0; value_item < num; ++value_item) {
     float* update_value = update_values[value_item];
     const float* push_value = push_values[value_item];
@@ -233,15 +246,20 @@ int32_t CtrCommonAccessor::Update(float** update_values,
         push_click * _config.ctr_accessor_param().click_coeff();
     update_value[common_feature_value.UnseenDaysIndex()] = 0;
     // TODO(zhaocaibei123): add configure show_scale
-    _embed_sgd_rule->UpdateValue(
-        update_value + common_feature_value.EmbedWIndex(),
-        update_value + common_feature_value.EmbedG2SumIndex(),
-        push_value + CtrCommonPushValue::EmbedGIndex(), push_show);
-    _embedx_sgd_rule->UpdateValue(
-        update_value + common_feature_value.EmbedxWIndex(),
-        update_value + common_feature_value.EmbedxG2SumIndex(),
-        push_value + CtrCommonPushValue::EmbedxGIndex(), push_show);
+    push_shows[value_item] = push_show;
+    embed_w[value_item] = update_value + common_feature_value.EmbedWIndex();
+    embed_g2sum[value_item] =
+        update_value + common_feature_value.EmbedG2SumIndex();
+    embed_g[value_item] = push_value + CtrCommonPushValue::EmbedGIndex();
+    embedx_w[value_item] = update_value + common_feature_value.EmbedxWIndex();
+    embedx_g2sum[value_item] =
+        update_value + common_feature_value.EmbedxG2SumIndex();
+    embedx_g[value_item] = push_value + CtrCommonPushValue::EmbedxGIndex();
   }
+  _embed_sgd_rule->UpdateValues(embed_w, embed_g2sum, embed_g,
+                                push_shows.data(), num);
+  _embedx_sgd_rule->UpdateValues(embedx_w, embedx_g2sum, embedx_g,
+                                 push_shows.data(), num);
   return 0;
 }
 
@@ -183,6 +183,9 @@ struct alignas(64) SparseTableShard {
     quick_erase(it);
     return 1;
   }
+
+  size_t bucket(const KEY& key) { return compute_bucket(_hasher(key)); }
+
   size_t compute_bucket(size_t hash) {
     if (CTR_SPARSE_SHARD_BUCKET_NUM == 1) {
       return 0;
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <omp.h>
+#include <algorithm>
 #include <sstream>
 
 #include "paddle/fluid/distributed/common/cost_timer.h"
@@ -30,6 +31,8 @@ namespace distributed {
 bool FLAGS_pserver_create_value_when_push = true;
 int FLAGS_pserver_table_save_max_retry = 3;
 bool FLAGS_pserver_enable_create_feasign_randomly = false;
+// the values updated in place by a call to the accessor, fitting the cache
+size_t FLAGS_pserver_sparse_update_batch_size = 512;
 
 int32_t MemorySparseTable::Initialize() {
   _shards_task_pool.resize(_task_pool_size);
@@ -46,26 +49,49 @@ int32_t MemorySparseTable::Initialize() {
 
 int32_t MemorySparseTable::InitializeValue() {
   _sparse_table_shard_num = static_cast<int>(_config.shard_num());
+  InitializeLayout();
+  _local_shards.resize(_real_local_shard_num);
+  for (auto& shard : _local_shards) {
+    shard.reset(new shard_type());
+  }
+  return 0;
+}
+
+void MemorySparseTable::InitializeLayout() {
   _avg_local_shard_num =
       sparse_local_shard_num(_sparse_table_shard_num, _shard_num);
   _real_local_shard_num = _avg_local_shard_num;
   if (_real_local_shard_num * (_shard_idx + 1) > _sparse_table_shard_num) {
     _real_local_shard_num =
-        _sparse_table_shard_num - _real_local_shard_num * _shard_idx;
-    _real_local_shard_num =
-        _real_local_shard_num < 0 ? 0 : _real_local_shard_num;
+        _sparse_table_shard_num > _real_local_shard_num * _shard_idx
+            ? _sparse_table_shard_num - _real_local_shard_num * _shard_idx
+            : 0;
   }
   VLOG(1) << "memory sparse table _avg_local_shard_num: "
           << _avg_local_shard_num
           << " _real_local_shard_num: " << _real_local_shard_num;
 
-  _local_shards.reset(new shard_type[_real_local_shard_num]);
-
-  return 0;
+  _shard_slots.resize(_sparse_table_shard_num);
+  for (size_t shard = 0; shard < _sparse_table_shard_num; ++shard) {
+    size_t shard_id = shard % _avg_local_shard_num;
+    if (shard / _avg_local_shard_num == _shard_idx) {
+      _shard_slots[shard] = shard_id;
+    } else {
+      // the keys of the other servers are served by a local shard as well,
+      // until the table is resharded and the service forwards them instead
+      _shard_slots[shard] =
+          !_resharded && shard_id < _real_local_shard_num ? shard_id : -1;
+    }
+  }
 }
 
 int32_t MemorySparseTable::Load(const std::string& path,
                                 const std::string& param) {
+  phi::AutoRDLock lock(&_reshard_lock);
+  if (_reshard_server_num != 0) {
+    LOG(WARNING) << "MemorySparseTable can not load while resharding";
+    return -1;
+  }
   std::string table_path = TableDir(path);
   auto file_list = _afs_client.list(table_path);
 
@@ -112,7 +138,7 @@ int32_t MemorySparseTable::Load(const std::string& path,
       std::string line_data;
       auto read_channel = _afs_client.open_r(channel_config, 0, &err_no);
       char* end = NULL;
-      auto& shard = _local_shards[i];
+      auto& shard = *_local_shards[i];
       try {
         while (read_channel->read_line(line_data) == 0 &&
                line_data.size() > 1) {
@@ -189,7 +215,7 @@ int32_t MemorySparseTable::LoadLocalFS(const std::string& path,
       std::string line_data;
       std::ifstream file(file_list[file_start_idx + i]);
       char* end = NULL;
-      auto& shard = _local_shards[i];
+      auto& shard = *_local_shards[i];
       try {
         while (std::getline(file, line_data) && line_data.size() > 1) {
           uint64_t key = std::strtoul(line_data.data(), &end, 10);
@@ -228,6 +254,11 @@ int32_t MemorySparseTable::LoadLocalFS(const std::string& path,
 int32_t MemorySparseTable::Save(const std::string& dirname,
                                 const std::string& param) {
   VLOG(0) << "MemorySparseTable::save dirname: " << dirname;
+  phi::AutoRDLock lock(&_reshard_lock);
+  if (_reshard_server_num != 0) {
+    LOG(WARNING) << "MemorySparseTable can not save while resharding";
+    return -1;
+  }
   int save_param =
       atoi(param.c_str());  // checkpoint:0  xbox delta:1  xbox base:2
   std::string table_path = TableDir(dirname);
@@ -258,7 +289,7 @@ int32_t MemorySparseTable::Save(const std::string& dirname,
     int feasign_size = 0;
     int retry_num = 0;
     int err_no = 0;
-    auto& shard = _local_shards[i];
+    auto& shard = *_local_shards[i];
     do {
       err_no = 0;
       feasign_size = 0;
@@ -325,7 +356,7 @@ int32_t MemorySparseTable::SaveLocalFS(const std::string& dirname,
 #pragma omp parallel for schedule(dynamic)
   for (size_t i = 0; i < _real_local_shard_num; ++i) {
     feasign_cnt = 0;
-    auto& shard = _local_shards[i];
+    auto& shard = *_local_shards[i];
     std::string file_name = paddle::string::format_string(
         "%s/part-%s-%03d-%05d", table_path.c_str(), prefix.c_str(), _shard_idx,
         file_start_idx + i);
@@ -352,7 +383,7 @@ int32_t MemorySparseTable::SaveLocalFS(const std::string& dirname,
 int64_t MemorySparseTable::LocalSize() {
   int64_t local_size = 0;
   for (size_t i = 0; i < _real_local_shard_num; ++i) {
-    local_size += _local_shards[i].size();
+    local_size += _local_shards[i]->size();
   }
   return local_size;
 }
@@ -365,7 +396,7 @@ int64_t MemorySparseTable::LocalMFSize() {
     tasks[shard_id] =
         _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
             [this, shard_id, &size_arr]() -> int {
-              auto& local_shard = _local_shards[shard_id];
+              auto& local_shard = *_local_shards[shard_id];
               for (auto it = local_shard.begin(); it != local_shard.end();
                    ++it) {
                 if (_value_accesor->HasMF(it.value().size())) {
@@ -385,6 +416,7 @@ int64_t MemorySparseTable::LocalMFSize() {
 }
 
 std::pair<int64_t, int64_t> MemorySparseTable::PrintTableStat() {
+  phi::AutoRDLock lock(&_reshard_lock);
   int64_t feasign_size = LocalSize();
   int64_t mf_size = LocalMFSize();
   return {feasign_size, mf_size};
@@ -395,11 +427,12 @@ int32_t MemorySparseTable::Pull(TableContext& context) {
   if (context.use_ptr) {
     char** pull_values = context.pull_context.ptr_values;
     const uint64_t* keys = context.pull_context.keys;
-    return PullSparsePtr(pull_values, keys, context.num);
+    return PullSparsePtr(pull_values, keys, context.num,
+                         context.unserved_keys);
   } else {
     float* pull_values = context.pull_context.values;
     const PullSparseValue& pull_value = context.pull_context.pull_value;
-    return PullSparse(pull_values, pull_value);
+    return PullSparse(pull_values, pull_value, context.unserved_keys);
   }
 }
 
@@ -407,17 +440,35 @@ int32_t MemorySparseTable::Push(TableContext& context) {
   CHECK(context.value_type == Sparse);
   if (!context.use_ptr) {
     return PushSparse(context.push_context.keys, context.push_context.values,
-                      context.num);
+                      context.num, context.unserved_keys);
   } else {
     return PushSparse(context.push_context.keys,
-                      context.push_context.ptr_values, context.num);
+                      context.push_context.ptr_values, context.num,
+                      context.unserved_keys);
+  }
+}
+
+// Waits for the tasks of the local shards, the ones of the shards not serving
+// return 1 and their keys are added to unserved.
+static void WaitShardTasks(
+    std::vector<std::future<int>>* tasks,
+    const std::vector<std::vector<std::pair<uint64_t, int>>>& task_keys,
+    std::vector<size_t>* unserved) {
+  for (size_t shard_id = 0; shard_id < tasks->size(); ++shard_id) {
+    if ((*tasks)[shard_id].get() != 0 && unserved != nullptr) {
+      for (auto& key : task_keys[shard_id]) {
+        unserved->push_back(key.second);
+      }
+    }
   }
 }
 
 int32_t MemorySparseTable::PullSparse(float* pull_values,
-                                      const PullSparseValue& pull_value) {
+                                      const PullSparseValue& pull_value,
+                                      std::vector<size_t>* unserved) {
   CostTimer timer("pserver_sparse_select_all");
-  std::vector<std::future<int>> tasks(_real_local_shard_num);
+  phi::AutoRDLock lock(&_reshard_lock);
+  std::vector<std::future<int>> tasks(_local_shards.size());
 
   const size_t value_size =
       _value_accesor->GetAccessorInfo().size / sizeof(float);
@@ -428,19 +479,26 @@ int32_t MemorySparseTable::PullSparse(float* pull_values,
   // std::atomic<uint32_t> missed_keys{0};
 
   std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(
-      _real_local_shard_num);
+      _local_shards.size());
   size_t num = pull_value.numel_;
   for (size_t i = 0; i < num; ++i) {
-    int shard_id = (pull_value.feasigns_[i] % _sparse_table_shard_num) %
-                   _avg_local_shard_num;
+    int shard_id =
+        _shard_slots[pull_value.feasigns_[i] % _sparse_table_shard_num];
+    if (shard_id < 0) {
+      if (unserved != nullptr) unserved->push_back(i);
+      continue;
+    }
     task_keys[shard_id].push_back({pull_value.feasigns_[i], i});
   }
-  for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
+  for (int shard_id = 0; shard_id < _local_shards.size(); ++shard_id) {
     tasks[shard_id] =
         _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
             [this, shard_id, &task_keys, value_size, pull_values, mf_value_size,
              select_value_size]() -> int {
-              auto& local_shard = _local_shards[shard_id];
+              if (!ShardServing(shard_id)) {
+                return 1;
+              }
+              auto& local_shard = *_local_shards[shard_id];
               float data_buffer[value_size];  // NOLINT
               float* data_buffer_ptr = data_buffer;
 
@@ -460,6 +518,7 @@ int32_t MemorySparseTable::PullSparse(float* pull_values,
                     _value_accesor->Create(&data_buffer_ptr, 1);
                     memcpy(data_ptr, data_buffer_ptr,
                            data_size * sizeof(float));
+                    MarkChanged(shard_id, key);
                   }
                 } else {
                   data_size = itr.value().size();
@@ -479,34 +538,41 @@ int32_t MemorySparseTable::PullSparse(float* pull_values,
             });
   }
 
-  for (size_t shard_id = 0; shard_id < tasks.size(); ++shard_id) {
-    tasks[shard_id].wait();
-  }
+  WaitShardTasks(&tasks, task_keys, unserved);
   return 0;
 }
 
 int32_t MemorySparseTable::PullSparsePtr(char** pull_values,
-                                         const uint64_t* keys, size_t num) {
+                                         const uint64_t* keys, size_t num,
+                                         std::vector<size_t>* unserved) {
   CostTimer timer("pscore_sparse_select_all");
+  phi::AutoRDLock lock(&_reshard_lock);
   size_t value_size = _value_accesor->GetAccessorInfo().size / sizeof(float);
   size_t mf_value_size =
       _value_accesor->GetAccessorInfo().mf_size / sizeof(float);
 
-  std::vector<std::future<int>> tasks(_real_local_shard_num);
+  std::vector<std::future<int>> tasks(_local_shards.size());
   std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(
-      _real_local_shard_num);
+      _local_shards.size());
   for (size_t i = 0; i < num; ++i) {
-    int shard_id = (keys[i] % _sparse_table_shard_num) % _avg_local_shard_num;
+    int shard_id = _shard_slots[keys[i] % _sparse_table_shard_num];
+    if (shard_id < 0) {
+      if (unserved != nullptr) unserved->push_back(i);
+      continue;
+    }
     task_keys[shard_id].push_back({keys[i], i});
   }
   // std::atomic<uint32_t> missed_keys{0};
-  for (size_t shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
+  for (size_t shard_id = 0; shard_id < _local_shards.size(); ++shard_id) {
     tasks[shard_id] =
         _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
             [this, shard_id, &task_keys, pull_values, value_size,
              mf_value_size]() -> int {
+              if (!ShardServing(shard_id)) {
+                return 1;
+              }
               auto& keys = task_keys[shard_id];
-              auto& local_shard = _local_shards[shard_id];
+              auto& local_shard = *_local_shards[shard_id];
               float data_buffer[value_size];
               float* data_buffer_ptr = data_buffer;
               for (int i = 0; i < keys.size(); ++i) {
@@ -525,26 +591,32 @@ int32_t MemorySparseTable::PullSparsePtr(char** pull_values,
                 } else {
                   ret = itr.value_ptr();
                 }
+                // the value may be updated through the pointer
+                MarkChanged(shard_id, key);
                 int pull_data_idx = keys[i].second;
                 pull_values[pull_data_idx] = (char*)ret;
               }
               return 0;
             });
   }
-  for (size_t shard_id = 0; shard_id < tasks.size(); ++shard_id) {
-    tasks[shard_id].wait();
-  }
+  WaitShardTasks(&tasks, task_keys, unserved);
   return 0;
 }
 
 int32_t MemorySparseTable::PushSparse(const uint64_t* keys, const float* values,
-                                      size_t num) {
+                                      size_t num,
+                                      std::vector<size_t>* unserved) {
   CostTimer timer("pserver_sparse_update_all");
-  std::vector<std::future<int>> tasks(_real_local_shard_num);
+  phi::AutoRDLock lock(&_reshard_lock);
+  std::vector<std::future<int>> tasks(_local_shards.size());
   std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(
-      _real_local_shard_num);
+      _local_shards.size());
   for (size_t i = 0; i < num; ++i) {
-    int shard_id = (keys[i] % _sparse_table_shard_num) % _avg_local_shard_num;
+    int shard_id = _shard_slots[keys[i] % _sparse_table_shard_num];
+    if (shard_id < 0) {
+      if (unserved != nullptr) unserved->push_back(i);
+      continue;
+    }
     task_keys[shard_id].push_back({keys[i], i});
   }
 
@@ -555,14 +627,27 @@ int32_t MemorySparseTable::PushSparse(const uint64_t* keys, const float* values,
   size_t update_value_col =
       _value_accesor->GetAccessorInfo().update_size / sizeof(float);
 
-  for (size_t shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
+  for (size_t shard_id = 0; shard_id < _local_shards.size(); ++shard_id) {
     tasks[shard_id] = _shards_task_pool[shard_id % _task_pool_size]->enqueue(
         [this, shard_id, value_col, mf_value_col, update_value_col, values,
          &task_keys]() -> int {
+          if (!ShardServing(shard_id)) {
+            return 1;
+          }
           auto& keys = task_keys[shard_id];
-          auto& local_shard = _local_shards[shard_id];
+          auto& local_shard = *_local_shards[shard_id];
           float data_buffer[value_col];  // NOLINT
           float* data_buffer_ptr = data_buffer;
+          // the values of full size are updated in place in batches, their
+          // data is not moved by the other keys of the shard
+          std::vector<float*> batch_values;
+          std::vector<const float*> batch_updates;
+          auto update_batch = [this, &batch_values, &batch_updates]() {
+            _value_accesor->Update(batch_values.data(), batch_updates.data(),
+                                   batch_values.size());
+            batch_values.clear();
+            batch_updates.clear();
+          };
           for (int i = 0; i < keys.size(); ++i) {
             uint64_t key = keys[i].first;
             uint64_t push_data_idx = keys[i].second;
@@ -582,13 +667,19 @@ int32_t MemorySparseTable::PushSparse(const uint64_t* keys, const float* values,
                      value_size * sizeof(float));
               itr = local_shard.find(key);
             }
+            MarkChanged(shard_id, key);
 
             auto& feature_value = itr.value();
             float* value_data = feature_value.data();
             size_t value_size = feature_value.size();
 
             if (value_size == value_col) {  // 已拓展到最大size, 则就地update
-              _value_accesor->Update(&value_data, &update_data, 1);
+              batch_values.push_back(value_data);
+              batch_updates.push_back(update_data);
+              if (batch_values.size() >=
+                  FLAGS_pserver_sparse_update_batch_size) {
+                update_batch();
+              }
             } else {
               // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
               memcpy(data_buffer_ptr, value_data, value_size * sizeof(float));
@@ -602,23 +693,30 @@ int32_t MemorySparseTable::PushSparse(const uint64_t* keys, const float* values,
               memcpy(value_data, data_buffer_ptr, value_size * sizeof(float));
             }
           }
+          if (!batch_values.empty()) {
+            update_batch();
+          }
           return 0;
         });
   }
 
-  for (size_t shard_id = 0; shard_id < tasks.size(); ++shard_id) {
-    tasks[shard_id].wait();
-  }
+  WaitShardTasks(&tasks, task_keys, unserved);
   return 0;
 }
 
 int32_t MemorySparseTable::PushSparse(const uint64_t* keys,
-                                      const float** values, size_t num) {
-  std::vector<std::future<int>> tasks(_real_local_shard_num);
+                                      const float** values, size_t num,
+                                      std::vector<size_t>* unserved) {
+  phi::AutoRDLock lock(&_reshard_lock);
+  std::vector<std::future<int>> tasks(_local_shards.size());
   std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(
-      _real_local_shard_num);
+      _local_shards.size());
   for (size_t i = 0; i < num; ++i) {
-    int shard_id = (keys[i] % _sparse_table_shard_num) % _avg_local_shard_num;
+    int shard_id = _shard_slots[keys[i] % _sparse_table_shard_num];
+    if (shard_id < 0) {
+      if (unserved != nullptr) unserved->push_back(i);
+      continue;
+    }
     task_keys[shard_id].push_back({keys[i], i});
   }
 
@@ -628,14 +726,27 @@ int32_t MemorySparseTable::PushSparse(const uint64_t* keys,
   size_t update_value_col =
       _value_accesor->GetAccessorInfo().update_size / sizeof(float);
 
-  for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
+  for (int shard_id = 0; shard_id < _local_shards.size(); ++shard_id) {
     tasks[shard_id] = _shards_task_pool[shard_id % _task_pool_size]->enqueue(
         [this, shard_id, value_col, mf_value_col, update_value_col, values,
          &task_keys]() -> int {
+          if (!ShardServing(shard_id)) {
+            return 1;
+          }
           auto& keys = task_keys[shard_id];
-          auto& local_shard = _local_shards[shard_id];
+          auto& local_shard = *_local_shards[shard_id];
           float data_buffer[value_col];  // NOLINT
           float* data_buffer_ptr = data_buffer;
+          // the values of full size are updated in place in batches, their
+          // data is not moved by the other keys of the shard
+          std::vector<float*> batch_values;
+          std::vector<const float*> batch_updates;
+          auto update_batch = [this, &batch_values, &batch_updates]() {
+            _value_accesor->Update(batch_values.data(), batch_updates.data(),
+                                   batch_values.size());
+            batch_values.clear();
+            batch_updates.clear();
+          };
           for (int i = 0; i < keys.size(); ++i) {
             uint64_t key = keys[i].first;
             uint64_t push_data_idx = keys[i].second;
@@ -654,11 +765,17 @@ int32_t MemorySparseTable::PushSparse(const uint64_t* keys,
                      value_size * sizeof(float));
               itr = local_shard.find(key);
             }
+            MarkChanged(shard_id, key);
             auto& feature_value = itr.value();
             float* value_data = feature_value.data();
             size_t value_size = feature_value.size();
             if (value_size == value_col) {  // 已拓展到最大size, 则就地update
-              _value_accesor->Update(&value_data, &update_data, 1);
+              batch_values.push_back(value_data);
+              batch_updates.push_back(update_data);
+              if (batch_values.size() >=
+                  FLAGS_pserver_sparse_update_batch_size) {
+                update_batch();
+              }
             } else {
               // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
               memcpy(data_buffer_ptr, value_data, value_size * sizeof(float));
@@ -671,13 +788,14 @@ int32_t MemorySparseTable::PushSparse(const uint64_t* keys,
               memcpy(value_data, data_buffer_ptr, value_size * sizeof(float));
             }
           }
+          if (!batch_values.empty()) {
+            update_batch();
+          }
           return 0;
         });
   }
 
-  for (size_t shard_id = 0; shard_id < tasks.size(); ++shard_id) {
-    tasks[shard_id].wait();
-  }
+  WaitShardTasks(&tasks, task_keys, unserved);
   return 0;
 }
 
@@ -685,10 +803,15 @@ int32_t MemorySparseTable::Flush() { return 0; }
 
 int32_t MemorySparseTable::Shrink(const std::string& param) {
   VLOG(0) << "MemorySparseTable::Shrink";
+  phi::AutoRDLock lock(&_reshard_lock);
+  if (_reshard_server_num != 0) {
+    LOG(WARNING) << "MemorySparseTable can not shrink while resharding";
+    return -1;
+  }
   // TODO(zhaocaibei123): implement with multi-thread
   for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
     // Shrink
-    auto& shard = _local_shards[shard_id];
+    auto& shard = *_local_shards[shard_id];
     for (auto it = shard.begin(); it != shard.end();) {
       if (_value_accesor->Shrink(it.value().data())) {
         it = shard.erase(it);
@@ -702,5 +825,242 @@ int32_t MemorySparseTable::Shrink(const std::string& param) {
 
 void MemorySparseTable::Clear() { VLOG(0) << "clear coming soon"; }
 
+int32_t MemorySparseTable::BeginReshard(size_t old_server_num,
+                                        size_t new_server_num) {
+  phi::AutoWRLock lock(&_reshard_lock);
+  if (_reshard_server_num != 0 || old_server_num == 0 ||
+      new_server_num == 0) {
+    LOG(WARNING) << "MemorySparseTable can not reshard from "
+                 << old_server_num << " servers to " << new_server_num
+                 << ", resharding: " << _reshard_server_num;
+    return -1;
+  }
+  if (_shard_num != old_server_num && LocalSize() != 0) {
+    LOG(WARNING) << "MemorySparseTable with " << _shard_num
+                 << " servers is not empty, can not reshard from "
+                 << old_server_num << " servers";
+    return -1;
+  }
+  // the keys of the other servers are forwarded since then
+  _resharded = true;
+  if (_shard_num != old_server_num) {
+    // a server joining, started with the new number of servers
+    _shard_num = old_server_num;
+    InitializeValue();
+  } else {
+    InitializeLayout();
+  }
+
+  size_t new_avg_shard_num =
+      sparse_local_shard_num(_sparse_table_shard_num, new_server_num);
+  _reshard_shards.resize(_local_shards.size());
+  for (size_t i = 0; i < _local_shards.size(); ++i) {
+    auto& state = _reshard_shards[i];
+    state.shard = _avg_local_shard_num * _shard_idx + i;
+    state.dest = state.shard / new_avg_shard_num;
+    if (state.dest != _shard_idx) {
+      state.outgoing = true;
+      state.exported.assign(_local_shards[i]->bucket_count(), false);
+    }
+  }
+  size_t begin = std::min(new_avg_shard_num * _shard_idx,
+                          _sparse_table_shard_num);
+  size_t end = std::min(begin + new_avg_shard_num, _sparse_table_shard_num);
+  for (size_t shard = begin; shard < end; ++shard) {
+    if (_shard_slots[shard] >= 0) {
+      continue;
+    }
+    _shard_slots[shard] = _local_shards.size();
+    _local_shards.emplace_back(new shard_type());
+    ReshardShard state;
+    state.shard = shard;
+    state.incoming = true;
+    state.serving = false;
+    _reshard_shards.push_back(state);
+  }
+  _reshard_server_num = new_server_num;
+  VLOG(0) << "MemorySparseTable begin reshard from " << old_server_num
+          << " servers to " << new_server_num << ", shard_idx: " << _shard_idx
+          << ", incoming shards: "
+          << _local_shards.size() - _real_local_shard_num;
+  return 0;
+}
+
+std::vector<std::pair<size_t, size_t>> MemorySparseTable::OutgoingShards() {
+  phi::AutoRDLock lock(&_reshard_lock);
+  std::vector<std::pair<size_t, size_t>> shards;
+  for (auto& state : _reshard_shards) {
+    if (state.outgoing) {
+      shards.push_back({state.shard, state.dest});
+    }
+  }
+  return shards;
+}
+
+int32_t MemorySparseTable::ExportShard(size_t shard, bool handoff,
+                                       size_t max_bytes,
+                                       std::vector<std::string>* chunks) {
+  phi::AutoRDLock lock(&_reshard_lock);
+  int shard_id = shard < _shard_slots.size() ? _shard_slots[shard] : -1;
+  if (_reshard_server_num == 0 || shard_id < 0 ||
+      !_reshard_shards[shard_id].outgoing) {
+    LOG(WARNING) << "MemorySparseTable shard " << shard
+                 << " is not moving out";
+    return -1;
+  }
+  auto task = _shards_task_pool[shard_id % _task_pool_size]->enqueue(
+      [this, shard_id, handoff, max_bytes, chunks]() -> int {
+        auto& state = _reshard_shards[shard_id];
+        if (!state.serving) {
+          return 0;  // handed off already
+        }
+        auto& local_shard = *_local_shards[shard_id];
+        /*
+        Export Content, of each key:
+        |---key---|---size---|---valueData---|
+        |---8B----|---4B-----|---4*{size}B---|
+        */
+        size_t bytes = 0;
+        int exported = 0;
+        std::string* chunk = nullptr;
+        for (size_t bucket = 0; bucket < state.exported.size(); ++bucket) {
+          if (state.exported[bucket]) {
+            continue;
+          }
+          if (!handoff && bytes >= max_bytes) {
+            break;
+          }
+          for (auto it = local_shard.begin(bucket);
+               it != local_shard.end(bucket); ++it) {
+            if (chunk == nullptr || chunk->size() >= max_bytes) {
+              chunks->emplace_back();
+              chunk = &chunks->back();
+            }
+            uint64_t key = it.key();
+            uint32_t size = it.value().size();
+            chunk->append(reinterpret_cast<char*>(&key), sizeof(uint64_t));
+            chunk->append(reinterpret_cast<char*>(&size), sizeof(uint32_t));
+            chunk->append(reinterpret_cast<char*>(it.value().data()),
+                          sizeof(float) * size);
+            bytes += sizeof(uint64_t) + sizeof(uint32_t) + sizeof(float) * size;
+          }
+          state.exported[bucket] = true;
+          ++exported;
+        }
+        if (handoff) {
+          state.serving = false;
+        }
+        return exported;
+      });
+  return task.get();
+}
+
+int32_t MemorySparseTable::ImportShard(size_t shard, const char* data,
+                                       size_t size, bool last) {
+  phi::AutoRDLock lock(&_reshard_lock);
+  int shard_id = shard < _shard_slots.size() ? _shard_slots[shard] : -1;
+  if (_reshard_server_num == 0 || shard_id < 0 ||
+      !_reshard_shards[shard_id].incoming) {
+    LOG(WARNING) << "MemorySparseTable shard " << shard << " is not moving in";
+    return -1;
+  }
+  auto task = _shards_task_pool[shard_id % _task_pool_size]->enqueue(
+      [this, shard_id, data, size, last]() -> int {
+        auto& state = _reshard_shards[shard_id];
+        if (state.serving) {
+          LOG(WARNING) << "MemorySparseTable shard " << state.shard
+                       << " is imported already";
+          return -1;
+        }
+        auto& local_shard = *_local_shards[shard_id];
+        const char* end = data + size;
+        const char* ptr = data;
+        while (ptr + sizeof(uint64_t) + sizeof(uint32_t) <= end) {
+          uint64_t key = 0;
+          uint32_t value_size = 0;
+          memcpy(&key, ptr, sizeof(uint64_t));
+          memcpy(&value_size, ptr + sizeof(uint64_t), sizeof(uint32_t));
+          ptr += sizeof(uint64_t) + sizeof(uint32_t);
+          if (ptr + sizeof(float) * value_size > end) {
+            break;
+          }
+          auto& value = local_shard[key];
+          value.resize(value_size);
+          memcpy(value.data(), ptr, sizeof(float) * value_size);
+          ptr += sizeof(float) * value_size;
+        }
+        if (ptr != end) {
+          LOG(WARNING) << "MemorySparseTable shard " << state.shard
+                       << " import data is not in format";
+          return -1;
+        }
+        if (last) {
+          state.serving = true;
+        }
+        return 0;
+      });
+  return task.get();
+}
+
+int32_t MemorySparseTable::CommitReshard() {
+  // the shards moved out are released out of the lock
+  std::vector<std::shared_ptr<shard_type>> old_shards;
+  phi::AutoWRLock lock(&_reshard_lock);
+  if (_reshard_server_num == 0) {
+    LOG(WARNING) << "MemorySparseTable is not resharding";
+    return -1;
+  }
+  for (auto& state : _reshard_shards) {
+    if ((state.outgoing && state.serving) ||
+        (state.incoming && !state.serving)) {
+      LOG(WARNING) << "MemorySparseTable shard " << state.shard
+                   << " has not moved, can not commit reshard";
+      return -1;
+    }
+  }
+
+  auto old_slots = _shard_slots;
+  old_shards.swap(_local_shards);
+  _shard_num = _reshard_server_num;
+  InitializeLayout();
+  _local_shards.resize(_real_local_shard_num);
+  for (size_t i = 0; i < _real_local_shard_num; ++i) {
+    size_t shard = _avg_local_shard_num * _shard_idx + i;
+    _local_shards[i] = old_shards[old_slots[shard]];
+  }
+  _reshard_shards.clear();
+  _reshard_server_num = 0;
+  VLOG(0) << "MemorySparseTable commit reshard to " << _shard_num
+          << " servers, shard_idx: " << _shard_idx;
+  return 0;
+}
+
+int32_t MemorySparseTable::AbortReshard() {
+  // the shards moved in are released out of the lock
+  std::vector<std::shared_ptr<shard_type>> incoming_shards;
+  phi::AutoWRLock lock(&_reshard_lock);
+  if (_reshard_server_num == 0) {
+    LOG(WARNING) << "MemorySparseTable is not resharding";
+    return -1;
+  }
+  // the incoming shards follow the local ones
+  incoming_shards.assign(_local_shards.begin() + _real_local_shard_num,
+                         _local_shards.end());
+  _local_shards.resize(_real_local_shard_num);
+  InitializeLayout();
+  _reshard_shards.clear();
+  _reshard_server_num = 0;
+  VLOG(0) << "MemorySparseTable abort reshard, " << _shard_num
+          << " servers, shard_idx: " << _shard_idx;
+  return 0;
+}
+
+size_t MemorySparseTable::ReshardOwner(uint64_t key) {
+  phi::AutoRDLock lock(&_reshard_lock);
+  size_t server_num =
+      _reshard_server_num != 0 ? _reshard_server_num : _shard_num;
+  return get_sparse_shard(_sparse_table_shard_num, server_num, key);
+}
+
 }  // namespace distributed
 }  // namespace paddle
@@ -28,6 +28,7 @@
 #include "paddle/fluid/distributed/ps/table/common_table.h"
 #include "paddle/fluid/distributed/ps/table/depends/feature_value.h"
 #include "paddle/fluid/string/string_helper.h"
+#include "paddle/phi/core/utils/rw_lock.h"
 
 #define PSERVER_SAVE_SUFFIX ".shard"
 
@@ -74,29 +75,96 @@ class MemorySparseTable : public Table {
   int64_t LocalMFSize();
 
   std::pair<int64_t, int64_t> PrintTableStat() override;
-  int32_t PullSparse(float* values, const PullSparseValue& pull_value);
+  // The keys not served here are left out, their offsets are added to
+  // unserved if given.
+  int32_t PullSparse(float* values, const PullSparseValue& pull_value,
+                     std::vector<size_t>* unserved = nullptr);
 
-  int32_t PullSparsePtr(char** pull_values, const uint64_t* keys, size_t num);
+  int32_t PullSparsePtr(char** pull_values, const uint64_t* keys, size_t num,
+                        std::vector<size_t>* unserved = nullptr);
 
-  int32_t PushSparse(const uint64_t* keys, const float* values, size_t num);
+  int32_t PushSparse(const uint64_t* keys, const float* values, size_t num,
+                     std::vector<size_t>* unserved = nullptr);
 
-  int32_t PushSparse(const uint64_t* keys, const float** values, size_t num);
+  int32_t PushSparse(const uint64_t* keys, const float** values, size_t num,
+                     std::vector<size_t>* unserved = nullptr);
 
   int32_t Flush() override;
   int32_t Shrink(const std::string& param) override;
   void Clear() override;
 
   void* GetShard(size_t shard_idx) override {
-    return &_local_shards[shard_idx];
+    return _local_shards[shard_idx].get();
   }
 
+  // Online resharding moves whole shards of the table to the servers owning
+  // them with another number of servers, the shard_num is unchanged and all
+  // the shards keep serving while they move:
+  //   1. BeginReshard on all the servers, the old and the new ones;
+  //   2. the old owners stream the OutgoingShards to the new owners, with
+  //      ExportShard on the old owner and ImportShard on the new one;
+  //   3. CommitReshard on all the servers once every shard has moved.
+  // The keys of a shard handed off, or not imported completely, are not
+  // served, the service forwards them to their ReshardOwner.
+  int32_t BeginReshard(size_t old_server_num, size_t new_server_num);
+  // The global shards moving out of this server, with their new owners.
+  std::vector<std::pair<size_t, size_t>> OutgoingShards();
+  // Serializes the buckets of an outgoing shard not exported yet, or changed
+  // since they were, into chunks of about max_bytes, until max_bytes are
+  // exported. With handoff all of them are, and the shard stops serving.
+  // Returns the number of the buckets exported, -1 on error.
+  int32_t ExportShard(size_t shard, bool handoff, size_t max_bytes,
+                      std::vector<std::string>* chunks);
+  // Adds a chunk exported to an incoming shard, which serves after the last.
+  int32_t ImportShard(size_t shard, const char* data, size_t size, bool last);
+  int32_t CommitReshard();
+  // Rolls back a reshard not committed, the shards handed off serve here
+  // again without the pushes their new owners took since, and the incoming
+  // ones are dropped.
+  int32_t AbortReshard();
+  // The server owning the key, with the new number of servers while
+  // resharding.
+  size_t ReshardOwner(uint64_t key);
+
  protected:
+  // The state of a local shard while resharding, only touched on the task
+  // pool of the shard.
+  struct ReshardShard {
+    size_t shard = 0;  // the global shard index
+    bool outgoing = false;
+    bool incoming = false;
+    bool serving = true;
+    size_t dest = 0;             // the new owner of an outgoing shard
+    std::vector<bool> exported;  // by bucket, of an outgoing shard
+  };
+
+  // Lays out the local shards of _shard_idx among _shard_num servers.
+  void InitializeLayout();
+  bool ShardServing(size_t shard_id) {
+    return _reshard_shards.empty() || _reshard_shards[shard_id].serving;
+  }
+  // Marks the bucket of a key changed, to export it again.
+  void MarkChanged(size_t shard_id, uint64_t key) {
+    if (!_reshard_shards.empty() && _reshard_shards[shard_id].outgoing) {
+      _reshard_shards[shard_id].exported[_local_shards[shard_id]->bucket(
+          key)] = false;
+    }
+  }
+
   const int _task_pool_size = 24;
   size_t _avg_local_shard_num;
   size_t _real_local_shard_num;
   size_t _sparse_table_shard_num;
   std::vector<std::shared_ptr<::ThreadPool>> _shards_task_pool;
-  std::unique_ptr<shard_type[]> _local_shards;
+  // the local shards, then the incoming ones while resharding
+  std::vector<std::shared_ptr<shard_type>> _local_shards;
+  // the local shard of each global shard, -1 when not served here
+  std::vector<int> _shard_slots;
+  bool _resharded = false;
+  // the new number of servers, 0 when not resharding
+  size_t _reshard_server_num = 0;
+  std::vector<ReshardShard> _reshard_shards;
+  phi::RWLock _reshard_lock;
 };
 
 }  // namespace distributed
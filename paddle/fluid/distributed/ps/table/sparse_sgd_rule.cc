@@ -15,12 +15,15 @@
 #include "paddle/fluid/distributed/ps/table/sparse_sgd_rule.h"
 #include <gflags/gflags.h>
 #include "glog/logging.h"
+#include "paddle/fluid/operators/jit/kernels.h"
 
 DEFINE_bool(enable_show_scale_gradient, true, "enable show scale gradient");
 
 namespace paddle {
 namespace distributed {
 
+namespace jit = paddle::operators::jit;
+
 void SparseNaiveSGDRule::LoadConfig(const SparseCommonSGDRuleParameter& param,
                                     size_t emb_dim) {
   _embedding_dim = emb_dim;
@@ -47,6 +50,15 @@ void SparseNaiveSGDRule::UpdateValueWork(float* w, float* sgd,
   }
 }
 
+void SparseNaiveSGDRule::UpdateValuesWork(float** w, float** sgd,
+                                          const float** push_values,
+                                          const float* scales, size_t num) {
+  for (size_t i = 0; i < num; ++i) {
+    SparseNaiveSGDRule::UpdateValueWork(w[i], sgd[i], push_values[i],
+                                        scales[i]);
+  }
+}
+
 void SparseNaiveSGDRule::InitValueWork(float* value, float* sgd,
                                        bool zero_init) {
   if (zero_init) {
@@ -99,6 +111,21 @@ void SparseAdaGradSGDRule::UpdateValueWork(float* w, float* sgd,
   g2sum += add_g2sum / _embedding_dim;
 }
 
+void SparseAdaGradSGDRule::UpdateValuesWork(float** w, float** sgd,
+                                            const float** grads,
+                                            const float* scales, size_t num) {
+  // the bounds may be changed after the config is loaded
+  const jit::sparse_adagrad_attr_t attr(_embedding_dim, false, learning_rate_,
+                                        _initial_g2sum, _min_bound,
+                                        _max_bound);
+  // looked up on the calling thread, which owns the cached kernels
+  auto update_values = jit::KernelFuncs<jit::SparseAdaGradTuple<float>,
+                                        platform::CPUPlace>::Cache()
+                           .At(attr);
+  // the g2sum is at the head of the sgd
+  update_values(w, sgd, grads, scales, num, &attr);
+}
+
 void SparseAdaGradSGDRule::InitValueWork(float* value, float* sgd,
                                          bool zero_init) {
   for (int i = 0; i < _embedding_dim; ++i) {
@@ -149,6 +176,21 @@ void StdAdaGradSGDRule::UpdateValueWork(float* w, float* sgd, const float* grad,
   }
 }
 
+void StdAdaGradSGDRule::UpdateValuesWork(float** w, float** sgd,
+                                         const float** grads,
+                                         const float* scales, size_t num) {
+  // the bounds may be changed after the config is loaded
+  const jit::sparse_adagrad_attr_t attr(_embedding_dim, true, learning_rate_,
+                                        _initial_g2sum, _min_bound,
+                                        _max_bound);
+  // looked up on the calling thread, which owns the cached kernels
+  auto update_values = jit::KernelFuncs<jit::SparseAdaGradTuple<float>,
+                                        platform::CPUPlace>::Cache()
+                           .At(attr);
+  // the g2sums are at the head of the sgd
+  update_values(w, sgd, grads, scales, num, &attr);
+}
+
 void StdAdaGradSGDRule::InitValueWork(float* value, float* sgd,
                                       bool zero_init) {
   for (int i = 0; i < _embedding_dim; ++i) {
@@ -215,6 +257,32 @@ void SparseAdamSGDRule::UpdateValueWork(float* w, float* sgd, const float* grad,
   (*beta2_pow) *= _beta2_decay_rate;
 }
 
+void SparseAdamSGDRule::UpdateValuesWork(float** w, float** sgd,
+                                         const float** grads,
+                                         const float* scales, size_t num) {
+  // looked up on the calling thread, which owns the cached kernels
+  auto adam =
+      jit::KernelFuncs<jit::AdamTuple<float>, platform::CPUPlace>::Cache().At(
+          jit::adam_attr_t(_beta1_decay_rate, _beta2_decay_rate));
+  for (size_t n = 0; n < num; ++n) {
+    float* gsum = sgd[n] + GSumIndex();
+    float* g2sum = sgd[n] + G2SumIndex();
+    float* beta1_pow = sgd[n] + Beta1PowIndex();
+    float* beta2_pow = sgd[n] + Beta2PowIndex();
+
+    float lr = learning_rate_;
+    lr *= sqrt(1 - *beta2_pow) / (1 - *beta1_pow);
+    // the kernel adds lr times the update, so it takes -lr
+    adam(_beta1_decay_rate, _beta2_decay_rate, -lr, _ada_epsilon,
+         _embedding_dim, grads[n], gsum, g2sum, w[n], gsum, g2sum, w[n]);
+    for (size_t i = 0; i < _embedding_dim; ++i) {
+      BoundValue(w[n][i]);
+    }
+    (*beta1_pow) *= _beta1_decay_rate;
+    (*beta2_pow) *= _beta2_decay_rate;
+  }
+}
+
 void SparseAdamSGDRule::InitValueWork(float* value, float* sgd,
                                       bool zero_init) {
   for (int i = 0; i < _embedding_dim; ++i) {
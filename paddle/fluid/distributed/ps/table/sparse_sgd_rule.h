@@ -35,6 +35,15 @@ class SparseValueSGDRule {
   }
   virtual void UpdateValueWork(float* w, float* sgd, const float* push_value,
                                float scale) = 0;
+  // Updates num values at once, with the rule resolved once for all of
+  // them. The rules override it with their vectorized kernels.
+  virtual void UpdateValuesWork(float** w, float** sgd,
+                                const float** push_values, const float* scales,
+                                size_t num) {
+    for (size_t i = 0; i < num; ++i) {
+      UpdateValueWork(w[i], sgd[i], push_values[i], scales[i]);
+    }
+  }
   virtual void InitValueWork(float* value, float* sgd, bool zero_init) = 0;
   virtual size_t Dim() = 0;
   const std::string& GetName() const { return _name; }
@@ -45,6 +54,10 @@ class SparseValueSGDRule {
                    float scale = 1) {
     UpdateValueWork(w, sgd, push_value, scale);
   }
+  void UpdateValues(float** w, float** sgd, const float** push_values,
+                    const float* scales, size_t num) {
+    UpdateValuesWork(w, sgd, push_values, scales, num);
+  }
   template <class T>
   void BoundValue(T& w) {  // NOLINT
     if (!(w >= _min_bound)) {
@@ -74,6 +87,9 @@ class SparseNaiveSGDRule : public SparseValueSGDRule {
                           size_t emb_dim);
   virtual void UpdateValueWork(float* w, float* sgd, const float* push_value,
                                float scale);
+  virtual void UpdateValuesWork(float** w, float** sgd,
+                                const float** push_values, const float* scales,
+                                size_t num);
   virtual void InitValueWork(float* value, float* sgd, bool zero_init);
   virtual size_t Dim() { return 0; }
 
@@ -87,6 +103,9 @@ class SparseAdaGradSGDRule : public SparseValueSGDRule {
                           size_t emb_dim);
   virtual void UpdateValueWork(float* w, float* sgd, const float* push_value,
                                float scale);
+  virtual void UpdateValuesWork(float** w, float** sgd,
+                                const float** push_values, const float* scales,
+                                size_t num);
   virtual void InitValueWork(float* value, float* sgd, bool zero_init);
   virtual size_t Dim() { return 1; }
   size_t G2SumIndex() { return 0; }
@@ -102,6 +121,9 @@ class StdAdaGradSGDRule : public SparseValueSGDRule {
                           size_t emb_dim);
   virtual void UpdateValueWork(float* w, float* sgd, const float* push_value,
                                float scale);
+  virtual void UpdateValuesWork(float** w, float** sgd,
+                                const float** push_values, const float* scales,
+                                size_t num);
   virtual void InitValueWork(float* value, float* sgd, bool zero_init);
   virtual size_t Dim() { return _embedding_dim; }
   size_t G2SumIndex() { return 0; }
@@ -117,6 +139,9 @@ class SparseAdamSGDRule : public SparseValueSGDRule {
                           size_t emb_dim);
   virtual void UpdateValueWork(float* w, float* sgd, const float* push_value,
                                float scale);
+  virtual void UpdateValuesWork(float** w, float** sgd,
+                                const float** push_values, const float* scales,
+                                size_t num);
   virtual void InitValueWork(float* value, float* sgd, bool zero_init);
   virtual size_t Dim() { return _embedding_dim * 2 + 2; }
   size_t GSumIndex() { return 0; }
@@ -0,0 +1,270 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <unistd.h>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps.pb.h"
+#include "paddle/fluid/distributed/ps/service/brpc_ps_client.h"
+#include "paddle/fluid/distributed/ps/service/brpc_ps_server.h"
+#include "paddle/fluid/distributed/ps/service/env.h"
+#include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
+#include "paddle/fluid/framework/program_desc.h"
+
+DECLARE_int32(pserver_hot_key_threshold);
+DECLARE_int32(pserver_hot_key_cache_steps);
+
+namespace distributed = paddle::distributed;
+namespace framework = paddle::framework;
+
+void GetDownpourSparseTableProto(
+    ::paddle::distributed::TableParameter* sparse_table_proto) {
+  sparse_table_proto->set_table_id(0);
+  sparse_table_proto->set_table_class("MemorySparseTable");
+  sparse_table_proto->set_shard_num(10);
+  ::paddle::distributed::TableAccessorParameter* accessor_config =
+      sparse_table_proto->mutable_accessor();
+
+  accessor_config->set_accessor_class("SparseAccessor");
+  accessor_config->set_fea_dim(10);
+  accessor_config->set_embedx_dim(9);
+  accessor_config->set_embedx_threshold(0);
+  accessor_config->mutable_ctr_accessor_param()->set_nonclk_coeff(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_click_coeff(1);
+  accessor_config->mutable_ctr_accessor_param()->set_base_threshold(0.5);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_threshold(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_keep_days(16);
+  accessor_config->mutable_ctr_accessor_param()->set_show_click_decay_rate(
+      0.99);
+
+  accessor_config->mutable_embed_sgd_param()->set_name("SparseNaiveSGDRule");
+  auto* naive_param =
+      accessor_config->mutable_embed_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(1.0);
+  naive_param->set_initial_range(0.3);
+  naive_param->add_weight_bounds(-10.0);
+  naive_param->add_weight_bounds(10.0);
+
+  accessor_config->mutable_embedx_sgd_param()->set_name("SparseNaiveSGDRule");
+  naive_param = accessor_config->mutable_embedx_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(1.0);
+  naive_param->set_initial_range(0.3);
+  naive_param->add_weight_bounds(-10.0);
+  naive_param->add_weight_bounds(10.0);
+}
+
+void GetServiceProto(::paddle::distributed::ServerParameter* server_proto) {
+  ::paddle::distributed::DownpourServerParameter* downpour_server_proto =
+      server_proto->mutable_downpour_server_param();
+  ::paddle::distributed::ServerServiceParameter* server_service_proto =
+      downpour_server_proto->mutable_service_param();
+  server_service_proto->set_service_class("BrpcPsService");
+  server_service_proto->set_server_class("BrpcPsServer");
+  server_service_proto->set_client_class("BrpcPsClient");
+  server_service_proto->set_start_server_port(0);
+  server_service_proto->set_server_thread_num(12);
+
+  ::paddle::distributed::TableParameter* sparse_table_proto =
+      downpour_server_proto->add_downpour_table_param();
+  GetDownpourSparseTableProto(sparse_table_proto);
+}
+
+::paddle::distributed::PSParameter GetServerProto() {
+  ::paddle::distributed::PSParameter server_fleet_desc;
+  GetServiceProto(server_fleet_desc.mutable_server_param());
+  return server_fleet_desc;
+}
+
+::paddle::distributed::PSParameter GetWorkerProto() {
+  ::paddle::distributed::PSParameter worker_fleet_desc;
+  ::paddle::distributed::DownpourWorkerParameter* downpour_worker_proto =
+      worker_fleet_desc.mutable_worker_param()
+          ->mutable_downpour_worker_param();
+  GetDownpourSparseTableProto(
+      downpour_worker_proto->add_downpour_table_param());
+  GetServiceProto(worker_fleet_desc.mutable_server_param());
+  return worker_fleet_desc;
+}
+
+/*-------------------------------------------------------------------------*/
+
+std::string ip_ = "127.0.0.1";
+uint32_t port_ = 4251;
+
+std::vector<std::string> host_sign_list_;
+
+std::shared_ptr<paddle::distributed::PSServer> pserver_ptr_;
+
+std::shared_ptr<paddle::distributed::PSClient> worker_ptr_;
+
+void RunServer() {
+  ::paddle::distributed::PSParameter server_proto = GetServerProto();
+
+  auto _ps_env = paddle::distributed::PaddlePSEnvironment();
+  _ps_env.SetPsServers(&host_sign_list_, 1);
+  pserver_ptr_ = std::shared_ptr<paddle::distributed::PSServer>(
+      paddle::distributed::PSServerFactory::Create(server_proto));
+  std::vector<framework::ProgramDesc> empty_vec;
+  framework::ProgramDesc empty_prog;
+  empty_vec.push_back(empty_prog);
+  pserver_ptr_->Configure(server_proto, _ps_env, 0, empty_vec);
+  pserver_ptr_->Start(ip_, port_);
+}
+
+void RunClient() {
+  ::paddle::distributed::PSParameter worker_proto = GetWorkerProto();
+  paddle::distributed::PaddlePSEnvironment _ps_env;
+  _ps_env.SetPsServers(&host_sign_list_, host_sign_list_.size());
+  std::map<uint64_t, std::vector<paddle::distributed::Region>> dense_regions;
+  dense_regions.insert(
+      std::pair<uint64_t, std::vector<paddle::distributed::Region>>(0, {}));
+  worker_ptr_ = std::shared_ptr<paddle::distributed::PSClient>(
+      paddle::distributed::PSClientFactory::Create(worker_proto));
+  worker_ptr_->Configure(worker_proto, dense_regions, _ps_env, 0);
+}
+
+size_t select_dim_ = 10;
+size_t update_dim_ = 13;
+
+// Pulls the keys through the worker, counting the step of the hot key cache.
+std::vector<float> PullSparse(std::vector<uint64_t> keys) {
+  std::vector<float> values(keys.size() * select_dim_);
+  std::vector<float*> value_ptrs;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    value_ptrs.push_back(values.data() + i * select_dim_);
+  }
+  EXPECT_EQ(worker_ptr_
+                ->PullSparse(value_ptrs.data(), 0, keys.data(), keys.size(),
+                             true)
+                .get(),
+            0);
+  return values;
+}
+
+// Pulls the keys from the table of the server, not counted as hot.
+std::vector<float> TableValues(std::vector<uint64_t> keys) {
+  auto* table = dynamic_cast<paddle::distributed::MemorySparseTable*>(
+      pserver_ptr_->GetTable(0));
+  std::vector<uint32_t> frequencies(keys.size(), 1);
+  std::vector<float> values(keys.size() * select_dim_);
+  table->PullSparse(values.data(),
+                    paddle::distributed::PullSparseValue(keys, frequencies,
+                                                         select_dim_));
+  return values;
+}
+
+void PushSparse(std::vector<uint64_t> keys) {
+  std::vector<float> grads(keys.size() * update_dim_, 1.0);
+  std::vector<const float*> grad_ptrs;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    grad_ptrs.push_back(grads.data() + i * update_dim_);
+  }
+  // the values are copied before this returns
+  worker_ptr_->PushSparse(0, keys.data(), grad_ptrs.data(), keys.size());
+}
+
+// Pushes the keys as the communicator does, waiting for the servers.
+void PushSparseRawGradient(std::vector<uint64_t> keys) {
+  std::vector<float> grads(keys.size() * update_dim_, 1.0);
+  std::vector<const float*> grad_ptrs;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    grad_ptrs.push_back(grads.data() + i * update_dim_);
+  }
+  auto* closure =
+      new paddle::distributed::DownpourBrpcClosure(1, [](void* done) {
+        auto* closure = (paddle::distributed::DownpourBrpcClosure*)done;
+        closure->set_promise_value(closure->check_response(
+            0, paddle::distributed::PS_PUSH_SPARSE_TABLE));
+      });
+  EXPECT_EQ(worker_ptr_
+                ->PushSparseRawGradient(0, keys.data(), grad_ptrs.data(),
+                                        keys.size(), closure)
+                .get(),
+            0);
+}
+
+void RunBrpcHotKey() {
+  setenv("http_proxy", "", 1);
+  setenv("https_proxy", "", 1);
+  // a key pulled twice in a window is hot, the hot keys are refreshed every
+  // 3 pulls of the worker, with the first one
+  FLAGS_pserver_hot_key_threshold = 2;
+  FLAGS_pserver_hot_key_cache_steps = 3;
+  auto ph_host = paddle::distributed::PSHost(ip_, port_, 0);
+  host_sign_list_.push_back(ph_host.SerializeToString());
+
+  std::thread server_thread(RunServer);
+  sleep(1);
+  RunClient();
+
+  // The pulls refreshing the cache pull a key of their own, so the keys of
+  // the test are counted the same whether the hot keys are pulled before or
+  // after them. Flush waits for the refresh.
+  auto refresh = [](uint64_t key) {
+    PullSparse({key});
+    worker_ptr_->Flush();
+  };
+
+  refresh(100);
+  PullSparse({0, 1, 2});
+  PullSparse({0, 1});
+
+  /*-----------------------Test Key Set Swap--------------------------------*/
+  // 0 and 1 are hot, then read through as their values are not cached yet
+  LOG(INFO) << "Run refresh with 0 and 1 hot";
+  refresh(101);
+  auto values = PullSparse({0, 1, 2});
+  ASSERT_EQ(values, TableValues({0, 1, 2}));
+
+  /*-----------------------Test Hot Key Pushes------------------------------*/
+  // the pushes of 0 are merged on the worker until the flush, whichever
+  // way they are pushed
+  LOG(INFO) << "Run push_sparse of hot keys";
+  PushSparse({0, 2});
+  PushSparseRawGradient({0, 2});
+  ASSERT_EQ(TableValues({0}),
+            std::vector<float>(values.begin(), values.begin() + select_dim_));
+  worker_ptr_->Flush();
+  auto table_values = TableValues({0, 2});
+  EXPECT_FLOAT_EQ(table_values[0], values[0] - 2.0);
+  EXPECT_FLOAT_EQ(table_values[select_dim_], values[2 * select_dim_] - 2.0);
+
+  /*-----------------------Test Cache Hits----------------------------------*/
+  // 0 is served by the cache with its value before the pushes, 2 is not hot
+  LOG(INFO) << "Run pull_sparse of hot keys cached";
+  auto cached_values = PullSparse({0, 2});
+  ASSERT_EQ(std::vector<float>(cached_values.begin(),
+                               cached_values.begin() + select_dim_),
+            std::vector<float>(values.begin(), values.begin() + select_dim_));
+  ASSERT_EQ(std::vector<float>(cached_values.begin() + select_dim_,
+                               cached_values.end()),
+            std::vector<float>(table_values.begin() + select_dim_,
+                               table_values.end()));
+
+  // the values cached are dropped when the hot keys are swapped in
+  LOG(INFO) << "Run refresh with 0, 1 and 2 hot";
+  refresh(102);
+  ASSERT_EQ(PullSparse({0}), TableValues({0}));
+
+  LOG(INFO) << "Run stop_server";
+  worker_ptr_->StopServer();
+  LOG(INFO) << "Run finalize_worker";
+  worker_ptr_->FinalizeWorker();
+  server_thread.join();
+}
+
+TEST(RunBrpcHotKey, Run) { RunBrpcHotKey(); }
@@ -0,0 +1,299 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <unistd.h>
+#include <chrono>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps.pb.h"
+#include "paddle/fluid/distributed/ps/service/brpc_ps_client.h"
+#include "paddle/fluid/distributed/ps/service/brpc_ps_server.h"
+#include "paddle/fluid/distributed/ps/service/env.h"
+#include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
+#include "paddle/fluid/framework/program_desc.h"
+
+DECLARE_int32(pserver_reshard_bandwidth_mb);
+DECLARE_int32(pserver_reshard_chunk_kb);
+
+namespace distributed = paddle::distributed;
+namespace framework = paddle::framework;
+
+void GetDownpourSparseTableProto(
+    ::paddle::distributed::TableParameter* sparse_table_proto) {
+  sparse_table_proto->set_table_id(0);
+  sparse_table_proto->set_table_class("MemorySparseTable");
+  sparse_table_proto->set_shard_num(10);
+  ::paddle::distributed::TableAccessorParameter* accessor_config =
+      sparse_table_proto->mutable_accessor();
+
+  accessor_config->set_accessor_class("SparseAccessor");
+  accessor_config->set_fea_dim(10);
+  accessor_config->set_embedx_dim(9);
+  accessor_config->set_embedx_threshold(0);
+  accessor_config->mutable_ctr_accessor_param()->set_nonclk_coeff(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_click_coeff(1);
+  accessor_config->mutable_ctr_accessor_param()->set_base_threshold(0.5);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_threshold(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_keep_days(16);
+  accessor_config->mutable_ctr_accessor_param()->set_show_click_decay_rate(
+      0.99);
+
+  accessor_config->mutable_embed_sgd_param()->set_name("SparseNaiveSGDRule");
+  auto* naive_param =
+      accessor_config->mutable_embed_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(1.0);
+  naive_param->set_initial_range(0.3);
+  naive_param->add_weight_bounds(-10.0);
+  naive_param->add_weight_bounds(10.0);
+
+  accessor_config->mutable_embedx_sgd_param()->set_name("SparseNaiveSGDRule");
+  naive_param = accessor_config->mutable_embedx_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(1.0);
+  naive_param->set_initial_range(0.3);
+  naive_param->add_weight_bounds(-10.0);
+  naive_param->add_weight_bounds(10.0);
+}
+
+void GetServiceProto(::paddle::distributed::ServerParameter* server_proto) {
+  ::paddle::distributed::DownpourServerParameter* downpour_server_proto =
+      server_proto->mutable_downpour_server_param();
+  ::paddle::distributed::ServerServiceParameter* server_service_proto =
+      downpour_server_proto->mutable_service_param();
+  server_service_proto->set_service_class("BrpcPsService");
+  server_service_proto->set_server_class("BrpcPsServer");
+  server_service_proto->set_client_class("BrpcPsClient");
+  server_service_proto->set_start_server_port(0);
+  server_service_proto->set_server_thread_num(12);
+
+  ::paddle::distributed::TableParameter* sparse_table_proto =
+      downpour_server_proto->add_downpour_table_param();
+  GetDownpourSparseTableProto(sparse_table_proto);
+}
+
+::paddle::distributed::PSParameter GetServerProto() {
+  ::paddle::distributed::PSParameter server_fleet_desc;
+  GetServiceProto(server_fleet_desc.mutable_server_param());
+  return server_fleet_desc;
+}
+
+::paddle::distributed::PSParameter GetWorkerProto() {
+  ::paddle::distributed::PSParameter worker_fleet_desc;
+  ::paddle::distributed::DownpourWorkerParameter* downpour_worker_proto =
+      worker_fleet_desc.mutable_worker_param()
+          ->mutable_downpour_worker_param();
+  GetDownpourSparseTableProto(
+      downpour_worker_proto->add_downpour_table_param());
+  GetServiceProto(worker_fleet_desc.mutable_server_param());
+  return worker_fleet_desc;
+}
+
+/*-------------------------------------------------------------------------*/
+
+std::string ip_ = "127.0.0.1";
+// the 2 servers of the workers, then the one joining, then one not started
+std::vector<uint32_t> ports_ = {4231, 4232, 4233, 4234};
+
+std::vector<std::shared_ptr<paddle::distributed::PSServer>> pserver_ptrs_(3);
+
+std::shared_ptr<paddle::distributed::PSClient> worker_ptr_;
+
+std::vector<std::string> HostSigns(size_t server_num) {
+  std::vector<std::string> host_signs;
+  for (size_t i = 0; i < server_num; ++i) {
+    host_signs.push_back(
+        paddle::distributed::PSHost(ip_, ports_[i], i).SerializeToString());
+  }
+  return host_signs;
+}
+
+std::string Endpoint(size_t rank) {
+  return ip_ + ":" + std::to_string(ports_[rank]);
+}
+
+void RunServer(size_t rank, size_t server_num) {
+  ::paddle::distributed::PSParameter server_proto = GetServerProto();
+
+  auto host_signs = HostSigns(server_num);
+  auto _ps_env = paddle::distributed::PaddlePSEnvironment();
+  _ps_env.SetPsServers(&host_signs, server_num);
+  pserver_ptrs_[rank] = std::shared_ptr<paddle::distributed::PSServer>(
+      paddle::distributed::PSServerFactory::Create(server_proto));
+  std::vector<framework::ProgramDesc> empty_vec;
+  framework::ProgramDesc empty_prog;
+  empty_vec.push_back(empty_prog);
+  pserver_ptrs_[rank]->Configure(server_proto, _ps_env, rank, empty_vec);
+  pserver_ptrs_[rank]->Start(ip_, ports_[rank]);
+}
+
+void RunClient() {
+  ::paddle::distributed::PSParameter worker_proto = GetWorkerProto();
+  auto host_signs = HostSigns(2);
+  paddle::distributed::PaddlePSEnvironment _ps_env;
+  _ps_env.SetPsServers(&host_signs, host_signs.size());
+  std::map<uint64_t, std::vector<paddle::distributed::Region>> dense_regions;
+  dense_regions.insert(
+      std::pair<uint64_t, std::vector<paddle::distributed::Region>>(0, {}));
+  worker_ptr_ = std::shared_ptr<paddle::distributed::PSClient>(
+      paddle::distributed::PSClientFactory::Create(worker_proto));
+  worker_ptr_->Configure(worker_proto, dense_regions, _ps_env, 0);
+}
+
+int64_t LocalSize(size_t rank) {
+  auto* table = dynamic_cast<paddle::distributed::MemorySparseTable*>(
+      pserver_ptrs_[rank]->GetTable(0));
+  return table->LocalSize();
+}
+
+void RunBrpcReshard() {
+  setenv("http_proxy", "", 1);
+  setenv("https_proxy", "", 1);
+
+  // 2 servers, resharded to 3
+  std::vector<std::thread> server_threads;
+  for (size_t i = 0; i < 3; ++i) {
+    server_threads.emplace_back(RunServer, i, i < 2 ? 2 : 3);
+  }
+  sleep(1);
+  RunClient();
+  auto* client = dynamic_cast<paddle::distributed::BrpcPsClient*>(
+      worker_ptr_.get());
+  ASSERT_NE(client, nullptr);
+
+  size_t key_num = 10000;
+  size_t select_dim = 10;
+  size_t update_dim = 13;
+  std::vector<uint64_t> keys(key_num);
+  std::vector<float> values(key_num * select_dim);
+  std::vector<float> expect_values(key_num * select_dim);
+  std::vector<float*> value_ptrs(key_num);
+  std::vector<float*> expect_value_ptrs(key_num);
+  std::vector<float> grads(key_num * update_dim, 1.0);
+  std::vector<const float*> grad_ptrs(key_num);
+  for (size_t i = 0; i < key_num; ++i) {
+    keys[i] = i;
+    value_ptrs[i] = values.data() + i * select_dim;
+    expect_value_ptrs[i] = expect_values.data() + i * select_dim;
+    grad_ptrs[i] = grads.data() + i * update_dim;
+  }
+  auto push_closure = [](int cmd_id) {
+    return new paddle::distributed::DownpourBrpcClosure(
+        2, [cmd_id](void* done) {
+          int ret = 0;
+          auto* closure = (paddle::distributed::DownpourBrpcClosure*)done;
+          for (size_t i = 0; i < 2; ++i) {
+            if (closure->check_response(i, cmd_id) != 0) {
+              ret = -1;
+              break;
+            }
+          }
+          closure->set_promise_value(ret);
+        });
+  };
+
+  // create the keys, then expand their embedx
+  ASSERT_EQ(
+      client->PullSparse(value_ptrs.data(), 0, keys.data(), key_num, true)
+          .get(),
+      0);
+  ASSERT_EQ(client
+                ->PushSparseRawGradient(
+                    0, keys.data(), grad_ptrs.data(), key_num,
+                    push_closure(paddle::distributed::PS_PUSH_SPARSE_TABLE))
+                .get(),
+            0);
+  ASSERT_EQ(client
+                ->PullSparse(expect_value_ptrs.data(), 0, keys.data(),
+                             key_num, true)
+                .get(),
+            0);
+  ASSERT_EQ(LocalSize(0), 5000);
+  ASSERT_EQ(LocalSize(1), 5000);
+
+  /*-----------------------Test Reshard Abort-------------------------------*/
+  // the server of the last endpoint is not started, so the servers begun are
+  // rolled back
+  LOG(INFO) << "Run reshard to a server not started";
+  ASSERT_NE(client->Reshard(0, {Endpoint(0), Endpoint(1), Endpoint(3)}).get(),
+            0);
+  ASSERT_EQ(
+      client->PullSparse(value_ptrs.data(), 0, keys.data(), key_num, true)
+          .get(),
+      0);
+  ASSERT_EQ(values, expect_values);
+  ASSERT_EQ(LocalSize(0), 5000);
+  ASSERT_EQ(LocalSize(1), 5000);
+
+  /*-----------------------Test Reshard-------------------------------------*/
+  // shard 4 moves to server 1, shards 8 and 9 to server 2, streamed in chunks
+  // of 1KB at 1MB per second
+  LOG(INFO) << "Run reshard";
+  FLAGS_pserver_reshard_bandwidth_mb = 1;
+  FLAGS_pserver_reshard_chunk_kb = 1;
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(client->Reshard(0, {Endpoint(0), Endpoint(1), Endpoint(2)}).get(),
+            0);
+  auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  ASSERT_EQ(LocalSize(0), 4000);
+  ASSERT_EQ(LocalSize(1), 4000);
+  ASSERT_EQ(LocalSize(2), 2000);
+  // server 1 sends the 2000 keys of shards 8 and 9, of their values without
+  // embedx at least, waiting for all the bytes but the last chunk
+  auto info =
+      pserver_ptrs_[1]->GetTable(0)->ValueAccesor()->GetAccessorInfo();
+  int64_t sent_bytes = 2000 * (sizeof(uint64_t) + sizeof(uint32_t) +
+                               info.size - info.mf_size);
+  EXPECT_GE(elapsed_us, sent_bytes - 2 * 1024);
+
+  /*-----------------------Test Forward-------------------------------------*/
+  // the workers keep sending to the 2 servers, which forward the keys moved
+  // out
+  LOG(INFO) << "Run pull_sparse forwarded";
+  ASSERT_EQ(
+      client->PullSparse(value_ptrs.data(), 0, keys.data(), key_num, true)
+          .get(),
+      0);
+  ASSERT_EQ(values, expect_values);
+
+  LOG(INFO) << "Run push_sparse_param forwarded";
+  ASSERT_EQ(client
+                ->PushSparseParam(
+                    0, keys.data(), grad_ptrs.data(), key_num,
+                    push_closure(paddle::distributed::PS_PUSH_SPARSE_PARAM))
+                .get(),
+            0);
+  ASSERT_EQ(
+      client->PullSparse(value_ptrs.data(), 0, keys.data(), key_num, true)
+          .get(),
+      0);
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_FLOAT_EQ(values[i], expect_values[i] - 1.0);
+  }
+  ASSERT_EQ(LocalSize(2), 2000);
+
+  LOG(INFO) << "Run stop_server";
+  worker_ptr_->StopServer();
+  pserver_ptrs_[2]->Stop();
+  LOG(INFO) << "Run finalize_worker";
+  worker_ptr_->FinalizeWorker();
+  for (auto& t : server_threads) {
+    t.join();
+  }
+}
+
+TEST(RunBrpcReshard, Run) { RunBrpcReshard(); }
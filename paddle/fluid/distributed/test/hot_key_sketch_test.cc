@@ -0,0 +1,59 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/common/hot_key_sketch.h"
+#include <algorithm>
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace distributed {
+
+TEST(HotKeySketch, DetectAndDecay) {
+  HotKeySketch sketch(16, 100, 100000, 10);
+  // keys 0 and 1 are hot, pulled 2000 times each among 20000 cold keys
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&sketch, t]() {
+      for (uint64_t key = 1000 + t; key < 21000; key += 4) {
+        sketch.Add(key, 1);
+        if (key % 100 < 2) {
+          sketch.Add(key % 100, 10);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto keys = sketch.HotKeys();
+  ASSERT_EQ(keys.size(), 2UL);
+  std::sort(keys.begin(), keys.end());
+  EXPECT_EQ(keys[0], 0UL);
+  EXPECT_EQ(keys[1], 1UL);
+
+  // a window later the keys are still reported, two windows later not
+  for (uint64_t key = 100000; key < 180000; ++key) {
+    sketch.Add(key, 1);
+  }
+  EXPECT_EQ(sketch.HotKeys().size(), 2UL);
+  for (uint64_t key = 200000; key < 300000; ++key) {
+    sketch.Add(key, 1);
+  }
+  EXPECT_EQ(sketch.HotKeys().size(), 0UL);
+}
+
+}  // namespace distributed
+}  // namespace paddle
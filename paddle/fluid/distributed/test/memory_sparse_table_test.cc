@@ -15,8 +15,11 @@ limitations under the License. */
 #include <ThreadPool.h>
 
 #include <unistd.h>
+#include <algorithm>
+#include <map>
 #include <string>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
@@ -154,5 +157,205 @@ TEST(MemorySparseTable, SGD) {
   ctr_table->SaveLocalFS("./work/table.save", "0", "test");
 }
 
+// The table of a server of server_num ones, with the accessor of the SGD test.
+static MemorySparseTable *CreateReshardTable(size_t shard_idx,
+                                             size_t server_num) {
+  TableParameter table_config;
+  table_config.set_table_class("MemorySparseTable");
+  table_config.set_shard_num(10);
+  FsClientParameter fs_config;
+  Table *table = new MemorySparseTable();
+  table->SetShard(shard_idx, server_num);
+
+  TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CtrCommonAccessor");
+  accessor_config->set_fea_dim(11);
+  accessor_config->set_embedx_dim(8);
+  accessor_config->set_embedx_threshold(5);
+  accessor_config->mutable_embed_sgd_param()->set_name("SparseNaiveSGDRule");
+  auto *naive_param =
+      accessor_config->mutable_embed_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(0.1);
+  naive_param->set_initial_range(0.3);
+  naive_param->add_weight_bounds(-10.0);
+  naive_param->add_weight_bounds(10.0);
+  accessor_config->mutable_embedx_sgd_param()->set_name("SparseNaiveSGDRule");
+  naive_param = accessor_config->mutable_embedx_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(0.1);
+  naive_param->set_initial_range(0.3);
+  naive_param->add_weight_bounds(-10.0);
+  naive_param->add_weight_bounds(10.0);
+
+  EXPECT_EQ(table->Initialize(table_config, fs_config), 0);
+  return dynamic_cast<MemorySparseTable *>(table);
+}
+
+TEST(MemorySparseTable, Reshard) {
+  int emb_dim = 8;
+  size_t select_dim = emb_dim + 3;
+  size_t update_dim = emb_dim + 4;
+  // 2 servers resharded to 3, the third one joining
+  std::vector<std::unique_ptr<MemorySparseTable>> tables;
+  for (size_t i = 0; i < 3; ++i) {
+    tables.emplace_back(CreateReshardTable(i, i < 2 ? 2 : 3));
+  }
+  std::vector<uint64_t> keys;
+  for (uint64_t key = 0; key < 100; ++key) {
+    keys.push_back(key);
+  }
+
+  auto push = [&](MemorySparseTable *table, std::vector<uint64_t> push_keys) {
+    std::vector<float> push_values;
+    for (auto key : push_keys) {
+      for (size_t j = 0; j < update_dim; ++j) {
+        push_values.push_back(0.01 * key + 0.1 * j);
+      }
+    }
+    std::vector<size_t> unserved;
+    TableContext context;
+    context.value_type = Sparse;
+    context.push_context.keys = push_keys.data();
+    context.push_context.values = push_values.data();
+    context.num = push_keys.size();
+    context.unserved_keys = &unserved;
+    table->Push(context);
+    return unserved;
+  };
+  auto pull = [&](MemorySparseTable *table, std::vector<uint64_t> pull_keys,
+                  std::vector<float> *values) {
+    std::vector<uint32_t> frequencies(pull_keys.size(), 1);
+    values->resize(pull_keys.size() * select_dim);
+    std::vector<size_t> unserved;
+    TableContext context;
+    context.value_type = Sparse;
+    context.pull_context.pull_value =
+        PullSparseValue(pull_keys, frequencies, emb_dim);
+    context.pull_context.values = values->data();
+    context.unserved_keys = &unserved;
+    table->Pull(context);
+    return unserved;
+  };
+  // the keys of each server with server_num servers
+  auto split = [&](size_t server_num) {
+    std::vector<std::vector<uint64_t>> server_keys(3);
+    for (auto key : keys) {
+      server_keys[MemorySparseTable::get_sparse_shard(10, server_num, key)]
+          .push_back(key);
+    }
+    return server_keys;
+  };
+  auto old_keys = split(2);
+  auto new_keys = split(3);
+  std::vector<float> values;
+  for (size_t i = 0; i < 2; ++i) {
+    ASSERT_TRUE(push(tables[i].get(), old_keys[i]).empty());
+    // the keys of the other server are served too before resharding
+    ASSERT_TRUE(pull(tables[i].get(), old_keys[1 - i], &values).empty());
+  }
+
+  // an aborted reshard leaves the servers as they were, even with the shards
+  // handed off already
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_EQ(tables[i]->BeginReshard(2, 3), 0);
+  }
+  for (auto &item : tables[0]->OutgoingShards()) {
+    std::vector<std::string> chunks;
+    ASSERT_GE(tables[0]->ExportShard(item.first, true, 64, &chunks), 0);
+    chunks.emplace_back();
+    for (size_t j = 0; j < chunks.size(); ++j) {
+      ASSERT_EQ(tables[item.second]->ImportShard(item.first, chunks[j].data(),
+                                                 chunks[j].size(),
+                                                 j + 1 == chunks.size()),
+                0);
+    }
+  }
+  ASSERT_FALSE(pull(tables[0].get(), old_keys[0], &values).empty());
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_EQ(tables[i]->AbortReshard(), 0);
+  }
+  ASSERT_NE(tables[0]->AbortReshard(), 0);
+  for (size_t i = 0; i < 2; ++i) {
+    ASSERT_TRUE(pull(tables[i].get(), old_keys[i], &values).empty());
+  }
+  ASSERT_EQ(tables[2]->LocalSize(), 0);
+
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_EQ(tables[i]->BeginReshard(2, 3), 0);
+  }
+  // the keys of the other servers are not served since then, nor the ones of
+  // the shards not imported yet
+  ASSERT_EQ(push(tables[0].get(), old_keys[1]).size(), old_keys[1].size());
+  ASSERT_EQ(pull(tables[2].get(), new_keys[2], &values).size(),
+            new_keys[2].size());
+
+  // stream the shards, then push to them again before the handoff
+  size_t max_bytes = 64;
+  for (size_t i = 0; i < 2; ++i) {
+    for (auto &item : tables[i]->OutgoingShards()) {
+      ASSERT_EQ(item.second, MemorySparseTable::get_sparse_shard(
+                                 10, 3, item.first));
+      std::vector<std::string> chunks;
+      while (tables[i]->ExportShard(item.first, false, max_bytes, &chunks) >
+             0) {
+      }
+      ASSERT_GT(chunks.size(), 1UL);
+      for (auto &chunk : chunks) {
+        ASSERT_EQ(tables[item.second]->ImportShard(
+                      item.first, chunk.data(), chunk.size(), false),
+                  0);
+      }
+    }
+  }
+  std::vector<std::vector<float>> expect_values(3);
+  for (size_t i = 0; i < 2; ++i) {
+    ASSERT_TRUE(push(tables[i].get(), old_keys[i]).empty());
+    ASSERT_TRUE(pull(tables[i].get(), old_keys[i], &expect_values[i]).empty());
+  }
+  ASSERT_NE(tables[0]->CommitReshard(), 0);
+
+  for (size_t i = 0; i < 2; ++i) {
+    for (auto &item : tables[i]->OutgoingShards()) {
+      std::vector<std::string> chunks;
+      ASSERT_GE(tables[i]->ExportShard(item.first, true, max_bytes, &chunks),
+                0);
+      chunks.emplace_back();
+      for (size_t j = 0; j < chunks.size(); ++j) {
+        ASSERT_EQ(tables[item.second]->ImportShard(
+                      item.first, chunks[j].data(), chunks[j].size(),
+                      j + 1 == chunks.size()),
+                  0);
+      }
+    }
+    // the keys moved out are left to their new owners
+    auto unserved = pull(tables[i].get(), old_keys[i], &values);
+    for (size_t j = 0; j < old_keys[i].size(); ++j) {
+      bool moved = tables[i]->ReshardOwner(old_keys[i][j]) != i;
+      ASSERT_EQ(std::count(unserved.begin(), unserved.end(), j), moved);
+    }
+  }
+
+  std::map<uint64_t, std::vector<float>> expect;
+  for (size_t i = 0; i < 2; ++i) {
+    for (size_t j = 0; j < old_keys[i].size(); ++j) {
+      expect[old_keys[i][j]].assign(
+          expect_values[i].begin() + j * select_dim,
+          expect_values[i].begin() + (j + 1) * select_dim);
+    }
+  }
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_EQ(tables[i]->CommitReshard(), 0);
+  }
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_TRUE(pull(tables[i].get(), new_keys[i], &values).empty());
+    for (size_t j = 0; j < new_keys[i].size(); ++j) {
+      std::vector<float> value(values.begin() + j * select_dim,
+                               values.begin() + (j + 1) * select_dim);
+      ASSERT_EQ(value, expect[new_keys[i][j]]);
+    }
+    ASSERT_EQ(tables[i]->LocalSize(),
+              static_cast<int64_t>(new_keys[i].size()));
+  }
+}
+
 }  // namespace distributed
 }  // namespace paddle
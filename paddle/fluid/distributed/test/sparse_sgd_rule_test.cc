@@ -15,6 +15,8 @@ limitations under the License. */
 #include "paddle/fluid/distributed/ps/table/sparse_sgd_rule.h"
 #include <cmath>
 #include <iostream>
+#include <thread>  // NOLINT
+#include <vector>
 #include "gtest/gtest.h"
 #include "paddle/fluid/distributed/ps.pb.h"
 
@@ -187,5 +189,76 @@ TEST(downpour_sparse_adam_test, test_init_and_update) {
     ASSERT_FLOAT_EQ(value[i], label[i]) << "i is " << i;
   }
 }
+
+// the batched updates match the updates of the values one by one
+void CheckUpdateValues(SparseValueSGDRule* rule, size_t embed_dim) {
+  const size_t kItemNum = 3;
+  const size_t value_dim = embed_dim + rule->Dim();
+  std::vector<float> values(kItemNum * value_dim);
+  std::vector<float> grads(kItemNum * embed_dim);
+  std::vector<float> scales = {1.0, 2.0, 3.0};
+  for (size_t n = 0; n < kItemNum; ++n) {
+    rule->InitValue(&values[n * value_dim], &values[n * value_dim + embed_dim],
+                    false);
+  }
+  for (size_t i = 0; i < grads.size(); ++i) {
+    grads[i] = (i % 7) * 0.5 - 1.5;
+  }
+  std::vector<float> batch_values(values);
+
+  std::vector<float*> w, sgd;
+  std::vector<const float*> push_values;
+  for (size_t n = 0; n < kItemNum; ++n) {
+    rule->UpdateValue(&values[n * value_dim],
+                      &values[n * value_dim + embed_dim],
+                      &grads[n * embed_dim], scales[n]);
+    w.push_back(&batch_values[n * value_dim]);
+    sgd.push_back(&batch_values[n * value_dim + embed_dim]);
+    push_values.push_back(&grads[n * embed_dim]);
+  }
+  rule->UpdateValues(w.data(), sgd.data(), push_values.data(), scales.data(),
+                     kItemNum);
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_NEAR(batch_values[i], values[i], 1e-5) << "i is " << i;
+  }
+}
+
+TEST(sparse_value_sgd_test, update_values) {
+  const size_t embed_dim = 10;
+  SparseCommonSGDRuleParameter param;
+  auto* naive_param = param.mutable_naive();
+  naive_param->set_learning_rate(0.1);
+  naive_param->set_initial_range(0.3);
+  auto* adagrad_param = param.mutable_adagrad();
+  adagrad_param->set_learning_rate(0.1);
+  adagrad_param->set_initial_g2sum(0.2);
+  adagrad_param->set_initial_range(0.3);
+  adagrad_param->add_weight_bounds(-0.5);
+  adagrad_param->add_weight_bounds(0.5);
+  auto* adam_param = param.mutable_adam();
+  adam_param->set_learning_rate(0.1);
+  adam_param->set_initial_range(0.3);
+  adam_param->set_beta1_decay_rate(0.9);
+  adam_param->set_beta2_decay_rate(0.999);
+  adam_param->set_ada_epsilon(1e-08);
+
+  SparseNaiveSGDRule naive_rule;
+  SparseAdaGradSGDRule adagrad_rule;
+  StdAdaGradSGDRule std_adagrad_rule;
+  SparseAdamSGDRule adam_rule;
+  // Like a table, loaded by a thread other than the updating ones, which
+  // exits before they update.
+  std::thread load_thread([&] {
+    naive_rule.LoadConfig(param, embed_dim);
+    adagrad_rule.LoadConfig(param, embed_dim);
+    std_adagrad_rule.LoadConfig(param, embed_dim);
+    adam_rule.LoadConfig(param, embed_dim);
+  });
+  load_thread.join();
+  CheckUpdateValues(&naive_rule, embed_dim);
+  CheckUpdateValues(&adagrad_rule, embed_dim);
+  CheckUpdateValues(&std_adagrad_rule, embed_dim);
+  CheckUpdateValues(&adam_rule, embed_dim);
+}
 }  // namespace distributed
 }  // namespace paddle
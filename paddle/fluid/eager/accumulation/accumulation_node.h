@@ -45,6 +45,10 @@ class GradNodeAccumulation : public GradNodeBase {
 
   std::string name() { return "GradNodeAccumulation"; }
 
+  bool CanRunOnAnyThread() override {
+    return GradNodeBase::CanRunOnAnyThread() && !ReduceHooksRegistered();
+  }
+
   /**
    * Register ReduceHook
    * **/
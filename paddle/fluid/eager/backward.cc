@@ -13,8 +13,16 @@
 // limitations under the License.
 
 #include "paddle/fluid/eager/backward.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <exception>
+#include <mutex>  // NOLINT
 #include <queue>
+#include <tuple>
 
+#include "paddle/fluid/eager/api/utils/global_utils.h"
 #include "paddle/fluid/eager/autograd_meta.h"
 #include "paddle/fluid/eager/grad_node_info.h"
 #include "paddle/fluid/eager/grad_tensor_holder.h"
@@ -25,7 +33,12 @@
 #include "paddle/fluid/platform/enforce.h"
 #include "paddle/fluid/platform/errors.h"
 
+#include "gflags/gflags.h"
 #include "glog/logging.h"
+#include "paddle/fluid/framework/new_executor/workqueue/workqueue.h"
+
+DECLARE_int32(eager_backward_num_threads);
+DECLARE_bool(eager_backward_deterministic);
 
 namespace egr {
 
@@ -518,6 +531,258 @@ void DuplicateCheck(const std::vector<paddle::experimental::Tensor>& inputs,
 
 GeneralGrad* GeneralGrad::general_grad_ = new GeneralGrad();
 
+std::shared_ptr<paddle::framework::WorkQueue> BackwardThreadPool(
+    size_t num_threads) {
+  static std::mutex mutex;
+  static auto* pool = new std::shared_ptr<paddle::framework::WorkQueue>();
+  std::lock_guard<std::mutex> guard(mutex);
+  if (!*pool || (*pool)->NumThreads() != num_threads) {
+    *pool = paddle::framework::CreateMultiThreadedWorkQueue(
+        paddle::framework::WorkQueueOptions(
+            /*name*/ "EagerBackward", /*num_threads*/ num_threads,
+            /*allow_spinning*/ true, /*track_task*/ false));
+  }
+  return *pool;
+}
+
+/*
+ * ParallelBackward runs the nodes of a backward graph on the backward thread
+ * pool as soon as their grads are ready, so that the independent branches of
+ * the graph run at the same time. Each node counts its producers not done
+ * yet, the last one to send it a grad schedules it. The nodes which can not
+ * run on any thread run on the calling thread, which waits for the others.
+ *
+ * The grads sent to a node are summed in the order they come, under the lock
+ * of their slot. With FLAGS_eager_backward_deterministic, they are kept until
+ * the node is ready and summed in the order their producers are found from
+ * the start nodes, so that every run gives the same sums.
+ * **/
+class ParallelBackward {
+ public:
+  ParallelBackward(const std::vector<GradNodeBase*>& start_nodes,
+                   const std::unordered_map<GradNodeBase*, int>& in_degrees,
+                   std::unordered_map<GradNodeBase*,
+                                      std::unique_ptr<GradTensorHolder>>*
+                       input_buffers,
+                   bool retain_graph, size_t num_threads)
+      : start_nodes_(start_nodes),
+        retain_graph_(retain_graph),
+        deterministic_(FLAGS_eager_backward_deterministic),
+        pool_(BackwardThreadPool(num_threads)) {
+    auto& controller = Controller::Instance();
+    if (controller.GetCurrentTracer()) {
+      has_grad_ = controller.HasGrad();
+      amp_level_ = controller.GetAMPLevel();
+    }
+
+    // Visits the nodes in the order of getInDegreeMap, numbering them.
+    std::queue<GradNodeBase*> queue;
+    for (auto* node : start_nodes_) queue.push(node);
+    while (!queue.empty()) {
+      GradNodeBase* node = queue.front();
+      queue.pop();
+      if (states_.count(node)) continue;
+      auto& state = states_[node];
+      state.reset(new NodeState());
+      state->order = states_.size();
+      auto iter = in_degrees.find(node);
+      state->in_degree = iter == in_degrees.end() ? 0 : iter->second;
+      auto buffer = input_buffers->find(node);
+      if (buffer != input_buffers->end() && buffer->second) {
+        state->buffer = std::move(buffer->second);
+      } else {
+        state->buffer.reset(new GradTensorHolder(node->InputMeta()));
+      }
+      state->slot_mutexes.resize(node->InputMeta().size());
+      for (auto& mutex : state->slot_mutexes) mutex.reset(new std::mutex());
+
+      for (const auto& edge_list : node->GetEdges()) {
+        for (const Edge& edge : edge_list) {
+          GradNodeBase* next_node = edge.GetMutableGradNode().get();
+          if (next_node) queue.push(next_node);
+        }
+      }
+    }
+    input_buffers->clear();
+  }
+
+  void Run() {
+    std::vector<GradNodeBase*> ready;
+    for (auto* node : start_nodes_) {
+      if (states_.at(node)->in_degree == 0 &&
+          std::find(ready.begin(), ready.end(), node) == ready.end()) {
+        ready.push_back(node);
+      }
+    }
+    for (auto* node : ready) Schedule(node);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this] {
+        return !caller_nodes_.empty() || num_running_ == 0;
+      });
+      if (caller_nodes_.empty()) break;
+      GradNodeBase* node = caller_nodes_.front();
+      caller_nodes_.pop_front();
+      lock.unlock();
+      RunNode(node);
+      lock.lock();
+    }
+    if (error_) std::rethrow_exception(error_);
+  }
+
+ private:
+  // A grad kept for a node, from the slot, rank of a producer.
+  struct KeptGrad {
+    size_t producer;
+    size_t slot;
+    size_t rank;
+    std::pair<size_t, size_t> edge_rank;
+    paddle::experimental::Tensor grad;
+  };
+
+  struct NodeState {
+    size_t order;
+    std::atomic<int> in_degree;
+    std::unique_ptr<GradTensorHolder> buffer;
+    std::vector<std::unique_ptr<std::mutex>> slot_mutexes;
+    // Guards the kept grads, and the slots of buffer out of slot_mutexes.
+    std::mutex mutex;
+    std::vector<KeptGrad> kept_grads;
+  };
+
+  void Schedule(GradNodeBase* node) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    ++num_running_;
+    if (!node->CanRunOnAnyThread()) {
+      caller_nodes_.push_back(node);
+      cv_.notify_all();
+      return;
+    }
+    pool_->AddTask([this, node] {
+      auto& controller = Controller::Instance();
+      if (controller.GetCurrentTracer()) {
+        controller.SetHasGrad(has_grad_);
+        controller.SetAMPLevel(amp_level_);
+      }
+      RunNode(node);
+    });
+  }
+
+  void RunNode(GradNodeBase* node) {
+    if (!failed_) {
+      try {
+        Execute(node);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!error_) error_ = std::current_exception();
+        failed_ = true;
+      }
+    }
+    // Notifies under the lock, the caller may return once it is released.
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (--num_running_ == 0) cv_.notify_all();
+  }
+
+  void Execute(GradNodeBase* node) {
+    VLOG(6) << "Running GradNode:" << node->name();
+    paddle::platform::RecordEvent node_record_event(
+        std::string(typeid(*node).name()) + " grad_node",
+        paddle::platform::TracerEventType::Operator, 1);
+    NodeState* state = states_.at(node).get();
+    if (deterministic_) {
+      std::sort(state->kept_grads.begin(), state->kept_grads.end(),
+                [](const KeptGrad& a, const KeptGrad& b) {
+                  return std::tie(a.producer, a.slot, a.rank) <
+                         std::tie(b.producer, b.slot, b.rank);
+                });
+      for (auto& kept : state->kept_grads) {
+        state->buffer->add(kept.edge_rank.first, kept.edge_rank.second,
+                           kept.grad);
+      }
+      state->kept_grads.clear();
+    }
+
+    EnforceGradNodeHasInput(node);
+    std::vector<std::vector<paddle::experimental::Tensor>> grad_output_tensors =
+        (*node)(state->buffer->Buffers(), false);
+    if (!retain_graph_) {
+      node->ClearTensorWrappers();
+    }
+    state->buffer.reset();
+
+    const std::vector<std::vector<Edge>>& edges = node->GetEdges();
+    PADDLE_ENFORCE(edges.size() == grad_output_tensors.size() || edges.empty(),
+                   paddle::platform::errors::Fatal(
+                       "Number of edges should be either empty ( for leaf node "
+                       ") or the same as number of output grad tensors, but we "
+                       "got edges size is: %d, grad_output size is: %d",
+                       edges.size(), grad_output_tensors.size()));
+    for (size_t i = 0; i < edges.size(); i++) {
+      for (size_t j = 0; j < edges[i].size(); j++) {
+        const Edge& edge = edges[i][j];
+        if (!edge.IsInitialized()) {
+          continue;
+        }
+        GradNodeBase* next_node = edge.GetMutableGradNode().get();
+        if (!next_node || grad_output_tensors[i].empty()) {
+          continue;
+        }
+        PADDLE_ENFORCE_LT(
+            j, grad_output_tensors[i].size(),
+            paddle::platform::errors::Fatal(
+                "Rank of grad_output_tensors should be less than "
+                "grad_output_tensors[i].size(), which is: %d. This error may "
+                "indicate autoprune or autograd api error. ",
+                grad_output_tensors.size()));
+        SendGrad(state->order, i, j, edge.GetEdgeRankInfo(),
+                 grad_output_tensors[i][j], next_node);
+      }
+    }
+  }
+
+  void SendGrad(size_t producer, size_t slot, size_t rank,
+                const std::pair<size_t, size_t>& edge_rank,
+                const paddle::experimental::Tensor& grad,
+                GradNodeBase* next_node) {
+    NodeState* next = states_.at(next_node).get();
+    if (deterministic_) {
+      std::lock_guard<std::mutex> guard(next->mutex);
+      next->kept_grads.push_back({producer, slot, rank, edge_rank, grad});
+    } else {
+      std::mutex* mutex = edge_rank.first < next->slot_mutexes.size()
+                              ? next->slot_mutexes[edge_rank.first].get()
+                              : &next->mutex;
+      std::lock_guard<std::mutex> guard(*mutex);
+      next->buffer->add(edge_rank.first, edge_rank.second, grad);
+    }
+    int in_degree = next->in_degree.fetch_sub(1) - 1;
+    PADDLE_ENFORCE(
+        in_degree >= 0,
+        paddle::platform::errors::Fatal(
+            "Detected in-degree value smaller than zero. For Node: %s"
+            "Node's in-degree cannot be negative.",
+            next_node->name()));
+    if (in_degree == 0) Schedule(next_node);
+  }
+
+  std::vector<GradNodeBase*> start_nodes_;
+  bool retain_graph_;
+  bool deterministic_;
+  bool has_grad_ = true;
+  paddle::imperative::AmpLevel amp_level_ = paddle::imperative::AmpLevel::O0;
+  std::shared_ptr<paddle::framework::WorkQueue> pool_;
+  // Only read while running the nodes.
+  std::unordered_map<GradNodeBase*, std::unique_ptr<NodeState>> states_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<GradNodeBase*> caller_nodes_;
+  int num_running_ = 0;
+  std::atomic<bool> failed_{false};
+  std::exception_ptr error_;
+};
+
 std::vector<paddle::experimental::Tensor> RunBackward(
     const std::vector<paddle::experimental::Tensor>& tensors,  // output
     const std::vector<paddle::experimental::Tensor>& grad_tensors,
@@ -620,6 +885,23 @@ std::vector<paddle::experimental::Tensor> RunBackward(
   std::unordered_map<GradNodeBase*, int> node_in_degree_map =
       getInDegreeMap(queue);
 
+  // Runs the backward of the CPU tensors on threads
+  const size_t num_threads =
+      std::max(FLAGS_eager_backward_num_threads, 0);
+  if (num_threads > 1 && !is_general_grad && !create_graph &&
+      std::all_of(tensors.begin(), tensors.end(),
+                  [](const paddle::experimental::Tensor& tensor) {
+                    return !tensor.defined() || tensor.is_cpu();
+                  })) {
+    std::vector<GradNodeBase*> start_nodes;
+    for (; !queue.empty(); queue.pop()) start_nodes.push_back(queue.front());
+    VLOG(6) << "Run Backward on " << num_threads << " threads";
+    ParallelBackward(start_nodes, node_in_degree_map, &node_input_buffers_dict,
+                     retain_graph, num_threads)
+        .Run();
+    return {};
+  }
+
   if (is_general_grad) {
     // Prepare several vital preprocess for GeneralGrad
     GeneralGrad::Instance().PreparedForGeneralGrad(inputs, no_grad_vars, &queue,
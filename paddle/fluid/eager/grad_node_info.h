@@ -192,6 +192,13 @@ class GradNodeBase : public std::enable_shared_from_this<GradNodeBase> {
 
   virtual std::string name() { return "GradNodeBase"; }
 
+  /**
+   * Whether the node can run on the threads of the parallel backward, or
+   * has to run on the thread calling backward, like the ones calling into
+   * Python. The hooks may do so.
+   * **/
+  virtual bool CanRunOnAnyThread() { return !GradientHooksRegistered(); }
+
   /**
        * GetEdges is designed to get all edges of current node**/
   const std::vector<std::vector<Edge>>& GetEdges() const;
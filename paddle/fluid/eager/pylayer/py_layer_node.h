@@ -44,6 +44,9 @@ class GradNodePyLayer : public GradNodeBase {
     return "GradNodePyLayer_" + std::string(Py_TYPE(ctx_)->tp_name);
   }
 
+  // The backward of the PyLayer needs the GIL held by the calling thread.
+  bool CanRunOnAnyThread() override { return false; }
+
   // for paddle.grad get result
   PyObject* GetMutableOutputs() { return outputs_; }
 
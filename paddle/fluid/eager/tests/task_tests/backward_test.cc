@@ -36,6 +36,9 @@ PD_DECLARE_KERNEL(full, CPU, ALL_LAYOUT);
 PD_DECLARE_KERNEL(copy, CPU, ALL_LAYOUT);
 PD_DECLARE_KERNEL(add, CPU, ALL_LAYOUT);
 
+DECLARE_int32(eager_backward_num_threads);
+DECLARE_bool(eager_backward_deterministic);
+
 namespace egr {
 
 TEST(Backward, SingleNodeEmptyGrad) {
@@ -322,4 +325,62 @@ TEST(Backward, WithAccumulation) {
   eager_test::CompareGradTensorWithValue<float>(leaf_tensor, 2500.0);
 }
 
+TEST(Backward, ParallelBranches) {
+  // Prepare Device Contexts
+  eager_test::InitEnv(paddle::platform::CPUPlace());
+  paddle::framework::DDim ddim = phi::make_ddim({4, 16, 16, 32});
+
+  for (bool deterministic : {false, true}) {
+    FLAGS_eager_backward_num_threads = 4;
+    FLAGS_eager_backward_deterministic = deterministic;
+
+    // Target k -> ScaleNode k (scale k + 1) -> SumNode (scale 1) -> leaf,
+    // the scale nodes run at the same time.
+    const int num_branches = 8;
+    std::vector<paddle::experimental::Tensor> target_tensors;
+    paddle::experimental::Tensor leaf_tensor;
+    {
+      auto sum_node_ptr = std::make_shared<GradNodeScale>(1, 1);
+      sum_node_ptr->SetAttributes_scale(1.0 /*scale*/);
+      sum_node_ptr->SetDefaultGradInOutMeta();
+      std::vector<egr::AutogradMeta> edge_metas(num_branches);
+      for (int k = 0; k < num_branches; ++k) {
+        target_tensors.emplace_back(egr_utils_api::CreateTensorWithValue(
+            ddim, paddle::platform::CPUPlace(), phi::DataType::FLOAT32,
+            phi::DataLayout::NCHW, 1.0 /*value*/, false /*is_leaf*/));
+        auto node_ptr = std::make_shared<GradNodeScale>(1, 1);
+        node_ptr->SetAttributes_scale(k + 1.0 /*scale*/);
+        node_ptr->SetDefaultGradInOutMeta();
+        AutogradMeta* auto_grad_meta =
+            EagerUtils::autograd_meta(&(target_tensors[k]));
+        auto_grad_meta->SetGradNode(
+            std::dynamic_pointer_cast<GradNodeBase>(node_ptr));
+        auto_grad_meta->SetSingleOutRankWithSlot(0, 0);
+        auto_grad_meta->SetStopGradient(false);
+
+        edge_metas[k].SetStopGradient(false);
+        edge_metas[k].SetSingleOutRankWithSlot(0, 0);
+        edge_metas[k].SetGradNode(sum_node_ptr);
+        std::vector<egr::AutogradMeta*> res = {&edge_metas[k]};
+        node_ptr->AddEdges(&res, 0);
+      }
+
+      AutogradMeta* leaf_meta = EagerUtils::autograd_meta(&leaf_tensor);
+      auto acc_node_ptr =
+          std::make_shared<egr::GradNodeAccumulation>(leaf_meta);
+      leaf_meta->SetGradNode(
+          std::dynamic_pointer_cast<GradNodeBase>(acc_node_ptr));
+      leaf_meta->SetSingleOutRankWithSlot(0, 0);
+      leaf_meta->SetStopGradient(false);
+      std::vector<egr::AutogradMeta*> res = {leaf_meta};
+      sum_node_ptr->AddEdges(&res, 0);
+    }
+
+    Backward(target_tensors, {});
+    eager_test::CompareGradTensorWithValue<float>(leaf_tensor, 36.0);
+  }
+  FLAGS_eager_backward_num_threads = 0;
+  FLAGS_eager_backward_deterministic = false;
+}
+
 }  // namespace egr
@@ -14,6 +14,12 @@ limitations under the License. */
 
 #include "paddle/fluid/framework/device_worker.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
 #include "paddle/fluid/framework/convert_utils.h"
 
 namespace phi {
@@ -100,6 +106,305 @@ bool CheckValidOutput(LoDTensor* tensor, size_t batch_size) {
   return true;
 }
 
+namespace {
+
+template <typename T>
+void AppendPod(const T& value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void AppendBytes(const std::string& bytes, std::string* out) {
+  AppendPod(static_cast<uint32_t>(bytes.size()), out);
+  out->append(bytes);
+}
+
+void AppendUint(uint64_t value, std::string* out) {
+  char buf[24];
+  char* end = buf + sizeof(buf);
+  char* begin = end;
+  do {
+    *--begin = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value);
+  out->append(begin, end);
+}
+
+void AppendInt(int64_t value, std::string* out) {
+  if (value < 0) out->push_back('-');
+  AppendUint(value < 0 ? 0 - static_cast<uint64_t>(value)
+                       : static_cast<uint64_t>(value),
+             out);
+}
+
+// Reads the parts of a record written by the functions above.
+class RecordReader {
+ public:
+  explicit RecordReader(const std::string& record)
+      : pos_(record.data()), end_(record.data() + record.size()) {}
+
+  bool Done() const { return pos_ == end_; }
+
+  // Skips n bytes, returning where they start.
+  const char* Skip(size_t n) {
+    PADDLE_ENFORCE_LE(n, static_cast<size_t>(end_ - pos_),
+                      platform::errors::InvalidArgument(
+                          "The dump batch record is truncated."));
+    const char* begin = pos_;
+    pos_ += n;
+    return begin;
+  }
+
+  template <typename T>
+  T Read() {
+    T value;
+    std::memcpy(&value, Skip(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  std::pair<const char*, size_t> ReadBytes() {
+    size_t size = Read<uint32_t>();
+    return {Skip(size), size};
+  }
+
+ private:
+  const char* pos_;
+  const char* end_;
+};
+
+size_t SizeOf(DumpValueType type) {
+  switch (type) {
+    case DumpValueType::kFloat:
+      return sizeof(float);
+    case DumpValueType::kInt64:
+      return sizeof(int64_t);
+    case DumpValueType::kDouble:
+      return sizeof(double);
+    default:
+      return 0;
+  }
+}
+
+// The powers of ten exactly rounded, up to the ones the floats need.
+const double* Pow10Table() {
+  static const double* table = [] {
+    static double pow10[80];
+    for (int i = 0; i < 80; ++i) {
+      pow10[i] = std::strtod(("1e" + std::to_string(i)).c_str(), nullptr);
+    }
+    return pow10;
+  }();
+  return table;
+}
+
+double ScaleByPow10(double value, int exp10) {
+  const double* pow10 = Pow10Table();
+  return exp10 >= 0 ? value * pow10[exp10] : value / pow10[-exp10];
+}
+
+}  // namespace
+
+void AppendShortestFloat(float value, std::string* out) {
+  if (std::signbit(value)) out->push_back('-');
+  if (std::isnan(value)) {
+    out->append("nan");
+    return;
+  }
+  if (std::isinf(value)) {
+    out->append("inf");
+    return;
+  }
+  const float abs_value = std::fabs(value);
+  if (abs_value == 0.f) {
+    out->push_back('0');
+    return;
+  }
+  // Rounds the value to 1, 2, ... significant digits in double, which holds
+  // them exactly enough, until they read back to the same float.
+  const double d = abs_value;
+  int exp10 = static_cast<int>(std::floor(std::log10(d)));
+  if (d >= ScaleByPow10(1., exp10 + 1)) {
+    ++exp10;
+  } else if (d < ScaleByPow10(1., exp10)) {
+    --exp10;
+  }
+  uint64_t digits = 0;
+  int scale = 0;
+  for (int num_digits = 1; num_digits <= 17; ++num_digits) {
+    scale = exp10 - num_digits + 1;
+    digits = static_cast<uint64_t>(std::llround(ScaleByPow10(d, -scale)));
+    if (static_cast<float>(ScaleByPow10(digits, scale)) == abs_value) break;
+  }
+  while (digits % 10 == 0) {
+    digits /= 10;
+    ++scale;
+  }
+  char buf[24];
+  char* end = buf + sizeof(buf);
+  char* begin = end;
+  do {
+    *--begin = static_cast<char>('0' + digits % 10);
+    digits /= 10;
+  } while (digits);
+  const int num_digits = static_cast<int>(end - begin);
+  const int exp = scale + num_digits - 1;
+
+  // Laid out like the %g of printf, which std::ostream uses.
+  if (exp < -4 || exp >= 6) {
+    out->push_back(*begin);
+    if (num_digits > 1) {
+      out->push_back('.');
+      out->append(begin + 1, end);
+    }
+    out->append(exp < 0 ? "e-" : "e+");
+    if (std::abs(exp) < 10) out->push_back('0');
+    AppendInt(std::abs(exp), out);
+  } else if (exp < 0) {
+    out->append("0.");
+    out->append(-exp - 1, '0');
+    out->append(begin, end);
+  } else if (num_digits <= exp + 1) {
+    out->append(begin, end);
+    out->append(exp + 1 - num_digits, '0');
+  } else {
+    out->append(begin, begin + exp + 1);
+    out->push_back('.');
+    out->append(begin + exp + 1, end);
+  }
+}
+
+void EncodeDumpBatchHead(const std::vector<size_t>& hit_ins,
+                         const std::vector<std::string>& ins_ids,
+                         const std::vector<std::string>& ins_contents,
+                         std::string* record) {
+  record->push_back(kDumpBatchTag);
+  AppendPod(static_cast<uint32_t>(hit_ins.size()), record);
+  AppendPod(static_cast<uint8_t>(!ins_ids.empty()), record);
+  if (ins_ids.empty()) return;
+  for (size_t i : hit_ins) {
+    AppendBytes(ins_ids[i], record);
+    AppendBytes(ins_contents[i], record);
+  }
+}
+
+void EncodeDumpBatchField(const std::string& field, LoDTensor* tensor,
+                          const std::vector<size_t>& hit_ins,
+                          std::string* record) {
+  DumpValueType type = DumpValueType::kUnsupported;
+  auto proto_type = framework::TransToProtoVarType(tensor->dtype());
+  if (proto_type == proto::VarType::FP32) {
+    type = DumpValueType::kFloat;
+  } else if (proto_type == proto::VarType::INT64) {
+    type = DumpValueType::kInt64;
+  } else if (proto_type == proto::VarType::FP64) {
+    type = DumpValueType::kDouble;
+  }
+  AppendBytes(field, record);
+  AppendPod(type, record);
+
+  std::vector<std::pair<int64_t, int64_t>> bounds(hit_ins.size());
+  for (size_t i = 0; i < hit_ins.size(); ++i) {
+    bounds[i] = GetTensorBound(tensor, hit_ins[i]);
+    AppendPod(bounds[i].second - bounds[i].first, record);
+  }
+  const int64_t count = tensor->numel();
+  for (auto& bound : bounds) {
+    AppendPod(static_cast<uint8_t>(bound.first >= 0 && bound.second <= count),
+              record);
+  }
+  const size_t value_size = SizeOf(type);
+  if (value_size == 0) return;
+  const char* data = static_cast<const char*>(tensor->data());
+  for (auto& bound : bounds) {
+    if (bound.first < 0 || bound.second > count ||
+        bound.second <= bound.first) {
+      continue;
+    }
+    record->append(data + bound.first * value_size,
+                   (bound.second - bound.first) * value_size);
+  }
+}
+
+void DumpBatchToText(const std::string& record, std::string* out) {
+  RecordReader reader(record);
+  reader.Skip(1);
+  const size_t num_ins = reader.Read<uint32_t>();
+  const bool with_ins_id = reader.Read<uint8_t>();
+  std::vector<std::pair<const char*, size_t>> ins;
+  if (with_ins_id) {
+    ins.reserve(num_ins * 2);
+    for (size_t i = 0; i < num_ins * 2; ++i) ins.push_back(reader.ReadBytes());
+  }
+
+  struct Field {
+    std::pair<const char*, size_t> name;
+    DumpValueType type;
+    const char* nums;
+    const char* valid;
+    const char* values;
+  };
+  std::vector<Field> fields;
+  while (!reader.Done()) {
+    Field field;
+    field.name = reader.ReadBytes();
+    field.type = reader.Read<DumpValueType>();
+    field.nums = reader.Skip(num_ins * sizeof(int64_t));
+    field.valid = reader.Skip(num_ins);
+    size_t values_size = 0;
+    for (size_t i = 0; i < num_ins; ++i) {
+      int64_t num = 0;
+      std::memcpy(&num, field.nums + i * sizeof(int64_t), sizeof(int64_t));
+      if (field.valid[i] && num > 0) values_size += num;
+    }
+    field.values = reader.Skip(values_size * SizeOf(field.type));
+    fields.push_back(field);
+  }
+
+  char buf[32];
+  for (size_t i = 0; i < num_ins; ++i) {
+    const size_t line_begin = out->size();
+    if (with_ins_id) {
+      out->append(ins[i * 2].first, ins[i * 2].second);
+      out->push_back('\t');
+      out->append(ins[i * 2 + 1].first, ins[i * 2 + 1].second);
+    }
+    for (auto& field : fields) {
+      int64_t num = 0;
+      std::memcpy(&num, field.nums + i * sizeof(int64_t), sizeof(int64_t));
+      out->push_back('\t');
+      out->append(field.name.first, field.name.second);
+      out->push_back(':');
+      AppendInt(num, out);
+      if (field.type == DumpValueType::kUnsupported) {
+        out->append("unsupported type");
+        continue;
+      }
+      if (!field.valid[i]) {
+        out->append("access violation");
+        continue;
+      }
+      for (int64_t j = 0; j < num; ++j) {
+        out->push_back(':');
+        const char* value = field.values + j * SizeOf(field.type);
+        if (field.type == DumpValueType::kFloat) {
+          float v;
+          std::memcpy(&v, value, sizeof(v));
+          AppendShortestFloat(v, out);
+        } else if (field.type == DumpValueType::kInt64) {
+          uint64_t v;
+          std::memcpy(&v, value, sizeof(v));
+          AppendUint(v, out);
+        } else {
+          double v;
+          std::memcpy(&v, value, sizeof(v));
+          out->append(buf, std::snprintf(buf, sizeof(buf), "%g", v));
+        }
+      }
+      if (num > 0) field.values += num * SizeOf(field.type);
+    }
+    if (out->size() != line_begin) out->push_back('\n');
+  }
+}
+
 void DeviceWorker::DumpParam(const Scope& scope, const int batch_id) {
   std::ostringstream os;
   for (auto& param : *dump_param_) {
@@ -146,8 +451,7 @@ void DeviceWorker::DumpField(const Scope& scope, int dump_mode,
   if (ins_id_vec.size() > 0) {
     batch_size = ins_id_vec.size();
   }
-  std::vector<std::string> ars(batch_size);
-  std::vector<bool> hit(batch_size, false);
+  std::vector<size_t> hit_ins;
 
   std::default_random_engine engine(0);
   std::uniform_int_distribution<size_t> dist(0U, INT_MAX);
@@ -161,15 +465,16 @@ void DeviceWorker::DumpField(const Scope& scope, int dump_mode,
     if (r % dump_interval != 0) {
       continue;
     }
-    hit[i] = true;
+    hit_ins.push_back(i);
   }
-  for (size_t i = 0; i < ins_id_vec.size(); i++) {
-    if (!hit[i]) {
-      continue;
-    }
-    ars[i] += ins_id_vec[i];
-    ars[i] = ars[i] + "\t" + ins_content_vec[i];
+  if (hit_ins.empty()) {
+    return;
   }
+  // Only the raw values are copied on the training thread, the dump threads
+  // format them, see DumpBatchToText.
+  std::string record;
+  record.reserve(dump_batch_bytes_);
+  EncodeDumpBatchHead(hit_ins, ins_id_vec, ins_content_vec, &record);
   for (auto& field : *dump_fields_) {
     Variable* var = scope.FindVar(field);
     if (var == nullptr) {
@@ -195,23 +500,13 @@ void DeviceWorker::DumpField(const Scope& scope, int dump_mode,
                                             "wrong ";
       continue;
     }
-    for (size_t i = 0; i < batch_size; ++i) {
-      if (!hit[i]) {
-        continue;
-      }
-      auto bound = GetTensorBound(tensor, i);
-      ars[i] = ars[i] + "\t" + field + ":" +
-               std::to_string(bound.second - bound.first);
-      ars[i] += PrintLodTensor(tensor, bound.first, bound.second);
-    }
-  }
-  // #pragma omp parallel for
-  for (size_t i = 0; i < ars.size(); i++) {
-    if (ars[i].length() == 0) {
-      continue;
-    }
-    writer_ << ars[i];
+    EncodeDumpBatchField(field, tensor, hit_ins, &record);
   }
+  dump_batch_bytes_ = std::max(dump_batch_bytes_, record.size());
+  writer_ << std::move(record);
+  // A record is a whole batch, hand it over now rather than holding a block
+  // of them, so a bounded dump channel slows down the training thread.
+  writer_.Flush();
 }
 
 }  // namespace framework
@@ -15,7 +15,9 @@ limitations under the License. */
 #pragma once
 
 #include <atomic>
+#include <deque>
 #include <fstream>
+#include <future>  // NOLINT
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT
@@ -63,6 +65,37 @@ std::string PrintLodTensor(Tensor* tensor, int64_t start, int64_t end);
 std::pair<int64_t, int64_t> GetTensorBound(LoDTensor* tensor, int index);
 bool CheckValidOutput(LoDTensor* tensor, size_t batch_size);
 
+// DumpField hands the hit instances of a batch to the dump threads as one
+// record holding the raw values of the dumped fields, so that formatting
+// them is left to the dump threads. A record is laid out as
+//   kDumpBatchTag, uint32 number of instances, uint8 whether with ins ids,
+//   for each instance (when with ins ids): the ins id and the ins content,
+//   then for each field until the end of the record:
+//     the field name, uint8 DumpValueType,
+//     int64 number of values of each instance,
+//     uint8 whether the values of each instance are in the tensor,
+//     the values of the instances in the tensor, one after another,
+// with the strings written as a uint32 length and the bytes. The text lines
+// written to the dump channel never start with kDumpBatchTag.
+constexpr char kDumpBatchTag = '\0';
+enum class DumpValueType : uint8_t { kFloat, kInt64, kDouble, kUnsupported };
+
+inline bool IsDumpBatch(const std::string& record) {
+  return !record.empty() && record[0] == kDumpBatchTag;
+}
+void EncodeDumpBatchHead(const std::vector<size_t>& hit_ins,
+                         const std::vector<std::string>& ins_ids,
+                         const std::vector<std::string>& ins_contents,
+                         std::string* record);
+void EncodeDumpBatchField(const std::string& field, LoDTensor* tensor,
+                          const std::vector<size_t>& hit_ins,
+                          std::string* record);
+// Appends the lines of the instances of a record to out, one per instance:
+//   ins_id \t ins_content \t field:num:value:value... \t field:...
+// with the floats in their shortest form reading back to the same values.
+void DumpBatchToText(const std::string& record, std::string* out);
+void AppendShortestFloat(float value, std::string* out);
+
 class FleetWrapper;
 
 #if defined(PADDLE_WITH_PSLIB) && !defined(PADDLE_WITH_HETERPS)
@@ -228,6 +261,8 @@ class DeviceWorker {
 
   int dump_mode_ = 0;
   int dump_interval_ = 10000;
+  // The largest record of DumpField so far, reserved for the next one.
+  size_t dump_batch_bytes_ = 0;
   ChannelWriter<std::string> writer_;
   platform::DeviceContext* dev_ctx_ = nullptr;
 };
@@ -267,6 +302,7 @@ class HogwildWorker : public CPUWorkerBase {
  protected:
   void CreateThreadOperators(const ProgramDesc& program);
   void CreateThreadScope(const ProgramDesc& program);
+  void PrepareUnusedVars(const ProgramDesc& program);
 
   std::vector<std::string> op_names_;
   std::vector<OperatorBase*> ops_;
@@ -274,6 +310,17 @@ class HogwildWorker : public CPUWorkerBase {
   // Scope* thread_scope_;
   HogwildWorkerParameter param_;
   std::vector<std::string> skip_ops_;
+  // Whether the ops are prepared for the TrainFiles of HogwildWorker, which
+  // runs all of them in thread_scope_: their RuntimeContexts are cached and
+  // unused_vars_ is filled. Set by HogwildWorker::Initialize only, so not for
+  // the derived workers.
+  bool prepare_ops_ = false;
+  // Whether each op of ops_ matches one of skip_ops_, so it is not run.
+  std::vector<bool> need_skip_ops_;
+  // The variables to delete after each op runs, empty when eager deletion
+  // is disabled.
+  std::unordered_map<const OperatorBase*, std::vector<std::string>>
+      unused_vars_;
   std::map<std::string, int> stat_var_name_map_;
 };
 
@@ -348,6 +395,25 @@ class DownpourWorker : public HogwildWorker {
   std::vector<float> nid_show_;
   // std::map<uint64_t, uint64_t> table_dependency_;
   // std::vector<std::pair<uint64_t, uint64_t>> copy_dense_tables_;
+
+  // Prefetch of the sparse pull: the next batch is read into
+  // prefetch_scope_ and its sparse values pulled while the current batch
+  // runs, then the two are swapped.
+  void PrepareSparsePrefetch();
+  int PrefetchBatch();
+  int NextPrefetchedBatch();
+  bool prefetch_pull_sparse_ = false;
+  // the pull of a batch may miss the pushes of at most this many batches
+  // before it
+  int prefetch_max_push_staleness_ = 1;
+  std::unique_ptr<Scope> prefetch_scope_;
+  std::future<int> prefetch_status_;
+  std::map<uint64_t, std::vector<uint64_t>> prefetch_features_;
+  std::map<uint64_t, std::vector<std::vector<float>>> prefetch_feature_values_;
+  std::vector<std::string> prefetch_ins_ids_;
+  std::vector<std::string> ins_ids_;
+  // the pushes of the batches not waited for, the oldest first
+  std::deque<std::vector<::std::future<int32_t>>> pushes_in_flight_;
 };
 
 // Based on DownpourWorker，remove push pull code into operator
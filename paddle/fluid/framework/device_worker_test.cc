@@ -16,6 +16,11 @@
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
 #include "paddle/fluid/framework/lod_tensor.h"
 
 namespace paddle {
@@ -74,5 +79,86 @@ TEST(LodTensor, CheckValidOutput) {
   ASSERT_TRUE(CheckValidOutput(&tensor, 2));
 }
 
+TEST(DumpBatch, AppendShortestFloat) {
+  auto format = [](float value) {
+    std::string out;
+    AppendShortestFloat(value, &out);
+    return out;
+  };
+  EXPECT_EQ(format(0.2f), "0.2");
+  EXPECT_EQ(format(-0.5f), "-0.5");
+  EXPECT_EQ(format(0.f), "0");
+  EXPECT_EQ(format(120.f), "120");
+  EXPECT_EQ(format(123.456f), "123.456");
+  EXPECT_EQ(format(100000.f), "100000");
+  EXPECT_EQ(format(1e6f), "1e+06");
+  EXPECT_EQ(format(1.5e-5f), "1.5e-05");
+  EXPECT_EQ(format(0.0001f), "0.0001");
+  EXPECT_EQ(format(0.123456789f), "0.12345679");
+  EXPECT_EQ(format(3.4028235e38f), "3.4028235e+38");
+
+  std::mt19937 rng(0);
+  for (int i = 0; i < 100000; ++i) {
+    uint32_t bits = rng();
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    if (std::isnan(value)) continue;
+    EXPECT_EQ(std::strtof(format(value).c_str(), nullptr), value) << bits;
+  }
+}
+
+TEST(DumpBatch, DumpBatchToText) {
+  LoDTensor floats;
+  floats.set_lod({{0, 1, 3, 4}});
+  floats.Resize({4, 1});
+  auto* f = floats.mutable_data<float>(platform::CPUPlace());
+  f[0] = 0.1f;
+  f[1] = 0.25f;
+  f[2] = -3.f;
+  f[3] = 1e-7f;
+  LoDTensor ints;
+  ints.Resize({3, 2});
+  auto* n = ints.mutable_data<int64_t>(platform::CPUPlace());
+  for (int i = 0; i < 6; ++i) n[i] = i - 1;
+  LoDTensor doubles;
+  doubles.Resize({3, 1});
+  auto* d = doubles.mutable_data<double>(platform::CPUPlace());
+  for (int i = 0; i < 3; ++i) d[i] = 0.5 * i;
+  LoDTensor ints32;
+  ints32.Resize({3, 1});
+  ints32.mutable_data<int>(platform::CPUPlace());
+
+  std::vector<size_t> hit_ins = {0, 2};
+  std::vector<std::string> ins_ids = {"a", "b", "c"};
+  std::vector<std::string> ins_contents = {"x", "y", "z"};
+  std::string record;
+  EncodeDumpBatchHead(hit_ins, ins_ids, ins_contents, &record);
+  EncodeDumpBatchField("f", &floats, hit_ins, &record);
+  EncodeDumpBatchField("n", &ints, hit_ins, &record);
+  EncodeDumpBatchField("d", &doubles, hit_ins, &record);
+  EncodeDumpBatchField("i", &ints32, hit_ins, &record);
+  ASSERT_TRUE(IsDumpBatch(record));
+  std::string text;
+  DumpBatchToText(record, &text);
+  EXPECT_EQ(text,
+            "a\tx\tf:1:0.1\tn:2:18446744073709551615:0\td:1:0"
+            "\ti:1unsupported type\n"
+            "c\tz\tf:1:1e-07\tn:2:3:4\td:1:1\ti:1unsupported type\n");
+
+  // Without ins ids, the instances without fields have no lines.
+  record.clear();
+  EncodeDumpBatchHead(hit_ins, {}, {}, &record);
+  text.clear();
+  DumpBatchToText(record, &text);
+  EXPECT_EQ(text, "");
+  EncodeDumpBatchField("f", &floats, {1}, &record);
+  EXPECT_THROW(DumpBatchToText(record, &text), paddle::platform::EnforceNotMet);
+  record.clear();
+  EncodeDumpBatchHead({1}, {}, {}, &record);
+  EncodeDumpBatchField("f", &floats, {1}, &record);
+  DumpBatchToText(record, &text);
+  EXPECT_EQ(text, "\tf:2:0.25:-3\n");
+}
+
 }  // namespace framework
 }  // namespace paddle
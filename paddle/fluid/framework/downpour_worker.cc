@@ -86,6 +86,14 @@ void DownpourWorker::Initialize(const TrainerDesc& desc) {
 
   need_to_push_sparse_ = param_.push_sparse();
   need_to_push_dense_ = param_.push_dense();
+  prefetch_pull_sparse_ = param_.prefetch_pull_sparse();
+  prefetch_max_push_staleness_ = param_.prefetch_max_push_staleness();
+  PADDLE_ENFORCE_GE(prefetch_max_push_staleness_, 1,
+                    platform::errors::InvalidArgument(
+                        "The prefetch_max_push_staleness should be at least "
+                        "1, the pull of the next batch can not see the "
+                        "pushes of the running one, but received %d.",
+                        prefetch_max_push_staleness_));
 
   fleet_ptr_ = FleetWrapper::GetInstance();
   fetch_config_ = desc.fetch_config();
@@ -757,13 +765,100 @@ inline void AddAucMonitor(const Scope* scope, const platform::Place& place) {
 }
 #endif
 
+void DownpourWorker::PrepareSparsePrefetch() {
+  // The reader fills the feed vars of prefetch_scope_, the embedding vars
+  // are only looked up by the pull to skip the slots without them.
+  prefetch_scope_.reset(new Scope());
+  for (auto& name : device_reader_->GetUseSlotAlias()) {
+    prefetch_scope_->Var(name)->GetMutable<LoDTensor>();
+  }
+  for (auto& table : sparse_value_names_) {
+    for (auto& name : table.second) {
+      if (thread_scope_->FindVar(name) != nullptr) {
+        prefetch_scope_->Var(name);
+      }
+    }
+  }
+  device_reader_->AssignFeedVar(*prefetch_scope_);
+  prefetch_status_ =
+      std::async(std::launch::async, &DownpourWorker::PrefetchBatch, this);
+}
+
+// Runs in the background: reads the next batch and pulls the sparse values
+// of its distinct feasigns.
+int DownpourWorker::PrefetchBatch() {
+  int batch = device_reader_->Next();
+  if (batch <= 0) {
+    return batch;
+  }
+  prefetch_ins_ids_ = device_reader_->GetInsIdVec();
+  for (int i = 0; i < param_.program_config(0).pull_sparse_table_id_size();
+       ++i) {
+    uint64_t tid = static_cast<uint64_t>(
+        param_.program_config(0).pull_sparse_table_id(i));
+    TableParameter table;
+    for (auto j : param_.sparse_table()) {
+      if (j.table_id() == tid) {
+        table = j;
+        break;
+      }
+    }
+    fleet_ptr_->PullSparseVarsSync(
+        *prefetch_scope_, tid, sparse_key_names_.at(tid),
+        &prefetch_features_[tid], &prefetch_feature_values_[tid],
+        table.fea_dim(), sparse_value_names_.at(tid), true);
+  }
+  return batch;
+}
+
+// Takes the prefetched batch into thread_scope_, then starts the prefetch of
+// the next one once the pushes it may not miss are done.
+int DownpourWorker::NextPrefetchedBatch() {
+  int batch = prefetch_status_.get();
+  if (batch <= 0) {
+    return batch;
+  }
+  for (auto& name : device_reader_->GetUseSlotAlias()) {
+    std::swap(*thread_scope_->FindVar(name)->GetMutable<LoDTensor>(),
+              *prefetch_scope_->FindVar(name)->GetMutable<LoDTensor>());
+  }
+  features_.swap(prefetch_features_);
+  feature_values_.swap(prefetch_feature_values_);
+  ins_ids_.swap(prefetch_ins_ids_);
+
+  // The running batch pushes after the pull, the ones before it may not have
+  // landed yet.
+  while (pushes_in_flight_.size() >=
+         static_cast<size_t>(prefetch_max_push_staleness_)) {
+    for (auto& t : pushes_in_flight_.front()) {
+      t.wait();
+    }
+    pushes_in_flight_.pop_front();
+  }
+  prefetch_status_ =
+      std::async(std::launch::async, &DownpourWorker::PrefetchBatch, this);
+  return batch;
+}
+
 void DownpourWorker::TrainFiles() {
   VLOG(3) << "Begin to train files";
   platform::SetNumThreads(1);
   device_reader_->Start();
   int batch_cnt = 0;
   int cur_batch;
-  while ((cur_batch = device_reader_->Next()) > 0) {
+  // The dumped fields read the instances of the current batch from the
+  // reader, and the copied tables must be seen by the next pull.
+  bool prefetch = prefetch_pull_sparse_ && !need_dump_field_ &&
+                  !copy_table_config_.need_copy();
+  if (prefetch_pull_sparse_ && !prefetch) {
+    LOG(WARNING) << "The sparse pull is not prefetched with dump fields or "
+                    "copy tables.";
+  }
+  if (prefetch) {
+    PrepareSparsePrefetch();
+  }
+  while ((cur_batch = prefetch ? NextPrefetchedBatch()
+                               : device_reader_->Next()) > 0) {
     if (copy_table_config_.need_copy()) {
       if (batch_cnt % copy_table_config_.batch_num() == 0) {
         CopySparseTable();
@@ -783,9 +878,11 @@ void DownpourWorker::TrainFiles() {
           break;
         }
       }
-      fleet_ptr_->PullSparseVarsSync(
-          *thread_scope_, tid, sparse_key_names_[tid], &features_[tid],
-          &feature_values_[tid], table.fea_dim(), sparse_value_names_[tid]);
+      if (!prefetch) {
+        fleet_ptr_->PullSparseVarsSync(
+            *thread_scope_, tid, sparse_key_names_[tid], &features_[tid],
+            &feature_values_[tid], table.fea_dim(), sparse_value_names_[tid]);
+      }
       CollectLabelInfo(i);
       FillSparseValue(i);
       auto nid_iter = std::find(sparse_value_names_[tid].begin(),
@@ -812,8 +909,11 @@ void DownpourWorker::TrainFiles() {
           op->Run(*thread_scope_, place_);
         } catch (std::exception& e) {
           fprintf(stderr, "error message: %s\n", e.what());
-          auto& ins_id_vec = device_reader_->GetInsIdVec();
-          size_t batch_size = device_reader_->GetCurBatchSize();
+          // the reader is on the prefetched batch
+          auto& ins_id_vec =
+              prefetch ? ins_ids_ : device_reader_->GetInsIdVec();
+          size_t batch_size =
+              prefetch ? cur_batch : device_reader_->GetCurBatchSize();
           std::string s = "";
           for (auto& ins_id : ins_id_vec) {
             if (s != "") s += ",";
@@ -970,6 +1070,10 @@ void DownpourWorker::TrainFiles() {
       }
     }
 
+    if (prefetch) {
+      pushes_in_flight_.push_back(std::move(push_sparse_status_));
+      push_sparse_status_.clear();
+    }
     if (need_to_push_sparse_) {
       VLOG(3) << "push sparse gradient done.";
       int32_t tmp_push_sparse_wait_times = -1;
@@ -1006,6 +1110,10 @@ void DownpourWorker::TrainFiles() {
     thread_scope_->DropKids();
     ++batch_cnt;
   }
+  if (prefetch) {
+    pushes_in_flight_.clear();
+    device_reader_->AssignFeedVar(*thread_scope_);
+  }
   if (need_dump_field_ || need_dump_param_) {
     writer_.Flush();
   }
@@ -83,13 +83,24 @@ std::unordered_map<const OperatorBase *, std::vector<std::string>>
 GetUnusedVars(const BlockDesc &block,
               const std::vector<std::unique_ptr<OperatorBase>> &ops,
               const std::vector<std::string> &skip_var_list) {
+  std::vector<OperatorBase *> raw_ops;
+  raw_ops.reserve(ops.size());
+  for (auto &op : ops) {
+    raw_ops.push_back(op.get());
+  }
+  return GetUnusedVars(block, raw_ops, skip_var_list);
+}
+
+std::unordered_map<const OperatorBase *, std::vector<std::string>>
+GetUnusedVars(const BlockDesc &block, const std::vector<OperatorBase *> &ops,
+              const std::vector<std::string> &skip_var_list) {
   std::unordered_set<std::string> skip_vars(skip_var_list.begin(),
                                             skip_var_list.end());
 
   std::unordered_map<std::string, size_t> var_op_idx_map;
 
   for (size_t i = 0; i < ops.size(); ++i) {
-    auto *op = ops[i].get();
+    auto *op = ops[i];
 
     OpInOutInfo info;
     for (auto &name_pair : op->Inputs()) {
@@ -128,7 +139,7 @@ GetUnusedVars(const BlockDesc &block,
   for (auto &name_op_idx_pair : var_op_idx_map) {
     auto &name = name_op_idx_pair.first;
     size_t op_idx = name_op_idx_pair.second;
-    result[ops[op_idx].get()].emplace_back(name);
+    result[ops[op_idx]].emplace_back(name);
   }
   return result;
 }
@@ -52,6 +52,10 @@ GetUnusedVars(const BlockDesc &block,
               const std::vector<std::unique_ptr<OperatorBase>> &ops,
               const std::vector<std::string> &skip_vars);
 
+std::unordered_map<const OperatorBase *, std::vector<std::string>>
+GetUnusedVars(const BlockDesc &block, const std::vector<OperatorBase *> &ops,
+              const std::vector<std::string> &skip_vars);
+
 // Collect unused tensors
 void DeleteUnusedTensors(const Scope &scope,
                          const std::vector<std::string> &delete_vars,
@@ -511,7 +511,7 @@ void FleetWrapper::PullSparseVarsSync(
     const Scope& scope, const uint64_t table_id,
     const std::vector<std::string>& var_names, std::vector<uint64_t>* fea_keys,
     std::vector<std::vector<float>>* fea_values, int fea_value_dim,
-    const std::vector<std::string>& var_emb_names) {
+    const std::vector<std::string>& var_emb_names, bool dedup_keys) {
 #ifdef PADDLE_WITH_PSLIB
   std::vector<::std::future<int32_t>> pull_sparse_status;
   pull_sparse_status.resize(0);
@@ -543,12 +543,31 @@ void FleetWrapper::PullSparseVarsSync(
       fea_keys->push_back(static_cast<uint64_t>(ids[i]));
     }
   }
-  fea_values->resize(fea_keys->size() + 1);
-  for (auto& t : *fea_values) {
+  // With dedup_keys, the values of the distinct keys are pulled and then
+  // copied to the ones of each key.
+  std::vector<uint64_t>* pull_keys = fea_keys;
+  std::vector<std::vector<float>>* pull_values = fea_values;
+  std::vector<uint64_t> distinct_keys;
+  std::vector<std::vector<float>> distinct_values;
+  std::vector<size_t> key_index;
+  if (dedup_keys) {
+    std::unordered_map<uint64_t, size_t> key_to_index;
+    key_to_index.reserve(fea_keys->size());
+    key_index.reserve(fea_keys->size());
+    for (auto key : *fea_keys) {
+      auto it = key_to_index.emplace(key, distinct_keys.size()).first;
+      if (it->second == distinct_keys.size()) distinct_keys.push_back(key);
+      key_index.push_back(it->second);
+    }
+    pull_keys = &distinct_keys;
+    pull_values = &distinct_values;
+  }
+  pull_values->resize(pull_keys->size() + 1);
+  for (auto& t : *pull_values) {
     t.resize(fea_value_dim);
   }
   std::vector<float*> pull_result_ptr;
-  for (auto& t : *fea_values) {
+  for (auto& t : *pull_values) {
     pull_result_ptr.push_back(t.data());
   }
 
@@ -556,7 +575,7 @@ void FleetWrapper::PullSparseVarsSync(
   while (true) {
     pull_sparse_status.clear();
     auto status = pslib_ptr_->_worker_ptr->pull_sparse(
-        pull_result_ptr.data(), table_id, fea_keys->data(), fea_keys->size());
+        pull_result_ptr.data(), table_id, pull_keys->data(), pull_keys->size());
     pull_sparse_status.push_back(std::move(status));
     bool flag = true;
     for (auto& t : pull_sparse_status) {
@@ -583,6 +602,13 @@ void FleetWrapper::PullSparseVarsSync(
       break;
     }
   }
+  if (dedup_keys) {
+    fea_values->resize(fea_keys->size() + 1);
+    for (size_t i = 0; i < key_index.size(); ++i) {
+      (*fea_values)[i] = distinct_values[key_index[i]];
+    }
+    fea_values->back().assign(fea_value_dim, 0);
+  }
 #endif
 }
 
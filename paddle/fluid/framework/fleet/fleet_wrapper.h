@@ -109,14 +109,16 @@ class FleetWrapper {
   int RegisterHeterCallback(HeterCallBackFunc handler);
 
   // Pull sparse variables from server in sync mode
-  // Param<in>: scope, table_id, var_names, fea_keys, fea_dim, var_emb_names
+  // Param<in>: scope, table_id, var_names, fea_keys, fea_dim, var_emb_names,
+  //            dedup_keys: pull each distinct key once
   // Param<out>: fea_values
   void PullSparseVarsSync(const Scope& scope, const uint64_t table_id,
                           const std::vector<std::string>& var_names,
                           std::vector<uint64_t>* fea_keys,
                           std::vector<std::vector<float>>* fea_values,
                           int fea_dim,
-                          const std::vector<std::string>& var_emb_names);
+                          const std::vector<std::string>& var_emb_names,
+                          bool dedup_keys = false);
 
   // Pull sparse variables from server in async mode
   // Param<in>: scope, table_id, var_names, fea_keys, fea_dim
@@ -136,7 +136,7 @@ std::string HeterPipelineTrainer::GetDumpPath(int tid) {
 }
 
 void HeterPipelineTrainer::InitDumpEnv() {
-  queue_ = paddle::framework::MakeChannel<std::string>();
+  queue_ = paddle::framework::MakeChannel<std::string>(dump_queue_capacity_);
   for (int i = 0; i < thread_num_; ++i) {
     workers_[i]->SetChannelWriter(queue_.get());
   }
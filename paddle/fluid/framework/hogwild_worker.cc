@@ -18,6 +18,8 @@ limitations under the License. */
 #include "paddle/fluid/framework/data_type.h"
 #include "paddle/fluid/framework/device_worker.h"
 #include "paddle/fluid/operators/controlflow/conditional_block_op_helper.h"
+#include "paddle/fluid/operators/controlflow/recurrent_op_helper.h"
+#include "paddle/fluid/operators/controlflow/while_op_helper.h"
 #include "paddle/fluid/platform/cpu_helper.h"
 #include "paddle/fluid/platform/lodtensor_printer.h"
 
@@ -37,6 +39,7 @@ void HogwildWorker::Initialize(const TrainerDesc &desc) {
   }
   use_cvm_ = desc.use_cvm();
   thread_barrier_ = desc.thread_barrier();
+  prepare_ops_ = true;
 
   for (int i = 0; i < param_.stat_var_names_size(); ++i) {
     stat_var_name_map_[param_.stat_var_names(i)] = 1;
@@ -46,9 +49,28 @@ void HogwildWorker::Initialize(const TrainerDesc &desc) {
 void HogwildWorker::CreateThreadOperators(const ProgramDesc &program) {
   auto &block = program.Block(0);
   op_names_.clear();
+  need_skip_ops_.clear();
   for (auto &op_desc : block.AllOps()) {
-    std::unique_ptr<OperatorBase> local_op = OpRegistry::CreateOp(*op_desc);
+    std::unique_ptr<OperatorBase> local_op;
+    if (prepare_ops_) {
+      // Each op runs in the same scope every batch, so it creates its
+      // RuntimeContext once rather than finding its variables every run.
+      AttributeMap attrs = op_desc->GetAttrMap();
+      attrs[kEnableCacheRuntimeContext] = true;
+      local_op = OpRegistry::CreateOp(op_desc->Type(), op_desc->Inputs(),
+                                      op_desc->Outputs(), attrs);
+    } else {
+      local_op = OpRegistry::CreateOp(*op_desc);
+    }
     op_names_.push_back(op_desc->Type());
+    bool need_skip = false;
+    for (auto &skip_op : skip_ops_) {
+      if (op_desc->Type().find(skip_op) != std::string::npos) {
+        need_skip = true;
+        break;
+      }
+    }
+    need_skip_ops_.push_back(need_skip);
     OperatorBase *local_op_ptr = local_op.release();
     ops_.push_back(local_op_ptr);
     continue;
@@ -57,6 +79,64 @@ void HogwildWorker::CreateThreadOperators(const ProgramDesc &program) {
       program, 0, ops_);
 }
 
+void HogwildWorker::PrepareUnusedVars(const ProgramDesc &program) {
+  unused_vars_.clear();
+  if (GetEagerDeletionThreshold() < 0 || !platform::is_cpu_place(place_)) {
+    return;
+  }
+
+  if (program.Size() > 1) {
+    std::vector<operators::OpVariant> while_ops, while_grad_ops;
+    operators::OpAndGradOpPair recurrent_ops;
+    for (auto *op : ops_) {
+      if (op->Type() == "while") {
+        while_ops.emplace_back(op);
+      } else if (op->Type() == "while_grad") {
+        while_grad_ops.emplace_back(op);
+      } else if (op->Type() == "recurrent") {
+        recurrent_ops.first.emplace(op);
+      } else if (op->Type() == "recurrent_grad") {
+        recurrent_ops.second.emplace(op);
+      }
+    }
+    operators::PrepareSafeEagerDeletionOnWhileOpAndWhileGradOp(
+        program, while_ops, while_grad_ops);
+    operators::PrepareSafeEagerDeletionOnRecurrentOpAndRecurrentGradOp(
+        program, &recurrent_ops);
+  }
+
+  // The feed variables are filled in place by the data feed every batch, so
+  // their buffers are kept for the next one. The fetched and the dumped ones
+  // are read after all the ops run.
+  std::vector<std::string> skip_vars = device_reader_->GetUseSlotAlias();
+  for (int i = 0; i < fetch_config_.fetch_var_names_size(); ++i) {
+    skip_vars.push_back(fetch_config_.fetch_var_names(i));
+  }
+  if (need_dump_field_ && dump_fields_ != nullptr) {
+    skip_vars.insert(skip_vars.end(), dump_fields_->begin(),
+                     dump_fields_->end());
+  }
+
+  // The skipped ops are handled out of the worker, their variables are kept
+  // as well.
+  std::vector<OperatorBase *> run_ops;
+  for (size_t i = 0; i < ops_.size(); ++i) {
+    if (!need_skip_ops_[i]) {
+      run_ops.push_back(ops_[i]);
+      continue;
+    }
+    for (auto &pair : ops_[i]->Inputs()) {
+      skip_vars.insert(skip_vars.end(), pair.second.begin(),
+                       pair.second.end());
+    }
+    for (auto &pair : ops_[i]->Outputs()) {
+      skip_vars.insert(skip_vars.end(), pair.second.begin(),
+                       pair.second.end());
+    }
+  }
+  unused_vars_ = GetUnusedVars(program.Block(0), run_ops, skip_vars);
+}
+
 void HogwildWorker::CreateThreadScope(const ProgramDesc &program) {
   auto &block = program.Block(0);
 
@@ -114,6 +194,9 @@ void HogwildWorker::BindingDataFeedMemory() {
 void HogwildWorker::CreateDeviceResource(const ProgramDesc &main_prog) {
   CreateThreadScope(main_prog);
   CreateThreadOperators(main_prog);
+  if (prepare_ops_) {
+    PrepareUnusedVars(main_prog);
+  }
 }
 
 void HogwildWorker::TrainFilesWithProfiler() {
@@ -141,16 +224,9 @@ void HogwildWorker::TrainFilesWithProfiler() {
     read_time += timeline.ElapsedSec();
     total_time += timeline.ElapsedSec();
     for (size_t i = 0; i < ops_.size(); ++i) {
-      bool need_skip = false;
-      for (auto t = 0u; t < skip_ops_.size(); ++t) {
-        if (ops_[i]->Type().find(skip_ops_[t]) != std::string::npos) {
-          need_skip = true;
-          break;
-        }
-      }
       timeline.Start();
       VLOG(3) << "Going to run op " << op_name[i];
-      if (!need_skip) {
+      if (!need_skip_ops_[i]) {
         ops_[i]->Run(*thread_scope_, place_);
 #ifdef PADDLE_WITH_HETERPS
         dev_ctx_->Wait();
@@ -214,22 +290,25 @@ void HogwildWorker::TrainFiles() {
   platform::Timer timeline;
   timeline.Start();
 
+  std::unique_ptr<GarbageCollector> gc;
+  if (!unused_vars_.empty()) {
+    gc.reset(new CPUGarbageCollector(platform::CPUPlace(),
+                                     GetEagerDeletionThreshold()));
+  }
+
   int total_ins_num = 0;
   // how to accumulate fetched values here
   device_reader_->Start();
   int cur_batch;
   int batch_cnt = 0;
   while ((cur_batch = device_reader_->Next()) > 0) {
-    for (auto &op : ops_) {
-      bool need_skip = false;
-      for (auto t = 0u; t < skip_ops_.size(); ++t) {
-        if (op->Type().find(skip_ops_[t]) != std::string::npos) {
-          need_skip = true;
-          break;
-        }
+    for (size_t i = 0; i < ops_.size(); ++i) {
+      if (need_skip_ops_[i]) {
+        continue;
       }
-      if (!need_skip) {
-        op->Run(*thread_scope_, place_);
+      ops_[i]->Run(*thread_scope_, place_);
+      if (gc) {
+        DeleteUnusedTensors(*thread_scope_, ops_[i], unused_vars_, gc.get());
       }
     }
 
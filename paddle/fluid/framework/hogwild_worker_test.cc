@@ -0,0 +1,221 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/channel.h"
+#include "paddle/fluid/framework/data_feed.h"
+#include "paddle/fluid/framework/device_worker.h"
+#include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/framework/program_desc.h"
+
+DECLARE_double(eager_delete_tensor_gb);
+
+namespace paddle {
+namespace framework {
+
+// The variables of the attribute "freed" found initialized by the runs of
+// HogwildTestScaleOp.
+static std::vector<std::string> hogwild_test_live_vars;
+
+// Out = X * scale.
+class HogwildTestScaleOp : public OperatorBase {
+ public:
+  HogwildTestScaleOp(const std::string& type, const VariableNameMap& inputs,
+                     const VariableNameMap& outputs,
+                     const AttributeMap& attrs)
+      : OperatorBase(type, inputs, outputs, attrs) {}
+
+ private:
+  void RunImpl(const Scope& scope,
+               const platform::Place& place) const override {
+    for (auto& name : Attr<std::vector<std::string>>("freed")) {
+      auto* var = scope.FindVar(name);
+      if (var != nullptr && var->Get<LoDTensor>().IsInitialized()) {
+        hogwild_test_live_vars.push_back(name);
+      }
+    }
+    auto& x = scope.FindVar(Input("X"))->Get<LoDTensor>();
+    auto* out = scope.FindVar(Output("Out"))->GetMutable<LoDTensor>();
+    out->Resize(x.dims());
+    float* out_data = out->mutable_data<float>(place);
+    for (int64_t i = 0; i < x.numel(); ++i) {
+      out_data[i] = x.data<float>()[i] * Attr<float>("scale");
+    }
+  }
+};
+
+class HogwildTestScaleOpMaker : public OpProtoAndCheckerMaker {
+ public:
+  void Make() override {
+    AddInput("X", "input");
+    AddOutput("Out", "output");
+    AddAttr<float>("scale", "scale of X").SetDefault(1.f);
+    AddAttr<std::vector<std::string>>(
+        "freed", "variables expected to be freed before the op runs")
+        .SetDefault({});
+    AddComment("");
+  }
+};
+
+// Feeds x of batch b as [b, b + 1, ..., b + batch_size - 1].
+class HogwildTestDataFeed : public DataFeed {
+ public:
+  explicit HogwildTestDataFeed(int num_batches) : num_batches_(num_batches) {}
+
+  void Init(const DataFeedDesc& data_feed_desc) override {
+    use_slots_ = {"x"};
+    feed_vec_.resize(use_slots_.size());
+    batch_size_ = 4;
+    finish_init_ = true;
+  }
+
+  bool Start() override {
+    batch_ = 0;
+    return true;
+  }
+
+  int Next() override {
+    if (batch_ == num_batches_) {
+      return 0;
+    }
+    auto* x = feed_vec_[0];
+    x->Resize({batch_size_, 1});
+    float* data = x->mutable_data<float>(platform::CPUPlace());
+    for (int i = 0; i < batch_size_; ++i) {
+      data[i] = batch_ + i;
+    }
+    ++batch_;
+    return batch_size_;
+  }
+
+ private:
+  int num_batches_;
+  int batch_ = 0;
+};
+
+namespace {
+
+void AppendScaleOp(BlockDesc* block, const std::string& type,
+                   const std::string& x, const std::string& out, float scale,
+                   const std::vector<std::string>& freed = {}) {
+  auto* op = block->AppendOp();
+  op->SetType(type);
+  op->SetInput("X", {x});
+  op->SetOutput("Out", {out});
+  op->SetAttr("scale", scale);
+  op->SetAttr("freed", freed);
+}
+
+ProgramDesc MakeProgram() {
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  for (auto* name : {"x", "a", "b", "d", "s", "t", "out"}) {
+    block->Var(name)->SetType(proto::VarType::LOD_TENSOR);
+  }
+  AppendScaleOp(block, "hogwild_test_scale", "x", "a", 2);
+  AppendScaleOp(block, "hogwild_test_scale", "a", "b", 3);
+  // Dumped.
+  AppendScaleOp(block, "hogwild_test_scale", "a", "d", 5);
+  AppendScaleOp(block, "hogwild_test_scale", "a", "s", 7);
+  // Skipped, so s is kept for it.
+  AppendScaleOp(block, "hogwild_test_skip", "s", "t", 1);
+  // Fetched, a is not used after s.
+  AppendScaleOp(block, "hogwild_test_scale", "b", "out", 1, {"a"});
+  return program;
+}
+
+}  // namespace
+
+TEST(HogwildWorker, eager_deletion) {
+  double eager_delete_tensor_gb = FLAGS_eager_delete_tensor_gb;
+  auto place = platform::CPUPlace();
+  ProgramDesc program = MakeProgram();
+  TrainerDesc desc;
+  desc.mutable_fetch_config()->add_fetch_var_names("out");
+  desc.mutable_fetch_config()->add_fetch_var_str_format("out");
+  desc.mutable_hogwild_param()->add_skip_ops("hogwild_test_skip");
+  std::vector<std::string> dump_fields = {"d"};
+
+  std::vector<std::vector<float>> results;
+  for (double threshold : {-1.0, 0.0}) {
+    FLAGS_eager_delete_tensor_gb = threshold;
+    hogwild_test_live_vars.clear();
+    Scope root_scope;
+    HogwildTestDataFeed data_feed(3);
+    data_feed.Init(DataFeedDesc());
+    auto dump_channel = MakeChannel<std::string>();
+    HogwildWorker worker;
+    worker.SetNeedDumpField(true);
+    worker.SetNeedDumpParam(false);
+    worker.SetDumpFieldVector(dump_fields);
+    worker.Initialize(desc);
+    worker.SetDeviceIndex(0);
+    worker.SetDataFeed(&data_feed);
+    worker.SetChannelWriter(dump_channel.get());
+    worker.SetPlace(place);
+    worker.SetReaderPlace(place);
+    worker.SetRootScope(&root_scope);
+    worker.CreateDeviceResource(program);
+    worker.BindingDataFeedMemory();
+    worker.TrainFiles();
+
+    Scope* scope = worker.GetThreadScope();
+    auto initialized = [scope](const std::string& name) {
+      return scope->FindVar(name)->Get<LoDTensor>().IsInitialized();
+    };
+    // The feed, fetched, dumped and skipped op variables are kept.
+    for (auto* name : {"x", "out", "d", "s"}) {
+      EXPECT_TRUE(initialized(name)) << name;
+    }
+    EXPECT_FALSE(initialized("t"));
+    if (threshold < 0) {
+      EXPECT_TRUE(initialized("a"));
+      EXPECT_TRUE(initialized("b"));
+      EXPECT_EQ(hogwild_test_live_vars.size(), 3UL);
+    } else {
+      // Freed after their last use, in every batch.
+      EXPECT_FALSE(initialized("a"));
+      EXPECT_FALSE(initialized("b"));
+      EXPECT_TRUE(hogwild_test_live_vars.empty());
+    }
+    EXPECT_EQ(dump_channel->Size(), 3UL);
+
+    std::vector<float> result;
+    for (auto* name : {"out", "d", "s"}) {
+      auto& tensor = scope->FindVar(name)->Get<LoDTensor>();
+      result.insert(result.end(), tensor.data<float>(),
+                    tensor.data<float>() + tensor.numel());
+    }
+    results.push_back(result);
+  }
+  // The last batch is [2, 3, 4, 5].
+  EXPECT_EQ(results[0], std::vector<float>({12, 18, 24, 30, 20, 30, 40, 50,
+                                            28, 42, 56, 70}));
+  EXPECT_EQ(results[1], results[0]);
+  FLAGS_eager_delete_tensor_gb = eager_delete_tensor_gb;
+}
+
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_OP_WITHOUT_GRADIENT(hogwild_test_scale,
+                             paddle::framework::HogwildTestScaleOp,
+                             paddle::framework::HogwildTestScaleOpMaker);
+REGISTER_OP_WITHOUT_GRADIENT(hogwild_test_skip,
+                             paddle::framework::HogwildTestScaleOp,
+                             paddle::framework::HogwildTestScaleOpMaker);
@@ -15,9 +15,14 @@ limitations under the License. */
 #include "paddle/fluid/framework/io/fs.h"
 
 #include <sys/stat.h>
+#include <algorithm>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 
 #include "glog/logging.h"
+#include "paddle/fluid/framework/threadpool.h"
 #include "paddle/fluid/platform/enforce.h"
 
 namespace paddle {
@@ -351,7 +356,265 @@ void hdfs_mv(const std::string& src, const std::string& dest) {
       "%s -mv %s %s; true", hdfs_command().c_str(), src.c_str(), dest.c_str()));
 }
 
-int fs_select_internal(const std::string& path) {
+static std::mutex& fs_registry_mutex_internal() {
+  static std::mutex x;
+  return x;
+}
+
+static std::map<std::string, std::shared_ptr<FileSystem>>&
+fs_registry_internal() {
+  static std::map<std::string, std::shared_ptr<FileSystem>> x;
+  return x;
+}
+
+void fs_register_file_system(const std::string& prefix,
+                             std::shared_ptr<FileSystem> fs) {
+  std::lock_guard<std::mutex> lock(fs_registry_mutex_internal());
+  if (fs == nullptr) {
+    fs_registry_internal().erase(prefix);
+  } else {
+    fs_registry_internal()[prefix] = std::move(fs);
+  }
+}
+
+// The file system registered for the longest prefix of path, nullptr if
+// there is none.
+static std::shared_ptr<FileSystem> fs_get_file_system_internal(
+    const std::string& path) {
+  std::lock_guard<std::mutex> lock(fs_registry_mutex_internal());
+  std::shared_ptr<FileSystem> fs;
+  size_t length = 0;
+  for (auto& item : fs_registry_internal()) {
+    if (item.first.length() >= length &&
+        fs_begin_with_internal(path, item.first)) {
+      fs = item.second;
+      length = item.first.length();
+    }
+  }
+  return fs;
+}
+
+static size_t& fs_read_ahead_block_size_internal() {
+  static size_t x = 4 << 20;
+  return x;
+}
+
+static int& fs_read_ahead_num_blocks_internal() {
+  static int x = 4;
+  return x;
+}
+
+size_t fs_read_ahead_block_size() {
+  return fs_read_ahead_block_size_internal();
+}
+
+int fs_read_ahead_num_blocks() { return fs_read_ahead_num_blocks_internal(); }
+
+void fs_set_read_ahead(size_t block_size, int num_blocks) {
+  PADDLE_ENFORCE_GT(block_size, 0,
+                    platform::errors::InvalidArgument(
+                        "The read ahead block size must be positive."));
+  PADDLE_ENFORCE_GT(num_blocks, 0,
+                    platform::errors::InvalidArgument(
+                        "The read ahead number of blocks must be positive."));
+  fs_read_ahead_block_size_internal() = block_size;
+  fs_read_ahead_num_blocks_internal() = num_blocks;
+}
+
+// The blocks of all the files are read on these threads, so the number of
+// range reads outstanding is bounded in total, however many files are open.
+static ThreadPool* fs_read_ahead_pool_internal() {
+  static ThreadPool* x = new ThreadPool(32);
+  return x;
+}
+
+// Reads a file in order while up to num_blocks blocks after the position are
+// being read on the thread pool.
+class ReadAheadFile {
+ public:
+  ReadAheadFile(std::shared_ptr<RandomAccessFile> file, int64_t size,
+                size_t block_size, int num_blocks, int* err_no)
+      : file_(std::move(file)),
+        err_no_(err_no),
+        size_(size),
+        block_size_(block_size),
+        num_blocks_(num_blocks) {
+    Schedule();
+  }
+
+  // The same as the read of the stdio cookies: the number of bytes read, 0
+  // at the end of the file, -1 on an error.
+  ssize_t Read(char* buf, size_t size) {
+    size_t copied = 0;
+    while (copied < size) {
+      if (current_ == nullptr || pos_ == current_->data.size()) {
+        if (current_ != nullptr && current_->data.size() < block_size_) {
+          break;  // The end of the file.
+        }
+        if (!Next()) {
+          return copied > 0 ? static_cast<ssize_t>(copied) : -1;
+        }
+        continue;
+      }
+      size_t n = std::min(size - copied, current_->data.size() - pos_);
+      memcpy(buf + copied, current_->data.data() + pos_, n);
+      pos_ += n;
+      copied += n;
+    }
+    return copied;
+  }
+
+ private:
+  struct Block {
+    int64_t offset = 0;
+    std::string data;
+    bool failed = false;
+  };
+
+  void Schedule() {
+    while (pending_.size() < num_blocks_ &&
+           (size_ < 0 || next_offset_ < size_)) {
+      auto block = std::make_shared<Block>();
+      block->offset = next_offset_;
+      auto file = file_;
+      size_t length = block_size_;
+      auto future = fs_read_ahead_pool_internal()->Run([=]() {
+        block->data.resize(length);
+        size_t done = 0;
+        try {
+          while (done < length) {
+            int64_t n = file->ReadAt(block->offset + done, length - done,
+                                     &block->data[done]);
+            if (n < 0) {
+              block->failed = true;
+              break;
+            }
+            if (n == 0) break;
+            done += n;
+          }
+        } catch (...) {
+          block->failed = true;
+        }
+        block->data.resize(done);
+      });
+      pending_.emplace_back(std::move(block), std::move(future));
+      next_offset_ += block_size_;
+    }
+  }
+
+  // Moves to the next block, waiting for it. Returns false on an error.
+  bool Next() {
+    if (pending_.empty()) {
+      // A file of a known size ended exactly at a block end.
+      current_ = std::make_shared<Block>();
+      pos_ = 0;
+      return true;
+    }
+    pending_.front().second.get();
+    current_ = std::move(pending_.front().first);
+    pending_.pop_front();
+    pos_ = 0;
+    if (current_->failed) {
+      LOG(WARNING) << "Failed to read a block of a file at offset "
+                   << current_->offset;
+      if (err_no_ != nullptr) *err_no_ = -1;
+      return false;
+    }
+    Schedule();
+    return true;
+  }
+
+  std::shared_ptr<RandomAccessFile> file_;
+  // Set to -1 on an error, as the one of shell_popen.
+  int* err_no_;
+  int64_t size_;
+  size_t block_size_;
+  size_t num_blocks_;
+  int64_t next_offset_ = 0;
+  std::deque<std::pair<std::shared_ptr<Block>, std::future<void>>> pending_;
+  std::shared_ptr<Block> current_;
+  size_t pos_ = 0;
+};
+
+#if defined(_WIN32) || defined(__APPLE__)
+#else
+static ssize_t fs_read_ahead_cookie_read_internal(void* cookie, char* buf,
+                                                  size_t size) {
+  return static_cast<ReadAheadFile*>(cookie)->Read(buf, size);
+}
+
+static int fs_read_ahead_cookie_close_internal(void* cookie) {
+  delete static_cast<ReadAheadFile*>(cookie);
+  return 0;
+}
+
+static ssize_t fs_writable_cookie_write_internal(void* cookie,
+                                                 const char* buf,
+                                                 size_t size) {
+  auto* file = static_cast<std::shared_ptr<WritableFile>*>(cookie);
+  return (*file)->Append(buf, size) ? size : 0;
+}
+
+static int fs_writable_cookie_close_internal(void* cookie) {
+  auto* file = static_cast<std::shared_ptr<WritableFile>*>(cookie);
+  bool ok = (*file)->Close();
+  delete file;
+  return ok ? 0 : EOF;
+}
+#endif
+
+std::shared_ptr<FILE> fs_open_read_ahead(std::shared_ptr<RandomAccessFile> file,
+                                         int64_t size, int* err_no) {
+#if defined(_WIN32) || defined(__APPLE__)
+  PADDLE_THROW(platform::errors::Unimplemented(
+      "Reading through a FileSystem is only supported on Linux."));
+  return {};
+#else
+  auto* cookie = new ReadAheadFile(std::move(file), size,
+                                   fs_read_ahead_block_size(),
+                                   fs_read_ahead_num_blocks(), err_no);
+  cookie_io_functions_t functions = {fs_read_ahead_cookie_read_internal,
+                                     nullptr, nullptr,
+                                     fs_read_ahead_cookie_close_internal};
+  FILE* fp = fopencookie(cookie, "r", functions);
+  PCHECK(fp != nullptr);
+  return {fp, [](FILE* fp) { fclose(fp); }};
+#endif
+}
+
+static std::shared_ptr<FILE> fs_open_writable_internal(
+    std::shared_ptr<WritableFile> file) {
+#if defined(_WIN32) || defined(__APPLE__)
+  PADDLE_THROW(platform::errors::Unimplemented(
+      "Writing through a FileSystem is only supported on Linux."));
+  return {};
+#else
+  auto* cookie = new std::shared_ptr<WritableFile>(std::move(file));
+  cookie_io_functions_t functions = {
+      nullptr, fs_writable_cookie_write_internal, nullptr,
+      fs_writable_cookie_close_internal};
+  FILE* fp = fopencookie(cookie, "w", functions);
+  PCHECK(fp != nullptr);
+  // Appends in blocks rather than in the small writes of the callers.
+  size_t buffer_size = fs_read_ahead_block_size();
+  char* buffer = new char[buffer_size];
+  CHECK_EQ(0, setvbuf(fp, buffer, _IOFBF, buffer_size));
+  return {fp, [buffer](FILE* fp) {
+            PCHECK(fclose(fp) == 0);
+            delete[] buffer;
+          }};
+#endif
+}
+
+// A converter is run by the shell, so the files needing one are read and
+// written through the shell commands, "cat" is the same as none.
+static bool fs_need_shell_internal(const std::string& path,
+                                   const std::string& converter) {
+  return fs_end_with_internal(path, ".gz") ||
+         (converter != "" && converter != "cat");
+}
+
+static int fs_select_shell_internal(const std::string& path) {
   if (fs_begin_with_internal(path, "hdfs:")) {
     return 1;
   } else if (fs_begin_with_internal(path, "afs:")) {
@@ -361,15 +624,109 @@ int fs_select_internal(const std::string& path) {
   return 0;
 }
 
+// The shell commands only reach the files of hdfs and afs, the other
+// registered file systems are not on the local disk.
+static void nativefs_check_shell_internal(const std::string& path,
+                                          const std::string& converter) {
+  if (fs_select_shell_internal(path) != 1) {
+    PADDLE_THROW(platform::errors::Unimplemented(
+        "The file system registered for path[%s] does not support the .gz "
+        "files or the converter[%s].",
+        path, converter));
+  }
+}
+
+static std::shared_ptr<FILE> nativefs_open_read_internal(
+    const std::shared_ptr<FileSystem>& fs, const std::string& path,
+    int* err_no, const std::string& converter) {
+  if (fs_need_shell_internal(path, converter)) {
+    nativefs_check_shell_internal(path, converter);
+    return hdfs_open_read(path, err_no, converter);
+  }
+
+  auto file = fs->OpenRead(path);
+  if (file == nullptr) {
+    PADDLE_THROW(platform::errors::Unavailable(
+        "Failed to open file, path[%s], mode[r].", path));
+  }
+  return fs_open_read_ahead(std::move(file), fs->FileSize(path), err_no);
+}
+
+static std::shared_ptr<FILE> nativefs_open_write_internal(
+    const std::shared_ptr<FileSystem>& fs, const std::string& path,
+    int* err_no, const std::string& converter) {
+  if (fs_need_shell_internal(path, converter)) {
+    nativefs_check_shell_internal(path, converter);
+    return hdfs_open_write(path, err_no, converter);
+  }
+
+  auto file = fs->OpenWrite(path);
+  if (file == nullptr) {
+    PADDLE_THROW(platform::errors::Unavailable(
+        "Failed to open file, path[%s], mode[w].", path));
+  }
+  return fs_open_writable_internal(std::move(file));
+}
+
+static std::string nativefs_tail_internal(
+    const std::shared_ptr<FileSystem>& fs, const std::string& path) {
+  auto file = fs->OpenRead(path);
+  int64_t size = fs->FileSize(path);
+  if (file == nullptr || size <= 0) {
+    return "";
+  }
+
+  // The last line, searched for in ever larger ends of the file.
+  for (int64_t length = 4096;; length *= 2) {
+    int64_t offset = std::max<int64_t>(size - length, 0);
+    std::string data(size - offset, '\0');
+    int64_t n = file->ReadAt(offset, data.size(), &data[0]);
+    if (n < 0) {
+      return "";
+    }
+    data.resize(n);
+    while (!data.empty() && data.back() == '\n') {
+      data.pop_back();
+    }
+    size_t begin = data.rfind('\n');
+    if (begin != std::string::npos) {
+      return data.substr(begin + 1);
+    }
+    if (offset == 0) {
+      return data;
+    }
+  }
+}
+
+// Also returns the registered file system of path in fs, which is looked up
+// once as it may be unregistered meanwhile.
+static int fs_select_internal(const std::string& path,
+                              std::shared_ptr<FileSystem>* fs) {
+  *fs = fs_get_file_system_internal(path);
+  if (*fs != nullptr) {
+    return 2;
+  }
+  return fs_select_shell_internal(path);
+}
+
+int fs_select_internal(const std::string& path) {
+  std::shared_ptr<FileSystem> fs;
+  return fs_select_internal(path, &fs);
+}
+
 std::shared_ptr<FILE> fs_open_read(const std::string& path, int* err_no,
                                    const std::string& converter) {
-  switch (fs_select_internal(path)) {
+  std::shared_ptr<FileSystem> fs;
+  switch (fs_select_internal(path, &fs)) {
     case 0:
       return localfs_open_read(path, converter);
 
     case 1:
       return hdfs_open_read(path, err_no, converter);
 
+    case 2:
+      return nativefs_open_read_internal(fs, path, err_no, converter);
+
     default:
       PADDLE_THROW(platform::errors::Unimplemented(
           "Unsupport file system. Now only supports local file system and "
@@ -381,13 +738,17 @@ std::shared_ptr<FILE> fs_open_read(const std::string& path, int* err_no,
 
 std::shared_ptr<FILE> fs_open_write(const std::string& path, int* err_no,
                                     const std::string& converter) {
-  switch (fs_select_internal(path)) {
+  std::shared_ptr<FileSystem> fs;
+  switch (fs_select_internal(path, &fs)) {
     case 0:
       return localfs_open_write(path, converter);
 
     case 1:
       return hdfs_open_write(path, err_no, converter);
 
+    case 2:
+      return nativefs_open_write_internal(fs, path, err_no, converter);
+
     default:
       PADDLE_THROW(platform::errors::Unimplemented(
           "Unsupport file system. Now only supports local file system and "
@@ -414,10 +775,14 @@ std::shared_ptr<FILE> fs_open(const std::string& path, const std::string& mode,
 }
 
 int64_t fs_file_size(const std::string& path) {
-  switch (fs_select_internal(path)) {
+  std::shared_ptr<FileSystem> fs;
+  switch (fs_select_internal(path, &fs)) {
     case 0:
       return localfs_file_size(path);
 
+    case 2:
+      return fs->FileSize(path);
+
     default:
       PADDLE_THROW(platform::errors::Unimplemented(
           "Unsupport file system. Now only supports local file system."));
@@ -427,13 +792,17 @@ int64_t fs_file_size(const std::string& path) {
 }
 
 void fs_remove(const std::string& path) {
-  switch (fs_select_internal(path)) {
+  std::shared_ptr<FileSystem> fs;
+  switch (fs_select_internal(path, &fs)) {
     case 0:
       return localfs_remove(path);
 
     case 1:
       return hdfs_remove(path);
 
+    case 2:
+      return fs->Remove(path);
+
     default:
       PADDLE_THROW(platform::errors::Unimplemented(
           "Unsupport file system. Now only supports local file system and "
@@ -442,13 +811,17 @@ void fs_remove(const std::string& path) {
 }
 
 std::vector<std::string> fs_list(const std::string& path) {
-  switch (fs_select_internal(path)) {
+  std::shared_ptr<FileSystem> fs;
+  switch (fs_select_internal(path, &fs)) {
     case 0:
       return localfs_list(path);
 
     case 1:
       return hdfs_list(path);
 
+    case 2:
+      return fs->List(path);
+
     default:
       PADDLE_THROW(platform::errors::Unimplemented(
           "Unsupport file system. Now only supports local file system and "
@@ -459,13 +832,17 @@ std::vector<std::string> fs_list(const std::string& path) {
 }
 
 std::string fs_tail(const std::string& path) {
-  switch (fs_select_internal(path)) {
+  std::shared_ptr<FileSystem> fs;
+  switch (fs_select_internal(path, &fs)) {
     case 0:
       return localfs_tail(path);
 
     case 1:
       return hdfs_tail(path);
 
+    case 2:
+      return nativefs_tail_internal(fs, path);
+
     default:
       PADDLE_THROW(platform::errors::Unimplemented(
           "Unsupport file system. Now only supports local file system and "
@@ -476,13 +853,17 @@ std::string fs_tail(const std::string& path) {
 }
 
 bool fs_exists(const std::string& path) {
-  switch (fs_select_internal(path)) {
+  std::shared_ptr<FileSystem> fs;
+  switch (fs_select_internal(path, &fs)) {
     case 0:
       return localfs_exists(path);
 
     case 1:
       return hdfs_exists(path);
 
+    case 2:
+      return fs->Exists(path);
+
     default:
       PADDLE_THROW(platform::errors::Unimplemented(
           "Unsupport file system. Now only supports local file system and "
@@ -493,13 +874,17 @@ bool fs_exists(const std::string& path) {
 }
 
 void fs_mkdir(const std::string& path) {
-  switch (fs_select_internal(path)) {
+  std::shared_ptr<FileSystem> fs;
+  switch (fs_select_internal(path, &fs)) {
     case 0:
       return localfs_mkdir(path);
 
     case 1:
       return hdfs_mkdir(path);
 
+    case 2:
+      return fs->Mkdir(path);
+
     default:
       PADDLE_THROW(platform::errors::Unimplemented(
           "Unsupport file system. Now only supports local file system and "
@@ -508,8 +893,9 @@ void fs_mkdir(const std::string& path) {
 }
 
 void fs_mv(const std::string& src, const std::string& dest) {
-  int s = fs_select_internal(src);
-  int d = fs_select_internal(dest);
+  std::shared_ptr<FileSystem> fs, dest_fs;
+  int s = fs_select_internal(src, &fs);
+  int d = fs_select_internal(dest, &dest_fs);
   CHECK_EQ(s, d);
   switch (s) {
     case 0:
@@ -517,6 +903,13 @@ void fs_mv(const std::string& src, const std::string& dest) {
 
     case 1:
       return hdfs_mv(src, dest);
+
+    case 2:
+      if (fs != dest_fs) {
+        PADDLE_THROW(platform::errors::Unimplemented(
+            "Can not move %s to %s of another file system.", src, dest));
+      }
+      return fs->Mv(src, dest);
   }
 }
 
@@ -85,6 +85,71 @@ extern void hdfs_mkdir(const std::string& path);
 
 extern void hdfs_mv(const std::string& src, const std::string& dest);
 
+// native file systems
+// A file of a FileSystem opened for reading. ReadAt may be called by several
+// threads at the same time.
+class RandomAccessFile {
+ public:
+  virtual ~RandomAccessFile() = default;
+
+  // Reads up to size bytes at offset into buf. Returns the number of bytes
+  // read, less than size only at the end of the file, or -1 on an error.
+  virtual int64_t ReadAt(int64_t offset, size_t size, char* buf) = 0;
+};
+
+// A file of a FileSystem opened for writing.
+class WritableFile {
+ public:
+  virtual ~WritableFile() = default;
+
+  // Both return false on an error.
+  virtual bool Append(const char* data, size_t size) = 0;
+  virtual bool Close() = 0;
+};
+
+// The client of a file system, e.g. HDFS or an object store, used by the fs_*
+// functions instead of the shell commands for the paths it is registered for.
+// It is shared by all the files opened, so it is expected to reuse its
+// connections, and must be thread safe.
+class FileSystem {
+ public:
+  virtual ~FileSystem() = default;
+
+  // Both return nullptr on an error.
+  virtual std::shared_ptr<RandomAccessFile> OpenRead(
+      const std::string& path) = 0;
+  virtual std::shared_ptr<WritableFile> OpenWrite(const std::string& path) = 0;
+
+  // -1 when the size is unknown.
+  virtual int64_t FileSize(const std::string& path) = 0;
+  // The paths of the files in the directory.
+  virtual std::vector<std::string> List(const std::string& path) = 0;
+  virtual bool Exists(const std::string& path) = 0;
+  virtual void Remove(const std::string& path) = 0;
+  virtual void Mkdir(const std::string& path) = 0;
+  virtual void Mv(const std::string& src, const std::string& dest) = 0;
+};
+
+// Uses fs for the paths beginning with prefix, e.g. "hdfs:", the longest
+// prefix registered wins. A nullptr fs unregisters the prefix.
+extern void fs_register_file_system(const std::string& prefix,
+                                    std::shared_ptr<FileSystem> fs);
+
+// The files of a FileSystem are read num_blocks blocks of block_size bytes
+// ahead, each block by a separate ReadAt on a shared thread pool, so that
+// several range reads of a file are outstanding at the same time.
+extern size_t fs_read_ahead_block_size();
+
+extern int fs_read_ahead_num_blocks();
+
+extern void fs_set_read_ahead(size_t block_size, int num_blocks);
+
+// Reads file with the read ahead, through a FILE. size is the one of the
+// file, -1 when it is unknown. *err_no is set to -1 when a read fails.
+extern std::shared_ptr<FILE> fs_open_read_ahead(
+    std::shared_ptr<RandomAccessFile> file, int64_t size,
+    int* err_no = nullptr);
+
 // aut-detect fs
 extern std::shared_ptr<FILE> fs_open_read(const std::string& path, int* err_no,
                                           const std::string& converter);
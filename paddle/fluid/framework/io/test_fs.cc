@@ -13,7 +13,11 @@
 // limitations under the License.
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <fstream>
+#include <thread>  // NOLINT
 #include "paddle/fluid/framework/io/fs.h"
 
 #if defined _WIN32 || defined __APPLE__
@@ -45,3 +49,172 @@ TEST(FS, mv) {
   }
 #endif
 }
+
+#ifdef _LINUX
+// A file system of the paths "mock:<name>", kept in a local directory, whose
+// reads take a while, like the ones of a remote file system.
+class MockFileSystem : public paddle::framework::FileSystem {
+ public:
+  explicit MockFileSystem(const std::string& dir) : dir_(dir) {
+    paddle::framework::localfs_mkdir(dir_);
+  }
+
+  class File : public paddle::framework::RandomAccessFile {
+   public:
+    File(MockFileSystem* fs, const std::string& path) : fs_(fs), path_(path) {}
+
+    int64_t ReadAt(int64_t offset, size_t size, char* buf) override {
+      int reads = ++fs_->outstanding_reads_;
+      int max_reads = fs_->max_outstanding_reads_;
+      while (reads > max_reads &&
+             !fs_->max_outstanding_reads_.compare_exchange_weak(max_reads,
+                                                                reads)) {
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      std::ifstream in(path_, std::ios::binary);
+      in.seekg(offset);
+      in.read(buf, size);
+      --fs_->outstanding_reads_;
+      return in.gcount();
+    }
+
+   private:
+    MockFileSystem* fs_;
+    std::string path_;
+  };
+
+  class WritableFile : public paddle::framework::WritableFile {
+   public:
+    explicit WritableFile(const std::string& path)
+        : out_(path, std::ios::binary) {}
+
+    bool Append(const char* data, size_t size) override {
+      return static_cast<bool>(out_.write(data, size));
+    }
+
+    bool Close() override {
+      out_.close();
+      return static_cast<bool>(out_);
+    }
+
+   private:
+    std::ofstream out_;
+  };
+
+  std::shared_ptr<paddle::framework::RandomAccessFile> OpenRead(
+      const std::string& path) override {
+    if (!Exists(path)) return nullptr;
+    return std::make_shared<File>(this, Local(path));
+  }
+
+  std::shared_ptr<paddle::framework::WritableFile> OpenWrite(
+      const std::string& path) override {
+    return std::make_shared<WritableFile>(Local(path));
+  }
+
+  int64_t FileSize(const std::string& path) override {
+    return paddle::framework::localfs_file_size(Local(path));
+  }
+
+  std::vector<std::string> List(const std::string& path) override {
+    std::vector<std::string> list;
+    for (auto& file : paddle::framework::localfs_list(Local(path))) {
+      list.push_back("mock:" + file.substr(dir_.length() + 1));
+    }
+    return list;
+  }
+
+  bool Exists(const std::string& path) override {
+    return paddle::framework::localfs_exists(Local(path));
+  }
+
+  void Remove(const std::string& path) override {
+    paddle::framework::localfs_remove(Local(path));
+  }
+
+  void Mkdir(const std::string& path) override {
+    paddle::framework::localfs_mkdir(Local(path));
+  }
+
+  void Mv(const std::string& src, const std::string& dest) override {
+    paddle::framework::localfs_mv(Local(src), Local(dest));
+  }
+
+  std::atomic<int> outstanding_reads_{0};
+  std::atomic<int> max_outstanding_reads_{0};
+
+ private:
+  std::string Local(const std::string& path) {
+    return dir_ + "/" + path.substr(strlen("mock:"));
+  }
+
+  std::string dir_;
+};
+#endif
+
+TEST(FS, native) {
+#ifdef _LINUX
+  auto fs = std::make_shared<MockFileSystem>("test_fs_mock");
+  paddle::framework::fs_register_file_system("mock:", fs);
+  size_t block_size = paddle::framework::fs_read_ahead_block_size();
+  int num_blocks = paddle::framework::fs_read_ahead_num_blocks();
+  paddle::framework::fs_set_read_ahead(100, 4);
+
+  std::string content;
+  for (int i = 0; i < 1000; ++i) {
+    content += "line " + std::to_string(i) + "\n";
+  }
+  int err_no = 0;
+  {
+    auto fp = paddle::framework::fs_open_write("mock:a.txt", &err_no, "");
+    ASSERT_EQ(fwrite(content.data(), 1, content.size(), &*fp),
+              content.size());
+  }
+  EXPECT_TRUE(paddle::framework::fs_exists("mock:a.txt"));
+  EXPECT_EQ(paddle::framework::fs_file_size("mock:a.txt"),
+            static_cast<int64_t>(content.size()));
+  EXPECT_EQ(paddle::framework::fs_tail("mock:a.txt"), "line 999");
+
+  // "cat" changes nothing, so the file is still read by the ranges.
+  for (auto converter : {"", "cat"}) {
+    auto fp = paddle::framework::fs_open_read("mock:a.txt", &err_no, converter);
+    std::string read;
+    char buf[37];
+    size_t n = 0;
+    while ((n = fread(buf, 1, sizeof(buf), &*fp)) > 0) {
+      read.append(buf, n);
+    }
+    EXPECT_EQ(read, content);
+  }
+  EXPECT_GT(fs->max_outstanding_reads_.load(), 1);
+  EXPECT_LE(fs->max_outstanding_reads_.load(), 4);
+  EXPECT_ANY_THROW(paddle::framework::fs_open_read("mock:none", &err_no, ""));
+  // The shell commands, for .gz files and converters, do not reach the file
+  // system.
+  EXPECT_ANY_THROW(paddle::framework::fs_open_read("mock:a.gz", &err_no, ""));
+  EXPECT_ANY_THROW(
+      paddle::framework::fs_open_read("mock:a.txt", &err_no, "gzip -d"));
+  EXPECT_ANY_THROW(
+      paddle::framework::fs_open_write("mock:c.txt", &err_no, "gzip"));
+  EXPECT_FALSE(paddle::framework::localfs_exists("mock:c.txt"));
+
+  // Moving across registered file systems is not supported.
+  paddle::framework::fs_register_file_system(
+      "other:", std::make_shared<MockFileSystem>("test_fs_mock"));
+  EXPECT_ANY_THROW(paddle::framework::fs_mv("mock:a.txt", "other:b.txt"));
+  paddle::framework::fs_register_file_system("other:", nullptr);
+  EXPECT_TRUE(paddle::framework::fs_exists("mock:a.txt"));
+
+  paddle::framework::fs_mv("mock:a.txt", "mock:b.txt");
+  EXPECT_FALSE(paddle::framework::fs_exists("mock:a.txt"));
+  EXPECT_EQ(paddle::framework::fs_list("mock:"),
+            std::vector<std::string>{"mock:b.txt"});
+  paddle::framework::fs_remove("mock:b.txt");
+  EXPECT_TRUE(paddle::framework::fs_list("mock:").empty());
+
+  paddle::framework::fs_set_read_ahead(block_size, num_blocks);
+  paddle::framework::fs_register_file_system("mock:", nullptr);
+  EXPECT_EQ(paddle::framework::fs_select_internal("mock:b.txt"), 0);
+  paddle::framework::localfs_remove("test_fs_mock");
+#endif
+}
@@ -13,6 +13,10 @@
 // limitations under the License.
 
 #include "paddle/fluid/framework/ir/graph_pattern_detector.h"
+
+#include <algorithm>
+#include <limits>
+
 #include "paddle/fluid/framework/ir/graph_traits.h"
 #include "paddle/fluid/framework/ir/graph_viz_pass.h"
 #include "paddle/fluid/framework/operator.h"
@@ -100,11 +104,62 @@ bool GraphPatternDetector::MarkPDNodesInGraph(const ir::Graph &graph) {
   VLOG(3) << "mark pdnodes in graph";
   if (graph.Nodes().empty()) return false;
 
+  // Index the nodes by the op types they link to, the op types can be changed
+  // in place by the passes, so the index is built for each detection.
+  using Linked = PDNode::Linked;
+  std::map<Linked, std::unordered_map<std::string, std::vector<Node *>>>
+      linked_nodes;
+  std::vector<Node *> all_nodes;
   for (auto &node : GraphTraits::DFS(graph)) {
-    for (const auto &pdnode : pattern_.nodes()) {
-      if (pdnode->Tell(&node)) {
-        VLOG(4) << "Node " << node.Name() << " marked as " << pdnode->name();
-        pdnodes2nodes_[pdnode.get()].insert(&node);
+    all_nodes.push_back(&node);
+    if (node.IsOp()) {
+      if (node.Op()) {
+        linked_nodes[Linked::kIsOp][node.Op()->Type()].push_back(&node);
+      }
+      continue;
+    }
+    std::unordered_set<std::string> types;
+    for (auto *op : node.outputs) {
+      if (op->IsOp() && op->Op() && types.insert(op->Op()->Type()).second) {
+        linked_nodes[Linked::kOpInput][op->Op()->Type()].push_back(&node);
+      }
+    }
+    types.clear();
+    for (auto *op : node.inputs) {
+      if (op->IsOp() && op->Op() && types.insert(op->Op()->Type()).second) {
+        linked_nodes[Linked::kOpOutput][op->Op()->Type()].push_back(&node);
+      }
+    }
+  }
+
+  for (const auto &pdnode : pattern_.nodes()) {
+    // Only tell the nodes linked to the op types of the most selective
+    // assert, the others can not pass it.
+    const std::vector<Node *> *candidates = &all_nodes;
+    std::vector<Node *> linked;
+    size_t num_linked = all_nodes.size();
+    for (auto &op_types : pdnode->op_types_) {
+      if (pdnode->teller_) break;
+      auto &nodes = linked_nodes[op_types.first];
+      size_t num = 0;
+      for (auto &type : op_types.second) {
+        auto it = nodes.find(type);
+        if (it != nodes.end()) num += it->second.size();
+      }
+      if (candidates != &all_nodes && num >= num_linked) continue;
+      num_linked = num;
+      linked.clear();
+      for (auto &type : op_types.second) {
+        auto it = nodes.find(type);
+        if (it == nodes.end()) continue;
+        linked.insert(linked.end(), it->second.begin(), it->second.end());
+      }
+      candidates = &linked;
+    }
+    for (auto *node : *candidates) {
+      if (pdnode->Tell(node)) {
+        VLOG(4) << "Node " << node->Name() << " marked as " << pdnode->name();
+        pdnodes2nodes_[pdnode.get()].insert(node);
       }
     }
   }
@@ -188,55 +243,131 @@ bool IsNodesLink(Node *a, Node *b) {
   return false;
 }
 
+// The distinct nodes in nodes, in their order.
+std::vector<Node *> UniqueNodes(const std::vector<Node *> &nodes) {
+  std::vector<Node *> result;
+  for (auto *node : nodes) {
+    if (std::find(result.begin(), result.end(), node) == result.end()) {
+      result.push_back(node);
+    }
+  }
+  return result;
+}
+
 std::vector<GraphPatternDetector::subgraph_t>
 GraphPatternDetector::DetectPatterns() {
   // Init empty subgraphs.
   std::vector<GraphPatternDetector::subgraph_t> result;
-  std::vector<HitGroup> init_groups;
+  const auto &edges = pattern_.edges();
+  if (edges.empty()) {
+    auto *pnode = pattern().nodes().front().get();
+    if (!pdnodes2nodes_.count(pnode)) return result;
+    for (auto *node : pdnodes2nodes_[pnode]) {
+      result.emplace_back(subgraph_t{{pnode, node}});
+    }
+    return result;
+  }
+  for (const auto &edge : edges) {
+    if (!pdnodes2nodes_.count(edge.first) ||
+        !pdnodes2nodes_.count(edge.second)) {
+      return result;
+    }
+  }
+  auto num_nodes = [&](PDNode *pnode) {
+    return pdnodes2nodes_.at(pnode).size();
+  };
+
+  // Order the edges to match them from the PDNode with the fewest nodes, an
+  // edge with both of its PDNodes matched first, then the one adding the
+  // PDNode with the fewest nodes.
+  std::set<PDNode *> bound;
+  PDNode *first_pnode = edges.front().first;
+  for (const auto &edge : edges) {
+    for (auto *pnode : {edge.first, edge.second}) {
+      if (num_nodes(pnode) < num_nodes(first_pnode)) first_pnode = pnode;
+    }
+  }
+  bound.insert(first_pnode);
+  std::vector<PDPattern::edge_t> ordered_edges;
+  std::vector<bool> used(edges.size(), false);
+  for (size_t step = 0; step < edges.size(); ++step) {
+    size_t best = edges.size();
+    size_t best_cost = 0;
+    for (size_t i = 0; i < edges.size(); ++i) {
+      if (used[i]) continue;
+      bool first_bound = bound.count(edges[i].first);
+      bool second_bound = bound.count(edges[i].second);
+      // An edge apart from the matched PDNodes only when there is no other.
+      size_t cost = std::numeric_limits<size_t>::max();
+      if (first_bound && second_bound) {
+        cost = 0;
+      } else if (first_bound) {
+        cost = 1 + num_nodes(edges[i].second);
+      } else if (second_bound) {
+        cost = 1 + num_nodes(edges[i].first);
+      }
+      if (best == edges.size() || cost < best_cost) {
+        best = i;
+        best_cost = cost;
+      }
+    }
+    used[best] = true;
+    ordered_edges.push_back(edges[best]);
+    bound.insert(edges[best].first);
+    bound.insert(edges[best].second);
+  }
+
   std::array<std::vector<HitGroup>, 2> bi_records;
-  auto *first_pnode = pattern_.edges().empty() ? pattern().nodes().front().get()
-                                               : pattern_.edges().front().first;
-  if (!pdnodes2nodes_.count(first_pnode)) return result;
   for (auto *node : pdnodes2nodes_[first_pnode]) {
     HitGroup group;
-    group.roles[first_pnode] = node;
-    init_groups.emplace_back(group);
+    group.Register(node, first_pnode);
+    bi_records[0].emplace_back(group);
   }
+  bound = {first_pnode};
 
+  // Extend the subgraphs by the links of their nodes matched to the PDNodes
+  // of the edges.
   int step = 0;
-  bi_records[0] = std::move(init_groups);
-
-  // Extend a PDNode to subgraphs by deducing the connection relations defined
-  // in edges of PDNodes.
-  for (const auto &edge : pattern_.edges()) {
+  for (const auto &edge : ordered_edges) {
     VLOG(4) << "check " << edge.first->name() << " -> " << edge.second->name();
-    // TODO(Superjomn) Fix bug here, the groups might be duplicate here.
-    // Each role has two PDNodes, which indicates two roles.
-    // Detect two Nodes that can match these two roles and they are connected.
     auto &pre_groups = bi_records[step % 2];
     auto &cur_groups = bi_records[1 - (step++ % 2)];
     cur_groups.clear();
     if (pre_groups.empty()) break;
-    // source -> target
-    for (Node *source : pdnodes2nodes_[edge.first]) {
-      for (Node *target : pdnodes2nodes_[edge.second]) {
-        VLOG(8) << "check " << source->id() << " -- " << target->id();
-        // TODO(Superjomn) add some prune strategies.
-        for (const auto &group : pre_groups) {
-          if (IsNodesLink(source, target)) {
-            HitGroup new_group = group;
-            bool flag = new_group.Match(source, edge.first) &&
-                        new_group.Match(target, edge.second);
-            if (flag) {
-              new_group.Register(source, edge.first);
-              new_group.Register(target, edge.second);
-              cur_groups.push_back(new_group);
-              // TODO(Superjomn) need to unique
-            }
+    const auto &sources = pdnodes2nodes_[edge.first];
+    const auto &targets = pdnodes2nodes_[edge.second];
+    auto extend = [&](const HitGroup &group, Node *source, Node *target) {
+      HitGroup new_group = group;
+      if (new_group.Match(source, edge.first) &&
+          new_group.Match(target, edge.second)) {
+        new_group.Register(source, edge.first);
+        new_group.Register(target, edge.second);
+        cur_groups.push_back(new_group);
+      }
+    };
+    for (auto &group : pre_groups) {
+      if (bound.count(edge.first)) {
+        Node *source = group.roles.at(edge.first);
+        for (auto *target : UniqueNodes(source->outputs)) {
+          if (targets.count(target)) extend(group, source, target);
+        }
+      } else if (bound.count(edge.second)) {
+        Node *target = group.roles.at(edge.second);
+        for (auto *source : UniqueNodes(target->inputs)) {
+          if (sources.count(source) && IsNodesLink(source, target)) {
+            extend(group, source, target);
+          }
+        }
+      } else {
+        for (auto *source : sources) {
+          for (auto *target : UniqueNodes(source->outputs)) {
+            if (targets.count(target)) extend(group, source, target);
           }
         }
       }
     }
+    bound.insert(edge.first);
+    bound.insert(edge.second);
     VLOG(3) << "step " << step << " get records: " << cur_groups.size();
     for (auto &group : cur_groups) {
       for (auto &item : group.roles) {
@@ -246,9 +377,28 @@ GraphPatternDetector::DetectPatterns() {
     }
   }
 
-  for (auto &group : bi_records[step % 2]) {
+  // Order the subgraphs as matching the edges in the order they were added
+  // does, by the nodes of the last edge first.
+  auto &groups = bi_records[step % 2];
+  std::vector<std::pair<std::vector<Node *>, size_t>> keys;
+  for (size_t i = 0; i < groups.size(); ++i) {
+    std::vector<Node *> key;
+    for (auto it = edges.rbegin(); it != edges.rend(); ++it) {
+      key.push_back(groups[i].roles.at(it->first));
+      key.push_back(groups[i].roles.at(it->second));
+    }
+    keys.emplace_back(std::move(key), i);
+  }
+  std::sort(keys.begin(), keys.end(),
+            [](const std::pair<std::vector<Node *>, size_t> &a,
+               const std::pair<std::vector<Node *>, size_t> &b) {
+              return std::lexicographical_compare(
+                  a.first.begin(), a.first.end(), b.first.begin(),
+                  b.first.end(), std::less<Node *>());
+            });
+  for (auto &key : keys) {
     GraphPatternDetector::subgraph_t subgraph;
-    for (auto &role : group.roles) {
+    for (auto &role : groups[key.second].roles) {
       subgraph.emplace(role.first, role.second);
     }
     result.emplace_back(subgraph);
@@ -402,6 +552,8 @@ PDNode *PDNode::assert_is_op() {
 }
 
 PDNode *PDNode::assert_is_op(const std::string &op_type) {
+  op_types_.emplace_back(Linked::kIsOp,
+                         std::unordered_set<std::string>{op_type});
   asserts_.emplace_back([op_type](Node *x) {
     return x && x->IsOp() && x->Op()->Type() == op_type;
   });
@@ -455,6 +607,8 @@ PDNode *PDNode::assert_is_op_nth_input(const std::string &op_type,
 PDNode *PDNode::assert_is_op_nth_output(const std::string &op_type,
                                         const std::string &argument, int nth) {
   assert_is_var();
+  op_types_.emplace_back(Linked::kOpOutput,
+                         std::unordered_set<std::string>{op_type});
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->inputs) {
       if (op->IsOp() && op->Op()->Type() == op_type &&
@@ -468,6 +622,8 @@ PDNode *PDNode::assert_is_op_nth_output(const std::string &op_type,
 
 PDNode *PDNode::assert_is_only_input_of_op(const std::string &op_type) {
   assert_is_var();
+  op_types_.emplace_back(Linked::kOpInput,
+                         std::unordered_set<std::string>{op_type});
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->outputs) {
       if (op && op->IsOp() && op->Op() && op->Op()->Type() == op_type &&
@@ -482,6 +638,8 @@ PDNode *PDNode::assert_is_only_input_of_op(const std::string &op_type) {
 
 PDNode *PDNode::assert_is_only_output_of_op(const std::string &op_type) {
   assert_is_var();
+  op_types_.emplace_back(Linked::kOpOutput,
+                         std::unordered_set<std::string>{op_type});
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->inputs) {
       if (op && op->IsOp() && op->Op() && op->Op()->Type() == op_type &&
@@ -496,6 +654,8 @@ PDNode *PDNode::assert_is_only_output_of_op(const std::string &op_type) {
 
 PDNode *PDNode::assert_is_op_output(const std::string &op_type) {
   assert_is_var();
+  op_types_.emplace_back(Linked::kOpOutput,
+                         std::unordered_set<std::string>{op_type});
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->inputs) {
       if (op && op->IsOp() && op->Op() && op->Op()->Type() == op_type) {
@@ -516,6 +676,8 @@ PDNode *PDNode::assert_is_op_output(const std::string &op_type,
 
 PDNode *PDNode::assert_is_op_input(const std::string &op_type) {
   assert_is_var();
+  op_types_.emplace_back(Linked::kOpInput,
+                         std::unordered_set<std::string>{op_type});
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->outputs) {
       if (op && op->IsOp() && op->Op() && op->Op()->Type() == op_type) {
@@ -572,6 +734,7 @@ PDNode *PDNode::assert_more(PDNode::teller_t &&teller) {
 }
 
 PDNode *PDNode::assert_is_ops(const std::unordered_set<std::string> &op_types) {
+  op_types_.emplace_back(Linked::kIsOp, op_types);
   asserts_.emplace_back([op_types](Node *x) {
     return x && x->IsOp() && op_types.count(x->Op()->Type());
   });
@@ -598,6 +761,7 @@ PDNode *PDNode::assert_is_ops_nth_output(
     const std::unordered_set<std::string> &op_types,
     const std::string &argument, int nth) {
   assert_is_var();
+  op_types_.emplace_back(Linked::kOpOutput, op_types);
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->inputs) {
       if (op->IsOp() && op_types.count(op->Op()->Type()) &&
@@ -611,6 +775,7 @@ PDNode *PDNode::assert_is_ops_nth_output(
 PDNode *PDNode::assert_is_ops_output(
     const std::unordered_set<std::string> &op_types) {
   assert_is_var();
+  op_types_.emplace_back(Linked::kOpOutput, op_types);
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->inputs) {
       if (op && op->IsOp() && op->Op() && op_types.count(op->Op()->Type())) {
@@ -633,6 +798,7 @@ PDNode *PDNode::assert_is_ops_output(
 PDNode *PDNode::assert_is_ops_input(
     const std::unordered_set<std::string> &op_types) {
   assert_is_var();
+  op_types_.emplace_back(Linked::kOpInput, op_types);
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->outputs) {
       if (op && op->IsOp() && op->Op() && op_types.count(op->Op()->Type())) {
@@ -655,6 +821,7 @@ PDNode *PDNode::assert_is_ops_input(
 PDNode *PDNode::assert_is_only_input_of_ops(
     const std::unordered_set<std::string> &op_types) {
   assert_is_var();
+  op_types_.emplace_back(Linked::kOpInput, op_types);
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->outputs) {
       if (op && op->IsOp() && op->Op() && op_types.count(op->Op()->Type()) &&
@@ -670,6 +837,7 @@ PDNode *PDNode::assert_is_only_input_of_ops(
 PDNode *PDNode::assert_is_only_output_of_ops(
     const std::unordered_set<std::string> &op_types) {
   assert_is_var();
+  op_types_.emplace_back(Linked::kOpOutput, op_types);
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->inputs) {
       if (op && op->IsOp() && op->Op() && op_types.count(op->Op()->Type()) &&
@@ -179,11 +179,19 @@ struct PDNode {
 
   PDNode(PDNode&& other) = default;
 
+  // How a node asserted on op types links to an op of one of the types: it
+  // is the op, one of its inputs or one of its outputs.
+  enum class Linked { kIsOp, kOpInput, kOpOutput };
+
   friend class PDPattern;
+  friend class GraphPatternDetector;
 
   // Will removed latter.
   teller_t teller_;
   std::vector<teller_t> asserts_;
+  // The op types required by the asserts, GraphPatternDetector only tells
+  // the nodes linked to them.
+  std::vector<std::pair<Linked, std::unordered_set<std::string>>> op_types_;
   PDPattern* pattern_;
   std::string name_;
   Type type_;
@@ -289,10 +297,15 @@ class GraphPatternDetector {
   PDPattern* mutable_pattern() { return &pattern_; }
 
  private:
-  // Mark the nodes that fits the pattern.
+  // Mark the nodes that fits the pattern. The nodes of a PDNode whose
+  // assertions require op types are picked from an index of the graph by op
+  // type, and only those are told.
   bool MarkPDNodesInGraph(const ir::Graph& graph);
 
-  // Detect all the pattern and output the hit records.
+  // Detect all the pattern and output the hit records. The edges are
+  // matched from the PDNode with the fewest marked nodes, each one extending
+  // the partial matches through the links of their nodes, and the records
+  // are returned in the order of matching the edges as they were added.
   std::vector<subgraph_t> DetectPatterns();
 
   // Remove duplicate patterns.
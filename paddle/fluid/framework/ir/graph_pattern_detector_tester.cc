@@ -15,6 +15,7 @@
 #include <gtest/gtest.h>
 
 #include "paddle/fluid/framework/ir/graph_pattern_detector.h"
+#include "paddle/fluid/framework/ir/pass_tester_helper.h"
 
 namespace paddle {
 namespace framework {
@@ -203,6 +204,68 @@ TEST(GraphPatternDetector, IntermediateCheck) {
   ASSERT_EQ(count, 1);
 }
 
+TEST(GraphPatternDetector, TellOpTypes) {
+  // Three blocks of mul -> elementwise_add -> relu.
+  Layers layers;
+  auto* x = layers.data("x", {4, 8});
+  for (int i = 0; i < 3; ++i) {
+    auto* w = layers.data("w" + std::to_string(i), {8, 8}, true);
+    auto* b = layers.data("b" + std::to_string(i), {8}, true);
+    x = layers.relu(layers.elementwise_add(layers.mul(x, w), b));
+  }
+  std::unique_ptr<Graph> graph(new Graph(layers.main_program()));
+
+  for (bool reversed : {false, true}) {
+    // The asserts on op types only tell the nodes linked to the op types.
+    int num_told_ops = 0;
+    int num_told_vars = 0;
+    GraphPatternDetector detector;
+    auto* pattern = detector.mutable_pattern();
+    auto* mul = pattern->NewNode("mul")->assert_is_op("mul");
+    auto* mul_out = pattern->NewNode("mul_out")
+                        ->assert_more([&](Node* node) {
+                          ++num_told_vars;
+                          return true;
+                        })
+                        ->assert_is_op_output("mul")
+                        ->assert_is_op_input("elementwise_add");
+    auto* add = pattern->NewNode("add")->assert_is_op("elementwise_add");
+    auto* add_out = pattern->NewNode("add_out")
+                        ->assert_is_op_output("elementwise_add")
+                        ->assert_is_op_input("relu");
+    auto* relu = pattern->NewNode("relu")
+                     ->assert_more([&](Node* node) {
+                       ++num_told_ops;
+                       return true;
+                     })
+                     ->assert_is_op("relu");
+    // The subgraphs do not depend on the order of the edges.
+    if (reversed) {
+      add_out->LinksTo({relu});
+      add->LinksTo({add_out});
+      mul_out->LinksTo({add});
+      mul->LinksTo({mul_out});
+    } else {
+      mul->LinksTo({mul_out});
+      mul_out->LinksTo({add});
+      add->LinksTo({add_out});
+      add_out->LinksTo({relu});
+    }
+
+    std::set<Node*> relus;
+    detector(graph.get(), [&](const GraphPatternDetector::subgraph_t& s,
+                              Graph* g) {
+      EXPECT_EQ(s.at(mul)->outputs[0], s.at(mul_out));
+      EXPECT_EQ(s.at(add_out)->outputs[0], s.at(relu));
+      relus.insert(s.at(relu));
+    });
+    EXPECT_EQ(relus.size(), 3UL);
+    // The outputs of mul are fewer than the inputs of elementwise_add.
+    EXPECT_EQ(num_told_vars, 3);
+    EXPECT_EQ(num_told_ops, 3);
+  }
+}
+
 }  // namespace ir
 }  // namespace framework
 }  // namespace paddle
@@ -0,0 +1,267 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/ir/weight_only_quant_pass.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+#include <vector>
+
+#include "paddle/fluid/framework/ir/graph_pattern_detector.h"
+#include "paddle/fluid/framework/op_version_registry.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+namespace {
+
+Node* FindInputNode(Node* op, const std::string& name) {
+  for (auto* in : op->inputs) {
+    if (in->Name() == name) return in;
+  }
+  return nullptr;
+}
+
+// Calls f(i, j) for the elements of the (k, n) weight, in the order they
+// are stored.
+template <typename Func>
+void ForEachElement(int64_t k, int64_t n, bool transposed, Func f) {
+  if (transposed) {
+    for (int64_t j = 0; j < n; ++j) {
+      for (int64_t i = 0; i < k; ++i) f(i, j);
+    }
+  } else {
+    for (int64_t i = 0; i < k; ++i) {
+      for (int64_t j = 0; j < n; ++j) f(i, j);
+    }
+  }
+}
+
+// Quantizes the (k, n) weight w, with its rows ld apart, or the (n, k) one
+// when transposed, to (n, k) int8 values, or (n, (k + 1) / 2) bytes of int4
+// ones, and the (n, ceil(k / group)) scales to dequantize them.
+void Quantize(const float* w, int64_t k, int64_t n, int64_t ld,
+              bool transposed, int weight_bits, int64_t group, int8_t* q,
+              float* scale) {
+  const int64_t num_groups = (k + group - 1) / group;
+  const int64_t ldq = weight_bits == 8 ? k : (k + 1) / 2;
+  const int max_q = weight_bits == 8 ? 127 : 7;
+  auto at = [&](int64_t i, int64_t j) {
+    return transposed ? w[j * ld + i] : w[i * ld + j];
+  };
+
+  std::fill(scale, scale + n * num_groups, 0.f);
+  ForEachElement(k, n, transposed, [&](int64_t i, int64_t j) {
+    float* s = scale + j * num_groups + i / group;
+    *s = std::max(*s, std::abs(at(i, j)));
+  });
+  for (int64_t i = 0; i < n * num_groups; ++i) {
+    scale[i] = scale[i] > 0.f ? scale[i] / max_q : 1.f;
+  }
+  std::fill(q, q + n * ldq, 0);
+  ForEachElement(k, n, transposed, [&](int64_t i, int64_t j) {
+    int v = static_cast<int>(
+        std::round(at(i, j) / scale[j * num_groups + i / group]));
+    v = std::min(std::max(v, -max_q), max_q);
+    if (weight_bits == 8) {
+      q[j * ldq + i] = static_cast<int8_t>(v);
+    } else {
+      q[j * ldq + i / 2] |= static_cast<int8_t>((v & 0xf) << (i % 2 * 4));
+    }
+  });
+}
+
+}  // namespace
+
+bool WeightOnlyQuantPass::QuantizeOp(Graph* graph, Node* op, int weight_bits,
+                                     int group_size,
+                                     QuantizedWeights* quantized) const {
+  auto* op_desc = op->Op();
+  const std::string& type = op_desc->Type();
+  if (op_desc->GetAttrIfExists<bool>("use_mkldnn")) return false;
+  const std::string x_arg = type == "fc" ? "Input" : "X";
+  const std::string w_arg = type == "fc" ? "W" : "Y";
+  if (op_desc->Input(x_arg).size() != 1 || op_desc->Input(w_arg).size() != 1 ||
+      op_desc->Output("Out").size() != 1) {
+    return false;
+  }
+  Node* x = FindInputNode(op, op_desc->Input(x_arg)[0]);
+  Node* w = FindInputNode(op, op_desc->Input(w_arg)[0]);
+  if (!x || !w || !x->Var() || !w->Var() || !w->Var()->Persistable()) {
+    return false;
+  }
+  auto* scope = param_scope();
+  auto* w_var = scope->FindVar(w->Name());
+  if (!w_var || !w_var->IsType<LoDTensor>()) return false;
+  const auto& w_tensor = w_var->Get<LoDTensor>();
+  if (w_tensor.dims().size() != 2 ||
+      w_tensor.dtype() != phi::DataType::FLOAT32 ||
+      !platform::is_cpu_place(w_tensor.place())) {
+    return false;
+  }
+
+  int64_t rows = w_tensor.dims()[0];
+  int64_t cols = w_tensor.dims()[1];
+  const int64_t ld = cols;
+  bool transposed = false;
+  int in_num_col_dims = 1;
+  std::string activation_type = "";
+  Node* bias = nullptr;
+  if (type == "fc") {
+    if (op_desc->GetAttrIfExists<bool>("padding_weights")) {
+      rows -= 4;
+      cols -= 4;
+    }
+    in_num_col_dims = BOOST_GET_CONST(int, op_desc->GetAttr("in_num_col_dims"));
+    activation_type =
+        op_desc->GetAttrIfExists<std::string>("activation_type");
+    if (activation_type != "" && activation_type != "relu") return false;
+    if (op_desc->Input("Bias").size() == 1) {
+      bias = FindInputNode(op, op_desc->Input("Bias")[0]);
+      if (!bias) return false;
+    }
+  } else if (type == "mul") {
+    if (BOOST_GET_CONST(int, op_desc->GetAttr("y_num_col_dims")) != 1) {
+      return false;
+    }
+    in_num_col_dims = BOOST_GET_CONST(int, op_desc->GetAttr("x_num_col_dims"));
+  } else {
+    int x_rank = x->Var()->GetShape().size();
+    if (BOOST_GET_CONST(bool, op_desc->GetAttr("trans_x")) || x_rank < 2) {
+      return false;
+    }
+    in_num_col_dims = x_rank - 1;
+    transposed = BOOST_GET_CONST(bool, op_desc->GetAttr("trans_y"));
+  }
+  const int64_t k = transposed ? cols : rows;
+  const int64_t n = transposed ? rows : cols;
+  const int64_t group = group_size > 0 && group_size < k ? group_size : k;
+
+  auto key = std::make_pair(w->Name(), transposed);
+  if (!quantized->count(key)) {
+    const int64_t ldq = weight_bits == 8 ? k : (k + 1) / 2;
+    const int64_t num_groups = (k + group - 1) / group;
+    std::string suffix = "@weight_only_int" + std::to_string(weight_bits);
+    VarDesc q_desc(patterns::UniqueKey(w->Name() + suffix));
+    q_desc.SetShape({n, ldq});
+    q_desc.SetDataType(proto::VarType::INT8);
+    q_desc.SetPersistable(true);
+    VarDesc scale_desc(patterns::UniqueKey(w->Name() + suffix + "_scale"));
+    scale_desc.SetShape({n, num_groups});
+    scale_desc.SetDataType(proto::VarType::FP32);
+    scale_desc.SetPersistable(true);
+
+    auto* q_tensor = scope->Var(q_desc.Name())->GetMutable<LoDTensor>();
+    q_tensor->Resize({n, ldq});
+    auto* scale_tensor =
+        scope->Var(scale_desc.Name())->GetMutable<LoDTensor>();
+    scale_tensor->Resize({n, num_groups});
+    Quantize(w_tensor.data<float>(), k, n, ld, transposed, weight_bits, group,
+             q_tensor->mutable_data<int8_t>(platform::CPUPlace()),
+             scale_tensor->mutable_data<float>(platform::CPUPlace()));
+    (*quantized)[key] = std::make_pair(graph->CreateVarNode(&q_desc),
+                                       graph->CreateVarNode(&scale_desc));
+  }
+  Node* q_node = quantized->at(key).first;
+  Node* scale_node = quantized->at(key).second;
+
+  OpDesc desc(op_desc->Block());
+  desc.SetType("weight_only_fc");
+  desc.SetInput("Input", {x->Name()});
+  desc.SetInput("W", {q_node->Name()});
+  desc.SetInput("WScale", {scale_node->Name()});
+  if (bias) desc.SetInput("Bias", {bias->Name()});
+  desc.SetOutput("Out", op_desc->Output("Out"));
+  desc.SetAttr("in_num_col_dims", in_num_col_dims);
+  desc.SetAttr("activation_type", activation_type);
+  desc.SetAttr("weight_bits", weight_bits);
+  desc.SetAttr("group_size", static_cast<int>(group));
+  desc.Flush();
+
+  auto* fc = graph->CreateOpNode(&desc);
+  IR_NODE_LINK_TO(x, fc);
+  IR_NODE_LINK_TO(q_node, fc);
+  IR_NODE_LINK_TO(scale_node, fc);
+  if (bias) IR_NODE_LINK_TO(bias, fc);
+  for (auto* out : op->outputs) {
+    IR_NODE_LINK_TO(fc, out);
+  }
+  return true;
+}
+
+void WeightOnlyQuantPass::ApplyImpl(ir::Graph* graph) const {
+  PADDLE_ENFORCE_NOT_NULL(
+      graph, platform::errors::InvalidArgument("Graph cannot be nullptr."));
+  FusePassBase::Init(name_scope_, graph);
+  int weight_bits = Has("weight_bits") ? Get<int>("weight_bits") : 8;
+  int group_size = Has("group_size") ? Get<int>("group_size") : 0;
+  PADDLE_ENFORCE_EQ(weight_bits == 8 || weight_bits == 4, true,
+                    platform::errors::InvalidArgument(
+                        "The weight_bits of weight_only_quant_pass should be "
+                        "8 or 4, but received %d.",
+                        weight_bits));
+  PADDLE_ENFORCE_GE(group_size, 0,
+                    platform::errors::InvalidArgument(
+                        "The group_size of weight_only_quant_pass should not "
+                        "be negative, but received %d.",
+                        group_size));
+
+  std::vector<Node*> ops;
+  for (auto* node : graph->Nodes()) {
+    if (node->IsOp() && node->Op() &&
+        (node->Op()->Type() == "fc" || node->Op()->Type() == "mul" ||
+         node->Op()->Type() == "matmul_v2")) {
+      ops.push_back(node);
+    }
+  }
+  QuantizedWeights quantized;
+  std::unordered_set<const Node*> replaced;
+  std::unordered_set<Node*> weights;
+  for (auto* op : ops) {
+    if (QuantizeOp(graph, op, weight_bits, group_size, &quantized)) {
+      replaced.insert(op);
+      const std::string& w_arg = op->Op()->Type() == "fc" ? "W" : "Y";
+      weights.insert(FindInputNode(op, op->Op()->Input(w_arg)[0]));
+    }
+  }
+  GraphSafeRemoveNodes(graph, replaced);
+
+  std::unordered_set<const Node*> unused;
+  std::vector<std::string> unused_names;
+  for (auto* w : weights) {
+    if (w->outputs.empty()) {
+      unused.insert(w);
+      unused_names.push_back(w->Name());
+    }
+  }
+  GraphSafeRemoveNodes(graph, unused);
+  param_scope()->EraseVars(unused_names);
+
+  AddStatis(replaced.size());
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_PASS(weight_only_quant_pass,
+              paddle::framework::ir::WeightOnlyQuantPass);
+REGISTER_PASS_CAPABILITY(weight_only_quant_pass)
+    .AddCombination(
+        paddle::framework::compatible::OpVersionComparatorCombination()
+            .EQ("fc", 0)
+            .EQ("mul", 0)
+            .EQ("matmul_v2", 0));
@@ -0,0 +1,63 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "paddle/fluid/framework/ir/fuse_pass_base.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+/*
+ * Quantize the persistable float weights of fc, mul and matmul_v2 ops to
+ * int8 with a scale per output channel, or to int4 with a scale per
+ * group_size input channels of each output channel, and replace the ops with
+ * weight_only_fc, which dequantizes the weights on the fly. The float weights
+ * are removed once no other op reads them.
+ *
+ * Pass attributes:
+ * - weight_bits: 8 (default) or 4.
+ * - group_size: input channels sharing a scale, 0 (default) for a scale per
+ *   output channel.
+ */
+class Graph;
+class Node;
+
+class WeightOnlyQuantPass : public FusePassBase {
+ public:
+  virtual ~WeightOnlyQuantPass() {}
+
+ protected:
+  void ApplyImpl(ir::Graph* graph) const override;
+
+  const std::string name_scope_{"weight_only_quant"};
+
+ private:
+  // The quantized weight and its scales, by the float weight and whether
+  // it is read transposed.
+  using QuantizedWeights =
+      std::map<std::pair<std::string, bool>, std::pair<Node*, Node*>>;
+
+  bool QuantizeOp(Graph* graph, Node* op, int weight_bits, int group_size,
+                  QuantizedWeights* quantized) const;
+};
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
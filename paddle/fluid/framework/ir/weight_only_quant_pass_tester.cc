@@ -0,0 +1,198 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/ir/weight_only_quant_pass.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include "paddle/fluid/framework/ir/pass_tester_helper.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+void AddVarToScope(Scope* param_scope, const std::string& name,
+                   const DDim& dims) {
+  auto* tensor = param_scope->Var(name)->GetMutable<LoDTensor>();
+  tensor->Resize(dims);
+  auto* data = tensor->mutable_data<float>(platform::CPUPlace());
+  std::mt19937 rng(static_cast<unsigned>(name.size()));
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  for (int64_t i = 0; i < tensor->numel(); ++i) data[i] = dist(rng);
+}
+
+// The float weight of a weight_only_fc op, dequantized to (k, n).
+std::vector<float> Dequantize(const Scope& scope, const OpDesc& op, int64_t k,
+                              int64_t n) {
+  auto& q = scope.FindVar(op.Input("W")[0])->Get<LoDTensor>();
+  auto& scale = scope.FindVar(op.Input("WScale")[0])->Get<LoDTensor>();
+  int bits = BOOST_GET_CONST(int, op.GetAttr("weight_bits"));
+  int group = BOOST_GET_CONST(int, op.GetAttr("group_size"));
+  EXPECT_EQ(q.dims(), phi::make_ddim({n, bits == 8 ? k : (k + 1) / 2}));
+  EXPECT_EQ(scale.dims(), phi::make_ddim({n, (k + group - 1) / group}));
+  std::vector<float> w(k * n);
+  for (int64_t i = 0; i < k; ++i) {
+    for (int64_t j = 0; j < n; ++j) {
+      const int8_t* row = q.data<int8_t>() + j * q.dims()[1];
+      int v = row[bits == 8 ? i : i / 2];
+      if (bits == 4) {
+        v = i % 2 ? v >> 4 : static_cast<int8_t>(v << 4) >> 4;
+      }
+      w[i * n + j] = v * scale.data<float>()[j * scale.dims()[1] + i / group];
+    }
+  }
+  return w;
+}
+
+const OpDesc* FindOpWithOutput(const Graph& graph, const std::string& out) {
+  for (auto* node : graph.Nodes()) {
+    if (node->IsOp() && node->Op()->Type() == "weight_only_fc" &&
+        node->Op()->Output("Out")[0] == out) {
+      return node->Op();
+    }
+  }
+  return nullptr;
+}
+
+TEST(WeightOnlyQuantPass, int8) {
+  // inputs                    operator     output
+  // --------------------------------------------------------
+  // (x, weights_0, bias_0)    fc        -> fc_out
+  // (fc_out, weights_1)       mul       -> mul_out
+  // (y, weights_2)            matmul_v2 -> matmul_out, with trans_y
+  Layers layers;
+  auto* x = layers.data("x", {4, 8});
+  auto* weights_0 = layers.data("weights_0", {8, 6}, true);
+  auto* bias_0 = layers.data("bias_0", {6}, true);
+  auto* fc_out = layers.fc(x, weights_0, bias_0, 1, "relu");
+  auto* weights_1 = layers.data("weights_1", {6, 5}, true);
+  auto* mul_out = layers.mul(fc_out, weights_1);
+  auto* y = layers.data("y", {2, 3, 5});
+  auto* weights_2 = layers.data("weights_2", {7, 5}, true);
+  auto* matmul_out = layers.matmul_v2(y, weights_2, nullptr, false, true);
+
+  std::unique_ptr<ir::Graph> graph(new ir::Graph(layers.main_program()));
+  auto* scope = new Scope();
+  AddVarToScope(scope, "weights_0", {8, 6});
+  AddVarToScope(scope, "bias_0", {6});
+  AddVarToScope(scope, "weights_1", {6, 5});
+  AddVarToScope(scope, "weights_2", {7, 5});
+  std::vector<float> w0(8 * 6);
+  std::copy_n(scope->FindVar("weights_0")->Get<LoDTensor>().data<float>(),
+              w0.size(), w0.begin());
+  std::vector<float> w2(7 * 5);
+  std::copy_n(scope->FindVar("weights_2")->Get<LoDTensor>().data<float>(),
+              w2.size(), w2.begin());
+  graph->Set("__param_scope__", scope);
+
+  auto pass = PassRegistry::Instance().Get("weight_only_quant_pass");
+  graph.reset(pass->Apply(graph.release()));
+  EXPECT_EQ(GetNumOpNodes(graph, "weight_only_fc"), 3);
+  EXPECT_EQ(GetNumOpNodes(graph, "fc"), 0);
+  EXPECT_EQ(GetNumOpNodes(graph, "mul"), 0);
+  EXPECT_EQ(GetNumOpNodes(graph, "matmul_v2"), 0);
+  for (auto* name : {"weights_0", "weights_1", "weights_2"}) {
+    EXPECT_EQ(scope->FindVar(name), nullptr) << name;
+  }
+  EXPECT_NE(scope->FindVar("bias_0"), nullptr);
+
+  auto* fc = FindOpWithOutput(*graph, fc_out->Name());
+  ASSERT_NE(fc, nullptr);
+  EXPECT_EQ(fc->Input("Bias")[0], "bias_0");
+  EXPECT_EQ(BOOST_GET_CONST(std::string, fc->GetAttr("activation_type")),
+            "relu");
+  EXPECT_EQ(BOOST_GET_CONST(int, fc->GetAttr("group_size")), 8);
+  auto w = Dequantize(*scope, *fc, 8, 6);
+  for (size_t i = 0; i < w.size(); ++i) {
+    EXPECT_NEAR(w[i], w0[i], 1.f / 127) << i;
+  }
+  ASSERT_NE(FindOpWithOutput(*graph, mul_out->Name()), nullptr);
+
+  // weights_2 is (n, k), read transposed.
+  auto* matmul = FindOpWithOutput(*graph, matmul_out->Name());
+  ASSERT_NE(matmul, nullptr);
+  EXPECT_EQ(BOOST_GET_CONST(int, matmul->GetAttr("in_num_col_dims")), 2);
+  w = Dequantize(*scope, *matmul, 5, 7);
+  for (int64_t i = 0; i < 5; ++i) {
+    for (int64_t j = 0; j < 7; ++j) {
+      EXPECT_NEAR(w[i * 7 + j], w2[j * 5 + i], 1.f / 127);
+    }
+  }
+}
+
+TEST(WeightOnlyQuantPass, int4) {
+  // inputs                    operator            output
+  // --------------------------------------------------------
+  // (x, weights_0)            mul              -> mul_out_0
+  // (x, weights_0)            mul              -> mul_out_1
+  // (mul_out_1, weights_1)    mul              -> mul_out_2
+  // (weights_1, bias)         elementwise_add  -> add_out
+  Layers layers;
+  auto* x = layers.data("x", {4, 33});
+  auto* weights_0 = layers.data("weights_0", {33, 6}, true);
+  auto* mul_out_0 = layers.mul(x, weights_0);
+  auto* mul_out_1 = layers.mul(x, weights_0);
+  auto* weights_1 = layers.data("weights_1", {6, 6}, true);
+  layers.mul(mul_out_1, weights_1);
+  auto* bias = layers.data("bias", {6}, true);
+  layers.elementwise_add(weights_1, bias);
+
+  std::unique_ptr<ir::Graph> graph(new ir::Graph(layers.main_program()));
+  auto* scope = new Scope();
+  AddVarToScope(scope, "weights_0", {33, 6});
+  AddVarToScope(scope, "weights_1", {6, 6});
+  AddVarToScope(scope, "bias", {6});
+  std::vector<float> w0(33 * 6);
+  std::copy_n(scope->FindVar("weights_0")->Get<LoDTensor>().data<float>(),
+              w0.size(), w0.begin());
+  graph->Set("__param_scope__", scope);
+
+  auto pass = PassRegistry::Instance().Get("weight_only_quant_pass");
+  pass->Set("weight_bits", new int(4));
+  pass->Set("group_size", new int(16));
+  graph.reset(pass->Apply(graph.release()));
+  EXPECT_EQ(GetNumOpNodes(graph, "weight_only_fc"), 3);
+  EXPECT_EQ(GetNumOpNodes(graph, "mul"), 0);
+  EXPECT_EQ(GetNumOpNodes(graph, "elementwise_add"), 1);
+  EXPECT_EQ(scope->FindVar("weights_0"), nullptr);
+  // Still read by elementwise_add.
+  EXPECT_NE(scope->FindVar("weights_1"), nullptr);
+
+  // Both ops reading weights_0 share its quantized weight.
+  int num_quantized = 0;
+  for (auto* node : graph->Nodes()) {
+    if (node->IsVar() &&
+        node->Name().find("weights_0@weight_only_int4") == 0 &&
+        node->Name().find("_scale") == std::string::npos) {
+      ++num_quantized;
+      EXPECT_EQ(node->outputs.size(), 2UL);
+    }
+  }
+  EXPECT_EQ(num_quantized, 1);
+
+  auto* op = FindOpWithOutput(*graph, mul_out_0->Name());
+  ASSERT_NE(op, nullptr);
+  EXPECT_EQ(BOOST_GET_CONST(int, op->GetAttr("weight_bits")), 4);
+  EXPECT_EQ(BOOST_GET_CONST(int, op->GetAttr("group_size")), 16);
+  auto w = Dequantize(*scope, *op, 33, 6);
+  for (size_t i = 0; i < w.size(); ++i) {
+    EXPECT_NEAR(w[i], w0[i], 1.f / 7) << i;
+  }
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+USE_PASS(weight_only_quant_pass);
@@ -0,0 +1,400 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/mapped_params_file.h"
+
+#include <xxhash.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "paddle/fluid/framework/convert_utils.h"
+#include "paddle/fluid/framework/data_type.h"
+#include "paddle/fluid/framework/tensor_util.h"
+#include "paddle/fluid/memory/allocation/allocator.h"
+#include "paddle/fluid/memory/malloc.h"
+#ifndef _WIN32
+#include "paddle/fluid/memory/allocation/mmap_allocator.h"
+#endif
+
+namespace paddle {
+namespace framework {
+
+namespace {
+
+constexpr char kMagic[8] = {'P', 'D', 'M', 'P', 'A', 'R', 'A', 'M'};
+constexpr uint32_t kVersion = 2;
+constexpr size_t kDataAlignment = 4096;
+
+size_t AlignUp(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+void Append(std::string* buf, T value) {
+  buf->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Bounds checked reader of the header and the index.
+class IndexReader {
+ public:
+  IndexReader(const char* data, size_t size, const std::string& path)
+      : data_(data), size_(size), path_(path) {}
+
+  template <typename T>
+  T Read() {
+    T value;
+    std::memcpy(&value, Consume(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  std::string ReadString(size_t length) {
+    return std::string(Consume(length), length);
+  }
+
+ private:
+  const char* Consume(size_t length) {
+    PADDLE_ENFORCE_LE(
+        length, size_ - pos_,
+        platform::errors::InvalidArgument(
+            "The parameters file %s is truncated or damaged.", path_));
+    const char* p = data_ + pos_;
+    pos_ += length;
+    return p;
+  }
+
+  const char* data_;
+  size_t size_;
+  size_t pos_{0};
+  const std::string& path_;
+};
+
+// A tensor inside the mapped file. It keeps the mapping alive while tensors
+// still hold it.
+class MappedParamsSlice : public memory::allocation::Allocation {
+ public:
+  MappedParamsSlice(const std::shared_ptr<phi::Allocation>& file,
+                    size_t offset, size_t size)
+      : Allocation(static_cast<char*>(file->ptr()) + offset, size,
+                   file->place()),
+        file_(file) {}
+
+ private:
+  std::shared_ptr<phi::Allocation> file_;
+};
+
+std::shared_ptr<phi::Allocation> MapFile(const std::string& path) {
+#ifndef _WIN32
+  return memory::allocation::AllocateMemoryMapFileAllocation(path);
+#else
+  std::ifstream fin(path, std::ios::binary | std::ios::ate);
+  PADDLE_ENFORCE_EQ(static_cast<bool>(fin), true,
+                    platform::errors::NotFound("Cannot open file %s.", path));
+  size_t size = static_cast<size_t>(fin.tellg());
+  fin.seekg(0);
+  auto file = memory::AllocShared(platform::CPUPlace(), size);
+  fin.read(static_cast<char*>(file->ptr()), size);
+  PADDLE_ENFORCE_EQ(
+      static_cast<bool>(fin), true,
+      platform::errors::Unavailable("Cannot read file %s.", path));
+  return file;
+#endif
+}
+
+int NumThreads(int num_threads, size_t num_tasks) {
+  if (num_threads <= 0) {
+    num_threads = std::min<int>(std::thread::hardware_concurrency(),
+                                kMaxParamsIOThreads);
+  }
+  return std::max<int>(std::min<size_t>(num_threads, num_tasks), 1);
+}
+
+// Runs func(i) for every i in [0, n) on num_threads threads, and rethrows the
+// first exception thrown by func.
+void ParallelFor(size_t n, int num_threads,
+                 const std::function<void(size_t)>& func) {
+  std::atomic<size_t> next{0};
+  std::exception_ptr error;
+  std::mutex mutex;
+  auto run = [&]() {
+    for (size_t i = next++; i < n; i = next++) {
+      try {
+        func(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (!error) error = std::current_exception();
+        next = n;
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < NumThreads(num_threads, n); ++i) {
+    threads.emplace_back(run);
+  }
+  run();
+  for (auto& thread : threads) thread.join();
+  if (error) std::rethrow_exception(error);
+}
+
+}  // namespace
+
+bool IsMappedParamsFile(const std::string& path) {
+  std::ifstream fin(path, std::ios::binary);
+  char magic[sizeof(kMagic)];
+  if (!fin.read(magic, sizeof(magic))) return false;
+  return std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+void SaveMappedParams(const std::string& path,
+                      const std::vector<std::string>& names,
+                      const Scope& scope, int num_threads) {
+  std::vector<const LoDTensor*> tensors(names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    auto* var = scope.FindVar(names[i]);
+    PADDLE_ENFORCE_NOT_NULL(
+        var, platform::errors::NotFound("Variable %s is not found in scope.",
+                                        names[i]));
+    PADDLE_ENFORCE_EQ(var->IsType<LoDTensor>(), true,
+                      platform::errors::Unimplemented(
+                          "Only LoDTensor can be saved as a mapped parameter, "
+                          "but variable %s is %s.",
+                          names[i], ToTypeName(var->Type())));
+    tensors[i] = &var->Get<LoDTensor>();
+  }
+  SaveMappedParams(path, names, tensors, num_threads);
+}
+
+void SaveMappedParams(const std::string& path,
+                      const std::vector<std::string>& names,
+                      const std::vector<const LoDTensor*>& inputs,
+                      int num_threads) {
+  PADDLE_ENFORCE_EQ(names.size(), inputs.size(),
+                    platform::errors::InvalidArgument(
+                        "The number of names (%d) and tensors (%d) to save "
+                        "as mapped parameters are not equal.",
+                        names.size(), inputs.size()));
+  std::vector<LoDTensor> tensors(names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    auto& tensor = *inputs[i];
+    PADDLE_ENFORCE_EQ(tensor.IsInitialized(), true,
+                      platform::errors::PreconditionNotMet(
+                          "Tensor %s to be saved is not initialized.",
+                          names[i]));
+    if (platform::is_cpu_place(tensor.place())) {
+      tensors[i].ShareDataWith(tensor);
+    } else {
+      TensorCopySync(tensor, platform::CPUPlace(), &tensors[i]);
+    }
+    tensors[i].set_lod(tensor.lod());
+  }
+
+  // Index entries have a known size, so the data offsets are known before
+  // the index is written.
+  size_t index_size = 0;
+  std::vector<size_t> bytes(names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    auto& tensor = tensors[i];
+    index_size += sizeof(uint32_t) + names[i].size() + sizeof(int32_t) +
+                  sizeof(uint32_t) + tensor.dims().size() * sizeof(int64_t) +
+                  sizeof(uint32_t) + 3 * sizeof(uint64_t);
+    for (auto& level : tensor.lod()) {
+      index_size += (level.size() + 1) * sizeof(uint64_t);
+    }
+    bytes[i] =
+        tensor.numel() * SizeOfType(TransToProtoVarType(tensor.dtype()));
+  }
+  const size_t header_size = sizeof(kMagic) + 2 * sizeof(uint32_t);
+  size_t data_offset =
+      AlignUp(header_size + sizeof(uint64_t) + index_size, kDataAlignment);
+  std::vector<size_t> offsets(names.size());
+  size_t cursor = data_offset;
+  for (size_t i = 0; i < names.size(); ++i) {
+    offsets[i] = cursor;
+    cursor = AlignUp(cursor + bytes[i], kMappedParamsAlignment);
+  }
+
+  {
+    std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+    PADDLE_ENFORCE_EQ(static_cast<bool>(fout), true,
+                      platform::errors::Unavailable(
+                          "Cannot open %s to save parameters.", path));
+  }
+  // Every thread writes the data of its tensors through its own stream, the
+  // space between them reads as zeros. The checksums in the index are known
+  // once the data is written.
+  std::vector<uint64_t> checksums(names.size());
+  ParallelFor(names.size(), num_threads, [&](size_t i) {
+    const char* data = static_cast<const char*>(tensors[i].data());
+    checksums[i] = XXH64(data, bytes[i], 0);
+    std::fstream fout(path, std::ios::in | std::ios::out | std::ios::binary);
+    fout.seekp(offsets[i]);
+    fout.write(data, bytes[i]);
+    fout.close();
+    PADDLE_ENFORCE_EQ(static_cast<bool>(fout), true,
+                      platform::errors::Unavailable(
+                          "Failed to write parameter %s to %s.", names[i],
+                          path));
+  });
+
+  std::string buf(kMagic, sizeof(kMagic));
+  Append<uint32_t>(&buf, kVersion);
+  Append<uint32_t>(&buf, names.size());
+  Append<uint64_t>(&buf, data_offset);
+  for (size_t i = 0; i < names.size(); ++i) {
+    auto& tensor = tensors[i];
+    Append<uint32_t>(&buf, names[i].size());
+    buf.append(names[i]);
+    Append<int32_t>(&buf, TransToProtoVarType(tensor.dtype()));
+    auto dims = tensor.dims();
+    Append<uint32_t>(&buf, dims.size());
+    for (int d = 0; d < dims.size(); ++d) Append<int64_t>(&buf, dims[d]);
+    Append<uint32_t>(&buf, tensor.lod().size());
+    for (auto& level : tensor.lod()) {
+      Append<uint64_t>(&buf, level.size());
+      for (size_t offset : level) Append<uint64_t>(&buf, offset);
+    }
+    Append<uint64_t>(&buf, offsets[i]);
+    Append<uint64_t>(&buf, bytes[i]);
+    Append<uint64_t>(&buf, checksums[i]);
+  }
+  buf.resize(data_offset, '\0');
+
+  std::fstream fout(path, std::ios::in | std::ios::out | std::ios::binary);
+  fout.write(buf.data(), buf.size());
+  // Pads the file to the aligned end of the last tensor.
+  fout.seekp(0, std::ios::end);
+  size_t size = static_cast<size_t>(fout.tellp());
+  if (size < cursor) {
+    fout.write(std::string(cursor - size, '\0').data(), cursor - size);
+  }
+  fout.close();
+  PADDLE_ENFORCE_EQ(static_cast<bool>(fout), true,
+                    platform::errors::Unavailable(
+                        "Failed to write parameters to %s.", path));
+}
+
+MappedParamsFile::MappedParamsFile(const std::string& path)
+    : path_(path), file_(MapFile(path)) {
+  const char* data = static_cast<const char*>(file_->ptr());
+  IndexReader reader(data, file_->size(), path_);
+  PADDLE_ENFORCE_EQ(
+      reader.ReadString(sizeof(kMagic)) == std::string(kMagic, sizeof(kMagic)),
+      true, platform::errors::InvalidArgument(
+                "%s is not a mapped parameters file.", path_));
+  version_ = reader.Read<uint32_t>();
+  PADDLE_ENFORCE_EQ(version_ >= 1 && version_ <= kVersion, true,
+                    platform::errors::Unimplemented(
+                        "The version %d of mapped parameters file %s is not "
+                        "supported, expect 1 to %d.",
+                        version_, path_, kVersion));
+  uint32_t count = reader.Read<uint32_t>();
+  reader.Read<uint64_t>();
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string name = reader.ReadString(reader.Read<uint32_t>());
+    Entry entry;
+    entry.dtype = static_cast<proto::VarType::Type>(reader.Read<int32_t>());
+    std::vector<int64_t> dims(reader.Read<uint32_t>());
+    for (auto& dim : dims) dim = reader.Read<int64_t>();
+    entry.dims = make_ddim(dims);
+    entry.lod.resize(reader.Read<uint32_t>());
+    for (auto& level : entry.lod) {
+      level.resize(reader.Read<uint64_t>());
+      for (auto& offset : level) offset = reader.Read<uint64_t>();
+    }
+    entry.offset = reader.Read<uint64_t>();
+    entry.bytes = reader.Read<uint64_t>();
+    entry.checksum = version_ >= 2 ? reader.Read<uint64_t>() : 0;
+    PADDLE_ENFORCE_LE(
+        entry.offset + entry.bytes, file_->size(),
+        platform::errors::InvalidArgument(
+            "The parameters file %s is truncated or damaged.", path_));
+    PADDLE_ENFORCE_EQ(
+        static_cast<size_t>(phi::product(entry.dims)) * SizeOfType(entry.dtype),
+        entry.bytes,
+        platform::errors::InvalidArgument(
+            "The size of tensor %s in %s does not match its shape.", name,
+            path_));
+    entries_.emplace(std::move(name), std::move(entry));
+  }
+}
+
+std::vector<std::string> MappedParamsFile::Names() const {
+  std::vector<std::string> names;
+  names.reserve(entries_.size());
+  for (auto& pair : entries_) names.push_back(pair.first);
+  return names;
+}
+
+const MappedParamsFile::Entry& MappedParamsFile::GetEntry(
+    const std::string& name) const {
+  auto it = entries_.find(name);
+  PADDLE_ENFORCE_EQ(it != entries_.end(), true,
+                    platform::errors::NotFound(
+                        "Tensor %s is not found in parameters file %s.", name,
+                        path_));
+  return it->second;
+}
+
+void MappedParamsFile::ShareTo(const std::string& name,
+                               LoDTensor* tensor) const {
+  auto& entry = GetEntry(name);
+  tensor->clear();
+  tensor->Resize(entry.dims);
+  tensor->ResetHolderWithType(
+      std::make_shared<MappedParamsSlice>(file_, entry.offset, entry.bytes),
+      TransToPhiDataType(entry.dtype));
+  tensor->set_lod(entry.lod);
+}
+
+bool MappedParamsFile::Verify(const std::string& name) const {
+  auto& entry = GetEntry(name);
+  if (version_ < 2) return true;
+  const char* data = static_cast<const char*>(file_->ptr()) + entry.offset;
+  return XXH64(data, entry.bytes, 0) == entry.checksum;
+}
+
+void MappedParamsFile::CopyTo(const std::vector<std::string>& names,
+                              const std::vector<LoDTensor*>& tensors,
+                              int num_threads) const {
+  PADDLE_ENFORCE_EQ(names.size(), tensors.size(),
+                    platform::errors::InvalidArgument(
+                        "The number of names (%d) and tensors (%d) to load "
+                        "from mapped parameters are not equal.",
+                        names.size(), tensors.size()));
+  ParallelFor(names.size(), num_threads, [&](size_t i) {
+    auto& entry = GetEntry(names[i]);
+    auto* tensor = tensors[i];
+    tensor->Resize(entry.dims);
+    void* data = tensor->mutable_data(platform::CPUPlace(),
+                                      TransToPhiDataType(entry.dtype));
+    const char* src = static_cast<const char*>(file_->ptr()) + entry.offset;
+    std::memcpy(data, src, entry.bytes);
+    tensor->set_lod(entry.lod);
+    PADDLE_ENFORCE_EQ(
+        version_ < 2 || XXH64(data, entry.bytes, 0) == entry.checksum, true,
+        platform::errors::InvalidArgument(
+            "The checksum of tensor %s in parameters file %s does not match, "
+            "the file is damaged.",
+            names[i], path_));
+  });
+}
+
+}  // namespace framework
+}  // namespace paddle
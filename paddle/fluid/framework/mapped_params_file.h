@@ -0,0 +1,108 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "paddle/fluid/framework/framework.pb.h"
+#include "paddle/fluid/framework/lod_tensor.h"
+#include "paddle/fluid/framework/scope.h"
+
+namespace paddle {
+namespace framework {
+
+/*
+ * A parameters file laid out to be memory mapped.
+ *
+ *   header  | magic (8 bytes) | version (u32) | tensor count (u32) |
+ *           | data offset (u64) |
+ *   index   | per tensor: name length (u32), name, dtype (i32), rank (u32),
+ *           | dims (i64 each), lod levels (u32), per level: length (u64) and
+ *           | offsets (u64 each), data offset (u64), data bytes (u64),
+ *           | checksum (u64, the XXH64 of the data, since version 2) |
+ *   data    | the raw tensor data, every tensor aligned to
+ *           | kMappedParamsAlignment, starting at a page boundary |
+ *
+ * Integers are stored in the byte order of the host. Loading a tensor from
+ * the file does not copy it: the tensor points into a copy-on-write mapping
+ * of the file, so every process loading the same file shares its pages
+ * through the page cache until a page is written.
+ *
+ * The index gives the place of every tensor, so the tensors are written and
+ * read by several threads at once, and a subset of them is read without
+ * touching the others.
+ */
+constexpr size_t kMappedParamsAlignment = 64;
+constexpr int kMaxParamsIOThreads = 16;
+
+// Whether path names a file starting with the magic of the format.
+bool IsMappedParamsFile(const std::string& path);
+
+// Saves the LoDTensors of names found in scope, in this order, with
+// num_threads threads writing different tensors. 0 uses a thread per CPU,
+// at most kMaxParamsIOThreads.
+void SaveMappedParams(const std::string& path,
+                      const std::vector<std::string>& names,
+                      const Scope& scope, int num_threads = 0);
+
+// Saves the tensors under names, which are in the same order.
+void SaveMappedParams(const std::string& path,
+                      const std::vector<std::string>& names,
+                      const std::vector<const LoDTensor*>& tensors,
+                      int num_threads = 0);
+
+class MappedParamsFile {
+ public:
+  explicit MappedParamsFile(const std::string& path);
+
+  bool Has(const std::string& name) const { return entries_.count(name) > 0; }
+  std::vector<std::string> Names() const;
+
+  // Makes tensor a CPU tensor pointing to the data of name in the file.
+  void ShareTo(const std::string& name, LoDTensor* tensor) const;
+
+  // Whether the data of name matches the checksum saved with it, always
+  // true for the files of version 1, which have no checksums.
+  bool Verify(const std::string& name) const;
+
+  // Copies the tensors of names to CPU tensors, with num_threads threads
+  // reading different tensors, and verifies them.
+  void CopyTo(const std::vector<std::string>& names,
+              const std::vector<LoDTensor*>& tensors,
+              int num_threads = 0) const;
+
+ private:
+  struct Entry {
+    proto::VarType::Type dtype;
+    DDim dims;
+    LoD lod;
+    size_t offset;
+    size_t bytes;
+    uint64_t checksum;
+  };
+
+  const Entry& GetEntry(const std::string& name) const;
+
+  std::string path_;
+  uint32_t version_;
+  std::shared_ptr<phi::Allocation> file_;
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+}  // namespace framework
+}  // namespace paddle
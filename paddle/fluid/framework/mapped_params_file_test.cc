@@ -0,0 +1,132 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/mapped_params_file.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace framework {
+
+TEST(MappedParamsFile, save_and_load) {
+  platform::CPUPlace place;
+  Scope scope;
+  auto* w = scope.Var("w")->GetMutable<LoDTensor>();
+  w->Resize({3, 7});
+  float* w_data = w->mutable_data<float>(place);
+  for (int i = 0; i < 21; ++i) w_data[i] = i * 0.5f;
+  auto* b = scope.Var("b")->GetMutable<LoDTensor>();
+  b->Resize({5});
+  b->set_lod({{0, 2, 5}});
+  int64_t* b_data = b->mutable_data<int64_t>(place);
+  for (int i = 0; i < 5; ++i) b_data[i] = -i;
+
+  std::string path = "mapped_params_file_test.pdparams";
+  SaveMappedParams(path, {"w", "b"}, scope);
+  ASSERT_TRUE(IsMappedParamsFile(path));
+
+  MappedParamsFile file(path);
+  EXPECT_TRUE(file.Has("w"));
+  EXPECT_FALSE(file.Has("c"));
+  EXPECT_EQ(file.Names().size(), 2UL);
+
+  LoDTensor w_loaded, b_loaded;
+  file.ShareTo("w", &w_loaded);
+  file.ShareTo("b", &b_loaded);
+  ASSERT_EQ(w_loaded.dims(), w->dims());
+  ASSERT_EQ(w_loaded.dtype(), w->dtype());
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(w_loaded.data<float>()) %
+                kMappedParamsAlignment,
+            0UL);
+  for (int i = 0; i < 21; ++i) ASSERT_EQ(w_loaded.data<float>()[i], w_data[i]);
+  ASSERT_EQ(b_loaded.lod(), b->lod());
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_EQ(b_loaded.data<int64_t>()[i], b_data[i]);
+  }
+
+  // Writing a loaded tensor neither faults nor changes the file.
+  w_loaded.mutable_data<float>(place)[0] = 100.f;
+  LoDTensor w_reloaded;
+  MappedParamsFile(path).ShareTo("w", &w_reloaded);
+  EXPECT_EQ(w_reloaded.data<float>()[0], 0.f);
+}
+
+TEST(MappedParamsFile, parallel_copy_and_verify) {
+  platform::CPUPlace place;
+  Scope scope;
+  std::vector<std::string> names;
+  for (int i = 0; i < 32; ++i) {
+    names.push_back("p" + std::to_string(i));
+    auto* p = scope.Var(names.back())->GetMutable<LoDTensor>();
+    p->Resize({i + 1, 3});
+    float* data = p->mutable_data<float>(place);
+    for (int j = 0; j < (i + 1) * 3; ++j) data[j] = i * 100 + j;
+  }
+  std::string path = "mapped_params_file_test_parallel.pdparams";
+  SaveMappedParams(path, names, scope, 4);
+
+  // A subset, copied by several threads.
+  std::vector<std::string> subset = {"p31", "p7", "p0", "p12"};
+  std::vector<LoDTensor> loaded(subset.size());
+  std::vector<LoDTensor*> outs;
+  for (auto& tensor : loaded) outs.push_back(&tensor);
+  MappedParamsFile file(path);
+  file.CopyTo(subset, outs, 3);
+  for (size_t i = 0; i < subset.size(); ++i) {
+    auto& expected = scope.FindVar(subset[i])->Get<LoDTensor>();
+    ASSERT_EQ(loaded[i].dims(), expected.dims());
+    for (int64_t j = 0; j < expected.numel(); ++j) {
+      ASSERT_EQ(loaded[i].data<float>()[j], expected.data<float>()[j]);
+    }
+    EXPECT_TRUE(file.Verify(subset[i]));
+  }
+  LoDTensor missing;
+  EXPECT_ANY_THROW(file.CopyTo({"p1", "q"}, {outs[0], &missing}));
+
+  // Damages the data of p7.
+  auto& p7 = scope.FindVar("p7")->Get<LoDTensor>();
+  std::string p7_data(reinterpret_cast<const char*>(p7.data<float>()),
+                      p7.numel() * sizeof(float));
+  std::ifstream fin(path, std::ios::binary);
+  std::string content((std::istreambuf_iterator<char>(fin)),
+                      std::istreambuf_iterator<char>());
+  size_t offset = content.find(p7_data);
+  ASSERT_NE(offset, std::string::npos);
+  ASSERT_EQ(offset % kMappedParamsAlignment, 0UL);
+  {
+    std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(offset);
+    f.write("\xff", 1);
+  }
+  MappedParamsFile damaged(path);
+  EXPECT_FALSE(damaged.Verify("p7"));
+  EXPECT_TRUE(damaged.Verify("p12"));
+  EXPECT_ANY_THROW(damaged.CopyTo({"p7"}, {outs[0]}));
+}
+
+TEST(MappedParamsFile, other_formats) {
+  std::string path = "mapped_params_file_test.txt";
+  std::ofstream(path) << "not a parameters file";
+  EXPECT_FALSE(IsMappedParamsFile(path));
+  EXPECT_FALSE(IsMappedParamsFile("mapped_params_file_test.missing"));
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -90,7 +90,7 @@ std::string MultiTrainer::GetDumpPath(int tid) {
 }
 
 void MultiTrainer::InitDumpEnv() {
-  queue_ = paddle::framework::MakeChannel<std::string>();
+  queue_ = paddle::framework::MakeChannel<std::string>(dump_queue_capacity_);
   for (int i = 0; i < thread_num_; ++i) {
     workers_[i]->SetChannelWriter(queue_.get());
   }
@@ -17,6 +17,7 @@
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/framework/variable_helper.h"
 #include "paddle/fluid/platform/denormal.h"
+#include "paddle/fluid/platform/profiler/op_metrics.h"
 #ifdef PADDLE_WITH_MKLDNN
 #include "paddle/fluid/platform/mkldnn_helper.h"
 #endif
@@ -44,12 +45,65 @@ void NaiveExecutor::Run() {
   platform::RegisterModelLayout(ops_, place_);
 #endif
   platform::ScopedFlushDenormal flush;
-  for (auto &op : ops_) {
+  if (shape_plan_cache_) {
+    shape_plan_cache_->PrepareRun(scope_);
+  }
+  if (op_runner_ && !memory_planner_) {
+    op_runner_->Run(*scope_, place_, shape_plan_cache_.get());
+    return;
+  }
+  bool record_memory_plan = false;
+  if (memory_planner_) {
+    memory_planner_->PrepareRun(scope_);
+    record_memory_plan = memory_planner_->recording();
+  }
+  for (size_t i = 0; i < ops_.size(); ++i) {
+    auto &op = ops_[i];
     VLOG(4) << std::this_thread::get_id() << " run "
             << op->DebugStringEx(scope_) << " on scope " << scope_;
     op->SetIsCalledByExecutor(false);
-    op->Run(*scope_, place_);
+    {
+      platform::RecordOpMetrics record_metrics(op.get(), op->Type(), place_);
+      if (shape_plan_cache_) {
+        shape_plan_cache_->RunOp(i, *scope_, place_);
+      } else {
+        op->Run(*scope_, place_);
+      }
+    }
+    if (record_memory_plan) {
+      memory_planner_->RecordOp(i, *scope_);
+    }
+  }
+  if (record_memory_plan) {
+    memory_planner_->FinishRecording();
+  }
+}
+
+void NaiveExecutor::EnableStaticMemoryPlan(
+    const std::vector<std::string> &skip_vars) {
+  if (memory_planner_) {
+    memory_planner_->Unbind();
+  }
+  memory_planner_.reset(new StaticMemoryPlanner(ops_, skip_vars, place_));
+}
+
+void NaiveExecutor::EnableParallelExecution(int num_threads,
+                                            int math_num_threads,
+                                            int64_t inline_cost_us) {
+  PADDLE_ENFORCE_EQ(
+      platform::is_cpu_place(place_), true,
+      platform::errors::Unimplemented(
+          "Parallel execution of NaiveExecutor only supports CPUPlace."));
+  if (num_threads <= 1) {
+    op_runner_.reset();
+    return;
   }
+  op_runner_.reset(new ParallelOpRunner(ops_, num_threads, math_num_threads,
+                                        inline_cost_us));
+}
+
+void NaiveExecutor::EnableShapePlanCache(size_t capacity) {
+  shape_plan_cache_.reset(new ShapePlanCache(ops_, capacity));
 }
 
 void NaiveExecutor::CreateVariables(const ProgramDesc &desc, int block_id,
@@ -126,6 +180,22 @@ void NaiveExecutor::CleanFeedFetchOps() {
     }
   }
   ops_.swap(ops);
+  if (memory_planner_) {
+    // The plan refers to the ops by their index.
+    memory_planner_->Unbind();
+    memory_planner_.reset(
+        new StaticMemoryPlanner(ops_, memory_planner_->skip_vars(), place_));
+  }
+  if (op_runner_) {
+    // The dependencies refer to the ops by their index too.
+    op_runner_.reset(new ParallelOpRunner(ops_, op_runner_->num_threads(),
+                                          op_runner_->math_num_threads(),
+                                          op_runner_->inline_cost_us()));
+  }
+  if (shape_plan_cache_) {
+    shape_plan_cache_.reset(
+        new ShapePlanCache(ops_, shape_plan_cache_->capacity()));
+  }
 }
 
 NaiveExecutor::~NaiveExecutor() {
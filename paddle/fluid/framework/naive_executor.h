@@ -19,8 +19,11 @@
 #include <vector>
 
 #include "paddle/fluid/framework/operator.h"
+#include "paddle/fluid/framework/parallel_op_runner.h"
 #include "paddle/fluid/framework/program_desc.h"
 #include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/framework/shape_plan_cache.h"
+#include "paddle/fluid/framework/static_memory_plan.h"
 #include "paddle/fluid/platform/device_context.h"
 #include "paddle/fluid/platform/place.h"
 
@@ -32,7 +35,8 @@ namespace paddle {
 namespace framework {
 
 /*
- * Simple, intuitive and effective. Only single thread is supported, and
+ * Simple, intuitive and effective. Runs the ops one by one, or the
+ * independent ones concurrently with EnableParallelExecution, and
  * currently designed for inference.
  */
 class ProgramDesc;
@@ -68,6 +72,29 @@ class NaiveExecutor {
 
   void ResetTrtOps(int num);
 
+  // Place the intermediate tensors in one arena planned from the first run
+  // of every input shape, see StaticMemoryPlanner. The variables in
+  // skip_vars, e.g. the outputs read after Run, are not planned.
+  void EnableStaticMemoryPlan(const std::vector<std::string>& skip_vars);
+
+  StaticMemoryPlanner* memory_planner() { return memory_planner_.get(); }
+
+  // Run the independent branches of the ops concurrently on num_threads
+  // threads, the calling one included, see ParallelOpRunner. The other
+  // threads run the ops with math_num_threads threads of the math library.
+  // The ops taking less than inline_cost_us run on the thread that made them
+  // ready. Ignored with the static memory plan, whose reuse of memory follows
+  // the program order.
+  void EnableParallelExecution(int num_threads, int math_num_threads = 1,
+                               int64_t inline_cost_us = 20);
+
+  // Keep the output shapes the ops get for the last capacity input shapes,
+  // and skip their shape inference on the runs with these input shapes, see
+  // ShapePlanCache.
+  void EnableShapePlanCache(size_t capacity);
+
+  ShapePlanCache* shape_plan_cache() { return shape_plan_cache_.get(); }
+
  protected:
   void CreateOps(const ProgramDesc& desc, int block_id,
                  bool with_feed_fetch_ops);
@@ -77,6 +104,9 @@ class NaiveExecutor {
   // Catch the required resource to avoid recreate.
   std::vector<std::unique_ptr<OperatorBase>> ops_;
   Scope* scope_;
+  std::unique_ptr<StaticMemoryPlanner> memory_planner_;
+  std::unique_ptr<ParallelOpRunner> op_runner_;
+  std::unique_ptr<ShapePlanCache> shape_plan_cache_;
 };
 
 }  // namespace framework
@@ -22,6 +22,7 @@
 #include "paddle/fluid/framework/operator.h"
 #include "paddle/fluid/platform/os_info.h"
 #include "paddle/fluid/platform/profiler/event_tracing.h"
+#include "paddle/fluid/platform/profiler/op_metrics.h"
 #ifdef PADDLE_WITH_MKLDNN
 #include "paddle/fluid/platform/mkldnn_helper.h"
 #endif
@@ -427,6 +428,7 @@ void InterpreterCore::BuildSkipShareLoDInfo() {
 void InterpreterCore::RunInstruction(const Instruction& instr_node) {
   auto* op = instr_node.OpBase();
   auto place = instr_node.DeviceContext().GetPlace();
+  platform::RecordOpMetrics record_metrics(op, op->Type(), place);
   VLOG(4) << "Start run " << place << " " << op->DebugStringEx(global_scope_);
   Scope* local_scope = create_local_scope_
                            ? global_scope_->GetMutableLocalScope()
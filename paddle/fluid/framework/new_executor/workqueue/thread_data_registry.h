@@ -59,6 +59,13 @@ class ThreadDataRegistry {
     return impl_->GetAllThreadDataByRef();
   }
 
+  // Calls visitor(tid, data) with the data of all threads, the threads can
+  // not exit before it returns.
+  template <typename Visitor>
+  void VisitAllThreadData(Visitor visitor) {
+    impl_->VisitAllThreadData(visitor);
+  }
+
  private:
 // types
 // Lock types
@@ -131,6 +138,14 @@ class ThreadDataRegistry {
       return data_ref;
     }
 
+    template <typename Visitor>
+    void VisitAllThreadData(Visitor visitor) {
+      SharedLockGuardType guard(lock_);
+      for (auto& kv : tid_map_) {
+        visitor(kv.first, kv.second->GetData());
+      }
+    }
+
    private:
     LockType lock_;
     std::unordered_map<uint64_t, ThreadDataHolder*> tid_map_;  // not owned
@@ -644,6 +644,10 @@ class OperatorWithKernel : public OperatorBase {
     kernel_type_.reset(kernel_type);
   }
 
+  // When true, the runs do not infer the output shapes, the caller set them
+  // beforehand, see ShapePlanCache.
+  void SetSkipInferShape(bool x) { skip_infer_shape_ = x; }
+
  private:
   void RunImpl(const Scope& scope, const platform::Place& place) const final;
   void RunImpl(const Scope& scope, const platform::Place& place,
@@ -692,6 +696,7 @@ class OperatorWithKernel : public OperatorBase {
   mutable bool need_prepare_data_ = true;
   mutable bool enable_cache_runtime_context_ = false;
   mutable bool all_kernels_must_compute_runtime_shape_ = false;
+  bool skip_infer_shape_ = false;
   mutable std::mutex cache_update_mutex_;
   mutable bool enable_cache_transfer_scope_ = false;
   // NOTE(chenweihang): Similar op members are used to adapt to
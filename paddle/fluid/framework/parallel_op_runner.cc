@@ -0,0 +1,248 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/parallel_op_runner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
+#include <unordered_map>
+
+#include "paddle/fluid/platform/cpu_helper.h"
+#include "paddle/fluid/platform/denormal.h"
+#include "paddle/fluid/platform/profiler/op_metrics.h"
+
+namespace paddle {
+namespace framework {
+
+namespace {
+
+bool IsBarrierOp(const OperatorBase& op) {
+  if (op.HasAttr("sub_block") || op.HasAttr("blocks") ||
+      op.Type() == "feed" || op.Type() == "fetch") {
+    return true;
+  }
+  for (auto& pair : op.Outputs()) {
+    for (auto& name : pair.second) {
+      if (name != kEmptyVarName) return false;
+    }
+  }
+  // Run for its side effects, e.g. print.
+  return true;
+}
+
+}  // namespace
+
+std::vector<std::vector<size_t>> BuildOpDownstreams(
+    const std::vector<std::unique_ptr<OperatorBase>>& ops) {
+  std::vector<std::set<size_t>> upstreams(ops.size());
+  std::unordered_map<std::string, size_t> last_writer;
+  std::unordered_map<std::string, std::vector<size_t>> readers;
+  // Ops since the last barrier, a barrier waits for all of them.
+  std::vector<size_t> since_barrier;
+  bool has_barrier = false;
+  size_t last_barrier = 0;
+
+  for (size_t i = 0; i < ops.size(); ++i) {
+    auto& op = *ops[i];
+    auto& deps = upstreams[i];
+    if (IsBarrierOp(op)) {
+      deps.insert(since_barrier.begin(), since_barrier.end());
+      if (has_barrier) deps.insert(last_barrier);
+      since_barrier.clear();
+      has_barrier = true;
+      last_barrier = i;
+      // Variables written before the barrier are ordered by it.
+      last_writer.clear();
+      readers.clear();
+      continue;
+    }
+    if (has_barrier) deps.insert(last_barrier);
+    for (auto& pair : op.Inputs()) {
+      for (auto& name : pair.second) {
+        if (name == kEmptyVarName) continue;
+        auto it = last_writer.find(name);
+        if (it != last_writer.end()) deps.insert(it->second);
+      }
+    }
+    for (auto& pair : op.Outputs()) {
+      for (auto& name : pair.second) {
+        if (name == kEmptyVarName) continue;
+        auto it = last_writer.find(name);
+        if (it != last_writer.end()) deps.insert(it->second);
+        auto& var_readers = readers[name];
+        deps.insert(var_readers.begin(), var_readers.end());
+        var_readers.clear();
+      }
+    }
+    // Record after collecting, an op reading and writing a variable does
+    // not depend on itself.
+    for (auto& pair : op.Inputs()) {
+      for (auto& name : pair.second) {
+        if (name != kEmptyVarName) readers[name].push_back(i);
+      }
+    }
+    for (auto& pair : op.Outputs()) {
+      for (auto& name : pair.second) {
+        if (name == kEmptyVarName) continue;
+        last_writer[name] = i;
+        // It also read the variable if it is an input, which is ordered by
+        // the write now.
+        readers[name].clear();
+      }
+    }
+    deps.erase(i);
+    since_barrier.push_back(i);
+  }
+
+  std::vector<std::vector<size_t>> downstreams(ops.size());
+  for (size_t i = 0; i < ops.size(); ++i) {
+    for (size_t up : upstreams[i]) downstreams[up].push_back(i);
+  }
+  return downstreams;
+}
+
+ParallelOpRunner::ParallelOpRunner(
+    const std::vector<std::unique_ptr<OperatorBase>>& ops, int num_threads,
+    int math_num_threads, int64_t inline_cost_us)
+    : ops_(ops),
+      num_threads_(num_threads),
+      math_num_threads_(math_num_threads),
+      inline_cost_ns_(inline_cost_us * 1000),
+      downstreams_(BuildOpDownstreams(ops)),
+      num_upstreams_(ops.size(), 0),
+      upstreams_left_(new std::atomic<int>[ops.size()]),
+      op_cost_ns_(new std::atomic<int64_t>[ops.size()]) {
+  PADDLE_ENFORCE_GE(num_threads, 1,
+                    platform::errors::InvalidArgument(
+                        "The number of threads to run ops should be at least "
+                        "1, but it's %d.",
+                        num_threads));
+  for (auto& downstream : downstreams_) {
+    for (size_t op_idx : downstream) ++num_upstreams_[op_idx];
+  }
+  for (size_t i = 0; i < ops.size(); ++i) op_cost_ns_[i] = 0;
+  // The calling thread runs ops too.
+  if (num_threads > 1) {
+    WorkQueueOptions options("ParallelOpRunner", num_threads - 1,
+                             /*allow_spinning*/ true, /*track_task*/ false);
+    work_queue_ = CreateMultiThreadedWorkQueue(options);
+  }
+}
+
+void ParallelOpRunner::Run(const Scope& scope, const platform::Place& place,
+                           ShapePlanCache* shape_plan_cache) {
+  if (ops_.empty()) return;
+  scope_ = &scope;
+  place_ = place;
+  shape_plan_cache_ = shape_plan_cache;
+  failed_ = false;
+  error_ = nullptr;
+  done_ = false;
+  std::vector<size_t> roots;
+  for (size_t i = 0; i < ops_.size(); ++i) {
+    upstreams_left_[i].store(num_upstreams_[i], std::memory_order_relaxed);
+    if (num_upstreams_[i] == 0) roots.push_back(i);
+  }
+  ops_left_ = ops_.size();
+
+  // The ops never run yet cost 0, so with a positive inline_cost_us they
+  // run inline and the first run is sequential and measures them.
+  for (size_t i = 1; i < roots.size(); ++i) {
+    size_t root = roots[i];
+    if (work_queue_ && !IsCheap(root)) {
+      Schedule(root);
+    } else {
+      RunFrom(root);
+    }
+  }
+  RunFrom(roots[0]);
+
+  std::unique_lock<std::mutex> lock(mu_);
+  done_cv_.wait(lock, [this] { return done_; });
+  if (error_) std::rethrow_exception(error_);
+}
+
+void ParallelOpRunner::Schedule(size_t op_idx) {
+  work_queue_->AddTask([this, op_idx] {
+    // The worker threads only run the tasks of this runner, set their math
+    // library threads on the first one. The calling thread has them set by
+    // its caller, e.g. the predictor.
+    thread_local int worker_math_threads = 0;
+    if (worker_math_threads != math_num_threads_) {
+      platform::SetNumThreads(math_num_threads_);
+      worker_math_threads = math_num_threads_;
+    }
+    RunFrom(op_idx);
+  });
+}
+
+void ParallelOpRunner::RunFrom(size_t op_idx) {
+  // The worker threads flush denormals like the calling thread, so that the
+  // results do not depend on where an op runs.
+  platform::ScopedFlushDenormal flush;
+  std::vector<size_t> local = {op_idx};
+  while (!local.empty()) {
+    size_t idx = local.back();
+    local.pop_back();
+    if (!failed_.load(std::memory_order_relaxed)) {
+      auto& op = ops_[idx];
+      VLOG(4) << std::this_thread::get_id() << " run "
+              << op->DebugStringEx(scope_) << " on scope " << scope_;
+      auto start = std::chrono::steady_clock::now();
+      try {
+        platform::RecordOpMetrics record_metrics(op.get(), op->Type(), place_);
+        op->SetIsCalledByExecutor(false);
+        if (shape_plan_cache_) {
+          shape_plan_cache_->RunOp(idx, *scope_, place_);
+        } else {
+          op->Run(*scope_, place_);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (!error_) error_ = std::current_exception();
+        failed_ = true;
+      }
+      op_cost_ns_[idx].store(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count(),
+          std::memory_order_relaxed);
+    }
+
+    bool continued = false;
+    for (size_t next : downstreams_[idx]) {
+      if (upstreams_left_[next].fetch_sub(1) != 1) continue;
+      if (!continued || !work_queue_ || IsCheap(next)) {
+        local.push_back(next);
+        continued = true;
+      } else {
+        Schedule(next);
+      }
+    }
+
+    if (ops_left_.fetch_sub(1) == 1) {
+      // Notify under the lock, Run may return and the runner go as soon as
+      // it is released.
+      std::lock_guard<std::mutex> lock(mu_);
+      done_ = true;
+      done_cv_.notify_all();
+    }
+  }
+}
+
+}  // namespace framework
+}  // namespace paddle
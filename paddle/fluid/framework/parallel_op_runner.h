@@ -0,0 +1,105 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "paddle/fluid/framework/new_executor/workqueue/workqueue.h"
+#include "paddle/fluid/framework/operator.h"
+#include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/framework/shape_plan_cache.h"
+#include "paddle/fluid/platform/place.h"
+
+namespace paddle {
+namespace framework {
+
+// Returns, for every op, the later ops that must wait for it: the readers
+// and writers of the variables it writes, and the writers of the variables
+// it reads. Control flow, feed, fetch and ops without outputs are barriers
+// that wait for, and are waited for by, every other op.
+std::vector<std::vector<size_t>> BuildOpDownstreams(
+    const std::vector<std::unique_ptr<OperatorBase>>& ops);
+
+/*
+ * Runs a list of ops on a work queue, starting every op once the ops it
+ * depends on are done, so that independent branches run concurrently. The
+ * dependencies are those of the program order, so the outputs are the same
+ * as running the ops one by one.
+ *
+ * A thread that finishes an op runs one of the ops it makes ready itself,
+ * and the ops measured to take less than inline_cost_us as well, instead of
+ * paying a hand-off to the queue for them. The worker threads run the ops
+ * with math_num_threads threads of the math library, like the calling thread
+ * is expected to.
+ */
+class ParallelOpRunner {
+ public:
+  ParallelOpRunner(const std::vector<std::unique_ptr<OperatorBase>>& ops,
+                   int num_threads, int math_num_threads,
+                   int64_t inline_cost_us);
+
+  // Runs all the ops and waits for them. Rethrows the first error of an op,
+  // the ops depending on a failed op are skipped. The ops run through
+  // shape_plan_cache when given.
+  void Run(const Scope& scope, const platform::Place& place,
+           ShapePlanCache* shape_plan_cache = nullptr);
+
+  int num_threads() const { return num_threads_; }
+  int math_num_threads() const { return math_num_threads_; }
+  int64_t inline_cost_us() const { return inline_cost_ns_ / 1000; }
+
+ private:
+  void RunFrom(size_t op_idx);
+  // Runs RunFrom(op_idx) on a worker thread.
+  void Schedule(size_t op_idx);
+  bool IsCheap(size_t op_idx) const {
+    return op_cost_ns_[op_idx].load(std::memory_order_relaxed) <
+           inline_cost_ns_;
+  }
+
+  const std::vector<std::unique_ptr<OperatorBase>>& ops_;
+  const int num_threads_;
+  const int math_num_threads_;
+  const int64_t inline_cost_ns_;
+  std::vector<std::vector<size_t>> downstreams_;
+  std::vector<int> num_upstreams_;
+
+  // Per op, the upstream ops not done yet in the current run and the run
+  // time of the last run in nanoseconds.
+  std::unique_ptr<std::atomic<int>[]> upstreams_left_;
+  std::unique_ptr<std::atomic<int64_t>[]> op_cost_ns_;
+
+  // State of the current run.
+  const Scope* scope_{nullptr};
+  platform::Place place_;
+  ShapePlanCache* shape_plan_cache_{nullptr};
+  std::atomic<size_t> ops_left_{0};
+  std::atomic<bool> failed_{false};
+  std::exception_ptr error_;
+  bool done_{false};
+  std::mutex mu_;
+  std::condition_variable done_cv_;
+
+  // Destroyed first, joining the threads before the state above goes.
+  std::unique_ptr<WorkQueue> work_queue_;
+};
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,245 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/parallel_op_runner.h"
+
+#include <algorithm>
+
+#ifdef PADDLE_WITH_MKLML
+#include <omp.h>
+#endif
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/naive_executor.h"
+#include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/framework/program_desc.h"
+#include "paddle/fluid/platform/cpu_helper.h"
+
+namespace paddle {
+namespace framework {
+
+// Out = sum(X) + value, fails when value is negative.
+class ParallelTestSumOp : public OperatorBase {
+ public:
+  ParallelTestSumOp(const std::string& type, const VariableNameMap& inputs,
+                    const VariableNameMap& outputs, const AttributeMap& attrs)
+      : OperatorBase(type, inputs, outputs, attrs) {}
+
+ private:
+  void RunImpl(const Scope& scope,
+               const platform::Place& place) const override {
+    float value = Attr<float>("value");
+    PADDLE_ENFORCE_GE(value, 0.f, platform::errors::InvalidArgument(
+                                      "Failed on purpose."));
+    std::vector<float> sum(64, value);
+    for (auto& name : Inputs("X")) {
+      auto& x = scope.FindVar(name)->Get<LoDTensor>();
+      for (int64_t i = 0; i < x.numel(); ++i) sum[i] += x.data<float>()[i];
+    }
+    auto* out = scope.FindVar(Output("Out"))->GetMutable<LoDTensor>();
+    out->Resize({static_cast<int64_t>(sum.size())});
+    std::copy(sum.begin(), sum.end(), out->mutable_data<float>(place));
+  }
+};
+
+class ParallelTestSumOpMaker : public OpProtoAndCheckerMaker {
+ public:
+  void Make() override {
+    AddInput("X", "inputs").AsDuplicable();
+    AddOutput("Out", "output");
+    AddAttr<float>("value", "added to the sum").SetDefault(0.f);
+    AddComment("");
+  }
+};
+
+#ifdef PADDLE_WITH_MKLML
+// Out = [the number of OpenMP threads of the thread running the op].
+class ParallelTestMathThreadsOp : public OperatorBase {
+ public:
+  ParallelTestMathThreadsOp(const std::string& type,
+                            const VariableNameMap& inputs,
+                            const VariableNameMap& outputs,
+                            const AttributeMap& attrs)
+      : OperatorBase(type, inputs, outputs, attrs) {}
+
+ private:
+  void RunImpl(const Scope& scope,
+               const platform::Place& place) const override {
+    auto* out = scope.FindVar(Output("Out"))->GetMutable<LoDTensor>();
+    out->Resize({1});
+    *out->mutable_data<int>(place) = omp_get_max_threads();
+  }
+};
+
+class ParallelTestMathThreadsOpMaker : public OpProtoAndCheckerMaker {
+ public:
+  void Make() override {
+    AddOutput("Out", "output");
+    AddComment("");
+  }
+};
+#endif
+
+namespace {
+
+void AppendSumOp(BlockDesc* block, const std::vector<std::string>& inputs,
+                 const std::string& output, float value) {
+  for (auto& name : inputs) {
+    block->Var(name)->SetType(proto::VarType::LOD_TENSOR);
+  }
+  block->Var(output)->SetType(proto::VarType::LOD_TENSOR);
+  auto* op = block->AppendOp();
+  op->SetType("parallel_test_sum");
+  op->SetInput("X", inputs);
+  op->SetOutput("Out", {output});
+  op->SetAttr("value", value);
+}
+
+std::vector<std::unique_ptr<OperatorBase>> CreateOps(
+    const ProgramDesc& program) {
+  std::vector<std::unique_ptr<OperatorBase>> ops;
+  for (auto* op_desc : program.Block(0).AllOps()) {
+    ops.emplace_back(OpRegistry::CreateOp(*op_desc));
+  }
+  return ops;
+}
+
+}  // namespace
+
+TEST(ParallelOpRunner, downstreams) {
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  AppendSumOp(block, {}, "a", 1);          // 0
+  AppendSumOp(block, {"a"}, "b", 1);       // 1: reads a
+  AppendSumOp(block, {"a"}, "c", 1);       // 2: reads a
+  AppendSumOp(block, {"b", "c"}, "d", 1);  // 3: reads b and c
+  AppendSumOp(block, {}, "a", 2);          // 4: rewrites a after 1 and 2
+  AppendSumOp(block, {"d"}, "d", 1);       // 5: in place on d
+  auto ops = CreateOps(program);
+  auto downstreams = BuildOpDownstreams(ops);
+  for (auto& downstream : downstreams) {
+    std::sort(downstream.begin(), downstream.end());
+  }
+  EXPECT_EQ(downstreams[0], std::vector<size_t>({1, 2, 4}));
+  EXPECT_EQ(downstreams[1], std::vector<size_t>({3, 4}));
+  EXPECT_EQ(downstreams[2], std::vector<size_t>({3, 4}));
+  EXPECT_EQ(downstreams[3], std::vector<size_t>({5}));
+  EXPECT_TRUE(downstreams[4].empty());
+  EXPECT_TRUE(downstreams[5].empty());
+}
+
+TEST(ParallelOpRunner, naive_executor) {
+  // Eight branches from a, each a chain of ten ops, summed into out.
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  std::vector<std::string> branch_outs;
+  for (int b = 0; b < 8; ++b) {
+    std::string prev = "a";
+    for (int k = 0; k < 10; ++k) {
+      std::string name = "b" + std::to_string(b) + "_" + std::to_string(k);
+      AppendSumOp(block, {prev}, name, b + k);
+      prev = name;
+    }
+    branch_outs.push_back(prev);
+  }
+  AppendSumOp(block, branch_outs, "out", 0);
+
+  auto place = platform::CPUPlace();
+  Scope scope;
+  Scope* sub_scope = &scope.NewScope();
+  NaiveExecutor exe(place);
+  exe.CreateVariables(program, 0, false, sub_scope);
+  exe.Prepare(sub_scope, program, 0, false);
+  // Hand every op to the queue once measured.
+  exe.EnableParallelExecution(4, /*math_num_threads*/ 1,
+                              /*inline_cost_us*/ 0);
+
+  for (int run = 0; run < 20; ++run) {
+    auto* a = exe.FindTensor("a");
+    a->Resize({64});
+    float* a_data = a->mutable_data<float>(place);
+    for (int i = 0; i < 64; ++i) a_data[i] = i + run;
+    exe.Run();
+    auto* out = exe.FindTensor("out");
+    ASSERT_EQ(out->numel(), 64);
+    for (int i = 0; i < 64; ++i) {
+      // Every branch adds sum(b + k for k in 0..9) = 10 * b + 45.
+      ASSERT_EQ(out->data<float>()[i], 8 * (i + run) + 10 * 28 + 8 * 45);
+    }
+  }
+}
+
+TEST(ParallelOpRunner, error) {
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  AppendSumOp(block, {}, "a", 1);
+  AppendSumOp(block, {"a"}, "b", -1);
+  AppendSumOp(block, {"b"}, "c", 1);
+  AppendSumOp(block, {"a"}, "d", 1);
+  auto ops = CreateOps(program);
+
+  Scope scope;
+  for (auto name : {"a", "b", "c", "d"}) {
+    scope.Var(name)->GetMutable<LoDTensor>();
+  }
+  ParallelOpRunner runner(ops, 2, 1, 0);
+  for (int run = 0; run < 3; ++run) {
+    EXPECT_THROW(runner.Run(scope, platform::CPUPlace()),
+                 platform::EnforceNotMet);
+    // The op after the failed one is skipped.
+    EXPECT_FALSE(scope.FindVar("c")->Get<LoDTensor>().IsInitialized());
+  }
+}
+
+#ifdef PADDLE_WITH_MKLML
+TEST(ParallelOpRunner, math_num_threads) {
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  std::vector<std::string> outs;
+  for (int i = 0; i < 16; ++i) {
+    outs.push_back("out" + std::to_string(i));
+    block->Var(outs.back())->SetType(proto::VarType::LOD_TENSOR);
+    auto* op = block->AppendOp();
+    op->SetType("parallel_test_math_threads");
+    op->SetOutput("Out", {outs.back()});
+  }
+  auto ops = CreateOps(program);
+
+  Scope scope;
+  for (auto& name : outs) scope.Var(name)->GetMutable<LoDTensor>();
+  // As the predictor does for the calling thread.
+  platform::SetNumThreads(3);
+  // Every op but the first runs on a worker.
+  ParallelOpRunner runner(ops, 4, 3, 0);
+  for (int run = 0; run < 3; ++run) {
+    runner.Run(scope, platform::CPUPlace());
+    for (auto& name : outs) {
+      EXPECT_EQ(scope.FindVar(name)->Get<LoDTensor>().data<int>()[0], 3);
+    }
+  }
+  platform::SetNumThreads(1);
+}
+#endif
+
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_OP_WITHOUT_GRADIENT(parallel_test_sum,
+                             paddle::framework::ParallelTestSumOp,
+                             paddle::framework::ParallelTestSumOpMaker);
+#ifdef PADDLE_WITH_MKLML
+REGISTER_OP_WITHOUT_GRADIENT(parallel_test_math_threads,
+                             paddle::framework::ParallelTestMathThreadsOp,
+                             paddle::framework::ParallelTestMathThreadsOpMaker);
+#endif
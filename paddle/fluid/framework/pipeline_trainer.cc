@@ -63,7 +63,7 @@ std::string PipelineTrainer::GetDumpPath(int tid) {
 }
 
 void PipelineTrainer::InitDumpEnv() {
-  queue_ = paddle::framework::MakeChannel<std::string>();
+  queue_ = paddle::framework::MakeChannel<std::string>(dump_queue_capacity_);
   // TODO(sandyhouse): should make it as a config
   dump_thread_num_ = 1;
   for (int i = 0; i < dump_thread_num_; i++) {
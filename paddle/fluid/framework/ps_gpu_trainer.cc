@@ -306,7 +306,7 @@ void PSGPUTrainer::InitTrainerEnv(const ProgramDesc& main_program,
 }
 
 void PSGPUTrainer::InitDumpEnv() {
-  queue_ = paddle::framework::MakeChannel<std::string>();
+  queue_ = paddle::framework::MakeChannel<std::string>(dump_queue_capacity_);
   for (size_t i = 0; i < places_.size(); ++i) {
     workers_[i]->SetChannelWriter(queue_.get());
   }
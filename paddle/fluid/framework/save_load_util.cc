@@ -16,9 +16,13 @@
 
 #include <fstream>
 
+#include "gflags/gflags.h"
 #include "paddle/fluid/framework/convert_utils.h"
+#include "paddle/fluid/framework/mapped_params_file.h"
 #include "paddle/fluid/imperative/layer.h"
 
+DECLARE_bool(save_indexed_params);
+
 namespace paddle {
 namespace framework {
 
@@ -249,6 +253,17 @@ bool SaveTensorToDisk(const std::string& file_name,
                       const std::map<std::string, Tensor*>& map_tensor) {
   MkDirRecursively(DirName(file_name).c_str());
 
+  if (FLAGS_save_indexed_params) {
+    std::vector<std::string> names;
+    std::vector<const LoDTensor*> tensors;
+    for (auto& itera : map_tensor) {
+      names.push_back(itera.first);
+      tensors.push_back(itera.second);
+    }
+    SaveMappedParams(file_name, names, tensors);
+    return true;
+  }
+
   std::ofstream fout(file_name, std::ios::binary);
   PADDLE_ENFORCE_EQ(
       fout.is_open(), true,
@@ -325,6 +340,19 @@ bool SaveTensorToDisk(const std::string& file_name,
 bool LoadTensorFromDisk(
     const std::string& file_name,
     std::map<std::string, std::shared_ptr<Tensor>>* map_tensor) {
+  if (IsMappedParamsFile(file_name)) {
+    MappedParamsFile file(file_name);
+    std::vector<std::string> names = file.Names();
+    std::vector<LoDTensor*> tensors;
+    for (auto& name : names) {
+      auto& tensor = (*map_tensor)[name];
+      tensor.reset(new Tensor());
+      tensors.push_back(tensor.get());
+    }
+    file.CopyTo(names, tensors);
+    return true;
+  }
+
   std::ifstream fin(file_name, std::ios::binary);
 
   PADDLE_ENFORCE_EQ(
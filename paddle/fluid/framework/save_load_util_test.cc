@@ -15,8 +15,11 @@
 #include <time.h>
 
 #include "gtest/gtest.h"
+#include "paddle/fluid/framework/mapped_params_file.h"
 #include "paddle/fluid/framework/save_load_util.h"
 
+DECLARE_bool(save_indexed_params);
+
 namespace paddle {
 namespace framework {
 TEST(test_save_load_util, test_save_load) {
@@ -71,5 +74,33 @@ TEST(test_save_load_util, test_save_load) {
     ASSERT_EQ(ptr_2[i], ptr_2_new[i]);
   }
 }
+
+TEST(test_save_load_util, test_save_load_indexed) {
+  auto cpu_place = platform::CPUPlace();
+  std::map<std::string, Tensor*> map_tensor;
+  std::vector<Tensor> tensors(20);
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    tensors[i].Resize({static_cast<int64_t>(i * 100 + 1)});
+    auto* data = tensors[i].mutable_data<float>(cpu_place);
+    for (int64_t j = 0; j < tensors[i].numel(); ++j) data[j] = i + j * 0.5f;
+    map_tensor["t" + std::to_string(i)] = &tensors[i];
+  }
+
+  FLAGS_save_indexed_params = true;
+  SaveTensorToDisk("test_indexed", map_tensor);
+  FLAGS_save_indexed_params = false;
+  ASSERT_TRUE(IsMappedParamsFile("test_indexed"));
+
+  std::map<std::string, std::shared_ptr<Tensor>> load_map_tensor;
+  LoadTensorFromDisk("test_indexed", &load_map_tensor);
+  ASSERT_EQ(load_map_tensor.size(), tensors.size());
+  for (auto& pair : map_tensor) {
+    auto& loaded = *load_map_tensor.at(pair.first);
+    ASSERT_EQ(loaded.dims(), pair.second->dims());
+    for (int64_t j = 0; j < loaded.numel(); ++j) {
+      ASSERT_EQ(loaded.data<float>()[j], pair.second->data<float>()[j]);
+    }
+  }
+}
 }  // namespace framework
 }  // namespace paddle
@@ -0,0 +1,223 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/shape_plan_cache.h"
+
+#include <string>
+#include <unordered_set>
+
+#include "paddle/fluid/framework/feed_fetch_type.h"
+
+namespace paddle {
+namespace framework {
+
+namespace {
+
+void AppendTensorKey(const LoDTensor& tensor, std::vector<int64_t>* key) {
+  auto dims = tensor.dims();
+  key->push_back(dims.size());
+  for (int i = 0; i < dims.size(); ++i) key->push_back(dims[i]);
+  key->push_back(tensor.lod().size());
+  for (auto& level : tensor.lod()) {
+    key->push_back(level.size());
+    key->insert(key->end(), level.begin(), level.end());
+  }
+}
+
+void AppendValueKey(const LoDTensor& tensor, std::vector<int64_t>* key) {
+  if (!tensor.IsInitialized() || !platform::is_cpu_place(tensor.place()) ||
+      tensor.numel() > ShapePlanCache::kMaxValueKeyNumel) {
+    return;
+  }
+  if (tensor.dtype() == phi::DataType::INT32) {
+    const int* data = tensor.data<int>();
+    key->insert(key->end(), data, data + tensor.numel());
+  } else if (tensor.dtype() == phi::DataType::INT64) {
+    const int64_t* data = tensor.data<int64_t>();
+    key->insert(key->end(), data, data + tensor.numel());
+  }
+}
+
+}  // namespace
+
+ShapePlanCache::ShapePlanCache(
+    const std::vector<std::unique_ptr<OperatorBase>>& ops, size_t capacity)
+    : ops_(ops), capacity_(capacity) {
+  PADDLE_ENFORCE_GT(capacity, 0UL,
+                    platform::errors::InvalidArgument(
+                        "The capacity of the shape plan cache should be "
+                        "greater than 0."));
+}
+
+void ShapePlanCache::Init(Scope* scope) {
+  op_inputs_.assign(ops_.size(), {});
+  op_outputs_.assign(ops_.size(), {});
+  cacheable_.assign(ops_.size(), 0);
+  program_inputs_.clear();
+  std::unordered_set<std::string> written;
+  std::unordered_set<std::string> read;
+
+  for (size_t i = 0; i < ops_.size(); ++i) {
+    auto& op = *ops_[i];
+    bool cacheable = dynamic_cast<OperatorWithKernel*>(&op) != nullptr &&
+                     !op.HasAttr(kAllKernelsMustComputeRuntimeShape) &&
+                     !op.HasAttr("sub_block") && !op.HasAttr("blocks");
+    std::unordered_set<std::string> input_names;
+    for (auto& pair : op.Inputs()) {
+      for (auto& name : pair.second) {
+        if (name == kEmptyVarName) continue;
+        auto* var = scope->FindVar(name);
+        if (!written.count(name) && read.insert(name).second && var) {
+          program_inputs_.push_back(var);
+        }
+        cacheable = cacheable && var != nullptr;
+        op_inputs_[i].push_back(var);
+        input_names.insert(name);
+      }
+    }
+    for (auto& pair : op.Outputs()) {
+      for (auto& name : pair.second) {
+        if (name == kEmptyVarName) continue;
+        auto* var = scope->FindVar(name);
+        // Setting the shape of an inplace output before the op runs would
+        // change its input.
+        cacheable =
+            cacheable && var != nullptr && input_names.count(name) == 0;
+        op_outputs_[i].push_back(var);
+        written.insert(name);
+      }
+    }
+    cacheable_[i] = cacheable;
+  }
+  plans_.clear();
+  index_.clear();
+  current_ = nullptr;
+  scope_ = scope;
+}
+
+ShapePlanCache::Key ShapePlanCache::ProgramInputKey() const {
+  Key key;
+  for (auto* var : program_inputs_) {
+    if (var->IsType<LoDTensor>()) {
+      AppendTensorKey(var->Get<LoDTensor>(), &key);
+    } else if (var->IsType<FeedList>()) {
+      for (auto& item : var->Get<FeedList>()) {
+        const auto* tensor = boost::get<LoDTensor>(&item);
+        if (tensor) {
+          AppendTensorKey(*tensor, &key);
+        } else {
+          key.push_back(-1);
+        }
+      }
+    } else {
+      key.push_back(-1);
+    }
+  }
+  return key;
+}
+
+bool ShapePlanCache::InputKey(size_t op_idx,
+                              std::vector<int64_t>* key) const {
+  key->clear();
+  for (auto* var : op_inputs_[op_idx]) {
+    if (!var->IsType<LoDTensor>()) return false;
+    auto& tensor = var->Get<LoDTensor>();
+    AppendTensorKey(tensor, key);
+    AppendValueKey(tensor, key);
+  }
+  return true;
+}
+
+void ShapePlanCache::PrepareRun(Scope* scope) {
+  if (scope_ != scope) Init(scope);
+  auto key = ProgramInputKey();
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    ++hits_;
+    plans_.splice(plans_.begin(), plans_, it->second);
+    current_ = &plans_.front().second;
+    return;
+  }
+  ++misses_;
+  if (plans_.size() >= capacity_) {
+    index_.erase(plans_.back().first);
+    plans_.pop_back();
+    ++evictions_;
+  }
+  plans_.emplace_front(key, Plan(ops_.size()));
+  index_.emplace(std::move(key), plans_.begin());
+  current_ = &plans_.front().second;
+}
+
+void ShapePlanCache::RunOp(size_t op_idx, const Scope& scope,
+                           const platform::Place& place) {
+  auto& op = ops_[op_idx];
+  if (!cacheable_[op_idx] || current_ == nullptr) {
+    op->Run(scope, place);
+    return;
+  }
+
+  auto& shapes = (*current_)[op_idx];
+  std::vector<int64_t> input_key;
+  if (!InputKey(op_idx, &input_key)) {
+    static_cast<OperatorWithKernel*>(op.get())->SetSkipInferShape(false);
+    op->Run(scope, place);
+    return;
+  }
+  auto& outputs = op_outputs_[op_idx];
+  bool hit = shapes.recorded && shapes.input_key == input_key;
+  if (hit) {
+    for (size_t i = 0; i < outputs.size(); ++i) {
+      auto* tensor = outputs[i]->GetMutable<LoDTensor>();
+      tensor->Resize(shapes.dims[i]);
+      tensor->set_lod(shapes.lods[i]);
+    }
+    ++skipped_infer_shapes_;
+  } else {
+    ++run_infer_shapes_;
+  }
+  static_cast<OperatorWithKernel*>(op.get())->SetSkipInferShape(hit);
+  op->Run(scope, place);
+  if (hit) return;
+
+  shapes.recorded = false;
+  shapes.dims.clear();
+  shapes.lods.clear();
+  for (auto* var : outputs) {
+    if (!var->IsType<LoDTensor>()) {
+      // E.g. SelectedRows outputs, shapes of other types are not planned.
+      cacheable_[op_idx] = 0;
+      return;
+    }
+    auto& tensor = var->Get<LoDTensor>();
+    shapes.dims.push_back(tensor.dims());
+    shapes.lods.push_back(tensor.lod());
+  }
+  shapes.input_key = std::move(input_key);
+  shapes.recorded = true;
+}
+
+ShapePlanCacheStats ShapePlanCache::stats() const {
+  ShapePlanCacheStats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.evictions = evictions_;
+  stats.skipped_infer_shapes = skipped_infer_shapes_.load();
+  stats.run_infer_shapes = run_infer_shapes_.load();
+  stats.num_plans = plans_.size();
+  return stats;
+}
+
+}  // namespace framework
+}  // namespace paddle
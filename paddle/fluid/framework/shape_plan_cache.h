@@ -0,0 +1,115 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "paddle/fluid/framework/lod_tensor.h"
+#include "paddle/fluid/framework/operator.h"
+#include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/platform/place.h"
+
+namespace paddle {
+namespace framework {
+
+struct ShapePlanCacheStats {
+  // Runs whose input shapes had, or had not, a plan.
+  uint64_t hits{0};
+  uint64_t misses{0};
+  // Plans dropped to make room for new input shapes.
+  uint64_t evictions{0};
+  // Ops run with their output shapes from the plan, and ops whose shapes
+  // were inferred.
+  uint64_t skipped_infer_shapes{0};
+  uint64_t run_infer_shapes{0};
+  size_t num_plans{0};
+};
+
+/*
+ * Shape plans of a NaiveExecutor, keyed by the shapes of the program inputs
+ * and evicted least recently used first.
+ *
+ * The kernels and runtime contexts of the ops are kept by the ops across
+ * runs, so what a run with a new input shape redoes for every op is the
+ * shape inference. A plan records the output dims and LoD every op got for
+ * the input shapes of the run; a later run with the same input shapes sets
+ * them on the outputs and runs the op without InferShape. An op is only run
+ * from the plan when its own inputs still have the recorded dims, LoD and,
+ * for small integer tensors that may hold shapes, values, so ops whose
+ * shapes depend on data are inferred again.
+ */
+class ShapePlanCache {
+ public:
+  // Integer inputs with at most this many elements are part of the key of
+  // an op, they may be shape tensors.
+  static constexpr int64_t kMaxValueKeyNumel = 8;
+
+  ShapePlanCache(const std::vector<std::unique_ptr<OperatorBase>>& ops,
+                 size_t capacity);
+
+  // Selects the plan of the current input shapes, creating it if missing.
+  void PrepareRun(Scope* scope);
+  // Runs op_idx with the shapes of the plan, or records them. Ops of
+  // different indices may run concurrently.
+  void RunOp(size_t op_idx, const Scope& scope, const platform::Place& place);
+
+  size_t capacity() const { return capacity_; }
+  ShapePlanCacheStats stats() const;
+
+ private:
+  struct OpShapes {
+    bool recorded{false};
+    std::vector<int64_t> input_key;
+    std::vector<DDim> dims;
+    std::vector<LoD> lods;
+  };
+  using Plan = std::vector<OpShapes>;
+  using Key = std::vector<int64_t>;
+
+  void Init(Scope* scope);
+  bool InputKey(size_t op_idx, std::vector<int64_t>* key) const;
+  Key ProgramInputKey() const;
+
+  const std::vector<std::unique_ptr<OperatorBase>>& ops_;
+  const size_t capacity_;
+  const Scope* scope_{nullptr};
+
+  // Per op, the input and output variables, and whether its shapes can be
+  // planned. uint8_t rather than bool, ops update their own flag
+  // concurrently.
+  std::vector<std::vector<Variable*>> op_inputs_;
+  std::vector<std::vector<Variable*>> op_outputs_;
+  std::vector<uint8_t> cacheable_;
+  std::vector<Variable*> program_inputs_;
+
+  // Most recently used first.
+  std::list<std::pair<Key, Plan>> plans_;
+  std::map<Key, std::list<std::pair<Key, Plan>>::iterator> index_;
+  Plan* current_{nullptr};
+
+  uint64_t hits_{0};
+  uint64_t misses_{0};
+  uint64_t evictions_{0};
+  std::atomic<uint64_t> skipped_infer_shapes_{0};
+  std::atomic<uint64_t> run_infer_shapes_{0};
+};
+
+}  // namespace framework
+}  // namespace paddle
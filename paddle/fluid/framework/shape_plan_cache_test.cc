@@ -0,0 +1,148 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/shape_plan_cache.h"
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/naive_executor.h"
+#include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/framework/program_desc.h"
+#include "paddle/fluid/platform/init.h"
+
+namespace paddle {
+namespace framework {
+
+static int infer_shape_calls = 0;
+
+// Out = X repeated Times times, Times is a one element int64 tensor.
+class ShapeCacheTestRepeatOp : public OperatorWithKernel {
+ public:
+  using OperatorWithKernel::OperatorWithKernel;
+
+ protected:
+  void InferShape(framework::InferShapeContext* ctx) const override {
+    ++infer_shape_calls;
+    auto x_dims = ctx->GetInputDim("X");
+    int64_t times = 1;
+    if (ctx->IsRuntime()) {
+      auto* var = BOOST_GET(Variable*, ctx->GetInputVarPtrs("Times")[0]);
+      times = var->Get<LoDTensor>().data<int64_t>()[0];
+    }
+    ctx->SetOutputDim("Out", {x_dims[0] * times});
+  }
+  OpKernelType GetExpectedKernelType(
+      const ExecutionContext& ctx) const override {
+    return OpKernelType(proto::VarType::FP32, ctx.GetPlace());
+  }
+};
+
+class ShapeCacheTestRepeatOpMaker : public OpProtoAndCheckerMaker {
+ public:
+  void Make() {
+    AddInput("X", "input");
+    AddInput("Times", "number of repeats");
+    AddOutput("Out", "output");
+    AddComment("");
+  }
+};
+
+template <typename DeviceContext, typename T>
+class ShapeCacheTestRepeatKernel : public OpKernel<T> {
+ public:
+  void Compute(const ExecutionContext& ctx) const {
+    auto* x = ctx.Input<LoDTensor>("X");
+    auto* out = ctx.Output<LoDTensor>("Out");
+    T* out_data = out->mutable_data<T>(ctx.GetPlace());
+    for (int64_t i = 0; i < out->numel(); ++i) {
+      out_data[i] = x->data<T>()[i % x->numel()];
+    }
+  }
+};
+
+TEST(ShapePlanCache, naive_executor) {
+  InitDevices();
+  // a -> (repeat t) b -> (repeat t) c
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  for (auto name : {"a", "t", "b", "c"}) {
+    block->Var(name)->SetType(proto::VarType::LOD_TENSOR);
+  }
+  for (auto pair : {std::make_pair("a", "b"), std::make_pair("b", "c")}) {
+    auto* op = block->AppendOp();
+    op->SetType("shape_cache_test_repeat");
+    op->SetInput("X", {pair.first});
+    op->SetInput("Times", {"t"});
+    op->SetOutput("Out", {pair.second});
+  }
+
+  auto place = platform::CPUPlace();
+  Scope scope;
+  Scope* sub_scope = &scope.NewScope();
+  NaiveExecutor exe(place);
+  exe.CreateVariables(program, 0, false, sub_scope);
+  exe.Prepare(sub_scope, program, 0, false);
+  exe.EnableShapePlanCache(2);
+
+  auto run = [&](int64_t n, int64_t times) {
+    auto* a = exe.FindTensor("a");
+    a->Resize({n});
+    float* a_data = a->mutable_data<float>(place);
+    for (int64_t i = 0; i < n; ++i) a_data[i] = i;
+    auto* t = exe.FindTensor("t");
+    t->Resize({1});
+    t->mutable_data<int64_t>(place)[0] = times;
+    exe.Run();
+    auto* c = exe.FindTensor("c");
+    ASSERT_EQ(c->numel(), n * times * times);
+    for (int64_t i = 0; i < c->numel(); ++i) {
+      ASSERT_EQ(c->data<float>()[i], i % n);
+    }
+  };
+
+  run(4, 2);
+  EXPECT_EQ(infer_shape_calls, 2);
+  run(4, 2);
+  run(4, 2);
+  EXPECT_EQ(infer_shape_calls, 2);
+  auto stats = exe.shape_plan_cache()->stats();
+  EXPECT_EQ(stats.hits, 2UL);
+  EXPECT_EQ(stats.misses, 1UL);
+  EXPECT_EQ(stats.skipped_infer_shapes, 4UL);
+
+  // The input shapes are the same but the shapes depend on the value of t.
+  run(4, 3);
+  EXPECT_EQ(infer_shape_calls, 4);
+  run(4, 3);
+  EXPECT_EQ(infer_shape_calls, 4);
+
+  // New input shapes evict the least recently used plan.
+  run(5, 2);
+  run(6, 2);
+  EXPECT_EQ(infer_shape_calls, 8);
+  run(4, 3);
+  EXPECT_EQ(infer_shape_calls, 10);
+  stats = exe.shape_plan_cache()->stats();
+  EXPECT_EQ(stats.num_plans, 2UL);
+  EXPECT_EQ(stats.evictions, 2UL);
+}
+
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_OP_WITHOUT_GRADIENT(shape_cache_test_repeat,
+                             paddle::framework::ShapeCacheTestRepeatOp,
+                             paddle::framework::ShapeCacheTestRepeatOpMaker);
+REGISTER_OP_CPU_KERNEL(shape_cache_test_repeat,
+                       paddle::framework::ShapeCacheTestRepeatKernel<
+                           paddle::platform::CPUDeviceContext, float>);
@@ -0,0 +1,348 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/static_memory_plan.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#include "paddle/fluid/framework/feed_fetch_type.h"
+#include "paddle/fluid/framework/lod_tensor.h"
+#include "paddle/fluid/memory/allocation/allocator.h"
+#include "paddle/fluid/memory/malloc.h"
+
+namespace paddle {
+namespace framework {
+
+namespace {
+
+constexpr size_t kMemoryPlanAlignment = 256;
+
+// A tensor buffer inside the arena. It keeps the arena alive while tensors
+// still hold it.
+class StaticMemoryPlanSlice : public memory::allocation::Allocation {
+ public:
+  StaticMemoryPlanSlice(const std::shared_ptr<phi::Allocation>& arena,
+                        size_t offset, size_t size)
+      : Allocation(static_cast<uint8_t*>(arena->ptr()) + offset, size,
+                   arena->place()),
+        arena_(arena) {}
+
+ private:
+  std::shared_ptr<phi::Allocation> arena_;
+};
+
+bool IsSlice(const LoDTensor& tensor) {
+  return dynamic_cast<const StaticMemoryPlanSlice*>(tensor.Holder().get()) !=
+         nullptr;
+}
+
+void AppendTensorKey(const LoDTensor& tensor, std::vector<int64_t>* key) {
+  auto dims = tensor.dims();
+  key->push_back(dims.size());
+  for (int i = 0; i < dims.size(); ++i) key->push_back(dims[i]);
+  key->push_back(static_cast<int64_t>(tensor.dtype()));
+  for (auto& level : tensor.lod()) key->push_back(level.size());
+}
+
+}  // namespace
+
+size_t AssignMemoryPlanOffsets(std::vector<MemoryPlanBlock>* blocks,
+                               size_t alignment) {
+  auto& b = *blocks;
+  std::vector<size_t> order(b.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t x, size_t y) {
+    return b[x].size > b[y].size;
+  });
+
+  size_t arena_size = 0;
+  std::vector<size_t> placed;
+  std::vector<std::pair<size_t, size_t>> conflicts;
+  for (size_t idx : order) {
+    size_t size = (b[idx].size + alignment - 1) / alignment * alignment;
+    conflicts.clear();
+    for (size_t other : placed) {
+      if (b[other].first_use <= b[idx].last_use &&
+          b[idx].first_use <= b[other].last_use) {
+        size_t other_size =
+            (b[other].size + alignment - 1) / alignment * alignment;
+        conflicts.emplace_back(b[other].offset, b[other].offset + other_size);
+      }
+    }
+    std::sort(conflicts.begin(), conflicts.end());
+    // Best fit among the gaps between the live blocks, or after them.
+    size_t cursor = 0;
+    size_t best_offset = 0;
+    size_t best_gap = std::numeric_limits<size_t>::max();
+    for (auto& range : conflicts) {
+      if (range.first > cursor) {
+        size_t gap = range.first - cursor;
+        if (gap >= size && gap < best_gap) {
+          best_gap = gap;
+          best_offset = cursor;
+        }
+      }
+      cursor = std::max(cursor, range.second);
+    }
+    b[idx].offset =
+        best_gap == std::numeric_limits<size_t>::max() ? cursor : best_offset;
+    arena_size = std::max(arena_size, b[idx].offset + size);
+    placed.push_back(idx);
+  }
+  return arena_size;
+}
+
+StaticMemoryPlanner::StaticMemoryPlanner(
+    const std::vector<std::unique_ptr<OperatorBase>>& ops,
+    const std::vector<std::string>& skip_vars, const platform::Place& place)
+    : ops_(ops), skip_vars_(skip_vars.begin(), skip_vars.end()),
+      place_(place) {}
+
+void StaticMemoryPlanner::Init(Scope* scope) {
+  std::unordered_set<std::string> written;
+  std::unordered_set<std::string> not_planned(skip_vars_);
+  auto use = [&](const std::string& name, size_t op_idx) {
+    auto it = var_ids_.find(name);
+    if (it == var_ids_.end()) {
+      it = var_ids_.emplace(name, static_cast<int>(var_names_.size())).first;
+      var_names_.push_back(name);
+      first_use_.push_back(op_idx);
+      last_use_.push_back(op_idx);
+    }
+    last_use_[it->second] = op_idx;
+  };
+
+  for (size_t i = 0; i < ops_.size(); ++i) {
+    auto& op = ops_[i];
+    // The tensors of control flow ops are also used by their sub-blocks,
+    // and feed and fetch share their buffers with the feed and fetch lists.
+    bool opaque = op->HasAttr("sub_block") || op->HasAttr("blocks") ||
+                  op->Type() == "feed" || op->Type() == "fetch";
+    for (auto& pair : op->Inputs()) {
+      for (auto& name : pair.second) {
+        if (name == kEmptyVarName) continue;
+        if (!written.count(name) && !var_ids_.count(name)) {
+          // Read before written, an input of the program.
+          auto* var = scope->FindVar(name);
+          if (var) inputs_.push_back(var);
+          not_planned.insert(name);
+        }
+        if (opaque) not_planned.insert(name);
+        use(name, i);
+      }
+    }
+    for (auto& pair : op->Outputs()) {
+      for (auto& name : pair.second) {
+        if (name == kEmptyVarName) continue;
+        written.insert(name);
+        if (opaque) not_planned.insert(name);
+        use(name, i);
+      }
+    }
+  }
+
+  for (auto& name : var_names_) {
+    // Persistable variables live in the ancestors of the executor scope.
+    auto* var = scope->FindLocalVar(name);
+    vars_.push_back(var);
+    not_planned_.push_back(var == nullptr || not_planned.count(name) > 0);
+  }
+  initialized_ = true;
+}
+
+std::vector<int64_t> StaticMemoryPlanner::InputShapeKey() const {
+  std::vector<int64_t> key;
+  for (auto* var : inputs_) {
+    if (var->IsType<LoDTensor>()) {
+      AppendTensorKey(var->Get<LoDTensor>(), &key);
+    } else if (var->IsType<FeedList>()) {
+      for (auto& item : var->Get<FeedList>()) {
+        const auto* tensor = boost::get<LoDTensor>(&item);
+        if (tensor) {
+          AppendTensorKey(*tensor, &key);
+        } else {
+          key.push_back(-1);
+        }
+      }
+    }
+  }
+  return key;
+}
+
+int StaticMemoryPlanner::Find(int var) {
+  while (parent_[var] != var) {
+    parent_[var] = parent_[parent_[var]];
+    var = parent_[var];
+  }
+  return var;
+}
+
+void StaticMemoryPlanner::Union(int a, int b) {
+  a = Find(a);
+  b = Find(b);
+  if (a == b) return;
+  parent_[a] = b;
+  excluded_[b] = excluded_[b] || excluded_[a];
+}
+
+void StaticMemoryPlanner::PrepareRun(Scope* scope) {
+  if (!initialized_) Init(scope);
+  auto key = InputShapeKey();
+  auto it = plans_.find(key);
+  if (it == plans_.end()) {
+    Unbind();
+    if (plans_.size() < kMaxPlans) {
+      recording_ = true;
+      recording_key_ = std::move(key);
+      parent_.resize(var_names_.size());
+      std::iota(parent_.begin(), parent_.end(), 0);
+      excluded_ = not_planned_;
+    }
+    return;
+  }
+
+  Plan* plan = &it->second;
+  if (bound_plan_ != plan) Unbind();
+  for (auto& slot : plan->slots) {
+    for (auto* var : slot.vars) {
+      auto* tensor = var->GetMutable<LoDTensor>();
+      if (tensor->Holder() != slot.slice) {
+        tensor->clear();
+        tensor->ResetHolder(slot.slice);
+      }
+    }
+  }
+  bound_plan_ = plan;
+}
+
+void StaticMemoryPlanner::RecordOp(size_t op_idx, const Scope& scope) {
+  struct Use {
+    int id;
+    const phi::Allocation* holder;
+  };
+  std::vector<Use> inputs, outputs;
+  auto collect = [&](const VariableNameMap& names, std::vector<Use>* uses) {
+    for (auto& pair : names) {
+      for (auto& name : pair.second) {
+        auto* var = scope.FindVar(name);
+        if (!var || !var->IsType<LoDTensor>()) continue;
+        auto* holder = var->Get<LoDTensor>().Holder().get();
+        if (!holder) continue;
+        auto it = var_ids_.find(name);
+        uses->push_back({it == var_ids_.end() ? -1 : it->second, holder});
+      }
+    }
+  };
+  auto& op = ops_[op_idx];
+  collect(op->Inputs(), &inputs);
+  collect(op->Outputs(), &outputs);
+
+  auto share = [&](const Use& out, const Use& other) {
+    if (out.id < 0 || out.holder != other.holder) return;
+    if (other.id < 0) {
+      excluded_[Find(out.id)] = true;
+    } else {
+      Union(out.id, other.id);
+    }
+  };
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    for (auto& in : inputs) share(outputs[i], in);
+    for (size_t j = i + 1; j < outputs.size(); ++j) {
+      share(outputs[i], outputs[j]);
+    }
+  }
+}
+
+void StaticMemoryPlanner::FinishRecording() {
+  recording_ = false;
+  const size_t num_vars = var_names_.size();
+  for (size_t v = 0; v < num_vars; ++v) {
+    auto* var = vars_[v];
+    bool plannable = var && var->IsType<LoDTensor>();
+    if (plannable) {
+      auto& holder = var->Get<LoDTensor>().Holder();
+      plannable = !holder || holder->place() == place_;
+    }
+    if (!plannable) excluded_[Find(v)] = true;
+  }
+
+  std::map<int, size_t> group_block;
+  std::vector<MemoryPlanBlock> blocks;
+  std::vector<std::vector<Variable*>> members;
+  for (size_t v = 0; v < num_vars; ++v) {
+    int root = Find(v);
+    if (excluded_[root]) continue;
+    auto it = group_block.find(root);
+    if (it == group_block.end()) {
+      it = group_block.emplace(root, blocks.size()).first;
+      blocks.push_back({0, first_use_[v], last_use_[v], 0});
+      members.emplace_back();
+    }
+    auto& block = blocks[it->second];
+    auto& holder = vars_[v]->Get<LoDTensor>().Holder();
+    if (holder) block.size = std::max(block.size, holder->size());
+    block.first_use = std::min(block.first_use, first_use_[v]);
+    block.last_use = std::max(block.last_use, last_use_[v]);
+    members[it->second].push_back(vars_[v]);
+  }
+
+  Plan plan;
+  size_t total_bytes = 0;
+  for (auto& block : blocks) total_bytes += block.size;
+  plan.arena_size = AssignMemoryPlanOffsets(&blocks, kMemoryPlanAlignment);
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    if (blocks[i].size == 0) continue;
+    plan.slots.push_back(
+        {std::move(members[i]), blocks[i].offset, blocks[i].size, nullptr});
+  }
+  VLOG(3) << "Static memory plan " << plans_.size() << ": "
+          << plan.slots.size() << " buffers of " << total_bytes
+          << " bytes packed into " << plan.arena_size << " bytes.";
+  plans_.emplace(std::move(recording_key_), std::move(plan));
+
+  size_t needed = 0;
+  for (auto& pair : plans_) needed = std::max(needed, pair.second.arena_size);
+  if (needed > arena_size_) {
+    arena_ = memory::AllocShared(place_, needed);
+    arena_size_ = needed;
+  }
+  CreateSlices();
+}
+
+void StaticMemoryPlanner::CreateSlices() {
+  for (auto& pair : plans_) {
+    for (auto& slot : pair.second.slots) {
+      slot.slice = std::make_shared<StaticMemoryPlanSlice>(arena_, slot.offset,
+                                                           slot.size);
+    }
+  }
+}
+
+void StaticMemoryPlanner::Unbind() {
+  if (!bound_plan_) return;
+  for (auto& slot : bound_plan_->slots) {
+    for (auto* var : slot.vars) {
+      auto* tensor = var->GetMutable<LoDTensor>();
+      if (IsSlice(*tensor)) tensor->clear();
+    }
+  }
+  bound_plan_ = nullptr;
+}
+
+}  // namespace framework
+}  // namespace paddle
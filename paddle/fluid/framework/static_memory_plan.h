@@ -0,0 +1,133 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "paddle/fluid/framework/operator.h"
+#include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/platform/place.h"
+
+namespace paddle {
+namespace framework {
+
+// A buffer to place in the arena. It is live from op first_use to op
+// last_use, both included.
+struct MemoryPlanBlock {
+  size_t size;
+  size_t first_use;
+  size_t last_use;
+  size_t offset;
+};
+
+// Assigns the offsets of the blocks so that blocks with overlapping live
+// ranges do not overlap in memory, greedily placing the largest blocks first
+// into the tightest gap. Offsets are multiples of alignment. Returns the
+// size of the arena that holds all the blocks.
+size_t AssignMemoryPlanOffsets(std::vector<MemoryPlanBlock>* blocks,
+                               size_t alignment);
+
+/*
+ * Static memory plan of the intermediate tensors of a NaiveExecutor.
+ *
+ * The first run with a new set of input shapes records the size of every
+ * intermediate tensor and which tensors share a buffer, and packs their
+ * buffers into one arena by their live ranges over the op list. Every later
+ * run with the same input shapes binds the tensors to their slices of the
+ * arena before the ops run, so the ops find their outputs already allocated
+ * and the peak footprint is known. Input tensors, tensors in skip_vars,
+ * persistable tensors and the tensors used by control flow ops are not
+ * planned and are allocated as usual.
+ */
+class StaticMemoryPlanner {
+ public:
+  // At most this many input shapes get a plan, the others run unplanned.
+  static constexpr size_t kMaxPlans = 16;
+
+  StaticMemoryPlanner(const std::vector<std::unique_ptr<OperatorBase>>& ops,
+                      const std::vector<std::string>& skip_vars,
+                      const platform::Place& place);
+
+  // Binds the tensors to the arena when there is a plan for the current
+  // input shapes, otherwise starts recording one if there is room.
+  void PrepareRun(Scope* scope);
+  bool recording() const { return recording_; }
+  // Records the buffers shared between the inputs and outputs of op_idx,
+  // called after the op runs when recording.
+  void RecordOp(size_t op_idx, const Scope& scope);
+  // Builds the plan of the recorded run.
+  void FinishRecording();
+  // Detaches the tensors bound by the last run from the arena.
+  void Unbind();
+
+  size_t arena_size() const { return arena_size_; }
+  size_t num_plans() const { return plans_.size(); }
+  std::vector<std::string> skip_vars() const {
+    return std::vector<std::string>(skip_vars_.begin(), skip_vars_.end());
+  }
+
+ private:
+  struct Slot {
+    std::vector<Variable*> vars;
+    size_t offset;
+    size_t size;
+    std::shared_ptr<phi::Allocation> slice;
+  };
+  struct Plan {
+    std::vector<Slot> slots;
+    size_t arena_size;
+  };
+
+  void Init(Scope* scope);
+  std::vector<int64_t> InputShapeKey() const;
+  int Find(int var);
+  void Union(int a, int b);
+  void CreateSlices();
+
+  const std::vector<std::unique_ptr<OperatorBase>>& ops_;
+  std::unordered_set<std::string> skip_vars_;
+  const platform::Place place_;
+  bool initialized_{false};
+
+  // Candidate variables with their live ranges.
+  std::vector<std::string> var_names_;
+  std::vector<Variable*> vars_;
+  std::vector<size_t> first_use_;
+  std::vector<size_t> last_use_;
+  std::map<std::string, int> var_ids_;
+  std::vector<Variable*> inputs_;
+
+  // Buffer sharing found by the recording run, as a union-find forest over
+  // the candidates. Groups that share a buffer with a tensor that is not
+  // planned are excluded.
+  bool recording_{false};
+  std::vector<int64_t> recording_key_;
+  std::vector<int> parent_;
+  std::vector<bool> excluded_;
+  // Candidates that are never planned, whatever the recording run finds.
+  std::vector<bool> not_planned_;
+
+  std::map<std::vector<int64_t>, Plan> plans_;
+  Plan* bound_plan_{nullptr};
+  std::shared_ptr<phi::Allocation> arena_;
+  size_t arena_size_{0};
+};
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,166 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/static_memory_plan.h"
+
+#include <random>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/naive_executor.h"
+#include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/framework/program_desc.h"
+
+namespace paddle {
+namespace framework {
+
+class PlanTestAddOneOp : public OperatorBase {
+ public:
+  PlanTestAddOneOp(const std::string& type, const VariableNameMap& inputs,
+                   const VariableNameMap& outputs, const AttributeMap& attrs)
+      : OperatorBase(type, inputs, outputs, attrs) {}
+
+ private:
+  void RunImpl(const Scope& scope,
+               const platform::Place& place) const override {
+    auto& x = scope.FindVar(Input("X"))->Get<LoDTensor>();
+    auto* out = scope.FindVar(Output("Out"))->GetMutable<LoDTensor>();
+    out->Resize(x.dims());
+    const float* x_data = x.data<float>();
+    float* out_data = out->mutable_data<float>(place);
+    for (int64_t i = 0; i < x.numel(); ++i) out_data[i] = x_data[i] + 1;
+  }
+};
+
+class PlanTestViewOp : public OperatorBase {
+ public:
+  PlanTestViewOp(const std::string& type, const VariableNameMap& inputs,
+                 const VariableNameMap& outputs, const AttributeMap& attrs)
+      : OperatorBase(type, inputs, outputs, attrs) {}
+
+ private:
+  void RunImpl(const Scope& scope,
+               const platform::Place& place) const override {
+    auto& x = scope.FindVar(Input("X"))->Get<LoDTensor>();
+    scope.FindVar(Output("Out"))->GetMutable<LoDTensor>()->ShareDataWith(x);
+  }
+};
+
+class PlanTestOpMaker : public OpProtoAndCheckerMaker {
+ public:
+  void Make() override {
+    AddInput("X", "input");
+    AddOutput("Out", "output");
+    AddComment("");
+  }
+};
+
+TEST(StaticMemoryPlan, assign_offsets) {
+  std::vector<MemoryPlanBlock> blocks = {
+      {100, 0, 1, 0}, {300, 1, 2, 0}, {50, 2, 3, 0}, {200, 3, 4, 0}};
+  size_t arena_size = AssignMemoryPlanOffsets(&blocks, 64);
+  // The largest block goes first. The 200 bytes block is never live with it
+  // and shares its offset, the other two are stacked above it.
+  EXPECT_EQ(blocks[1].offset, 0UL);
+  EXPECT_EQ(blocks[0].offset, 320UL);
+  EXPECT_EQ(blocks[3].offset, 0UL);
+  EXPECT_EQ(blocks[2].offset, 320UL);
+  EXPECT_EQ(arena_size, 448UL);
+
+  std::mt19937 gen(1);
+  blocks.clear();
+  for (int i = 0; i < 200; ++i) {
+    size_t first = gen() % 100;
+    blocks.push_back({gen() % 10000 + 1, first, first + gen() % 20, 0});
+  }
+  arena_size = AssignMemoryPlanOffsets(&blocks, 256);
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    ASSERT_EQ(blocks[i].offset % 256, 0UL);
+    ASSERT_LE(blocks[i].offset + blocks[i].size, arena_size);
+    for (size_t j = i + 1; j < blocks.size(); ++j) {
+      bool live_together = blocks[i].first_use <= blocks[j].last_use &&
+                           blocks[j].first_use <= blocks[i].last_use;
+      bool overlap = blocks[i].offset < blocks[j].offset + blocks[j].size &&
+                     blocks[j].offset < blocks[i].offset + blocks[i].size;
+      ASSERT_FALSE(live_together && overlap);
+    }
+  }
+}
+
+TEST(StaticMemoryPlan, naive_executor) {
+  // a -> b -> c -> (view) d -> e -> f
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  std::vector<std::string> names = {"a", "b", "c", "d", "e", "f"};
+  for (auto& name : names) {
+    block->Var(name)->SetType(proto::VarType::LOD_TENSOR);
+  }
+  for (size_t i = 0; i + 1 < names.size(); ++i) {
+    auto* op = block->AppendOp();
+    op->SetType(i == 2 ? "plan_test_view" : "plan_test_add_one");
+    op->SetInput("X", {names[i]});
+    op->SetOutput("Out", {names[i + 1]});
+  }
+
+  auto place = platform::CPUPlace();
+  Scope scope;
+  Scope* sub_scope = &scope.NewScope();
+  NaiveExecutor exe(place);
+  exe.CreateVariables(program, 0, false, sub_scope);
+  exe.Prepare(sub_scope, program, 0, false);
+  exe.EnableStaticMemoryPlan({"f"});
+
+  auto run = [&](int64_t n) {
+    auto* a = exe.FindTensor("a");
+    a->Resize({n});
+    float* a_data = a->mutable_data<float>(place);
+    for (int64_t i = 0; i < n; ++i) a_data[i] = i;
+    exe.Run();
+    auto* f = exe.FindTensor("f");
+    ASSERT_EQ(f->numel(), n);
+    for (int64_t i = 0; i < n; ++i) ASSERT_EQ(f->data<float>()[i], i + 3);
+  };
+
+  run(16);
+  EXPECT_EQ(exe.memory_planner()->num_plans(), 1UL);
+  for (int i = 0; i < 3; ++i) {
+    run(16);
+    // b and e are never live together and share the same buffer, d is a
+    // view of c.
+    EXPECT_EQ(exe.FindTensor("b")->data<float>(),
+              exe.FindTensor("e")->data<float>());
+    EXPECT_EQ(exe.FindTensor("c")->data<float>(),
+              exe.FindTensor("d")->data<float>());
+    EXPECT_NE(exe.FindTensor("b")->data<float>(),
+              exe.FindTensor("c")->data<float>());
+    EXPECT_NE(exe.FindTensor("f")->data<float>(),
+              exe.FindTensor("e")->data<float>());
+  }
+  EXPECT_EQ(exe.memory_planner()->arena_size(), 512UL);
+
+  // A new input shape is recorded first, then planned as well.
+  run(1000);
+  run(1000);
+  run(16);
+  EXPECT_EQ(exe.memory_planner()->num_plans(), 2UL);
+  EXPECT_EQ(exe.memory_planner()->arena_size(), 8192UL);
+}
+
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_OP_WITHOUT_GRADIENT(plan_test_add_one,
+                             paddle::framework::PlanTestAddOneOp,
+                             paddle::framework::PlanTestOpMaker);
+REGISTER_OP_WITHOUT_GRADIENT(plan_test_view, paddle::framework::PlanTestViewOp,
+                             paddle::framework::PlanTestOpMaker);
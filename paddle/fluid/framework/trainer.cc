@@ -35,6 +35,15 @@ void TrainerBase::ParseDumpConfig(const TrainerDesc& desc) {
   }
 
   dump_converter_ = desc.dump_converter();
+  PADDLE_ENFORCE_EQ(
+      desc.dump_format() == "text" || desc.dump_format() == "binary", true,
+      platform::errors::InvalidArgument(
+          "The dump_format should be text or binary, but received %s.",
+          desc.dump_format()));
+  binary_dump_ = desc.dump_format() == "binary";
+  if (desc.dump_queue_capacity() > 0) {
+    dump_queue_capacity_ = desc.dump_queue_capacity();
+  }
   if (desc.dump_fields_size() != 0) {
     need_dump_field_ = true;
     dump_fields_.resize(desc.dump_fields_size());
@@ -52,30 +61,45 @@ void TrainerBase::ParseDumpConfig(const TrainerDesc& desc) {
   }
 }
 
+// Writes the dump channel to the file of tid, in large blocks. The batch
+// records of DeviceWorker::DumpField are formatted into text lines, or with
+// dump_format binary, every string is written as a uint64 length and its
+// bytes, the batch records as they are.
 void TrainerBase::DumpWork(int tid) {
 #ifdef _LINUX
+  constexpr size_t kDumpBufferSize = 4 << 20;
   int err_no = 0;
   // GetDumpPath is implemented in each Trainer
   std::string path = GetDumpPath(tid);
 
   std::shared_ptr<FILE> fp = fs_open_write(path, &err_no, dump_converter_);
-  while (1) {
-    std::string out_str;
-    if (!queue_->Get(out_str)) {
-      break;
-    }
+  std::string buffer;
+  buffer.reserve(kDumpBufferSize * 2);
+  auto flush = [&]() {
     size_t write_count =
-        fwrite_unlocked(out_str.data(), 1, out_str.length(), fp.get());
-    if (write_count != out_str.length()) {
+        fwrite_unlocked(buffer.data(), 1, buffer.length(), fp.get());
+    if (write_count != buffer.length()) {
       VLOG(3) << "dump text failed";
-      continue;
     }
-    write_count = fwrite_unlocked("\n", 1, 1, fp.get());
-    if (write_count != 1) {
-      VLOG(3) << "dump text failed";
-      continue;
+    buffer.clear();
+  };
+  std::string out_str;
+  while (queue_->Get(out_str)) {
+    if (binary_dump_) {
+      uint64_t size = out_str.length();
+      buffer.append(reinterpret_cast<const char*>(&size), sizeof(size));
+      buffer.append(out_str);
+    } else if (IsDumpBatch(out_str)) {
+      DumpBatchToText(out_str, &buffer);
+    } else {
+      buffer.append(out_str);
+      buffer.push_back('\n');
+    }
+    if (buffer.length() >= kDumpBufferSize) {
+      flush();
     }
   }
+  flush();
 #endif
 }
 
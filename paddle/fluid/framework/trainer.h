@@ -16,6 +16,7 @@ limitations under the License. */
 
 #include <ctime>
 #include <fstream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT
@@ -94,6 +95,8 @@ class TrainerBase {
   std::string dump_converter_;
   std::vector<std::string> dump_param_;
   std::vector<std::string> dump_fields_;
+  bool binary_dump_ = false;
+  size_t dump_queue_capacity_ = (std::numeric_limits<size_t>::max)();
   int dump_thread_num_;
   std::vector<std::thread> dump_thread_;
   std::shared_ptr<paddle::framework::ChannelObject<std::string>> queue_;
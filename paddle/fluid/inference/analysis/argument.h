@@ -187,6 +187,9 @@ struct Argument {
   // Passed from config.
   DECL_ARGUMENT_FIELD(use_gpu, UseGPU, bool);
   DECL_ARGUMENT_FIELD(use_fc_padding, UseFcPadding, bool);
+  DECL_ARGUMENT_FIELD(weight_only_quant_bits, WeightOnlyQuantBits, int);
+  DECL_ARGUMENT_FIELD(weight_only_quant_group_size, WeightOnlyQuantGroupSize,
+                      int);
   DECL_ARGUMENT_FIELD(gpu_device_id, GPUDeviceId, int);
   DECL_ARGUMENT_FIELD(use_gpu_fp16, UseGPUFp16, bool);
   DECL_ARGUMENT_FIELD(gpu_fp16_disabled_op_types, GpuFp16DisabledOpTypes,
@@ -252,6 +252,11 @@ void IRPassManager::CreatePasses(Argument *argument,
       bool use_fc_padding = !fc_mkldnn_pass && argument->use_fc_padding();
       pass->Set("use_fc_padding", new bool(use_fc_padding));
     }
+    if (pass_name == "weight_only_quant_pass") {
+      pass->Set("weight_bits", new int(argument->weight_only_quant_bits()));
+      pass->Set("group_size",
+                new int(argument->weight_only_quant_group_size()));
+    }
     pre_pass = pass_name;
 
     passes_.emplace_back(std::move(pass));
@@ -0,0 +1,173 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Times the IR passes of the CPU inference on a large synthetic program, so
+// that the cost of the graph pattern matching shows up per pass.
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "paddle/fluid/framework/ir/pass_tester_helper.h"
+#include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/inference/api/paddle_inference_pass.h"
+#include "paddle/fluid/inference/api/paddle_pass_builder.h"
+#include "paddle/fluid/string/split.h"
+
+DEFINE_int32(blocks, 100, "The number of blocks of the program.");
+DEFINE_int32(repeat, 5, "Repeat times.");
+DEFINE_string(passes, "",
+              "The comma separated passes to run, the ones of "
+              "CpuPassStrategy by default.");
+
+namespace paddle {
+namespace inference {
+namespace analysis {
+
+using framework::ir::Layers;
+
+// Each block holds the patterns of the fc, conv + bn, matmul and attention
+// fusions, connected by the data flowing through the blocks.
+framework::ProgramDesc BuildProgram(int blocks) {
+  Layers layers;
+  auto* x = layers.data("x", {1, 16});
+  auto* image = layers.data("image", {1, 16, 8, 8});
+  int id = 0;
+  auto param = [&](const std::vector<int64_t>& shape) {
+    return layers.data("param_" + std::to_string(id++), shape, true);
+  };
+  for (int i = 0; i < blocks; ++i) {
+    // mul + elementwise_add + relu, twice for repeated_fc_relu_fuse_pass.
+    for (int j = 0; j < 2; ++j) {
+      x = layers.relu(layers.elementwise_add(
+          layers.mul(x, param({16, 16})), param({16})));
+    }
+    // conv2d + batch_norm + relu.
+    auto* conv = layers.conv2d(image, param({16, 16, 1, 1}), param({16}));
+    auto* bn = layers.batch_norm(conv, param({16}), param({16}), param({16}),
+                                 param({16}))[0];
+    image = layers.relu(bn);
+    // reshape2 + matmul, matmul_v2 + scale and the attention of a head.
+    auto* reshape = layers.reshape2(x, {1, 16}, true);
+    auto* q = layers.matmul(reshape, param({16, 16}));
+    auto* k = layers.scale(layers.matmul_v2(x, param({16, 16})), 0.5, 0, true);
+    auto* qk = layers.matmul(layers.transpose2(q, {1, 0}, true), k);
+    auto* v = layers.softmax(qk, -1);
+    x = layers.layer_norm(layers.elementwise_add(x, layers.matmul_v2(v, k)),
+                          param({16}), param({16}))[0];
+  }
+  return layers.main_program();
+}
+
+// The persistables of the program filled with ones.
+framework::Scope* BuildParamScope(const framework::ProgramDesc& program) {
+  auto* scope = new framework::Scope();
+  for (auto* var : program.Block(0).AllVars()) {
+    if (!var->Persistable()) continue;
+    auto* tensor = scope->Var(var->Name())->GetMutable<framework::LoDTensor>();
+    tensor->Resize(phi::make_ddim(var->GetShape()));
+    auto* data = tensor->mutable_data<float>(platform::CPUPlace());
+    std::fill(data, data + tensor->numel(), 1.f);
+  }
+  return scope;
+}
+
+// Applies the passes not failed yet to a graph of the program, adding the
+// time of each one to pass_ms. Returns false when a pass fails, it is added
+// to failed.
+bool RunPasses(const framework::ProgramDesc& program,
+               const std::vector<std::string>& passes,
+               std::map<std::string, std::string>* failed,
+               std::map<std::string, double>* pass_ms) {
+  std::unique_ptr<framework::ir::Graph> graph(
+      new framework::ir::Graph(program));
+  graph->Set("__param_scope__", BuildParamScope(program));
+  for (auto& name : passes) {
+    if (failed->count(name)) continue;
+    if (!framework::ir::PassRegistry::Instance().Has(name)) {
+      (*failed)[name] = "not registered";
+      continue;
+    }
+    auto pass = framework::ir::PassRegistry::Instance().Get(name);
+    auto start = std::chrono::steady_clock::now();
+    try {
+      graph.reset(pass->Apply(graph.release()));
+    } catch (const std::exception& e) {
+      (*failed)[name] = e.what();
+      return false;
+    }
+    (*pass_ms)[name] += std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+  }
+  return true;
+}
+
+void Run() {
+  std::vector<std::string> passes = CpuPassStrategy().AllPasses();
+  if (!FLAGS_passes.empty()) passes = string::Split(FLAGS_passes, ',');
+  auto program = BuildProgram(FLAGS_blocks);
+  LOG(INFO) << "Run " << passes.size() << " passes on "
+            << program.Block(0).OpSize() << " ops, repeat " << FLAGS_repeat
+            << " times.";
+
+  // Warm up, without the passes failing on the program, which may leave the
+  // graph broken for the passes after them.
+  std::map<std::string, std::string> failed;
+  std::map<std::string, double> pass_ms;
+  while (!RunPasses(program, passes, &failed, &pass_ms)) {
+  }
+  pass_ms.clear();
+  for (int i = 0; i < FLAGS_repeat; ++i) {
+    RunPasses(program, passes, &failed, &pass_ms);
+  }
+
+  double total_ms = 0;
+  for (auto& name : passes) {
+    if (failed.count(name)) {
+      LOG(WARNING) << name << " is skipped: " << failed[name];
+      continue;
+    }
+    double ms = pass_ms[name] / FLAGS_repeat;
+    total_ms += ms;
+    std::cout << std::left << std::setw(48) << name << std::right
+              << std::setw(12) << std::fixed << std::setprecision(3) << ms
+              << " ms" << std::endl;
+  }
+  std::cout << std::left << std::setw(48) << "total" << std::right
+            << std::setw(12) << std::fixed << std::setprecision(3) << total_ms
+            << " ms" << std::endl;
+}
+
+}  // namespace analysis
+}  // namespace inference
+}  // namespace paddle
+
+// Options:
+//     --blocks: the number of blocks of the program
+//     --repeat: the repeat times
+//     --passes: the comma separated passes to run
+int main(int argc, char* argv[]) {
+  ::GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  paddle::inference::analysis::Run();
+  return 0;
+}
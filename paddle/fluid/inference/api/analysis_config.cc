@@ -219,6 +219,7 @@ AnalysisConfig::AnalysisConfig(const AnalysisConfig &other) {
                                   // params_file_ fields.
 
   CP_MEMBER(opt_cache_dir_);
+  CP_MEMBER(use_optim_model_cache_);
   CP_MEMBER(prog_file_);
   CP_MEMBER(params_file_);
 
@@ -232,6 +233,13 @@ AnalysisConfig::AnalysisConfig(const AnalysisConfig &other) {
   CP_MEMBER(gpu_fp16_disabled_op_types_);
 
   CP_MEMBER(enable_memory_optim_);
+  CP_MEMBER(enable_static_memory_plan_);
+  CP_MEMBER(enable_parallel_execution_);
+  CP_MEMBER(parallel_execution_threads_);
+  CP_MEMBER(shape_plan_cache_capacity_);
+  CP_MEMBER(use_weight_only_quant_);
+  CP_MEMBER(weight_only_quant_bits_);
+  CP_MEMBER(weight_only_quant_group_size_);
   // TensorRT related.
   CP_MEMBER(use_tensorrt_);
   CP_MEMBER(tensorrt_workspace_size_);
@@ -632,6 +640,22 @@ void AnalysisConfig::Update() {
 #endif
   }
 
+  if (use_weight_only_quant_) {
+    const auto &passes = pass_builder()->AllPasses();
+    if (!enable_ir_optim_) {
+      LOG(ERROR) << "EnableWeightOnlyQuant() only works when IR optimization "
+                    "is enabled.";
+    } else if (use_gpu() || use_xpu() || use_npu() || use_ipu()) {
+      LOG(ERROR) << "EnableWeightOnlyQuant() only works on CPU.";
+    } else if (std::find(passes.begin(), passes.end(),
+                         "weight_only_quant_pass") == passes.end()) {
+      // After the fc fusions, before the passes caching the runtime context.
+      auto it =
+          std::find(passes.begin(), passes.end(), "runtime_context_cache_pass");
+      pass_builder()->InsertPass(it - passes.begin(), "weight_only_quant_pass");
+    }
+  }
+
 #ifdef PADDLE_WITH_MKLDNN
   // Do not optimize when mkldnn is on
   if (enable_memory_optim_ && !use_mkldnn_) {
@@ -722,6 +746,13 @@ std::string AnalysisConfig::SerializeInfoCache() {
   ss << trt_dla_core_;
 
   ss << enable_memory_optim_;
+  ss << enable_static_memory_plan_;
+  ss << enable_parallel_execution_;
+  ss << parallel_execution_threads_;
+  ss << shape_plan_cache_capacity_;
+  ss << use_weight_only_quant_;
+  ss << weight_only_quant_bits_;
+  ss << weight_only_quant_group_size_;
 
   ss << use_mkldnn_;
   ss << mkldnn_cache_capacity_;
@@ -733,6 +764,7 @@ std::string AnalysisConfig::SerializeInfoCache() {
   for (auto &item : bfloat16_enabled_op_types_) ss << item;
   ss << ";";
   ss << model_from_memory_;
+  ss << use_optim_model_cache_;
 
   ss << with_profile_;
 
@@ -808,6 +840,53 @@ bool AnalysisConfig::enable_memory_optim() const {
   return enable_memory_optim_;
 }
 
+void AnalysisConfig::EnableStaticMemoryPlan(bool x) {
+  enable_static_memory_plan_ = x;
+}
+
+void AnalysisConfig::EnableParallelExecution(bool x) {
+  enable_parallel_execution_ = x;
+}
+
+void AnalysisConfig::SetParallelExecutionThreads(int num_threads) {
+  PADDLE_ENFORCE_GE(num_threads, 1,
+                    platform::errors::InvalidArgument(
+                        "The number of threads of the parallel execution "
+                        "should be at least 1, but it's %d.",
+                        num_threads));
+  parallel_execution_threads_ = num_threads;
+}
+
+void AnalysisConfig::EnableShapePlanCache(int capacity) {
+  PADDLE_ENFORCE_GE(capacity, 0,
+                    platform::errors::InvalidArgument(
+                        "The capacity of the shape plan cache should not be "
+                        "negative, but it's %d.",
+                        capacity));
+  shape_plan_cache_capacity_ = capacity;
+}
+
+void AnalysisConfig::EnableWeightOnlyQuant(int weight_bits, int group_size) {
+  PADDLE_ENFORCE_EQ(weight_bits == 8 || weight_bits == 4, true,
+                    platform::errors::InvalidArgument(
+                        "The weight_bits of the weight-only quantization "
+                        "should be 8 or 4, but it's %d.",
+                        weight_bits));
+  PADDLE_ENFORCE_GE(group_size, 0,
+                    platform::errors::InvalidArgument(
+                        "The group_size of the weight-only quantization "
+                        "should not be negative, but it's %d.",
+                        group_size));
+  use_weight_only_quant_ = true;
+  weight_only_quant_bits_ = weight_bits;
+  weight_only_quant_group_size_ = group_size;
+  Update();
+}
+
+void AnalysisConfig::EnableOptimModelCache(bool x) {
+  use_optim_model_cache_ = x;
+}
+
 void AnalysisConfig::SetModelBuffer(const char *prog_buffer,
                                     size_t prog_buffer_size,
                                     const char *param_buffer,
@@ -976,6 +1055,22 @@ std::string AnalysisConfig::Summary() {
   os.InsertRow({"ir_optim", enable_ir_optim_ ? "true" : "false"});
   os.InsertRow({"ir_debug", ir_debug_ ? "true" : "false"});
   os.InsertRow({"memory_optim", enable_memory_optim_ ? "true" : "false"});
+  os.InsertRow({"static_memory_plan",
+                enable_static_memory_plan_ ? "true" : "false"});
+  os.InsertRow({"parallel_execution",
+                enable_parallel_execution_
+                    ? std::to_string(parallel_execution_threads_)
+                    : "false"});
+  os.InsertRow({"shape_plan_cache",
+                shape_plan_cache_capacity_ > 0
+                    ? std::to_string(shape_plan_cache_capacity_)
+                    : "false"});
+  os.InsertRow({"weight_only_quant",
+                use_weight_only_quant_
+                    ? "int" + std::to_string(weight_only_quant_bits_)
+                    : "false"});
+  os.InsertRow({"optim_model_cache",
+                use_optim_model_cache_ ? "true" : "false"});
   os.InsertRow({"enable_profile", with_profile_ ? "true" : "false"});
   os.InsertRow({"enable_log", with_glog_info_ ? "true" : "false"});
   os.InsertRow({"collect_shape_range_info",
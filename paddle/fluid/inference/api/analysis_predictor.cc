@@ -20,15 +20,18 @@
 #include <fstream>
 #include <memory>
 #include <set>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "gflags/gflags.h"
 #include "paddle/fluid//platform/device/gpu/gpu_types.h"
 #include "paddle/fluid/framework/feed_fetch_method.h"
 #include "paddle/fluid/framework/feed_fetch_type.h"
 #include "paddle/fluid/framework/ir/fuse_pass_base.h"
 #include "paddle/fluid/framework/ir/pass.h"
+#include "paddle/fluid/framework/mapped_params_file.h"
 #include "paddle/fluid/framework/naive_executor.h"
 #include "paddle/fluid/framework/op_proto_maker.h"
 #include "paddle/fluid/framework/scope.h"
@@ -43,6 +46,7 @@
 #include "paddle/fluid/inference/utils/singleton.h"
 #include "paddle/fluid/memory/memcpy.h"
 #include "paddle/fluid/platform/cpu_helper.h"
+#include "paddle/fluid/platform/cpu_info.h"
 #include "paddle/fluid/platform/device/gpu/gpu_info.h"
 #include "paddle/fluid/platform/device_context.h"
 #include "paddle/fluid/platform/place.h"
@@ -249,7 +253,20 @@ bool AnalysisPredictor::PrepareProgram(
     // if enable_ir_optim_ is false,
     // the analysis pass(op fuse, graph analysis, trt subgraph, mkldnn etc) will
     // not be executed.
-    OptimizeInferenceProgram();
+    auto cache = GetOptimModelCache();
+    if (cache && cache->Has()) {
+      LoadOptimModel(*cache);
+    } else {
+      OptimizeInferenceProgram();
+      if (cache) {
+        std::vector<std::string> persistables;
+        for (auto *var : inference_program_->Block(0).AllVars()) {
+          if (IsPersistable(var)) persistables.push_back(var->Name());
+        }
+        std::sort(persistables.begin(), persistables.end());
+        cache->Store(GetSerializedProgram(), persistables, *scope_);
+      }
+    }
   } else {
     // If the program is passed from external, no need to optimize it, this
     // logic is used in the clone scenario.
@@ -388,6 +405,26 @@ bool AnalysisPredictor::PrepareExecutor() {
   executor_->Prepare(sub_scope_, *inference_program_, 0,
                      config_.use_feed_fetch_ops_);
 
+  if (config_.static_memory_plan_enabled()) {
+    // The outputs are read after Run, so they keep their own buffers.
+    std::vector<std::string> skip_vars;
+    for (auto &item : idx2fetches_) {
+      skip_vars.push_back(item.second);
+    }
+    executor_->EnableStaticMemoryPlan(skip_vars);
+  }
+
+  if (config_.shape_plan_cache_enabled()) {
+    executor_->EnableShapePlanCache(config_.shape_plan_cache_capacity());
+  }
+
+  if (config_.parallel_execution_enabled() &&
+      platform::is_cpu_place(place_) && !config_.mkldnn_enabled()) {
+    executor_->EnableParallelExecution(
+        config_.parallel_execution_threads(),
+        config_.cpu_math_library_num_threads());
+  }
+
   PADDLE_ENFORCE_NOT_NULL(sub_scope_,
                           platform::errors::PreconditionNotMet(
                               "The sub_scope should not be nullptr."));
@@ -822,6 +859,9 @@ bool AnalysisPredictor::GetFetch(std::vector<PaddleTensor> *outputs,
 void AnalysisPredictor::PrepareArgument() {
   argument_.SetUseGPU(config_.use_gpu());
   argument_.SetUseFcPadding(config_.use_fc_padding());
+  argument_.SetWeightOnlyQuantBits(config_.weight_only_quant_bits());
+  argument_.SetWeightOnlyQuantGroupSize(
+      config_.weight_only_quant_group_size());
   argument_.SetGPUDeviceId(config_.gpu_device_id());
   argument_.SetEnableAnalysisOptim(config_.enable_ir_optim_);
   argument_.SetEnableMemoryOptim(config_.enable_memory_optim());
@@ -1523,6 +1563,136 @@ bool AnalysisPredictor::LoadParameters() {
   return true;
 }
 
+std::unique_ptr<inference::OptimModelCache>
+AnalysisPredictor::GetOptimModelCache() {
+  if (!config_.optim_model_cache_enabled() || !config_.ir_optim()) {
+    return nullptr;
+  }
+  // The subgraph engines and the devices other than CPU and GPU keep state
+  // out of the program and the scope, the quantizer needs warmup data.
+  if (config_.tensorrt_engine_enabled() || config_.lite_engine_enabled() ||
+      config_.dlnne_enabled() || config_.use_xpu() || config_.use_npu() ||
+      config_.use_ipu() || config_.mkldnn_quantizer_enabled()) {
+    LOG(WARNING) << "The optimized model cache does not work with the "
+                    "subgraph engines, XPU, NPU, IPU or the MKLDNN quantizer.";
+    return nullptr;
+  }
+  std::string dir = config_.opt_cache_dir_;
+  if (dir.empty()) {
+    if (config_.model_from_memory()) {
+      LOG(WARNING) << "The optimized model cache of a model loaded from "
+                      "memory needs the directory set by SetOptimCacheDir.";
+      return nullptr;
+    }
+    dir = (config_.model_dir().empty()
+               ? inference::analysis::GetDirRoot(config_.prog_file())
+               : config_.model_dir()) +
+          "/_opt_cache";
+  }
+  if (!inference::analysis::PathExists(dir) && MKDIR(dir.c_str()) == -1) {
+    LOG(WARNING) << "Can not create the optimization cache directory " << dir
+                 << ", the optimized model is not cached.";
+    return nullptr;
+  }
+
+  // Everything the optimized model depends on: the passes and their code,
+  // the model, the config, the flags and the instructions the passes may
+  // target.
+  std::stringstream key;
+  key << get_version();
+  if (config_.model_from_memory()) {
+    key << "program: " << inference::HashBuffer(config_.prog_file()) << "\n";
+    key << "params: " << inference::HashBuffer(config_.params_file()) << "\n";
+  } else {
+    key << "program: "
+        << inference::HashFile(config_.model_dir().empty()
+                                   ? config_.prog_file()
+                                   : config_.model_dir() + "/__model__")
+        << "\n";
+    if (!config_.params_file().empty()) {
+      key << "params: " << inference::HashFile(config_.params_file()) << "\n";
+    } else {
+      for (auto *var : inference_program_->Block(0).AllVars()) {
+        if (!IsPersistable(var)) continue;
+        key << "param " << var->Name() << ": "
+            << inference::HashFile(config_.model_dir() + "/" + var->Name())
+            << "\n";
+      }
+    }
+  }
+  key << "config: " << inference::HashBuffer(config_.SerializeInfoCache())
+      << "\n";
+  key << "passes:";
+  for (auto &pass : config_.pass_builder()->AllPasses()) key << " " << pass;
+  key << "\nanalysis passes:";
+  for (auto &pass : config_.pass_builder()->AnalysisPasses()) {
+    key << " " << pass;
+  }
+  // The flags read by the passes, e.g. convert_all_blocks, are not in the
+  // config, so every flag not at its default is part of the key.
+  std::vector<gflags::CommandLineFlagInfo> flags;
+  gflags::GetAllFlags(&flags);
+  key << "\nflags:";
+  for (auto &flag : flags) {
+    if (flag.current_value != flag.default_value) {
+      key << " " << flag.name << "=" << flag.current_value;
+    }
+  }
+  key << "\nisa:";
+  for (auto isa : {platform::sse42, platform::avx, platform::avx2,
+                   platform::avx512f, platform::avx512_core,
+                   platform::avx512_core_vnni, platform::avx512_mic,
+                   platform::avx512_mic_4ops, platform::avx512_bf16}) {
+    key << " " << platform::MayIUse(isa);
+  }
+  key << "\n";
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+  if (config_.use_gpu()) {
+    key << "gpu: "
+        << platform::GetGPUComputeCapability(config_.gpu_device_id()) << "\n";
+  }
+#endif
+  return std::unique_ptr<inference::OptimModelCache>(
+      new inference::OptimModelCache(dir, key.str()));
+}
+
+void AnalysisPredictor::LoadOptimModel(
+    const inference::OptimModelCache &cache) {
+  inference_program_.reset(new framework::ProgramDesc(
+      inference::analysis::LoadProgramDesc(cache.program_path())));
+
+  framework::ProgramDesc load_program;
+  framework::BlockDesc *load_block = load_program.MutableBlock(0);
+  std::vector<std::string> params;
+  for (auto *var : inference_program_->Block(0).AllVars()) {
+    if (IsPersistable(var)) {
+      framework::VarDesc *new_var = load_block->Var(var->Name());
+      new_var->SetShape(var->GetShape());
+      new_var->SetDataType(var->GetDataType());
+      new_var->SetType(var->GetType());
+      new_var->SetLoDLevel(var->GetLoDLevel());
+      new_var->SetPersistable(true);
+      params.push_back(var->Name());
+    }
+  }
+  if (!params.empty()) {
+    std::sort(params.begin(), params.end());
+    framework::OpDesc *op = load_block->AppendOp();
+    op->SetType("load_combine");
+    op->SetOutput("Out", params);
+    op->SetAttr("file_path", {cache.params_path()});
+    op->CheckAttrs();
+  }
+  framework::NaiveExecutor e(place_);
+  e.Prepare(scope_.get(), load_program, 0, false);
+  e.Run();
+
+  // Released as OptimizeInferenceProgram() does.
+  config_.PartiallyRelease();
+  optim_model_cache_hit_ = true;
+  LOG(INFO) << "Loaded the optimized model from " << cache.program_path();
+}
+
 uint64_t AnalysisPredictor::TryShrinkMemory() {
   ClearIntermediateTensor();
   return paddle::memory::Release(place_);
@@ -1643,6 +1813,23 @@ std::string AnalysisPredictor::GetSerializedProgram() const {
   return inference_program_->Proto()->SerializeAsString();
 }
 
+void AnalysisPredictor::SaveMappedParams(const std::string &path) {
+  std::vector<std::string> names;
+  for (framework::VarDesc *var : program().Block(0).AllVars()) {
+    if (IsPersistable(var)) names.push_back(var->Name());
+  }
+  std::sort(names.begin(), names.end());
+  framework::SaveMappedParams(path, names, *scope_);
+}
+
+framework::ShapePlanCacheStats AnalysisPredictor::GetShapePlanCacheStats()
+    const {
+  if (!executor_ || !executor_->shape_plan_cache()) {
+    return framework::ShapePlanCacheStats();
+  }
+  return executor_->shape_plan_cache()->stats();
+}
+
 // Add SaveOptimModel
 void AnalysisPredictor::SaveOptimModel(const std::string &dir) {
   // save model
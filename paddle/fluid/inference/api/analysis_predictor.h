@@ -27,6 +27,7 @@
 #include "paddle/fluid/inference/api/api_impl.h"
 #include "paddle/fluid/inference/api/details/reset_tensor_array.h"
 #include "paddle/fluid/inference/api/helper.h"
+#include "paddle/fluid/inference/api/optim_model_cache.h"
 #include "paddle/fluid/inference/api/paddle_inference_api.h"
 #include "paddle/fluid/platform/device/gpu/gpu_types.h"
 #include "paddle/fluid/platform/float16.h"
@@ -267,6 +268,33 @@ class AnalysisPredictor : public PaddlePredictor {
   ///
   void SaveOptimModel(const std::string &dir);
 
+  ///
+  /// \brief Save the parameters of the program into a memory mapped
+  /// parameters file. Used as the params file of a config, the parameters
+  /// are loaded without copies on CPU and their pages are shared by all the
+  /// processes loading the file.
+  ///
+  /// \param[in] path path of the parameters file
+  ///
+  void SaveMappedParams(const std::string &path);
+
+  ///
+  /// \brief Get the counters of the shape plan cache of the executor, see
+  /// AnalysisConfig::EnableShapePlanCache.
+  ///
+  /// \return the counters, all zero when the cache is not enabled
+  ///
+  framework::ShapePlanCacheStats GetShapePlanCacheStats() const;
+
+  ///
+  /// \brief Whether the program and the parameters of the predictor were
+  /// loaded from the optimized model cache, see
+  /// AnalysisConfig::EnableOptimModelCache.
+  ///
+  /// \return Whether the optimized model was loaded from the cache
+  ///
+  bool optim_model_cache_hit() const { return optim_model_cache_hit_; }
+
  protected:
   ///
   /// \brief Prepare predictor's required programs, including loading model
@@ -309,6 +337,21 @@ class AnalysisPredictor : public PaddlePredictor {
   ///
   bool LoadParameters();
 
+  ///
+  /// \brief Get the entry of the optimized model cache for the loaded
+  /// program and the config.
+  ///
+  /// \return The entry, or null when the optimized model can not be cached
+  ///
+  std::unique_ptr<inference::OptimModelCache> GetOptimModelCache();
+  ///
+  /// \brief Load the optimized program and its parameters from an entry of
+  /// the optimized model cache.
+  ///
+  /// \param[in] cache The entry to load
+  ///
+  void LoadOptimModel(const inference::OptimModelCache &cache);
+
   ///
   /// \brief Prepare input data, only used in Run()
   ///
@@ -482,6 +525,7 @@ class AnalysisPredictor : public PaddlePredictor {
  private:
   // Some status here that help to determine the status inside the predictor.
   bool status_is_cloned_{false};
+  bool optim_model_cache_hit_{false};
 
   std::map<std::string, std::vector<std::vector<int32_t>>> shape_info_;
   static int clone_num_;
@@ -18,6 +18,7 @@
 #endif
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <random>
 #include <thread>  // NOLINT
 #include "paddle/fluid/framework/ir/pass.h"
 #include "paddle/fluid/framework/tensor.h"
@@ -322,6 +323,146 @@ TEST(AnalysisPredictor, memory_optim) {
 }
 */
 
+TEST(AnalysisPredictor, static_memory_plan) {
+  AnalysisConfig config(FLAGS_dirname);
+  config.DisableGpu();
+  config.EnableMemoryOptim();
+
+  int64_t data[4] = {1, 2, 3, 4};
+  PaddleTensor tensor;
+  tensor.shape = std::vector<int>({4, 1});
+  tensor.data.Reset(data, sizeof(data));
+  tensor.dtype = PaddleDType::INT64;
+  std::vector<PaddleTensor> inputs(4, tensor);
+  std::vector<PaddleTensor> output, planned_output;
+
+  {
+    auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+    ASSERT_TRUE(predictor->Run(inputs, &output));
+  }
+
+  config.EnableStaticMemoryPlan();
+  ASSERT_TRUE(config.static_memory_plan_enabled());
+  auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+  // The first run records the plan, the others run inside the arena.
+  for (int i = 0; i < 3; i++) {
+    planned_output.clear();
+    ASSERT_TRUE(predictor->Run(inputs, &planned_output));
+    inference::CompareResult(output, planned_output);
+  }
+}
+
+TEST(AnalysisPredictor, parallel_execution) {
+  AnalysisConfig config(FLAGS_dirname);
+  config.DisableGpu();
+
+  int64_t data[4] = {1, 2, 3, 4};
+  PaddleTensor tensor;
+  tensor.shape = std::vector<int>({4, 1});
+  tensor.data.Reset(data, sizeof(data));
+  tensor.dtype = PaddleDType::INT64;
+  std::vector<PaddleTensor> inputs(4, tensor);
+  std::vector<PaddleTensor> output, parallel_output;
+
+  {
+    auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+    ASSERT_TRUE(predictor->Run(inputs, &output));
+  }
+
+  config.EnableParallelExecution();
+  config.SetParallelExecutionThreads(3);
+  ASSERT_TRUE(config.parallel_execution_enabled());
+  ASSERT_EQ(config.parallel_execution_threads(), 3);
+  auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+  // The first run measures the ops, the others hand them to the threads.
+  for (int i = 0; i < 3; i++) {
+    parallel_output.clear();
+    ASSERT_TRUE(predictor->Run(inputs, &parallel_output));
+    inference::CompareResult(output, parallel_output);
+  }
+}
+
+TEST(AnalysisPredictor, shape_plan_cache) {
+  AnalysisConfig config(FLAGS_dirname);
+  config.DisableGpu();
+  config.EnableShapePlanCache(2);
+  ASSERT_TRUE(config.shape_plan_cache_enabled());
+  auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+  auto* analysis_predictor = static_cast<AnalysisPredictor*>(predictor.get());
+
+  int64_t data[4] = {1, 2, 3, 4};
+  auto make_inputs = [&](int rows) {
+    PaddleTensor tensor;
+    tensor.shape = std::vector<int>({rows, 1});
+    tensor.data.Reset(data, rows * sizeof(int64_t));
+    tensor.dtype = PaddleDType::INT64;
+    return std::vector<PaddleTensor>(4, tensor);
+  };
+  // The first run of every shape records its plan, the others use it.
+  std::vector<PaddleTensor> output, cached_output;
+  for (int rows : {4, 2}) {
+    output.clear();
+    ASSERT_TRUE(predictor->Run(make_inputs(rows), &output));
+    for (int i = 0; i < 2; i++) {
+      cached_output.clear();
+      ASSERT_TRUE(predictor->Run(make_inputs(rows), &cached_output));
+      inference::CompareResult(output, cached_output);
+    }
+  }
+  auto stats = analysis_predictor->GetShapePlanCacheStats();
+  ASSERT_EQ(stats.misses, 2UL);
+  ASSERT_EQ(stats.hits, 4UL);
+  ASSERT_GT(stats.skipped_infer_shapes, 0UL);
+}
+
+TEST(AnalysisPredictor, optim_model_cache) {
+  AnalysisConfig config(FLAGS_dirname);
+  config.DisableGpu();
+  config.SetOptimCacheDir("optim_model_cache_" +
+                          std::to_string(std::random_device()()));
+  config.EnableOptimModelCache();
+  ASSERT_TRUE(config.optim_model_cache_enabled());
+
+  int64_t data[4] = {1, 2, 3, 4};
+  PaddleTensor tensor;
+  tensor.shape = std::vector<int>({4, 1});
+  tensor.data.Reset(data, sizeof(data));
+  tensor.dtype = PaddleDType::INT64;
+  std::vector<PaddleTensor> inputs(4, tensor);
+  std::vector<PaddleTensor> output, cached_output;
+
+  {
+    auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+    auto* analysis_predictor = static_cast<AnalysisPredictor*>(predictor.get());
+    ASSERT_FALSE(analysis_predictor->optim_model_cache_hit());
+    ASSERT_TRUE(predictor->Run(inputs, &output));
+  }
+
+  // The second predictor loads the model the first one optimized.
+  {
+    auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+    auto* analysis_predictor = static_cast<AnalysisPredictor*>(predictor.get());
+    ASSERT_TRUE(analysis_predictor->optim_model_cache_hit());
+    ASSERT_TRUE(predictor->Run(inputs, &cached_output));
+    inference::CompareResult(output, cached_output);
+  }
+
+  // The flags the passes read are part of the key.
+  FLAGS_convert_all_blocks = false;
+  {
+    auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+    auto* analysis_predictor = static_cast<AnalysisPredictor*>(predictor.get());
+    ASSERT_FALSE(analysis_predictor->optim_model_cache_hit());
+  }
+  FLAGS_convert_all_blocks = true;
+
+  // Other passes make another key.
+  config.pass_builder()->DeletePass("fc_fuse_pass");
+  auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+  auto* analysis_predictor = static_cast<AnalysisPredictor*>(predictor.get());
+  ASSERT_FALSE(analysis_predictor->optim_model_cache_hit());
+}
+
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
 TEST(AnalysisPredictor, bf16_gpu_pass_strategy) {
   AnalysisConfig config;
@@ -0,0 +1,459 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/inference/api/paddle_batching_predictor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "glog/logging.h"
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/fluid/platform/float16.h"
+
+namespace paddle_infer {
+namespace services {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int64_t MicrosecondsBetween(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+      .count();
+}
+
+template <typename Visitor>
+void VisitDataType(DataType dtype, Visitor visitor) {
+  switch (dtype) {
+    case DataType::FLOAT32:
+      visitor(float());
+      break;
+    case DataType::INT64:
+      visitor(int64_t());
+      break;
+    case DataType::INT32:
+      visitor(int32_t());
+      break;
+    case DataType::UINT8:
+      visitor(uint8_t());
+      break;
+    case DataType::INT8:
+      visitor(int8_t());
+      break;
+    case DataType::FLOAT16:
+      visitor(paddle::platform::float16());
+      break;
+    default:
+      PADDLE_THROW(paddle::platform::errors::Unimplemented(
+          "Unsupported data type %d in BatchingPredictor.",
+          static_cast<int>(dtype)));
+  }
+}
+
+size_t SizeOfDataType(DataType dtype) {
+  size_t size = 0;
+  VisitDataType(dtype, [&](auto value) { size = sizeof(value); });
+  return size;
+}
+
+size_t NumElements(const std::vector<int>& shape) {
+  size_t numel = 1;
+  for (int dim : shape) numel *= static_cast<size_t>(dim);
+  return numel;
+}
+
+// Copies a row-major tensor of src_dims into the leading corner of a
+// row-major tensor of dst_dims, where every src dim is at most the dst one.
+void CopyPadded(const char* src, const std::vector<int>& src_dims,
+                char* dst, const std::vector<int>& dst_dims, size_t elem_size,
+                size_t dim = 0) {
+  size_t src_stride = elem_size, dst_stride = elem_size;
+  for (size_t i = dim + 1; i < src_dims.size(); ++i) {
+    src_stride *= src_dims[i];
+    dst_stride *= dst_dims[i];
+  }
+  if (src_stride == dst_stride) {
+    std::memcpy(dst, src, src_dims[dim] * src_stride);
+    return;
+  }
+  for (int i = 0; i < src_dims[dim]; ++i) {
+    CopyPadded(src + i * src_stride, src_dims, dst + i * dst_stride, dst_dims,
+               elem_size, dim + 1);
+  }
+}
+
+}  // namespace
+
+struct BatchingPredictor::Impl {
+  struct Request {
+    // In the order of the input names of the predictor.
+    std::vector<paddle::PaddleTensor> inputs;
+    int rows;
+    Clock::time_point enqueue_time;
+    std::promise<BatchingResult> promise;
+  };
+
+  Impl(const Config& config, const BatchingConfig& batching_config);
+  ~Impl();
+
+  void Validate(Request* request) const;
+  bool CanJoin(const std::vector<std::unique_ptr<Request>>& batch, int rows,
+               const Request& request) const;
+  void WorkerLoop(Predictor* predictor);
+  void RunBatch(Predictor* predictor,
+                std::vector<std::unique_ptr<Request>>* batch);
+
+  BatchingConfig options;
+  std::shared_ptr<Predictor> main_predictor;
+  std::vector<std::unique_ptr<Predictor>> clones;
+  std::vector<std::string> input_names;
+  std::vector<std::string> output_names;
+
+  std::mutex mu;
+  std::condition_variable cv;
+  std::deque<std::unique_ptr<Request>> queue;
+  bool stop{false};
+  // Held by the worker collecting the next batch, so that the requests
+  // queued meanwhile join it instead of waking another worker.
+  std::mutex collect_mu;
+  std::vector<std::thread> workers;
+
+  mutable std::mutex stats_mu;
+  BatchingStats stats;
+};
+
+BatchingPredictor::Impl::Impl(const Config& config,
+                              const BatchingConfig& batching_config)
+    : options(batching_config) {
+  PADDLE_ENFORCE_GE(options.max_batch_size, 1,
+                    paddle::platform::errors::InvalidArgument(
+                        "The max batch size should be at least 1, but it's "
+                        "(%d).",
+                        options.max_batch_size));
+  PADDLE_ENFORCE_GE(options.num_predictors, 1,
+                    paddle::platform::errors::InvalidArgument(
+                        "The number of predictors should be at least 1, but "
+                        "it's (%d).",
+                        options.num_predictors));
+  main_predictor = CreatePredictor(config);
+  input_names = main_predictor->GetInputNames();
+  output_names = main_predictor->GetOutputNames();
+  std::vector<Predictor*> predictors = {main_predictor.get()};
+  for (int i = 1; i < options.num_predictors; ++i) {
+    if (config.tensorrt_engine_enabled()) {
+      clones.emplace_back(new Predictor(config));
+    } else {
+      clones.emplace_back(main_predictor->Clone());
+    }
+    predictors.push_back(clones.back().get());
+  }
+  for (auto* predictor : predictors) {
+    workers.emplace_back([this, predictor] { WorkerLoop(predictor); });
+  }
+}
+
+BatchingPredictor::Impl::~Impl() {
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    stop = true;
+  }
+  cv.notify_all();
+  // The workers run the queued requests before they exit.
+  for (auto& worker : workers) worker.join();
+}
+
+void BatchingPredictor::Impl::Validate(Request* request) const {
+  auto& inputs = request->inputs;
+  PADDLE_ENFORCE_EQ(inputs.size(), input_names.size(),
+                    paddle::platform::errors::InvalidArgument(
+                        "The model has %d inputs, but the request has %d.",
+                        input_names.size(), inputs.size()));
+  std::vector<paddle::PaddleTensor> ordered(inputs.size());
+  for (auto& input : inputs) {
+    auto it = std::find(input_names.begin(), input_names.end(), input.name);
+    PADDLE_ENFORCE_EQ(it != input_names.end(), true,
+                      paddle::platform::errors::InvalidArgument(
+                          "%s is not an input of the model.", input.name));
+    auto& slot = ordered[it - input_names.begin()];
+    PADDLE_ENFORCE_EQ(slot.name.empty(), true,
+                      paddle::platform::errors::InvalidArgument(
+                          "Input %s is given twice.", input.name));
+    PADDLE_ENFORCE_EQ(input.lod.empty(), true,
+                      paddle::platform::errors::Unimplemented(
+                          "Input %s has LoD, which is not supported by "
+                          "BatchingPredictor.",
+                          input.name));
+    PADDLE_ENFORCE_GE(input.shape.size(), 1UL,
+                      paddle::platform::errors::InvalidArgument(
+                          "Input %s should have a batch dim.", input.name));
+    size_t bytes = NumElements(input.shape) * SizeOfDataType(input.dtype);
+    PADDLE_ENFORCE_EQ(input.data.length(), bytes,
+                      paddle::platform::errors::InvalidArgument(
+                          "Input %s has %d bytes of data, but its shape "
+                          "needs %d.",
+                          input.name, input.data.length(), bytes));
+    slot = std::move(input);
+  }
+  request->rows = ordered[0].shape[0];
+  for (auto& input : ordered) {
+    PADDLE_ENFORCE_EQ(input.shape[0], request->rows,
+                      paddle::platform::errors::InvalidArgument(
+                          "All the inputs of a request should have the same "
+                          "batch dim, but input %s has %d and input %s has %d.",
+                          input.name, input.shape[0], ordered[0].name,
+                          request->rows));
+  }
+  inputs = std::move(ordered);
+}
+
+bool BatchingPredictor::Impl::CanJoin(
+    const std::vector<std::unique_ptr<Request>>& batch, int rows,
+    const Request& request) const {
+  if (batch.empty()) return true;
+  if (rows + request.rows > options.max_batch_size) return false;
+  auto& first = batch.front()->inputs;
+  for (size_t i = 0; i < first.size(); ++i) {
+    auto& a = first[i];
+    auto& b = request.inputs[i];
+    if (a.dtype != b.dtype || a.shape.size() != b.shape.size()) return false;
+    if (!options.pad_ragged_inputs &&
+        !std::equal(a.shape.begin() + 1, a.shape.end(), b.shape.begin() + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void BatchingPredictor::Impl::WorkerLoop(Predictor* predictor) {
+  while (true) {
+    std::vector<std::unique_ptr<Request>> batch;
+    {
+      std::lock_guard<std::mutex> collect_lock(collect_mu);
+      std::unique_lock<std::mutex> lock(mu);
+      cv.wait(lock, [this] { return stop || !queue.empty(); });
+      if (queue.empty()) return;
+      auto deadline = queue.front()->enqueue_time +
+                      std::chrono::microseconds(options.batch_timeout_us);
+      int rows = 0;
+      while (true) {
+        while (!queue.empty() && CanJoin(batch, rows, *queue.front())) {
+          rows += queue.front()->rows;
+          batch.push_back(std::move(queue.front()));
+          queue.pop_front();
+        }
+        // Stop at a full batch, or at a request that does not fit, so that
+        // the requests run in their arrival order.
+        if (rows >= options.max_batch_size || !queue.empty() || stop) break;
+        if (cv.wait_until(lock, deadline) == std::cv_status::timeout &&
+            queue.empty()) {
+          break;
+        }
+      }
+    }
+    // Another worker may start collecting the rest of the queue.
+    cv.notify_one();
+    RunBatch(predictor, &batch);
+  }
+}
+
+void BatchingPredictor::Impl::RunBatch(
+    Predictor* predictor, std::vector<std::unique_ptr<Request>>* batch) {
+  auto& requests = *batch;
+  auto start = Clock::now();
+  std::vector<std::vector<paddle::PaddleTensor>> outputs(requests.size());
+  // PaddleTensor has no noexcept move, reserve to avoid deep copies.
+  for (auto& request_outputs : outputs) {
+    request_outputs.reserve(output_names.size());
+  }
+  int rows = 0;
+  for (auto& request : requests) rows += request->rows;
+  bool padded = false;
+  try {
+    for (size_t i = 0; i < input_names.size(); ++i) {
+      auto& first = requests.front()->inputs[i];
+      std::vector<int> shape = first.shape;
+      shape[0] = rows;
+      bool ragged = false;
+      for (auto& request : requests) {
+        auto& input_shape = request->inputs[i].shape;
+        for (size_t d = 1; d < shape.size(); ++d) {
+          ragged = ragged || input_shape[d] != shape[d];
+          shape[d] = std::max(shape[d], input_shape[d]);
+        }
+      }
+      padded = padded || ragged;
+      size_t elem_size = SizeOfDataType(first.dtype);
+      std::vector<char> buffer(NumElements(shape) * elem_size);
+      // From the trailing dims, as every request of the batch may be empty.
+      size_t row_bytes =
+          NumElements(std::vector<int>(shape.begin() + 1, shape.end())) *
+          elem_size;
+      auto input = predictor->GetInputHandle(input_names[i]);
+      input->Reshape(shape);
+      VisitDataType(first.dtype, [&](auto value) {
+        using T = decltype(value);
+        if (ragged) {
+          std::fill_n(reinterpret_cast<T*>(buffer.data()),
+                      NumElements(shape), static_cast<T>(options.pad_value));
+        }
+        size_t offset = 0;
+        for (auto& request : requests) {
+          auto& tensor = request->inputs[i];
+          std::vector<int> dst_shape = shape;
+          dst_shape[0] = tensor.shape[0];
+          CopyPadded(static_cast<const char*>(tensor.data.data()),
+                     tensor.shape, buffer.data() + offset, dst_shape,
+                     elem_size);
+          offset += tensor.shape[0] * row_bytes;
+        }
+        input->CopyFromCpu(reinterpret_cast<const T*>(buffer.data()));
+      });
+    }
+
+    PADDLE_ENFORCE_EQ(predictor->Run(), true,
+                      paddle::platform::errors::Fatal(
+                          "BatchingPredictor failed to run a batch."));
+
+    for (auto& name : output_names) {
+      auto output = predictor->GetOutputHandle(name);
+      std::vector<int> shape = output->shape();
+      DataType dtype = output->type();
+      size_t elem_size = SizeOfDataType(dtype);
+      std::vector<char> buffer(NumElements(shape) * elem_size);
+      VisitDataType(dtype, [&](auto value) {
+        using T = decltype(value);
+        output->CopyToCpu(reinterpret_cast<T*>(buffer.data()));
+      });
+      if (requests.size() > 1) {
+        PADDLE_ENFORCE_EQ(
+            !shape.empty() && shape[0] == rows, true,
+            paddle::platform::errors::InvalidArgument(
+                "Output %s of a batch of %d rows should have %d rows to be "
+                "split to the requests.",
+                name, rows, rows));
+      }
+      size_t row_bytes = shape.empty() || shape[0] == 0
+                             ? buffer.size()
+                             : buffer.size() / shape[0];
+      size_t offset = 0;
+      for (size_t r = 0; r < requests.size(); ++r) {
+        paddle::PaddleTensor tensor;
+        tensor.name = name;
+        tensor.shape = shape;
+        tensor.dtype = dtype;
+        size_t bytes = buffer.size();
+        if (requests.size() > 1) {
+          tensor.shape[0] = requests[r]->rows;
+          bytes = requests[r]->rows * row_bytes;
+        }
+        if (bytes > 0) {
+          tensor.data.Resize(bytes);
+          std::memcpy(tensor.data.data(), buffer.data() + offset, bytes);
+        }
+        offset += bytes;
+        outputs[r].push_back(std::move(tensor));
+      }
+    }
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(stats_mu);
+      stats.num_failed_requests += requests.size();
+    }
+    auto error = std::current_exception();
+    for (auto& request : requests) request->promise.set_exception(error);
+    return;
+  }
+
+  auto end = Clock::now();
+  int64_t run_us = MicrosecondsBetween(start, end);
+  std::vector<BatchingResult> results(requests.size());
+  int64_t total_queue_us = 0, max_queue_us = 0;
+  for (size_t r = 0; r < requests.size(); ++r) {
+    auto& result = results[r];
+    result.outputs = std::move(outputs[r]);
+    result.batch_size = rows;
+    result.queue_us = MicrosecondsBetween(requests[r]->enqueue_time, start);
+    result.run_us = run_us;
+    result.total_us = MicrosecondsBetween(requests[r]->enqueue_time, end);
+    total_queue_us += result.queue_us;
+    max_queue_us = std::max(max_queue_us, result.queue_us);
+  }
+  VLOG(4) << "BatchingPredictor ran " << requests.size() << " requests of "
+          << rows << " rows in " << run_us << " us.";
+  {
+    // Before the results, so that the callers see their requests counted.
+    std::lock_guard<std::mutex> lock(stats_mu);
+    stats.num_requests += requests.size();
+    stats.num_batches += 1;
+    stats.num_padded_batches += padded;
+    stats.num_rows += rows;
+    stats.total_queue_us += total_queue_us;
+    stats.max_queue_us = std::max(stats.max_queue_us, max_queue_us);
+    stats.total_run_us += run_us;
+  }
+  for (size_t r = 0; r < requests.size(); ++r) {
+    requests[r]->promise.set_value(std::move(results[r]));
+  }
+}
+
+BatchingPredictor::BatchingPredictor(const Config& config,
+                                     const BatchingConfig& batching_config)
+    : impl_(new Impl(config, batching_config)) {}
+
+BatchingPredictor::~BatchingPredictor() = default;
+
+std::future<BatchingResult> BatchingPredictor::Submit(
+    std::vector<paddle::PaddleTensor> inputs) {
+  std::unique_ptr<Impl::Request> request(new Impl::Request);
+  request->inputs = std::move(inputs);
+  impl_->Validate(request.get());
+  request->enqueue_time = Clock::now();
+  auto future = request->promise.get_future();
+  {
+    std::lock_guard<std::mutex> lock(impl_->mu);
+    int max_queue_size = impl_->options.max_queue_size;
+    PADDLE_ENFORCE_EQ(
+        max_queue_size <= 0 ||
+            impl_->queue.size() < static_cast<size_t>(max_queue_size),
+        true,
+        paddle::platform::errors::ResourceExhausted(
+            "The BatchingPredictor queue is full with %d requests.",
+            max_queue_size));
+    impl_->queue.push_back(std::move(request));
+  }
+  impl_->cv.notify_one();
+  return future;
+}
+
+std::vector<std::string> BatchingPredictor::GetInputNames() const {
+  return impl_->input_names;
+}
+
+std::vector<std::string> BatchingPredictor::GetOutputNames() const {
+  return impl_->output_names;
+}
+
+BatchingStats BatchingPredictor::GetStats() const {
+  std::lock_guard<std::mutex> lock(impl_->stats_mu);
+  return impl_->stats;
+}
+
+}  // namespace services
+}  // namespace paddle_infer
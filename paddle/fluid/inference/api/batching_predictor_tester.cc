@@ -0,0 +1,228 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <thread>  // NOLINT
+
+#include "paddle/fluid/framework/program_desc.h"
+#include "paddle/fluid/inference/api/paddle_batching_predictor.h"
+#include "paddle/fluid/inference/api/paddle_inference_api.h"
+
+DEFINE_string(dirname, "", "dirname to tests.");
+
+namespace paddle_infer {
+namespace services {
+
+namespace {
+
+const std::vector<std::string> kInputNames = {"firstw", "secondw", "thirdw",
+                                              "forthw"};
+
+std::vector<paddle::PaddleTensor> MakeWord2VecInputs(int rows, int seed) {
+  std::vector<paddle::PaddleTensor> inputs;
+  for (size_t i = 0; i < kInputNames.size(); ++i) {
+    paddle::PaddleTensor tensor;
+    tensor.name = kInputNames[i];
+    tensor.shape = {rows, 1};
+    tensor.dtype = paddle::PaddleDType::INT64;
+    tensor.data.Resize(rows * sizeof(int64_t));
+    auto* data = static_cast<int64_t*>(tensor.data.data());
+    for (int r = 0; r < rows; ++r) data[r] = (seed * 7 + r * 3 + i) % 1000;
+    inputs.push_back(std::move(tensor));
+  }
+  return inputs;
+}
+
+std::vector<float> RunAlone(Predictor* predictor,
+                            const std::vector<paddle::PaddleTensor>& inputs) {
+  for (auto& input : inputs) {
+    auto handle = predictor->GetInputHandle(input.name);
+    handle->Reshape(input.shape);
+    handle->CopyFromCpu(static_cast<const int64_t*>(input.data.data()));
+  }
+  predictor->Run();
+  auto output = predictor->GetOutputHandle(predictor->GetOutputNames()[0]);
+  int numel = 1;
+  for (int dim : output->shape()) numel *= dim;
+  std::vector<float> result(numel);
+  output->CopyToCpu(result.data());
+  return result;
+}
+
+// A model computing out = 2 * x + 1 for a float x of any dims.
+std::string MakeScaleModel() {
+  namespace framework = paddle::framework;
+  framework::ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  auto* feed = block->Var("feed");
+  feed->SetType(framework::proto::VarType::FEED_MINIBATCH);
+  feed->SetPersistable(true);
+  auto* fetch = block->Var("fetch");
+  fetch->SetType(framework::proto::VarType::FETCH_LIST);
+  fetch->SetPersistable(true);
+  for (auto* name : {"x", "out"}) {
+    auto* var = block->Var(name);
+    var->SetType(framework::proto::VarType::LOD_TENSOR);
+    var->SetDataType(framework::proto::VarType::FP32);
+    var->SetShape({-1, -1});
+  }
+  auto* feed_op = block->AppendOp();
+  feed_op->SetType("feed");
+  feed_op->SetInput("X", {"feed"});
+  feed_op->SetOutput("Out", {"x"});
+  feed_op->SetAttr("col", 0);
+  auto* scale_op = block->AppendOp();
+  scale_op->SetType("scale");
+  scale_op->SetInput("X", {"x"});
+  scale_op->SetOutput("Out", {"out"});
+  scale_op->SetAttr("scale", 2.f);
+  scale_op->SetAttr("bias", 1.f);
+  scale_op->SetAttr("bias_after_scale", true);
+  auto* fetch_op = block->AppendOp();
+  fetch_op->SetType("fetch");
+  fetch_op->SetInput("X", {"out"});
+  fetch_op->SetOutput("Out", {"fetch"});
+  fetch_op->SetAttr("col", 0);
+  program.Flush();
+  return program.Proto()->SerializeAsString();
+}
+
+paddle::PaddleTensor MakeFloatInput(int rows, int cols, int seed) {
+  paddle::PaddleTensor tensor;
+  tensor.name = "x";
+  tensor.shape = {rows, cols};
+  tensor.dtype = paddle::PaddleDType::FLOAT32;
+  tensor.data.Resize(rows * cols * sizeof(float));
+  auto* data = static_cast<float*>(tensor.data.data());
+  for (int k = 0; k < rows * cols; ++k) data[k] = seed * 10 + k;
+  return tensor;
+}
+
+}  // namespace
+
+TEST(BatchingPredictor, concurrent_requests) {
+  Config config;
+  config.SetModel(FLAGS_dirname);
+  config.DisableGpu();
+  auto reference = CreatePredictor(config);
+
+  BatchingConfig batching_config;
+  batching_config.max_batch_size = 16;
+  batching_config.batch_timeout_us = 2000;
+  batching_config.num_predictors = 2;
+  BatchingPredictor predictor(config, batching_config);
+  ASSERT_EQ(predictor.GetInputNames().size(), kInputNames.size());
+
+  const int num_threads = 8;
+  const int num_requests = 20;
+  std::vector<std::vector<std::vector<float>>> results(num_threads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < num_requests; ++i) {
+        auto result =
+            predictor.Submit(MakeWord2VecInputs(1 + i % 3, t * 100 + i)).get();
+        ASSERT_EQ(result.outputs.size(), 1UL);
+        ASSERT_EQ(result.outputs[0].shape[0], 1 + i % 3);
+        ASSERT_LE(result.batch_size, batching_config.max_batch_size);
+        ASSERT_GE(result.total_us, result.queue_us);
+        auto& data = result.outputs[0].data;
+        auto* begin = static_cast<float*>(data.data());
+        results[t].emplace_back(begin, begin + data.length() / sizeof(float));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (int t = 0; t < num_threads; ++t) {
+    for (int i = 0; i < num_requests; ++i) {
+      auto expect = RunAlone(reference.get(),
+                             MakeWord2VecInputs(1 + i % 3, t * 100 + i));
+      ASSERT_EQ(expect.size(), results[t][i].size());
+      for (size_t k = 0; k < expect.size(); ++k) {
+        ASSERT_NEAR(expect[k], results[t][i][k], 1e-5);
+      }
+    }
+  }
+  auto stats = predictor.GetStats();
+  EXPECT_EQ(stats.num_requests,
+            static_cast<uint64_t>(num_threads * num_requests));
+  EXPECT_EQ(stats.num_failed_requests, 0UL);
+  EXPECT_LE(stats.num_batches, stats.num_requests);
+  LOG(INFO) << "Ran " << stats.num_requests << " requests in "
+            << stats.num_batches << " batches.";
+}
+
+TEST(BatchingPredictor, invalid_inputs) {
+  Config config;
+  config.SetModel(FLAGS_dirname);
+  config.DisableGpu();
+  BatchingConfig batching_config;
+  BatchingPredictor predictor(config, batching_config);
+
+  auto missing = MakeWord2VecInputs(2, 0);
+  missing.pop_back();
+  EXPECT_ANY_THROW(predictor.Submit(std::move(missing)));
+
+  auto mismatched = MakeWord2VecInputs(2, 0);
+  mismatched[1] = std::move(MakeWord2VecInputs(3, 0)[1]);
+  EXPECT_ANY_THROW(predictor.Submit(std::move(mismatched)));
+}
+
+TEST(BatchingPredictor, ragged_inputs) {
+  std::string model = MakeScaleModel();
+  Config config;
+  config.SetModelBuffer(model.data(), model.size(), "", 0);
+  config.DisableGpu();
+  BatchingConfig batching_config;
+  // The three requests fill a batch, which then runs without the timeout.
+  batching_config.max_batch_size = 4;
+  batching_config.batch_timeout_us = 1000000;
+  batching_config.pad_ragged_inputs = true;
+  batching_config.pad_value = -1.f;
+  BatchingPredictor predictor(config, batching_config);
+
+  const std::vector<std::pair<int, int>> dims = {{1, 2}, {2, 3}, {1, 4}};
+  std::vector<std::future<BatchingResult>> futures;
+  for (size_t r = 0; r < dims.size(); ++r) {
+    std::vector<paddle::PaddleTensor> inputs;
+    inputs.push_back(
+        MakeFloatInput(dims[r].first, dims[r].second, static_cast<int>(r)));
+    futures.push_back(predictor.Submit(std::move(inputs)));
+  }
+  for (size_t r = 0; r < dims.size(); ++r) {
+    auto result = futures[r].get();
+    ASSERT_EQ(result.batch_size, 4);
+    ASSERT_EQ(result.outputs.size(), 1UL);
+    auto& output = result.outputs[0];
+    // Padded up to the widest request of the batch.
+    ASSERT_EQ(output.shape, std::vector<int>({dims[r].first, 4}));
+    auto* data = static_cast<float*>(output.data.data());
+    int cols = dims[r].second;
+    for (int i = 0; i < dims[r].first; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        float x = j < cols ? r * 10 + i * cols + j : batching_config.pad_value;
+        EXPECT_FLOAT_EQ(data[i * 4 + j], 2 * x + 1);
+      }
+    }
+  }
+  auto stats = predictor.GetStats();
+  EXPECT_EQ(stats.num_batches, 1UL);
+  EXPECT_EQ(stats.num_padded_batches, 1UL);
+}
+
+}  // namespace services
+}  // namespace paddle_infer
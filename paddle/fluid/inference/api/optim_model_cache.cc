@@ -0,0 +1,116 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/inference/api/optim_model_cache.h"
+
+#include <xxhash.h>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+#include "paddle/fluid/framework/mapped_params_file.h"
+#include "paddle/fluid/inference/analysis/helper.h"
+
+namespace paddle {
+namespace inference {
+
+namespace {
+
+std::string ToHex(uint64_t hash) {
+  std::stringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return ss.str();
+}
+
+bool ReadFile(const std::string& path, std::string* content) {
+  std::ifstream fin(path, std::ios::in | std::ios::binary);
+  if (!fin.is_open()) return false;
+  std::stringstream buffer;
+  buffer << fin.rdbuf();
+  *content = buffer.str();
+  return true;
+}
+
+bool WriteFile(const std::string& path, const std::string& content) {
+  std::ofstream fout(path, std::ios::out | std::ios::binary);
+  fout.write(content.data(), content.size());
+  fout.close();
+  return static_cast<bool>(fout);
+}
+
+}  // namespace
+
+std::string HashBuffer(const std::string& buffer) {
+  return ToHex(XXH64(buffer.data(), buffer.size(), 0));
+}
+
+std::string HashFile(const std::string& path) {
+  std::ifstream fin(path, std::ios::in | std::ios::binary);
+  if (!fin.is_open()) return "";
+  XXH64_state_t* state = XXH64_createState();
+  XXH64_reset(state, 0);
+  std::vector<char> chunk(1 << 20);
+  while (fin) {
+    fin.read(chunk.data(), chunk.size());
+    XXH64_update(state, chunk.data(), fin.gcount());
+  }
+  uint64_t hash = XXH64_digest(state);
+  XXH64_freeState(state);
+  return ToHex(hash);
+}
+
+OptimModelCache::OptimModelCache(const std::string& dir,
+                                 const std::string& key)
+    : key_(key), prefix_(dir + "/" + HashBuffer(key)) {}
+
+bool OptimModelCache::Has() const {
+  std::string key;
+  return ReadFile(key_path(), &key) && key == key_ &&
+         analysis::FileExists(program_path()) &&
+         analysis::FileExists(params_path());
+}
+
+bool OptimModelCache::Store(const std::string& program,
+                            const std::vector<std::string>& persistables,
+                            const framework::Scope& scope) const {
+  for (auto& name : persistables) {
+    auto* var = scope.FindVar(name);
+    if (!var || !var->IsType<framework::LoDTensor>() ||
+        !var->Get<framework::LoDTensor>().IsInitialized()) {
+      LOG(WARNING) << "The optimized model is not cached, its persistable "
+                   << name << " is not an initialized LoDTensor.";
+      return false;
+    }
+  }
+
+  const std::string suffix = ".tmp" + std::to_string(std::random_device()());
+  const std::vector<std::string> paths = {params_path(), program_path(),
+                                          key_path()};
+  framework::SaveMappedParams(paths[0] + suffix, persistables, scope);
+  bool ok = WriteFile(paths[1] + suffix, program) &&
+            WriteFile(paths[2] + suffix, key_);
+  for (auto& path : paths) {
+    ok = ok && std::rename((path + suffix).c_str(), path.c_str()) == 0;
+  }
+  if (!ok) {
+    for (auto& path : paths) std::remove((path + suffix).c_str());
+    LOG(WARNING) << "Failed to write the optimized model to " << prefix_;
+  }
+  return ok;
+}
+
+}  // namespace inference
+}  // namespace paddle
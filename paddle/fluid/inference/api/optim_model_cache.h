@@ -0,0 +1,69 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/framework/scope.h"
+
+namespace paddle {
+namespace inference {
+
+/*
+ * A directory of optimized models: the program the analysis produced and the
+ * parameters it left in the scope, so that the predictors created later for
+ * the same model and config load them instead of running the passes again.
+ *
+ * The entry of a key is three files named by the hash of the key:
+ *   <hash>.pdmodel    the optimized program
+ *   <hash>.pdiparams  its persistables, in the memory mapped params format
+ *   <hash>.key        the text of the key
+ * Each file is written to a temporary name and renamed, the key last, so an
+ * entry is complete once its key file exists, even with several processes
+ * filling the cache at the same time. The key text is compared on lookup,
+ * so a hash collision is a miss.
+ */
+class OptimModelCache {
+ public:
+  OptimModelCache(const std::string& dir, const std::string& key);
+
+  // Whether the directory holds a complete entry for the key.
+  bool Has() const;
+
+  std::string program_path() const { return prefix_ + ".pdmodel"; }
+  std::string params_path() const { return prefix_ + ".pdiparams"; }
+
+  // Writes the entry of the key: the serialized optimized program and its
+  // persistables read from scope. Returns false and leaves no entry when a
+  // persistable can not be saved.
+  bool Store(const std::string& program,
+             const std::vector<std::string>& persistables,
+             const framework::Scope& scope) const;
+
+ private:
+  std::string key_path() const { return prefix_ + ".key"; }
+
+  std::string key_;
+  std::string prefix_;
+};
+
+// The XXH64 hashes, in hex, of a buffer and of the content of a file, ""
+// when the file can not be read.
+std::string HashBuffer(const std::string& buffer);
+std::string HashFile(const std::string& path);
+
+}  // namespace inference
+}  // namespace paddle
@@ -207,6 +207,27 @@ struct PD_INFER_DECL AnalysisConfig {
     opt_cache_dir_ = opt_cache_dir;
   }
   ///
+  /// \brief Turn on the cache of the optimized model. The program the IR
+  /// passes produce and its parameters are saved in the optimization cache
+  /// directory, keyed by the model, the passes, the config, the flags not at
+  /// their defaults and the CPU, and the predictors created later with the
+  /// same key load them instead of running the passes again. Any flag set
+  /// makes a new key, even one the passes do not read, and state the passes
+  /// read from elsewhere, e.g. the environment, is not part of the key. The
+  /// cache directory is the one set by SetOptimCacheDir, or _opt_cache in the
+  /// model directory.
+  ///
+  /// \param x Whether the optimized model cache is turned on.
+  ///
+  void EnableOptimModelCache(bool x = true);
+  ///
+  /// \brief A boolean state telling whether the optimized model cache is
+  /// turned on.
+  ///
+  /// \return bool Whether the optimized model cache is turned on.
+  ///
+  bool optim_model_cache_enabled() const { return use_optim_model_cache_; }
+  ///
   /// \brief Get the model directory path.
   ///
   /// \return const std::string& The model directory path.
@@ -789,6 +810,123 @@ struct PD_INFER_DECL AnalysisConfig {
   ///
   bool enable_memory_optim() const;
 
+  ///
+  /// \brief Turn on the static memory plan of the executor.
+  /// The first run with new input shapes records the sizes and live ranges
+  /// of the intermediate tensors, and later runs with the same input shapes
+  /// place them in one preallocated arena, without allocator calls.
+  ///
+  /// \param x Whether to enable the static memory plan.
+  ///
+  void EnableStaticMemoryPlan(bool x = true);
+  ///
+  /// \brief A boolean state telling whether the static memory plan is
+  /// activated.
+  ///
+  /// \return bool Whether the static memory plan is activated.
+  ///
+  bool static_memory_plan_enabled() const {
+    return enable_static_memory_plan_;
+  }
+
+  ///
+  /// \brief Turn on the parallel execution of the executor on CPU. The
+  /// independent branches of the program run concurrently on a pool of
+  /// threads, in the order of their dependencies, so the outputs are the
+  /// same as those of a sequential run. Every op still runs with
+  /// cpu_math_library_num_threads() threads of the math library, on whichever
+  /// thread of the pool runs it, so up to parallel_execution_threads() times
+  /// as many threads may be busy. Not used together with the static memory
+  /// plan or MKLDNN.
+  ///
+  /// \param x Whether to enable the parallel execution.
+  ///
+  void EnableParallelExecution(bool x = true);
+  ///
+  /// \brief A boolean state telling whether the parallel execution is
+  /// activated.
+  ///
+  /// \return bool Whether the parallel execution is activated.
+  ///
+  bool parallel_execution_enabled() const {
+    return enable_parallel_execution_;
+  }
+  ///
+  /// \brief Set the number of threads of the parallel execution, the
+  /// calling thread included.
+  ///
+  /// \param num_threads The number of threads.
+  ///
+  void SetParallelExecutionThreads(int num_threads);
+  ///
+  /// \brief Get the number of threads of the parallel execution.
+  ///
+  /// \return int The number of threads.
+  ///
+  int parallel_execution_threads() const {
+    return parallel_execution_threads_;
+  }
+
+  ///
+  /// \brief Turn on the shape plan cache of the executor. The output shapes
+  /// every op gets for an input shape are kept, and the later runs with the
+  /// same input shapes set them instead of inferring them op by op. The
+  /// plans of the capacity most recently used input shapes are kept.
+  ///
+  /// \param capacity The number of input shapes to keep the plans of, 0
+  /// turns the cache off.
+  ///
+  void EnableShapePlanCache(int capacity = 32);
+  ///
+  /// \brief A boolean state telling whether the shape plan cache is
+  /// activated.
+  ///
+  /// \return bool Whether the shape plan cache is activated.
+  ///
+  bool shape_plan_cache_enabled() const {
+    return shape_plan_cache_capacity_ > 0;
+  }
+  ///
+  /// \brief Get the number of input shapes the shape plan cache keeps.
+  ///
+  /// \return int The capacity of the shape plan cache.
+  ///
+  int shape_plan_cache_capacity() const { return shape_plan_cache_capacity_; }
+
+  ///
+  /// \brief Turn on the weight-only quantization on CPU. The float weights
+  /// of the fc, mul and matmul_v2 ops are quantized to int8 or int4 when the
+  /// model is loaded, and dequantized on the fly while multiplying, which
+  /// speeds up the memory-bound layers with small batches.
+  ///
+  /// \param weight_bits 8 or 4.
+  /// \param group_size The input channels sharing a scale, 0 for a scale per
+  /// output channel.
+  ///
+  void EnableWeightOnlyQuant(int weight_bits = 8, int group_size = 0);
+  ///
+  /// \brief A boolean state telling whether the weight-only quantization is
+  /// activated.
+  ///
+  /// \return bool Whether the weight-only quantization is activated.
+  ///
+  bool weight_only_quant_enabled() const { return use_weight_only_quant_; }
+  ///
+  /// \brief Get the bits of the weight-only quantized weights.
+  ///
+  /// \return int The bits of the quantized weights.
+  ///
+  int weight_only_quant_bits() const { return weight_only_quant_bits_; }
+  ///
+  /// \brief Get the input channels sharing a scale of the weight-only
+  /// quantized weights.
+  ///
+  /// \return int The group size, 0 for a scale per output channel.
+  ///
+  int weight_only_quant_group_size() const {
+    return weight_only_quant_group_size_;
+  }
+
   ///
   /// \brief Turn on profiling report.
   /// If not turned on, no profiling report will be generated.
@@ -933,6 +1071,19 @@ struct PD_INFER_DECL AnalysisConfig {
 
   // memory reuse related.
   bool enable_memory_optim_{false};
+  bool enable_static_memory_plan_{false};
+
+  // parallel execution related.
+  bool enable_parallel_execution_{false};
+  int parallel_execution_threads_{4};
+
+  // shape plan cache related.
+  int shape_plan_cache_capacity_{0};
+
+  // weight-only quantization related.
+  bool use_weight_only_quant_{false};
+  int weight_only_quant_bits_{8};
+  int weight_only_quant_group_size_{0};
 
   bool use_mkldnn_{false};
   std::unordered_set<std::string> mkldnn_enabled_op_types_;
@@ -1000,6 +1151,7 @@ struct PD_INFER_DECL AnalysisConfig {
   // So we release the memory when the predictor is set up.
   mutable bool is_valid_{true};
   std::string opt_cache_dir_;
+  bool use_optim_model_cache_{false};
   friend class paddle_infer::experimental::InternalUtils;
 
   // fleet exe related
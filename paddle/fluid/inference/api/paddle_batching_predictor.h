@@ -0,0 +1,135 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "paddle_inference_api.h"  // NOLINT
+
+///
+/// \file paddle_batching_predictor.h
+///
+/// \brief Dynamic request batching on top of Predictor.
+///
+/// \since 2.4.0
+///
+
+namespace paddle_infer {
+namespace services {
+
+///
+/// \brief Options of BatchingPredictor.
+///
+struct PD_INFER_DECL BatchingConfig {
+  /// Max number of rows, summed over the first dim of the requests, that
+  /// run in one batch. A larger request runs alone.
+  int max_batch_size{32};
+  /// Max time in microseconds a batch waits for more requests once its
+  /// first request is queued.
+  int64_t batch_timeout_us{1000};
+  /// Number of predictors, each running one batch at a time.
+  int num_predictors{1};
+  /// When true, requests whose inputs differ in dims other than the first
+  /// run in the same batch, padded with pad_value up to the largest dims of
+  /// the batch. Their outputs are returned padded. When false, such
+  /// requests run in different batches.
+  bool pad_ragged_inputs{false};
+  float pad_value{0.f};
+  /// Max number of queued requests, Submit fails beyond it. 0 means
+  /// unbounded.
+  int max_queue_size{0};
+};
+
+///
+/// \brief Outputs and latency of one request.
+///
+struct PD_INFER_DECL BatchingResult {
+  /// The rows of the request in every output, in GetOutputNames() order.
+  std::vector<paddle::PaddleTensor> outputs;
+  /// Number of rows of the batch the request ran in.
+  int batch_size{0};
+  /// Microseconds the request waited in the queue.
+  int64_t queue_us{0};
+  /// Microseconds spent on its batch: concatenation, run and split.
+  int64_t run_us{0};
+  /// Microseconds from Submit to the result.
+  int64_t total_us{0};
+};
+
+///
+/// \brief Counters of a BatchingPredictor since its creation.
+///
+struct PD_INFER_DECL BatchingStats {
+  uint64_t num_requests{0};
+  uint64_t num_failed_requests{0};
+  uint64_t num_batches{0};
+  uint64_t num_padded_batches{0};
+  uint64_t num_rows{0};
+  int64_t total_queue_us{0};
+  int64_t max_queue_us{0};
+  int64_t total_run_us{0};
+};
+
+///
+/// \class BatchingPredictor
+///
+/// \brief BatchingPredictor serves concurrent callers with dynamic batching.
+/// The inputs of the requests queued within a timeout are concatenated
+/// along their first dim, run once, and the outputs are split back to the
+/// requests. Every output is expected to keep the first dim of the inputs.
+///
+/// Usage:
+///
+/// \code{.cpp}
+/// BatchingConfig batching_config;
+/// batching_config.max_batch_size = 16;
+/// BatchingPredictor predictor(config, batching_config);
+/// // On any thread:
+/// auto result = predictor.Submit(std::move(inputs)).get();
+/// \endcode
+///
+class PD_INFER_DECL BatchingPredictor {
+ public:
+  BatchingPredictor(const Config& config,
+                    const BatchingConfig& batching_config);
+  BatchingPredictor(const BatchingPredictor&) = delete;
+  BatchingPredictor& operator=(const BatchingPredictor&) = delete;
+  ~BatchingPredictor();
+
+  ///
+  /// \brief Queue a request. Thread safe.
+  ///
+  /// \param[in] inputs one CPU tensor per model input, all with the same
+  /// first dim. LoD is not supported.
+  /// \return the future result of the request. Invalid inputs throw here,
+  /// the errors of the batch the request ran in are rethrown by get().
+  ///
+  std::future<BatchingResult> Submit(std::vector<paddle::PaddleTensor> inputs);
+
+  std::vector<std::string> GetInputNames() const;
+  std::vector<std::string> GetOutputNames() const;
+  BatchingStats GetStats() const;
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace services
+}  // namespace paddle_infer
@@ -0,0 +1,399 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/inference/utils/load_test.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>  // NOLINT
+
+#include "paddle/fluid/inference/utils/io_utils.h"
+#include "paddle/fluid/memory/stats.h"
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/fluid/platform/profiler/cpu_utilization.h"
+#include "paddle/fluid/string/split.h"
+
+namespace paddle {
+namespace inference {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+size_t SizeOfDType(PaddleDType dtype) {
+  switch (dtype) {
+    case PaddleDType::FLOAT32:
+    case PaddleDType::INT32:
+      return 4;
+    case PaddleDType::INT64:
+      return 8;
+    case PaddleDType::UINT8:
+    case PaddleDType::INT8:
+      return 1;
+    default:
+      PADDLE_THROW(platform::errors::Unimplemented(
+          "The load test does not support the data type %d.",
+          static_cast<int>(dtype)));
+  }
+}
+
+PaddleDType ParseDType(const std::string& name) {
+  if (name == "float32") return PaddleDType::FLOAT32;
+  if (name == "int64") return PaddleDType::INT64;
+  if (name == "int32") return PaddleDType::INT32;
+  if (name == "uint8") return PaddleDType::UINT8;
+  if (name == "int8") return PaddleDType::INT8;
+  PADDLE_THROW(platform::errors::InvalidArgument(
+      "Unknown data type %s, expected float32, int64, int32, uint8 or int8.",
+      name));
+}
+
+template <typename T>
+void FillRandom(PaddleBuf* buf, std::mt19937* gen) {
+  T* data = static_cast<T*>(buf->data());
+  size_t numel = buf->length() / sizeof(T);
+  // Small values, so that integer inputs are valid ids for most models.
+  std::uniform_int_distribution<int> dist(0, 99);
+  for (size_t i = 0; i < numel; ++i) data[i] = static_cast<T>(dist(*gen));
+}
+
+void Feed(paddle_infer::Predictor* predictor, const LoadTestRequest& request) {
+  for (auto& input : request) {
+    auto handle = predictor->GetInputHandle(input.name);
+    handle->Reshape(input.shape);
+    if (!input.lod.empty()) handle->SetLoD(input.lod);
+    switch (input.dtype) {
+      case PaddleDType::FLOAT32:
+        handle->CopyFromCpu(static_cast<const float*>(input.data.data()));
+        break;
+      case PaddleDType::INT64:
+        handle->CopyFromCpu(static_cast<const int64_t*>(input.data.data()));
+        break;
+      case PaddleDType::INT32:
+        handle->CopyFromCpu(static_cast<const int32_t*>(input.data.data()));
+        break;
+      case PaddleDType::UINT8:
+        handle->CopyFromCpu(static_cast<const uint8_t*>(input.data.data()));
+        break;
+      case PaddleDType::INT8:
+        handle->CopyFromCpu(static_cast<const int8_t*>(input.data.data()));
+        break;
+      default:
+        PADDLE_THROW(platform::errors::Unimplemented(
+            "The load test does not support the data type of input %s.",
+            input.name));
+    }
+  }
+}
+
+// Copies the outputs back like a client would, which also waits for them.
+void Fetch(paddle_infer::Predictor* predictor, std::vector<char>* buffer) {
+  for (auto& name : predictor->GetOutputNames()) {
+    auto handle = predictor->GetOutputHandle(name);
+    size_t numel = 1;
+    for (int dim : handle->shape()) numel *= dim;
+    auto dtype = handle->type();
+    buffer->resize(std::max<size_t>(numel * SizeOfDType(dtype), 1));
+    switch (dtype) {
+      case PaddleDType::FLOAT32:
+        handle->CopyToCpu(reinterpret_cast<float*>(buffer->data()));
+        break;
+      case PaddleDType::INT64:
+        handle->CopyToCpu(reinterpret_cast<int64_t*>(buffer->data()));
+        break;
+      case PaddleDType::INT32:
+        handle->CopyToCpu(reinterpret_cast<int32_t*>(buffer->data()));
+        break;
+      case PaddleDType::UINT8:
+        handle->CopyToCpu(reinterpret_cast<uint8_t*>(buffer->data()));
+        break;
+      default:
+        handle->CopyToCpu(reinterpret_cast<int8_t*>(buffer->data()));
+    }
+  }
+}
+
+bool RunRequest(paddle_infer::Predictor* predictor,
+                const LoadTestRequest& request, std::vector<char>* buffer) {
+  try {
+    Feed(predictor, request);
+    if (!predictor->Run()) return false;
+    Fetch(predictor, buffer);
+    return true;
+  } catch (const std::exception& e) {
+    LOG(WARNING) << "Request failed: " << e.what();
+    return false;
+  }
+}
+
+int64_t PeakRssBytes() {
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return static_cast<int64_t>(usage.ru_maxrss) * 1024;
+#endif
+  }
+#endif
+  return 0;
+}
+
+}  // namespace
+
+LatencySummary SummarizeLatencies(std::vector<double> latencies_us) {
+  LatencySummary summary;
+  if (latencies_us.empty()) return summary;
+  std::sort(latencies_us.begin(), latencies_us.end());
+  size_t n = latencies_us.size();
+  auto percentile = [&](double p) {
+    size_t rank = static_cast<size_t>(std::ceil(p * n / 100 - 1e-9));
+    return latencies_us[std::min(std::max<size_t>(rank, 1), n) - 1];
+  };
+  double sum = 0;
+  for (double latency : latencies_us) sum += latency;
+  summary.count = n;
+  summary.mean_us = sum / n;
+  summary.p50_us = percentile(50);
+  summary.p90_us = percentile(90);
+  summary.p99_us = percentile(99);
+  summary.p999_us = percentile(99.9);
+  summary.max_us = latencies_us.back();
+  return summary;
+}
+
+std::string LoadTestReport::ToJson() const {
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(3);
+  ss << "{\n";
+  ss << "  \"num_threads\": " << options.num_threads << ",\n";
+  ss << "  \"num_requests\": " << latency.count << ",\n";
+  ss << "  \"num_failed\": " << num_failed << ",\n";
+  ss << "  \"target_qps\": " << options.target_qps << ",\n";
+  ss << "  \"closed_loop\": " << (options.target_qps > 0 ? "false" : "true")
+     << ",\n";
+  ss << "  \"use_predictor_pool\": "
+     << (options.use_predictor_pool ? "true" : "false") << ",\n";
+  ss << "  \"duration_s\": " << duration_s << ",\n";
+  ss << "  \"throughput_qps\": " << throughput_qps << ",\n";
+  ss << "  \"latency_us\": {\"mean\": " << latency.mean_us
+     << ", \"p50\": " << latency.p50_us << ", \"p90\": " << latency.p90_us
+     << ", \"p99\": " << latency.p99_us << ", \"p99.9\": " << latency.p999_us
+     << ", \"max\": " << latency.max_us << "},\n";
+  ss << "  \"cpu_utilization\": " << cpu_utilization << ",\n";
+  ss << "  \"process_cpu_utilization\": " << process_cpu_utilization
+     << ",\n";
+  ss << "  \"peak_host_allocated_bytes\": " << peak_host_allocated_bytes
+     << ",\n";
+  ss << "  \"peak_device_allocated_bytes\": " << peak_device_allocated_bytes
+     << ",\n";
+  ss << "  \"peak_rss_bytes\": " << peak_rss_bytes << "\n";
+  ss << "}\n";
+  return ss.str();
+}
+
+std::vector<LoadTestRequest> MakeSyntheticRequests(const std::string& spec,
+                                                   int num_requests,
+                                                   unsigned seed) {
+  std::vector<LoadTestRequest> requests(num_requests);
+  std::mt19937 gen(seed);
+  for (auto& item : string::Split(spec, ',')) {
+    auto fields = string::Split(item, ':');
+    PADDLE_ENFORCE_EQ(
+        fields.size() == 2 || fields.size() == 3, true,
+        platform::errors::InvalidArgument(
+            "Expected name:dims[:dtype] for an input, but got %s.", item));
+    PaddleTensor tensor;
+    tensor.name = fields[0];
+    tensor.dtype =
+        fields.size() == 3 ? ParseDType(fields[2]) : PaddleDType::FLOAT32;
+    size_t numel = 1;
+    for (auto& dim : string::Split(fields[1], 'x')) {
+      tensor.shape.push_back(std::stoi(dim));
+      PADDLE_ENFORCE_GT(tensor.shape.back(), 0,
+                        platform::errors::InvalidArgument(
+                            "The dims of input %s should be positive.",
+                            tensor.name));
+      numel *= tensor.shape.back();
+    }
+    for (auto& request : requests) {
+      request.push_back(tensor);
+      auto& buf = request.back().data;
+      buf.Resize(numel * SizeOfDType(tensor.dtype));
+      switch (tensor.dtype) {
+        case PaddleDType::FLOAT32:
+          FillRandom<float>(&buf, &gen);
+          break;
+        case PaddleDType::INT64:
+          FillRandom<int64_t>(&buf, &gen);
+          break;
+        case PaddleDType::INT32:
+          FillRandom<int32_t>(&buf, &gen);
+          break;
+        case PaddleDType::UINT8:
+          FillRandom<uint8_t>(&buf, &gen);
+          break;
+        default:
+          FillRandom<int8_t>(&buf, &gen);
+      }
+    }
+  }
+  return requests;
+}
+
+std::vector<LoadTestRequest> LoadRecordedRequests(
+    const std::vector<std::string>& paths) {
+  std::vector<LoadTestRequest> requests(paths.size());
+  for (size_t i = 0; i < paths.size(); ++i) {
+    DeserializePDTensorsToFile(paths[i], &requests[i]);
+  }
+  return requests;
+}
+
+LoadTestReport RunLoadTest(const paddle_infer::Config& config,
+                           const LoadTestOptions& options,
+                           const std::vector<LoadTestRequest>& requests) {
+  PADDLE_ENFORCE_GE(options.num_threads, 1,
+                    platform::errors::InvalidArgument(
+                        "The load test needs at least one thread."));
+  PADDLE_ENFORCE_EQ(requests.empty(), false,
+                    platform::errors::InvalidArgument(
+                        "The load test needs at least one request."));
+  int num_threads = options.num_threads;
+  std::vector<paddle_infer::Predictor*> predictors;
+  std::shared_ptr<paddle_infer::Predictor> main_predictor;
+  std::vector<std::unique_ptr<paddle_infer::Predictor>> clones;
+  std::unique_ptr<paddle_infer::services::PredictorPool> pool;
+  if (options.use_predictor_pool) {
+    pool.reset(new paddle_infer::services::PredictorPool(config, num_threads));
+    for (int t = 0; t < num_threads; ++t) {
+      predictors.push_back(pool->Retrive(t));
+    }
+  } else {
+    main_predictor = paddle_infer::CreatePredictor(config);
+    predictors.push_back(main_predictor.get());
+    for (int t = 1; t < num_threads; ++t) {
+      clones.emplace_back(main_predictor->Clone());
+      predictors.push_back(clones.back().get());
+    }
+  }
+
+  // The threads warm up, then wait for all of them to be ready.
+  std::mutex mu;
+  std::condition_variable cv;
+  int num_ready = 0;
+  bool started = false;
+  Clock::time_point start;
+  std::vector<std::vector<double>> latencies(num_threads);
+  std::vector<uint64_t> failed(num_threads, 0);
+
+  auto client = [&](int t) {
+    std::vector<char> buffer;
+    auto* predictor = predictors[t];
+    auto request_of = [&](int k) -> const LoadTestRequest& {
+      return requests[(static_cast<size_t>(k) * num_threads + t) %
+                      requests.size()];
+    };
+    for (int k = 0; k < options.warmup_requests; ++k) {
+      RunRequest(predictor, request_of(k), &buffer);
+    }
+    {
+      std::unique_lock<std::mutex> lock(mu);
+      ++num_ready;
+      cv.notify_all();
+      cv.wait(lock, [&] { return started; });
+    }
+
+    // In open loop the threads take the due times in turn.
+    std::chrono::duration<double> interval(0);
+    std::chrono::duration<double> offset(0);
+    if (options.target_qps > 0) {
+      interval = std::chrono::duration<double>(num_threads /
+                                               options.target_qps);
+      offset = std::chrono::duration<double>(t / options.target_qps);
+    }
+    latencies[t].reserve(options.num_requests);
+    for (int k = 0; k < options.num_requests; ++k) {
+      auto begin = Clock::now();
+      if (options.target_qps > 0) {
+        auto due = start + std::chrono::duration_cast<Clock::duration>(
+                               offset + k * interval);
+        std::this_thread::sleep_until(due);
+        begin = due;
+      }
+      if (!RunRequest(predictor, request_of(k), &buffer)) {
+        ++failed[t];
+        continue;
+      }
+      latencies[t].push_back(
+          std::chrono::duration<double, std::micro>(Clock::now() - begin)
+              .count());
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) threads.emplace_back(client, t);
+  platform::CpuUtilization cpu_utilization;
+  {
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&] { return num_ready == num_threads; });
+    cpu_utilization.RecordBeginTimeInfo();
+    start = Clock::now();
+    started = true;
+    cv.notify_all();
+  }
+  for (auto& thread : threads) thread.join();
+  auto end = Clock::now();
+  cpu_utilization.RecordEndTimeInfo();
+
+  LoadTestReport report;
+  report.options = options;
+  std::vector<double> all_latencies;
+  for (int t = 0; t < num_threads; ++t) {
+    all_latencies.insert(all_latencies.end(), latencies[t].begin(),
+                         latencies[t].end());
+    report.num_failed += failed[t];
+  }
+  report.latency = SummarizeLatencies(std::move(all_latencies));
+  report.duration_s = std::chrono::duration<double>(end - start).count();
+  if (report.duration_s > 0) {
+    report.throughput_qps = report.latency.count / report.duration_s;
+  }
+  report.cpu_utilization = cpu_utilization.GetCpuUtilization();
+  report.process_cpu_utilization =
+      cpu_utilization.GetCpuCurProcessUtilization();
+  report.peak_host_allocated_bytes =
+      memory::StatGetPeakValue("HostAllocated", 0);
+  if (config.use_gpu()) {
+    report.peak_device_allocated_bytes =
+        memory::StatGetPeakValue("Allocated", config.gpu_device_id());
+  }
+  report.peak_rss_bytes = PeakRssBytes();
+  return report;
+}
+
+}  // namespace inference
+}  // namespace paddle
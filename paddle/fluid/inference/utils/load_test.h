@@ -0,0 +1,95 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/inference/api/paddle_inference_api.h"
+
+namespace paddle {
+namespace inference {
+
+struct LoadTestOptions {
+  // Client threads, each with its own predictor.
+  int num_threads{1};
+  // Requests every thread runs before, and while, measuring.
+  int warmup_requests{10};
+  int num_requests{100};
+  // Total requests per second the threads send, each at its share of it.
+  // The latency of a request counts from the time it was due, so a
+  // predictor falling behind shows in the latency. 0 runs closed loop:
+  // every thread sends its next request once the last one is done.
+  double target_qps{0};
+  // Get the predictors from a services::PredictorPool instead of cloning
+  // one predictor.
+  bool use_predictor_pool{false};
+};
+
+struct LatencySummary {
+  uint64_t count{0};
+  double mean_us{0};
+  double p50_us{0};
+  double p90_us{0};
+  double p99_us{0};
+  double p999_us{0};
+  double max_us{0};
+};
+
+// Nearest-rank percentiles of the latencies.
+LatencySummary SummarizeLatencies(std::vector<double> latencies_us);
+
+struct LoadTestReport {
+  LoadTestOptions options;
+  LatencySummary latency;
+  uint64_t num_failed{0};
+  double duration_s{0};
+  double throughput_qps{0};
+  // Of all the cpus and of this process, in percent, while measuring.
+  float cpu_utilization{0};
+  float process_cpu_utilization{0};
+  // Peaks since the process started. The allocator stats only cover the
+  // allocators keeping them, the RSS is that of the whole process.
+  int64_t peak_host_allocated_bytes{0};
+  int64_t peak_device_allocated_bytes{0};
+  int64_t peak_rss_bytes{0};
+
+  std::string ToJson() const;
+};
+
+// The inputs of one run, fed by name.
+using LoadTestRequest = std::vector<PaddleTensor>;
+
+// Requests with random values. spec lists the inputs as
+// "name:dim0xdim1[:dtype]" separated by commas, e.g.
+// "ids:1x128:int64,mask:1x128", dtype being float32 by default, or int64,
+// int32, uint8 or int8.
+std::vector<LoadTestRequest> MakeSyntheticRequests(const std::string& spec,
+                                                   int num_requests,
+                                                   unsigned seed);
+
+// Requests recorded with SerializePDTensorsToFile, one per file.
+std::vector<LoadTestRequest> LoadRecordedRequests(
+    const std::vector<std::string>& paths);
+
+// Runs the requests, in turn, from options.num_threads threads and
+// measures them.
+LoadTestReport RunLoadTest(const paddle_infer::Config& config,
+                           const LoadTestOptions& options,
+                           const std::vector<LoadTestRequest>& requests);
+
+}  // namespace inference
+}  // namespace paddle
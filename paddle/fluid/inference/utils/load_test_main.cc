@@ -0,0 +1,100 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Load test of a model under concurrent clients, reporting the latency
+// percentiles, throughput, cpu utilization and peak memory as JSON.
+//
+// Usage:
+//   paddle_inference_load_test --model_dir=/path/to/model --threads=8 \
+//       --inputs_spec=ids:1x128:int64 --qps=200 --json_output=report.json
+// or, with inputs recorded by SerializePDTensorsToFile:
+//   paddle_inference_load_test --model_file=model.pdmodel \
+//       --params_file=model.pdiparams --inputs=req0.bin,req1.bin
+
+#include <fstream>
+#include <iostream>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "paddle/fluid/inference/utils/load_test.h"
+#include "paddle/fluid/string/split.h"
+
+DEFINE_string(model_dir, "", "Directory of the model.");
+DEFINE_string(model_file, "", "Program file of a combined model.");
+DEFINE_string(params_file, "", "Parameters file of a combined model.");
+DEFINE_int32(threads, 1, "Number of client threads.");
+DEFINE_int32(warmup, 10, "Warmup requests per thread.");
+DEFINE_int32(requests, 100, "Measured requests per thread.");
+DEFINE_double(qps, 0, "Target total qps, 0 for a closed loop.");
+DEFINE_bool(use_pool, false, "Get the predictors from a PredictorPool.");
+DEFINE_string(inputs, "", "Comma separated files of recorded requests.");
+DEFINE_string(inputs_spec, "",
+              "Synthetic inputs as name:dim0xdim1[:dtype],... when no "
+              "recorded requests are given.");
+DEFINE_int32(synthetic_requests, 16, "Number of distinct synthetic inputs.");
+DEFINE_bool(use_gpu, false, "Run on GPU.");
+DEFINE_int32(gpu_id, 0, "Id of the GPU.");
+DEFINE_int32(cpu_math_threads, 1, "Math library threads per predictor.");
+DEFINE_bool(use_mkldnn, false, "Enable MKLDNN.");
+DEFINE_bool(ir_optim, true, "Enable the IR optimization.");
+DEFINE_string(json_output, "", "File to write the report to.");
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  paddle_infer::Config config;
+  if (!FLAGS_model_dir.empty()) {
+    config.SetModel(FLAGS_model_dir);
+  } else {
+    config.SetModel(FLAGS_model_file, FLAGS_params_file);
+  }
+  if (FLAGS_use_gpu) {
+    config.EnableUseGpu(100, FLAGS_gpu_id);
+  } else {
+    config.DisableGpu();
+    config.SetCpuMathLibraryNumThreads(FLAGS_cpu_math_threads);
+    if (FLAGS_use_mkldnn) config.EnableMKLDNN();
+  }
+  config.SwitchIrOptim(FLAGS_ir_optim);
+  config.DisableGlogInfo();
+
+  std::vector<paddle::inference::LoadTestRequest> requests;
+  if (!FLAGS_inputs.empty()) {
+    requests = paddle::inference::LoadRecordedRequests(
+        paddle::string::Split(FLAGS_inputs, ','));
+  } else if (!FLAGS_inputs_spec.empty()) {
+    requests = paddle::inference::MakeSyntheticRequests(
+        FLAGS_inputs_spec, FLAGS_synthetic_requests, 0);
+  } else {
+    LOG(ERROR) << "Either --inputs or --inputs_spec is required.";
+    return 1;
+  }
+
+  paddle::inference::LoadTestOptions options;
+  options.num_threads = FLAGS_threads;
+  options.warmup_requests = FLAGS_warmup;
+  options.num_requests = FLAGS_requests;
+  options.target_qps = FLAGS_qps;
+  options.use_predictor_pool = FLAGS_use_pool;
+  auto report = paddle::inference::RunLoadTest(config, options, requests);
+
+  std::string json = report.ToJson();
+  std::cout << json;
+  if (!FLAGS_json_output.empty()) {
+    std::ofstream out(FLAGS_json_output);
+    out << json;
+  }
+  return report.num_failed == 0 ? 0 : 2;
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/inference/utils/load_test.h"
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+using namespace paddle::inference;  // NOLINT
+TEST(LoadTest, SummarizeLatencies) {
+  std::vector<double> latencies;
+  for (int i = 1000; i >= 1; --i) latencies.push_back(i);
+  auto summary = SummarizeLatencies(latencies);
+  EXPECT_EQ(summary.count, 1000UL);
+  EXPECT_DOUBLE_EQ(summary.mean_us, 500.5);
+  EXPECT_DOUBLE_EQ(summary.p50_us, 500);
+  EXPECT_DOUBLE_EQ(summary.p90_us, 900);
+  EXPECT_DOUBLE_EQ(summary.p99_us, 990);
+  EXPECT_DOUBLE_EQ(summary.p999_us, 999);
+  EXPECT_DOUBLE_EQ(summary.max_us, 1000);
+
+  summary = SummarizeLatencies({7});
+  EXPECT_DOUBLE_EQ(summary.p50_us, 7);
+  EXPECT_DOUBLE_EQ(summary.p999_us, 7);
+  EXPECT_EQ(SummarizeLatencies({}).count, 0UL);
+}
+
+TEST(LoadTest, MakeSyntheticRequests) {
+  auto requests = MakeSyntheticRequests("ids:2x8:int64,x:3", 4, 0);
+  ASSERT_EQ(requests.size(), 4UL);
+  for (auto& request : requests) {
+    ASSERT_EQ(request.size(), 2UL);
+    EXPECT_EQ(request[0].name, "ids");
+    EXPECT_EQ(request[0].shape, std::vector<int>({2, 8}));
+    EXPECT_EQ(request[0].dtype, paddle::PaddleDType::INT64);
+    EXPECT_EQ(request[0].data.length(), 16 * sizeof(int64_t));
+    EXPECT_EQ(request[1].dtype, paddle::PaddleDType::FLOAT32);
+    EXPECT_EQ(request[1].data.length(), 3 * sizeof(float));
+  }
+  EXPECT_ANY_THROW(MakeSyntheticRequests("ids", 1, 0));
+  EXPECT_ANY_THROW(MakeSyntheticRequests("ids:2:float64", 1, 0));
+}
+
+TEST(LoadTest, ToJson) {
+  LoadTestReport report;
+  report.options.num_threads = 4;
+  report.latency = SummarizeLatencies({1, 2, 3, 4});
+  report.throughput_qps = 100;
+  auto json = report.ToJson();
+  LOG(INFO) << json;
+  EXPECT_NE(json.find("\"num_threads\": 4,"), std::string::npos);
+  EXPECT_NE(json.find("\"p99\": 4.000"), std::string::npos);
+  EXPECT_NE(json.find("\"closed_loop\": true"), std::string::npos);
+  EXPECT_EQ(json.front(), '{');
+}
@@ -23,6 +23,7 @@
 #include "paddle/fluid/memory/allocation/naive_best_fit_allocator.h"
 #include "paddle/fluid/memory/allocation/retry_allocator.h"
 #include "paddle/fluid/memory/allocation/stat_allocator.h"
+#include "paddle/fluid/memory/allocation/thread_cache_cpu_allocator.h"
 #include "paddle/fluid/platform/enforce.h"
 #include "paddle/fluid/platform/place.h"
 
@@ -94,6 +95,7 @@ PADDLE_DEFINE_EXPORTED_bool(use_cuda_managed_memory, false,
                             "strategy");
 
 DECLARE_string(allocator_strategy);
+DECLARE_string(cpu_allocator_strategy);
 
 namespace paddle {
 namespace memory {
@@ -170,7 +172,7 @@ class AllocatorFacadePrivate {
 
     switch (strategy_) {
       case AllocatorStrategy::kNaiveBestFit: {
-        InitNaiveBestFitCPUAllocator();
+        InitCPUAllocator();
 #ifdef PADDLE_WITH_IPU
         for (int dev_id = 0; dev_id < platform::GetIPUDeviceCount(); ++dev_id) {
           InitNaiveBestFitIPUAllocator(platform::IPUPlace(dev_id));
@@ -213,7 +215,7 @@ class AllocatorFacadePrivate {
       }
 
       case AllocatorStrategy::kAutoGrowth: {
-        InitNaiveBestFitCPUAllocator();
+        InitCPUAllocator();
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
         allow_free_idle_chunk_ = allow_free_idle_chunk;
         for (int dev_id = 0; dev_id < platform::GetGPUDeviceCount(); ++dev_id) {
@@ -279,7 +281,7 @@ class AllocatorFacadePrivate {
       }
 
       case AllocatorStrategy::kThreadLocal: {
-        InitNaiveBestFitCPUAllocator();
+        InitCPUAllocator();
 #ifdef PADDLE_WITH_XPU
         for (int dev_id = 0; dev_id < platform::GetXPUDeviceCount(); ++dev_id) {
           InitNaiveBestFitXPUAllocator(platform::XPUPlace(dev_id));
@@ -471,6 +473,24 @@ class AllocatorFacadePrivate {
         std::make_shared<NaiveBestFitAllocator>(platform::CPUPlace());
   }
 
+  void InitThreadCacheCPUAllocator() {
+    allocators_[platform::CPUPlace()] =
+        std::make_shared<ThreadCacheCPUAllocator>();
+  }
+
+  void InitCPUAllocator() {
+    if (FLAGS_cpu_allocator_strategy == "naive_best_fit") {
+      InitNaiveBestFitCPUAllocator();
+    } else if (FLAGS_cpu_allocator_strategy == "thread_cache") {
+      InitThreadCacheCPUAllocator();
+    } else {
+      PADDLE_THROW(platform::errors::InvalidArgument(
+          "Unsupported cpu_allocator_strategy: %s, please set "
+          "cpu_allocator_strategy to naive_best_fit or thread_cache.",
+          FLAGS_cpu_allocator_strategy));
+    }
+  }
+
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
   void InitNaiveBestFitCUDAPinnedAllocator() {
     allocators_[platform::CUDAPinnedPlace()] =
@@ -0,0 +1,102 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Allocation churn benchmark of the CPU allocators. Every thread keeps a
+// window of live allocations and repeatedly replaces a random one with a
+// new allocation of a random, log-uniformly distributed size, which is
+// roughly what the executors of many concurrent inference requests do.
+//
+// Usage: cpu_allocator_benchmark --threads=16 --iterations=200000
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "paddle/fluid/memory/allocation/cpu_allocator.h"
+#include "paddle/fluid/memory/allocation/naive_best_fit_allocator.h"
+#include "paddle/fluid/memory/allocation/thread_cache_cpu_allocator.h"
+#include "paddle/fluid/memory/stats.h"
+
+DEFINE_int32(threads, 8, "Number of allocating threads.");
+DEFINE_int32(iterations, 100000, "Allocations per thread.");
+DEFINE_int32(live, 64, "Live allocations kept by every thread.");
+DEFINE_int32(min_size_log2, 6, "Log2 of the smallest allocation size.");
+DEFINE_int32(max_size_log2, 20, "Log2 of the largest allocation size.");
+DEFINE_string(filter, "", "The allocator to benchmark, all if empty.");
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+double RunChurn(Allocator* allocator) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < FLAGS_threads; ++t) {
+    threads.emplace_back([allocator, t] {
+      std::mt19937 gen(t);
+      std::uniform_int_distribution<int> lg_dist(FLAGS_min_size_log2,
+                                                 FLAGS_max_size_log2);
+      std::vector<AllocationPtr> live(FLAGS_live);
+      for (int i = 0; i < FLAGS_iterations; ++i) {
+        int lg = lg_dist(gen);
+        size_t size = (1UL << lg) + gen() % (1UL << lg);
+        auto& slot = live[gen() % live.size()];
+        slot = allocator->Allocate(size);
+        // Touch the memory like a kernel writing its output would.
+        static_cast<char*>(slot->ptr())[0] = static_cast<char>(i);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+void RunAllBenchmarks() {
+  std::vector<std::pair<std::string, std::shared_ptr<Allocator>>> allocators =
+      {{"system", std::make_shared<CPUAllocator>()},
+       {"naive_best_fit",
+        std::make_shared<NaiveBestFitAllocator>(platform::CPUPlace())},
+       {"thread_cache", std::make_shared<ThreadCacheCPUAllocator>()}};
+  double total = static_cast<double>(FLAGS_threads) * FLAGS_iterations;
+  for (auto& pair : allocators) {
+    if (!FLAGS_filter.empty() && FLAGS_filter != pair.first) continue;
+    // Warm up, so that the pools are populated before timing.
+    RunChurn(pair.second.get());
+    double seconds = RunChurn(pair.second.get());
+    LOG(INFO) << "Benchmark " << pair.first << ": threads " << FLAGS_threads
+              << ", " << total / seconds / 1e6 << " M alloc/free per second, "
+              << seconds * 1e9 / total << " ns per alloc/free pair.";
+  }
+  LOG(INFO) << "Peak host memory reserved by thread_cache: "
+            << StatGetPeakValue("HostReserved", 0) << " bytes.";
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  paddle::memory::allocation::RunAllBenchmarks();
+  return 0;
+}
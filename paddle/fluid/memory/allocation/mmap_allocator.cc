@@ -19,6 +19,7 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <random>
 #include <string>
 
@@ -250,6 +251,39 @@ std::shared_ptr<MemoryMapReaderAllocation> RebuildMemoryMapReaderAllocation(
   return std::make_shared<MemoryMapReaderAllocation>(ptr, size, ipc_name);
 }
 
+void MemoryMapFileAllocation::close() {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  if (map_ptr_ != nullptr && munmap(map_ptr_, map_size_) != 0) {
+    LOG(WARNING) << "Unmapping file " << ipc_name_ << " failed.";
+  }
+}
+
+std::shared_ptr<MemoryMapFileAllocation> AllocateMemoryMapFileAllocation(
+    const std::string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  PADDLE_ENFORCE_NE(fd, -1, platform::errors::NotFound(
+                                "File %s open failed.", filename.c_str()));
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+    ::close(fd);
+    PADDLE_THROW(platform::errors::Unavailable(
+        "File %s is empty or its size is unknown.", filename.c_str()));
+  }
+  size_t size = static_cast<size_t>(file_stat.st_size);
+  // Writable and private, so that writing a page makes a private copy of
+  // it instead of faulting or changing the file.
+  void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  PADDLE_ENFORCE_NE(
+      ptr, MAP_FAILED,
+      platform::errors::Unavailable("Memory map of file %s failed.",
+                                    filename.c_str()));
+  return std::make_shared<MemoryMapFileAllocation>(ptr, size, filename);
+}
+
 MemoryMapFdSet &MemoryMapFdSet::Instance() {  // NOLINT
   static MemoryMapFdSet set;
   return set;
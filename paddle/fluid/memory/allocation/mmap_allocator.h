@@ -95,6 +95,22 @@ std::shared_ptr<RefcountedMemoryMapAllocation>
 AllocateRefcountedMemoryMapAllocation(std::string filename, int flags,
                                       size_t size);
 
+// A private, copy-on-write mapping of a whole regular file. The pages are
+// shared with the page cache and with every other process mapping the same
+// file until they are written.
+class MemoryMapFileAllocation : public MemoryMapAllocation {
+ public:
+  MemoryMapFileAllocation(void *ptr, size_t size, std::string filename)
+      : MemoryMapAllocation(ptr, size, std::move(filename)) {}
+
+  void close() override;
+
+  ~MemoryMapFileAllocation() override { close(); }
+};
+
+std::shared_ptr<MemoryMapFileAllocation> AllocateMemoryMapFileAllocation(
+    const std::string &filename);
+
 class MemoryMapWriterAllocation : public Allocation {
  public:
   explicit MemoryMapWriterAllocation(void *ptr, size_t size,
@@ -0,0 +1,336 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/thread_cache_cpu_allocator.h"
+
+#include <stdlib.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "paddle/fluid/memory/allocation/cpu_allocator.h"
+#include "paddle/fluid/memory/allocation/spin_lock.h"
+#include "paddle/fluid/memory/stats.h"
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+namespace {
+
+constexpr size_t kNumSizeClasses = ThreadCacheCPUAllocator::kNumSizeClasses;
+constexpr size_t kArenaChunkSize = 32UL << 20;
+constexpr size_t kHugePageSize = 2UL << 20;
+// Blocks moved between a thread cache and the central free list at once.
+constexpr size_t kBatchBytes = 256UL << 10;
+constexpr size_t kMaxBatchBlocks = 64;
+constexpr size_t kNumShards = 8;
+
+inline size_t FloorLog2(size_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(static_cast<unsigned long long>(v));  // NOLINT
+#else
+  size_t lg = 0;
+  while (v >>= 1) ++lg;
+  return lg;
+#endif
+}
+
+inline size_t BatchBlocks(size_t size_class) {
+  return std::min(
+      kMaxBatchBlocks,
+      std::max<size_t>(
+          1, kBatchBytes / ThreadCacheCPUAllocator::ClassSize(size_class)));
+}
+
+void* SystemAlloc(size_t size) {
+  void* p = nullptr;
+#ifdef _WIN32
+  p = _aligned_malloc(size, CPUAllocator::kAlignment);
+  int error = p ? 0 : errno;
+#else
+  int error = posix_memalign(&p, CPUAllocator::kAlignment, size);
+#endif
+  PADDLE_ENFORCE_EQ(
+      error, 0,
+      platform::errors::ResourceExhausted(
+          "Fail to alloc memory of %ld size, error code is %d.", size, error));
+  return p;
+}
+
+void SystemFree(void* p) {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+// Hands out blocks carved from large chunks that are never freed.
+class Arena {
+ public:
+  // Carves at most n blocks of the given size into out and returns how many
+  // were carved, which is at least one.
+  size_t Carve(size_t size, size_t n, void** out) {
+    std::lock_guard<SpinLock> guard(lock_);
+    if (remaining_ < size) {
+      NewChunk();
+    }
+    size_t carved = std::min(n, remaining_ / size);
+    for (size_t i = 0; i < carved; ++i) {
+      out[i] = cursor_;
+      cursor_ += size;
+    }
+    remaining_ -= carved * size;
+    return carved;
+  }
+
+ private:
+  void NewChunk() {
+    void* chunk = nullptr;
+#ifdef __linux__
+    // Over-allocate by one huge page so the chunk can be aligned to it.
+    size_t mapped = kArenaChunkSize + kHugePageSize;
+    void* p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    PADDLE_ENFORCE_NE(p, MAP_FAILED,
+                      platform::errors::ResourceExhausted(
+                          "Fail to map %ld bytes of host memory.", mapped));
+    uintptr_t begin = reinterpret_cast<uintptr_t>(p);
+    uintptr_t aligned =
+        (begin + kHugePageSize - 1) & ~(uintptr_t)(kHugePageSize - 1);
+    if (aligned > begin) {
+      munmap(p, aligned - begin);
+    }
+    uintptr_t end = aligned + kArenaChunkSize;
+    if (begin + mapped > end) {
+      munmap(reinterpret_cast<void*>(end), begin + mapped - end);
+    }
+    chunk = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+    // Only a hint, the chunk works with normal pages when THP is disabled.
+    madvise(chunk, kArenaChunkSize, MADV_HUGEPAGE);
+#endif
+#else
+    chunk = SystemAlloc(kArenaChunkSize);
+#endif
+    MEMORY_STAT_UPDATE(HostReserved, 0, kArenaChunkSize);
+    // The tail of the previous chunk, if any, is smaller than the block that
+    // did not fit and is left unused.
+    cursor_ = static_cast<char*>(chunk);
+    remaining_ = kArenaChunkSize;
+  }
+
+  SpinLock lock_;
+  char* cursor_{nullptr};
+  size_t remaining_{0};
+};
+
+// Free blocks shared by all threads, one list per size class in each shard.
+class CentralFreeList {
+ public:
+  static CentralFreeList& Instance() {
+    // Leaked on purpose, thread caches flush into it at thread exit.
+    static CentralFreeList* list = new CentralFreeList();
+    return *list;
+  }
+
+  // Moves up to n free blocks of a class into out, preferring the given
+  // shard and carving new blocks when all shards are empty. Returns the
+  // number of blocks, which is at least one.
+  size_t Fetch(size_t size_class, size_t n, size_t shard, void** out) {
+    for (size_t i = 0; i < kNumShards; ++i) {
+      auto& s = shards_[(shard + i) % kNumShards];
+      std::lock_guard<SpinLock> guard(s.lock);
+      auto& blocks = s.blocks[size_class];
+      if (blocks.empty()) continue;
+      size_t k = std::min(n, blocks.size());
+      std::copy(blocks.end() - k, blocks.end(), out);
+      blocks.resize(blocks.size() - k);
+      return k;
+    }
+    return arena_.Carve(
+        ThreadCacheCPUAllocator::ClassSize(size_class), n, out);
+  }
+
+  void Return(size_t size_class, void* const* blocks, size_t n, size_t shard) {
+    auto& s = shards_[shard];
+    std::lock_guard<SpinLock> guard(s.lock);
+    s.blocks[size_class].insert(s.blocks[size_class].end(), blocks, blocks + n);
+  }
+
+ private:
+  CentralFreeList() = default;
+
+  struct alignas(64) Shard {
+    SpinLock lock;
+    std::vector<void*> blocks[kNumSizeClasses];
+  };
+
+  Shard shards_[kNumShards];
+  Arena arena_;
+};
+
+inline size_t ShardOfThisThread() {
+  return std::hash<std::thread::id>()(std::this_thread::get_id()) %
+         kNumShards;
+}
+
+// Per-thread free blocks. A thread only takes the central locks when one of
+// its lists runs empty or grows beyond two batches.
+class ThreadCache {
+ public:
+  ThreadCache() : shard_(ShardOfThisThread()) {}
+
+  ~ThreadCache() {
+    Flush();
+    destroyed_ = true;
+  }
+
+  void* Pop(size_t size_class) {
+    auto& list = lists_[size_class];
+    if (list.empty()) {
+      size_t batch = BatchBlocks(size_class);
+      list.resize(batch);
+      list.resize(CentralFreeList::Instance().Fetch(
+          size_class, batch, shard_, list.data()));
+    }
+    void* p = list.back();
+    list.pop_back();
+    return p;
+  }
+
+  void Push(size_t size_class, void* p) {
+    auto& list = lists_[size_class];
+    list.push_back(p);
+    size_t batch = BatchBlocks(size_class);
+    if (list.size() > 2 * batch) {
+      CentralFreeList::Instance().Return(
+          size_class, list.data() + list.size() - batch, batch, shard_);
+      list.resize(list.size() - batch);
+    }
+  }
+
+  void Flush() {
+    for (size_t c = 0; c < kNumSizeClasses; ++c) {
+      auto& list = lists_[c];
+      if (list.empty()) continue;
+      CentralFreeList::Instance().Return(c, list.data(), list.size(), shard_);
+      list.clear();
+    }
+  }
+
+  // Blocks freed while thread-local objects are being destroyed at thread
+  // exit bypass the cache, which may already be gone.
+  static bool Destroyed() { return destroyed_; }
+
+ private:
+  std::vector<void*> lists_[kNumSizeClasses];
+  size_t shard_;
+  static thread_local bool destroyed_;
+};
+
+thread_local bool ThreadCache::destroyed_ = false;
+
+ThreadCache* GetThreadCache() {
+  if (ThreadCache::Destroyed()) return nullptr;
+  static thread_local ThreadCache cache;
+  return &cache;
+}
+
+}  // namespace
+
+constexpr size_t ThreadCacheCPUAllocator::kMinClassSize;
+constexpr size_t ThreadCacheCPUAllocator::kMaxClassSize;
+constexpr size_t ThreadCacheCPUAllocator::kNumSizeClasses;
+
+size_t ThreadCacheCPUAllocator::SizeClassOf(size_t size) {
+  if (size <= 4 * kMinClassSize) {
+    return size == 0 ? 0 : (size - 1) / kMinClassSize;
+  }
+  // 2^lg < size <= 2^(lg + 1), split into four steps of 2^(lg - 2).
+  size_t lg = FloorLog2(size - 1);
+  size_t step = lg - 2;
+  size_t k = (size - (1UL << lg) + (1UL << step) - 1) >> step;
+  return 4 + (lg - 8) * 4 + k - 1;
+}
+
+size_t ThreadCacheCPUAllocator::ClassSize(size_t size_class) {
+  if (size_class < 4) {
+    return (size_class + 1) * kMinClassSize;
+  }
+  size_t lg = 8 + (size_class - 4) / 4;
+  size_t k = (size_class - 4) % 4 + 1;
+  return (1UL << lg) + k * (1UL << (lg - 2));
+}
+
+phi::Allocation* ThreadCacheCPUAllocator::AllocateImpl(size_t size) {
+  void* p = nullptr;
+  if (size > kMaxClassSize) {
+    p = SystemAlloc(size);
+    MEMORY_STAT_UPDATE(HostReserved, 0, size);
+  } else {
+    size_t size_class = SizeClassOf(size);
+    size = ClassSize(size_class);
+    auto* cache = GetThreadCache();
+    if (LIKELY(cache != nullptr)) {
+      p = cache->Pop(size_class);
+    } else {
+      CentralFreeList::Instance().Fetch(size_class, 1, ShardOfThisThread(),
+                                        &p);
+    }
+  }
+  MEMORY_STAT_UPDATE(HostAllocated, 0, size);
+  return new Allocation(p, size, platform::CPUPlace());
+}
+
+void ThreadCacheCPUAllocator::FreeImpl(phi::Allocation* allocation) {
+  void* p = allocation->ptr();
+  size_t size = allocation->size();
+  if (size > kMaxClassSize) {
+    SystemFree(p);
+    MEMORY_STAT_UPDATE(HostReserved, 0, -static_cast<int64_t>(size));
+  } else {
+    size_t size_class = SizeClassOf(size);
+    auto* cache = GetThreadCache();
+    if (LIKELY(cache != nullptr)) {
+      cache->Push(size_class, p);
+    } else {
+      CentralFreeList::Instance().Return(size_class, &p, 1,
+                                         ShardOfThisThread());
+    }
+  }
+  MEMORY_STAT_UPDATE(HostAllocated, 0, -static_cast<int64_t>(size));
+  delete allocation;
+}
+
+uint64_t ThreadCacheCPUAllocator::ReleaseImpl(const platform::Place& place) {
+  auto* cache = GetThreadCache();
+  if (cache != nullptr) {
+    cache->Flush();
+  }
+  return 0;
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,66 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "paddle/fluid/memory/allocation/allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+// CPU allocator for workloads that allocate and free many small and medium
+// tensors from many threads, e.g. multi-threaded inference.
+//
+// Requests up to kMaxClassSize are rounded up to one of kNumSizeClasses size
+// classes (multiples of 64 bytes, four classes per power of two). Each thread
+// keeps a small cache of free blocks per class and only touches shared state
+// when its cache is empty or full, moving a batch of blocks at a time to or
+// from a central free list that is sharded by thread to keep lock contention
+// low. New blocks are carved from 32MB arenas that are backed by transparent
+// huge pages where the OS supports it. Larger requests go to the system.
+//
+// Memory of freed blocks is kept for reuse and never returned to the OS,
+// like NaiveBestFitAllocator does for CPU. The size of the returned
+// allocation is the size of its class.
+//
+// All instances share the same process-wide heap, so an allocation may be
+// freed from any thread and through any instance.
+class ThreadCacheCPUAllocator : public Allocator {
+ public:
+  static constexpr size_t kMinClassSize = 64;
+  static constexpr size_t kMaxClassSize = 4UL << 20;
+  static constexpr size_t kNumSizeClasses = 60;
+
+  bool IsAllocThreadSafe() const override { return true; }
+
+  // Index of the smallest class that fits size, for size <= kMaxClassSize.
+  static size_t SizeClassOf(size_t size);
+  // Block size of a class.
+  static size_t ClassSize(size_t size_class);
+
+ protected:
+  phi::Allocation* AllocateImpl(size_t size) override;
+  void FreeImpl(phi::Allocation* allocation) override;
+  // Returns the free blocks cached by the calling thread to the central free
+  // list so other threads can reuse them. Nothing is returned to the OS.
+  uint64_t ReleaseImpl(const platform::Place& place) override;
+};
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
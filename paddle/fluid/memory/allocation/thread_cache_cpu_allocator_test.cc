@@ -0,0 +1,123 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/thread_cache_cpu_allocator.h"
+
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/memory/stats.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+using Alloc = ThreadCacheCPUAllocator;
+
+TEST(ThreadCacheCPUAllocator, size_classes) {
+  size_t prev = 0;
+  for (size_t c = 0; c < Alloc::kNumSizeClasses; ++c) {
+    size_t size = Alloc::ClassSize(c);
+    ASSERT_GT(size, prev);
+    ASSERT_EQ(size % Alloc::kMinClassSize, 0UL);
+    ASSERT_EQ(Alloc::SizeClassOf(size), c);
+    ASSERT_EQ(Alloc::SizeClassOf(prev + 1), c);
+    prev = size;
+  }
+  ASSERT_EQ(prev, Alloc::kMaxClassSize);
+  for (size_t size = 1; size <= Alloc::kMaxClassSize; size += size / 7 + 1) {
+    size_t class_size = Alloc::ClassSize(Alloc::SizeClassOf(size));
+    ASSERT_GE(class_size, size);
+    // Rounding wastes at most a quarter of the request above 256 bytes.
+    ASSERT_LE(class_size, std::max<size_t>(size + size / 4, 256));
+  }
+}
+
+TEST(ThreadCacheCPUAllocator, allocate) {
+  Alloc allocator;
+  std::vector<AllocationPtr> allocations;
+  for (size_t size : {1UL, 64UL, 100UL, 4000UL, 1UL << 20, 5UL << 20}) {
+    auto allocation = allocator.Allocate(size);
+    ASSERT_GE(allocation->size(), size);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(allocation->ptr()) %
+                  Alloc::kMinClassSize,
+              0UL);
+    std::memset(allocation->ptr(), 0xab, size);
+    allocations.emplace_back(std::move(allocation));
+  }
+  // A freed block is reused by the next request of the same class.
+  void* p = allocations[2]->ptr();
+  allocations[2].reset();
+  ASSERT_EQ(allocator.Allocate(90)->ptr(), p);
+}
+
+TEST(ThreadCacheCPUAllocator, host_stats) {
+  Alloc allocator;
+  int64_t allocated = StatGetCurrentValue("HostAllocated", 0);
+  {
+    auto allocation = allocator.Allocate(1000);
+    ASSERT_EQ(StatGetCurrentValue("HostAllocated", 0),
+              allocated + static_cast<int64_t>(allocation->size()));
+    ASSERT_GE(StatGetCurrentValue("HostReserved", 0),
+              static_cast<int64_t>(allocation->size()));
+  }
+  ASSERT_EQ(StatGetCurrentValue("HostAllocated", 0), allocated);
+}
+
+TEST(ThreadCacheCPUAllocator, free_on_other_thread) {
+  Alloc allocator;
+  std::vector<AllocationPtr> allocations;
+  std::thread producer([&] {
+    for (int i = 0; i < 1000; ++i) {
+      allocations.emplace_back(allocator.Allocate(128 + i));
+    }
+  });
+  producer.join();
+  std::thread consumer([&] { allocations.clear(); });
+  consumer.join();
+  allocator.Release(platform::CPUPlace());
+}
+
+TEST(ThreadCacheCPUAllocator, multi_thread) {
+  Alloc allocator;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&allocator, t] {
+      std::mt19937 gen(t);
+      std::uniform_int_distribution<int> lg_dist(0, 20);
+      std::vector<AllocationPtr> live(64);
+      for (int i = 0; i < 20000; ++i) {
+        auto& slot = live[gen() % live.size()];
+        if (slot) {
+          auto* data = static_cast<unsigned char*>(slot->ptr());
+          ASSERT_EQ(data[0], static_cast<unsigned char>(t));
+          ASSERT_EQ(data[slot->size() - 1], static_cast<unsigned char>(t));
+        }
+        size_t size = (1UL << lg_dist(gen)) + gen() % 64;
+        slot = allocator.Allocate(size);
+        auto* data = static_cast<unsigned char*>(slot->ptr());
+        data[0] = static_cast<unsigned char>(t);
+        data[slot->size() - 1] = static_cast<unsigned char>(t);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -49,6 +49,11 @@ class StatRegistry {
     return GetStat(stat_type, dev_id)->GetPeakValue();
   }
 
+  int64_t GetThreadLocalTotalIncrement(const std::string& stat_type,
+                                       int dev_id) {
+    return GetStat(stat_type, dev_id)->GetThreadLocalTotalIncrement();
+  }
+
   void Register(const std::string& stat_type, int dev_id, StatBase* stat) {
     std::lock_guard<SpinLock> lock_guard(stat_map_lock_);
     stat_map_[GetStatKey(stat_type, dev_id)] = stat;
@@ -84,6 +89,12 @@ void StatUpdate(const std::string& stat_type, int dev_id, int64_t increment) {
   StatRegistry::GetInstance()->Update(stat_type, dev_id, increment);
 }
 
+int64_t StatGetThreadLocalTotalIncrement(const std::string& stat_type,
+                                         int dev_id) {
+  return StatRegistry::GetInstance()->GetThreadLocalTotalIncrement(stat_type,
+                                                                   dev_id);
+}
+
 #define MEMORY_STAT_REGISTER_WITH_ID(item, id) \
   StatRegistry::GetInstance()->Register(       \
       #item, id, Stat<ThreadLocalStatDevice##id##item>::GetInstance());
@@ -109,6 +120,8 @@ void StatUpdate(const std::string& stat_type, int dev_id, int64_t increment) {
 int RegisterAllStats() {
   MEMORY_STAT_REGISTER(Allocated);
   MEMORY_STAT_REGISTER(Reserved);
+  MEMORY_STAT_REGISTER(HostAllocated);
+  MEMORY_STAT_REGISTER(HostReserved);
   return 0;
 }
 
@@ -30,6 +30,8 @@ using framework::ThreadDataRegistry;
 struct ThreadLocalStatBase {
   int64_t current{0};
   int64_t peak{0};
+  // The sum of the positive updates, e.g. the bytes allocated by the thread.
+  int64_t total_increment{0};
 };
 
 class StatBase {
@@ -39,6 +41,7 @@ class StatBase {
 
   virtual int64_t GetCurrentValue() = 0;
   virtual int64_t GetPeakValue() = 0;
+  virtual int64_t GetThreadLocalTotalIncrement() = 0;
   virtual void Update(int64_t) = 0;
 
  private:
@@ -66,12 +69,19 @@ class Stat : public StatBase {
 
   int64_t GetPeakValue() override { return peak_value_; }
 
+  int64_t GetThreadLocalTotalIncrement() override {
+    return ThreadDataRegistry<ThreadLocalStatType>::GetInstance()
+        .GetCurrentThreadData()
+        .total_increment;
+  }
+
   void Update(int64_t increment) override {
     auto& thread_data_registry =
         ThreadDataRegistry<ThreadLocalStatType>::GetInstance();
     ThreadLocalStatType* thread_local_stat =
         thread_data_registry.GetMutableCurrentThreadData();
     thread_local_stat->current += increment;
+    if (increment > 0) thread_local_stat->total_increment += increment;
 
     if (thread_local_stat->current > thread_local_stat->peak) {
       thread_local_stat->peak = thread_local_stat->current;
@@ -99,6 +109,9 @@ class Stat : public StatBase {
 int64_t StatGetCurrentValue(const std::string& stat_type, int dev_id);
 int64_t StatGetPeakValue(const std::string& stat_type, int dev_id);
 void StatUpdate(const std::string& stat_type, int dev_id, int64_t increment);
+// The sum of the positive updates made by the current thread.
+int64_t StatGetThreadLocalTotalIncrement(const std::string& stat_type,
+                                         int dev_id);
 
 #define MEMORY_STAT_FUNC_SWITHCH_CASE(item, id)                          \
   case id:                                                               \
@@ -167,6 +180,8 @@ void StatUpdate(const std::string& stat_type, int dev_id, int64_t increment);
 // To add a new STAT type, declare here and register in stats.cc
 MEMORY_STAT_DECLARE(Allocated);
 MEMORY_STAT_DECLARE(Reserved);
+MEMORY_STAT_DECLARE(HostAllocated);
+MEMORY_STAT_DECLARE(HostReserved);
 
 }  // namespace memory
 }  // namespace paddle
@@ -103,5 +103,22 @@ TEST(stats_test, PeakValueTest) {
   EXPECT_EQ(StatGetPeakValue(stat_type, 0), peak_value);
 }
 
+TEST(stats_test, ThreadLocalTotalIncrementTest) {
+  std::string stat_type = "Reserved";
+  int64_t total = StatGetThreadLocalTotalIncrement(stat_type, 1);
+  StatUpdate(stat_type, 1, 100);
+  StatUpdate(stat_type, 1, -60);
+  StatUpdate(stat_type, 1, 20);
+  EXPECT_EQ(StatGetThreadLocalTotalIncrement(stat_type, 1), total + 120);
+
+  std::thread([&stat_type]() {
+    EXPECT_EQ(StatGetThreadLocalTotalIncrement(stat_type, 1), 0);
+    StatUpdate(stat_type, 1, 10);
+    EXPECT_EQ(StatGetThreadLocalTotalIncrement(stat_type, 1), 10);
+  }).join();
+  EXPECT_EQ(StatGetThreadLocalTotalIncrement(stat_type, 1), total + 120);
+  StatUpdate(stat_type, 1, -60);
+}
+
 }  // namespace memory
 }  // namespace paddle
@@ -0,0 +1,252 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifdef PADDLE_WITH_MKLML
+#include <omp.h>
+#endif
+
+#include "paddle/fluid/framework/lod_tensor.h"
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/phi/kernels/funcs/flat_hash_map.h"
+
+namespace paddle {
+namespace operators {
+
+// CPU embedding-bag helpers shared by fused_embedding_seq_pool and
+// fused_multi_embedding_seq_pool: lookup + sequence pooling in the forward
+// pass, and a backward pass that scatters the pooled gradient straight into
+// either a dense table gradient or a deduplicated SelectedRows gradient.
+
+enum class EmbeddingBagCombiner { kSum, kMean, kSqrt };
+
+inline EmbeddingBagCombiner GetEmbeddingBagCombiner(
+    const std::string& combiner) {
+  if (combiner == "sum") {
+    return EmbeddingBagCombiner::kSum;
+  } else if (combiner == "mean") {
+    return EmbeddingBagCombiner::kMean;
+  } else if (combiner == "sqrt") {
+    return EmbeddingBagCombiner::kSqrt;
+  }
+  PADDLE_THROW(platform::errors::Unimplemented(
+      "The combiner of fused embedding sequence pooling should be one of "
+      "sum, mean and sqrt, but received %s.",
+      combiner));
+}
+
+// One embedding table looked up by one LoD level-1 id tensor. The ids form a
+// [lod.back(), idx_width] matrix; column c of the rows of sequence i is
+// pooled into out[i, c * table_width : (c + 1) * table_width].
+template <typename T>
+struct EmbeddingBagSlot {
+  const T* table{nullptr};
+  int64_t table_height{0};
+  int64_t table_width{0};
+  const int64_t* ids{nullptr};
+  // Optional per-id weights with the same layout as ids.
+  const T* weights{nullptr};
+  std::vector<uint64_t> lod;
+  int64_t idx_width{1};
+  int64_t padding_idx{-1};
+
+  size_t num_seqs() const { return lod.size() - 1; }
+  int64_t out_width() const { return idx_width * table_width; }
+};
+
+template <typename T>
+EmbeddingBagSlot<T> MakeEmbeddingBagSlot(const framework::DDim& table_dims,
+                                         const T* table,
+                                         const framework::LoDTensor& ids,
+                                         const framework::LoDTensor* weights,
+                                         int64_t padding_idx) {
+  PADDLE_ENFORCE_EQ(ids.lod().size(), 1UL,
+                    platform::errors::InvalidArgument(
+                        "The LoD level of Input(Ids) should be 1. But "
+                        "received Ids's LoD level = %d.",
+                        ids.lod().size()));
+  EmbeddingBagSlot<T> slot;
+  slot.table = table;
+  slot.table_height = table_dims[0];
+  slot.table_width = table_dims[1];
+  slot.ids = ids.data<int64_t>();
+  slot.lod = ids.lod()[0];
+  PADDLE_ENFORCE_GT(slot.lod.size(), 1UL,
+                    platform::errors::InvalidArgument(
+                        "The tensor ids's LoD[0] should be greater than 1. "
+                        "But received the ids's LoD[0] = %d.",
+                        slot.lod.size()));
+  if (slot.lod.back() > 0) {
+    slot.idx_width = ids.numel() / static_cast<int64_t>(slot.lod.back());
+  }
+  slot.padding_idx = padding_idx;
+  if (weights != nullptr) {
+    PADDLE_ENFORCE_EQ(weights->numel(), ids.numel(),
+                      platform::errors::InvalidArgument(
+                          "Input(PerSampleWeight) should have one weight per "
+                          "id. But received %d weights for %d ids.",
+                          weights->numel(), ids.numel()));
+    slot.weights = weights->data<T>();
+  }
+  return slot;
+}
+
+// Checks the ids up front, so the pooling loops can run inside parallel
+// regions without throwing.
+template <typename T>
+void CheckEmbeddingBagIds(const EmbeddingBagSlot<T>& slot) {
+  const int64_t num_ids = slot.lod.back() * slot.idx_width;
+  for (int64_t i = 0; i < num_ids; ++i) {
+    int64_t id = slot.ids[i];
+    if (id == slot.padding_idx) continue;
+    PADDLE_ENFORCE_EQ(
+        id >= 0 && id < slot.table_height, true,
+        platform::errors::InvalidArgument(
+            "Variable value (input) of OP(fused_embedding_seq_pool) expected "
+            ">= 0 and < %ld, but got %ld. Please check input value.",
+            slot.table_height, id));
+  }
+}
+
+// The factor applied to every looked-up row of the bag formed by column col
+// of sequence seq: 1 for sum, 1 / sum(w) for mean and 1 / sqrt(sum(w^2)) for
+// sqrt, where w is 1 when there are no per-sample weights. Padding ids do
+// not count. Empty bags get 0.
+template <typename T>
+T EmbeddingBagScale(const EmbeddingBagSlot<T>& slot,
+                    EmbeddingBagCombiner combiner, size_t seq, int64_t col) {
+  if (combiner == EmbeddingBagCombiner::kSum) {
+    return static_cast<T>(1);
+  }
+  T acc = 0;
+  for (uint64_t j = slot.lod[seq]; j < slot.lod[seq + 1]; ++j) {
+    const int64_t pos = j * slot.idx_width + col;
+    if (slot.ids[pos] == slot.padding_idx) continue;
+    T w = slot.weights ? slot.weights[pos] : static_cast<T>(1);
+    acc += combiner == EmbeddingBagCombiner::kMean ? w : w * w;
+  }
+  if (acc == static_cast<T>(0)) {
+    return static_cast<T>(0);
+  }
+  return combiner == EmbeddingBagCombiner::kMean
+             ? static_cast<T>(1) / acc
+             : static_cast<T>(1) / std::sqrt(acc);
+}
+
+// out: [num_seqs, out_width].
+template <typename T>
+void EmbeddingBagForward(const EmbeddingBagSlot<T>& slot,
+                         EmbeddingBagCombiner combiner, T* out) {
+  const int64_t width = slot.table_width;
+  const int64_t out_width = slot.out_width();
+  for (size_t seq = 0; seq < slot.num_seqs(); ++seq) {
+    for (int64_t col = 0; col < slot.idx_width; ++col) {
+      T* dst = out + seq * out_width + col * width;
+      std::memset(dst, 0, width * sizeof(T));
+      const T scale = EmbeddingBagScale(slot, combiner, seq, col);
+      for (uint64_t j = slot.lod[seq]; j < slot.lod[seq + 1]; ++j) {
+        const int64_t pos = j * slot.idx_width + col;
+        const int64_t id = slot.ids[pos];
+        if (id == slot.padding_idx) continue;
+        const T w = slot.weights ? slot.weights[pos] * scale : scale;
+        const T* src = slot.table + id * width;
+        for (int64_t k = 0; k < width; ++k) {
+          dst[k] += w * src[k];
+        }
+      }
+    }
+  }
+}
+
+// Distinct non-padding ids of a slot, in order of first occurrence, and the
+// position of every id in that list (-1 for padding).
+struct EmbeddingBagGradRows {
+  std::vector<int64_t> rows;
+  std::vector<int64_t> row_ids;
+};
+
+template <typename T>
+void BuildEmbeddingBagGradRows(const EmbeddingBagSlot<T>& slot,
+                               EmbeddingBagGradRows* grad_rows) {
+  const int64_t num_ids = slot.lod.back() * slot.idx_width;
+  phi::funcs::FlatHashMap<int64_t, int64_t> id_to_row(num_ids);
+  grad_rows->rows.clear();
+  grad_rows->row_ids.resize(num_ids);
+  for (int64_t i = 0; i < num_ids; ++i) {
+    const int64_t id = slot.ids[i];
+    if (id == slot.padding_idx) {
+      grad_rows->row_ids[i] = -1;
+      continue;
+    }
+    bool inserted = false;
+    grad_rows->row_ids[i] = *id_to_row.Insert(
+        id, static_cast<int64_t>(grad_rows->rows.size()), &inserted);
+    if (inserted) {
+      grad_rows->rows.push_back(id);
+    }
+  }
+}
+
+// Scatters d_out ([num_seqs, out_width]) into d_rows. Row r of d_rows
+// receives the gradient of table row grad_rows->rows[r] when grad_rows is
+// given (d_rows then has grad_rows->rows.size() rows), and of table row r
+// otherwise (d_rows then covers the whole table). d_rows is zeroed first.
+template <typename T>
+void EmbeddingBagBackward(const EmbeddingBagSlot<T>& slot,
+                          EmbeddingBagCombiner combiner, const T* d_out,
+                          const EmbeddingBagGradRows* grad_rows, T* d_rows) {
+  const int64_t width = slot.table_width;
+  const int64_t out_width = slot.out_width();
+  const int64_t num_rows = grad_rows
+                               ? static_cast<int64_t>(grad_rows->rows.size())
+                               : slot.table_height;
+  std::memset(d_rows, 0, num_rows * width * sizeof(T));
+  for (size_t seq = 0; seq < slot.num_seqs(); ++seq) {
+    for (int64_t col = 0; col < slot.idx_width; ++col) {
+      const T* src = d_out + seq * out_width + col * width;
+      const T scale = EmbeddingBagScale(slot, combiner, seq, col);
+      for (uint64_t j = slot.lod[seq]; j < slot.lod[seq + 1]; ++j) {
+        const int64_t pos = j * slot.idx_width + col;
+        const int64_t id = slot.ids[pos];
+        if (id == slot.padding_idx) continue;
+        const int64_t row = grad_rows ? grad_rows->row_ids[pos] : id;
+        const T w = slot.weights ? slot.weights[pos] * scale : scale;
+        T* dst = d_rows + row * width;
+        for (int64_t k = 0; k < width; ++k) {
+          dst[k] += w * src[k];
+        }
+      }
+    }
+  }
+}
+
+// Runs fn(i) for i in [0, num_slots), spreading slots across threads. fn must
+// not throw.
+template <typename Fn>
+void ParallelForEmbeddingBagSlots(size_t num_slots, Fn&& fn) {
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for schedule(dynamic) if (num_slots > 1)
+#endif
+  for (int64_t i = 0; i < static_cast<int64_t>(num_slots); ++i) {
+    fn(static_cast<size_t>(i));
+  }
+}
+
+}  // namespace operators
+}  // namespace paddle
@@ -44,11 +44,17 @@ class FusedEmbeddingSeqPoolOp : public framework::OperatorWithKernel {
             "The last dimension of the input tensor 'Ids' should be 1. "
             "But received Ids's size in the last dimension = %d.",
             ids_dims[ids_dims.size() - 1]));
-    // we only support sum now
-    PADDLE_ENFORCE_EQ(combiner, "sum",
-                      platform::errors::Unimplemented(
-                          "The pooling type of sequence_pool only support sum "
-                          "now. So the 'combiner' must be 'sum'."));
+    GetEmbeddingBagCombiner(combiner);
+    if (ctx->HasInput("PerSampleWeight")) {
+      auto weight_dims = ctx->GetInputDim("PerSampleWeight");
+      PADDLE_ENFORCE_EQ(
+          weight_dims, ids_dims,
+          platform::errors::InvalidArgument(
+              "Input(PerSampleWeight) should have the same shape as "
+              "Input(Ids). But received PerSampleWeight's shape = [%s], "
+              "Ids's shape = [%s].",
+              weight_dims, ids_dims));
+    }
 
     int64_t last_dim = FusedEmbeddingSeqPoolLastDim(table_dims, ids_dims);
     // in compile time, the lod level of ids must be 1
@@ -83,13 +89,21 @@ class FusedEmbeddingSeqPoolOpMaker : public framework::OpProtoAndCheckerMaker {
              "An input with type int32 or int64 "
              "contains the ids to be looked up in W. "
              "The last dimension size must be 1.");
+    AddInput("PerSampleWeight",
+             "(LoDTensor, optional) A weight for every id, with the same "
+             "shape and LoD as Ids. Every looked-up row is multiplied by its "
+             "weight before pooling.")
+        .AsDispensable();
     AddOutput("Out", "The lookup results, which have the same type as W.");
     AddAttr<std::string>("combiner",
                          "(string, default sum) "
-                         "A string specifying the reduction op. Currently sum "
-                         "are supported, sum computes the weighted sum of the "
-                         "embedding results for each row.")
-        .SetDefault("sum");
+                         "A string specifying the reduction op: sum, mean or "
+                         "sqrt. sum computes the (weighted) sum of the "
+                         "embedding results for each row, mean divides it by "
+                         "the sum of the weights and sqrt by the square root "
+                         "of the sum of the squared weights.")
+        .SetDefault("sum")
+        .InEnum({"sum", "mean", "sqrt"});
     AddAttr<int64_t>("padding_idx",
                      "(int64, default -1) "
                      "If the value is -1, it makes no effect to lookup. "
@@ -115,9 +129,12 @@ FusedEmbeddingSeqPool Operator.
 Computes embeddings for the given ids and weights.
 
 This operator is used to perform lookups on the parameter W,
-then computes the weighted sum of the lookups results for each row
+then pools the lookups results of each sequence with the given combiner
 and concatenated into a dense tensor.
 
+With is_sparse, the gradient of W is a SelectedRows that holds one row per
+distinct id.
+
 The input Ids should carry the LoD (Level of Details) information.
 And the output will change the LoD information with input Ids.
 
@@ -174,6 +191,7 @@ class FusedEmbeddingSeqPoolGradOpMaker
     op->SetType("fused_embedding_seq_pool_grad");
     op->SetInput("Ids", this->Input("Ids"));
     op->SetInput("W", this->Input("W"));
+    op->SetInput("PerSampleWeight", this->Input("PerSampleWeight"));
     op->SetInput(framework::GradVarName("Out"), this->OutputGrad("Out"));
     op->SetOutput(framework::GradVarName("W"), this->InputGrad("W"));
     op->SetAttrMap(this->Attrs());
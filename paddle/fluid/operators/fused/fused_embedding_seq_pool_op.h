@@ -22,6 +22,7 @@ limitations under the License. */
 #include "paddle/fluid/framework/lod_tensor.h"
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/framework/selected_rows_utils.h"
+#include "paddle/fluid/operators/fused/embedding_bag_functor.h"
 #include "paddle/fluid/operators/jit/kernels.h"
 #include "paddle/phi/kernels/funcs/blas/blas.h"
 
@@ -132,7 +133,9 @@ class FusedEmbeddingSeqPoolKernel : public framework::OpKernel<T> {
     const LoDTensor *ids_t = context.Input<LoDTensor>("Ids");  // int tensor
     LoDTensor *output_t = context.Output<LoDTensor>("Out");    // float tensor
     const LoDTensor *table_var = context.Input<LoDTensor>("W");
+    const LoDTensor *weight_t = context.Input<LoDTensor>("PerSampleWeight");
     const std::string &combiner_type = context.Attr<std::string>("combiner");
+    auto combiner = GetEmbeddingBagCombiner(combiner_type);
 
     int64_t last_dim =
         FusedEmbeddingSeqPoolLastDim(table_var->dims(), ids_t->dims());
@@ -148,7 +151,15 @@ class FusedEmbeddingSeqPoolKernel : public framework::OpKernel<T> {
     // should be [seq_length, 1] -> [batch_size, last_dim]
     output_t->Resize({batch_size, last_dim});
 
-    if (combiner_type == "sum") {
+    if (combiner != EmbeddingBagCombiner::kSum || weight_t != nullptr) {
+      int64_t padding_idx = context.Attr<int64_t>("padding_idx");
+      auto slot =
+          MakeEmbeddingBagSlot<T>(table_var->dims(), table_var->data<T>(),
+                                  *ids_t, weight_t, padding_idx);
+      CheckEmbeddingBagIds(slot);
+      EmbeddingBagForward(slot, combiner,
+                          output_t->mutable_data<T>(context.GetPlace()));
+    } else {
 #if defined(PADDLE_WITH_MKLML) && !defined(_WIN32) && !defined(__APPLE__) && \
     !defined(__OSX__)
       int64_t padding_idx = context.Attr<int64_t>("padding_idx");
@@ -210,88 +221,43 @@ class FusedEmbeddingSeqPoolGradKernel : public framework::OpKernel<T> {
     }
 
     bool is_sparse = context.Attr<bool>("is_sparse");
+    int64_t padding_idx = context.Attr<int64_t>("padding_idx");
+    auto combiner =
+        GetEmbeddingBagCombiner(context.Attr<std::string>("combiner"));
+    auto *ids = context.Input<LoDTensor>("Ids");
+    auto *weight_t = context.Input<LoDTensor>("PerSampleWeight");
+    auto *d_output = context.Input<LoDTensor>(framework::GradVarName("Out"));
+    const T *d_output_data = d_output->data<T>();
+
+    auto slot = MakeEmbeddingBagSlot<T>(table_dim, nullptr, *ids, weight_t,
+                                        padding_idx);
+    CheckEmbeddingBagIds(slot);
     // Since paddings are not trainable and fixed in forward, the gradient of
     // paddings makes no sense and we don't deal with it in backward.
     if (is_sparse) {
-      auto *ids = context.Input<LoDTensor>("Ids");
-      auto *d_output = context.Input<LoDTensor>(framework::GradVarName("Out"));
       auto *d_table =
           context.Output<phi::SelectedRows>(framework::GradVarName("W"));
       // runtime shape
       d_table->set_height(table_dim[0]);
 
-      auto *ids_data = ids->data<int64_t>();
-      int64_t ids_num = ids->numel();
-      auto lod = ids->lod()[0];
-      int64_t out_width = d_output->dims()[1];
-
-      framework::Vector<int64_t> *new_rows = d_table->mutable_rows();
-      new_rows->resize(ids_num);
-      std::memcpy(&(*new_rows)[0], ids_data, ids_num * sizeof(int64_t));
+      // Rows looked up several times are merged here, so the optimizer gets
+      // one gradient row per distinct id.
+      EmbeddingBagGradRows grad_rows;
+      BuildEmbeddingBagGradRows(slot, &grad_rows);
 
       auto *d_table_value = d_table->mutable_value();
-      d_table_value->Resize({ids_num, table_dim[1]});
+      d_table_value->Resize(
+          {static_cast<int64_t>(grad_rows.rows.size()), table_dim[1]});
       T *d_table_data = d_table_value->mutable_data<T>(context.GetPlace());
-      const T *d_output_data = d_output->data<T>();
-
-      auto vbroadcast =
-          jit::KernelFuncs<jit::VBroadcastTuple<T>, platform::CPUPlace>::Cache()
-              .At(out_width);
-      for (int i = 0; i < static_cast<int>(lod.size()) - 1; ++i) {
-        int64_t h = static_cast<int64_t>(lod[i + 1] - lod[i]);
-        const T *src = d_output_data + i * out_width;
-        T *dst = d_table_data + lod[i] * out_width;
-        vbroadcast(src, dst, h, out_width);
-      }
+      EmbeddingBagBackward(slot, combiner, d_output_data, &grad_rows,
+                           d_table_data);
+      *d_table->mutable_rows() = std::move(grad_rows.rows);
     } else {
-#if defined(PADDLE_WITH_MKLML) && !defined(_WIN32) && !defined(__APPLE__) && \
-    !defined(__OSX__)
-      auto *ids = context.Input<LoDTensor>("Ids");
-      auto *d_output = context.Input<LoDTensor>(framework::GradVarName("Out"));
       auto *d_table = context.Output<LoDTensor>(framework::GradVarName("W"));
-      int64_t padding_idx = context.Attr<int64_t>("padding_idx");
-
       d_table->Resize(table_dim);
       auto *d_table_data = d_table->mutable_data<T>(context.GetPlace());
-      memset(d_table_data, 0, d_table->numel() * sizeof(T));
-
-      const auto &ids_lod = ids->lod();
-      PADDLE_ENFORCE_EQ(ids_lod.size(), 1UL,
-                        platform::errors::InvalidArgument(
-                            "The LoD level of Input(Ids) should be 1. But "
-                            "received Ids's LoD level = %d.",
-                            ids_lod.size()));
-      const std::vector<uint64_t> offset = ids_lod[0];
-      auto len = ids->numel();
-      int idx_width = len / offset.back();
-
-      Tensor csr_vals_t, csr_colmuns_t, csr_row_idx_t;
-      csr_vals_t.Resize({len});
-      csr_colmuns_t.Resize({len});
-      int64_t batch_size = ids_lod[0].size() - 1;
-      csr_row_idx_t.Resize({(batch_size + 1) * idx_width});
-      auto csr_vals = csr_vals_t.mutable_data<T>(context.GetPlace());
-      auto csr_colmuns = csr_colmuns_t.mutable_data<int>(context.GetPlace());
-      auto csr_row_idx = csr_row_idx_t.mutable_data<int>(context.GetPlace());
-      prepare_csr_data<T>(offset, ids->data<int64_t>(), idx_width, csr_vals,
-                          csr_colmuns, csr_row_idx, padding_idx);
-
-      auto *d_output_data = d_output->data<T>();
-      auto blas = phi::funcs::GetBlas<platform::CPUDeviceContext, T>(context);
-      int width = static_cast<int>(table_dim[1]);
-      int num_seq = batch_size * idx_width;
-      LOG(INFO) << "num seq = " << num_seq << " width = " << width;
-      for (int i = 0; i < num_seq; ++i) {
-        for (int j = csr_row_idx[i]; j < csr_row_idx[i + 1]; ++j) {
-          unsigned int word_idx = csr_colmuns[j];
-          T val = csr_vals[j];
-          blas.AXPY(width, val, d_output_data + i * width,
-                    d_table_data + word_idx * width);
-        }
-      }
-#else
-      LOG(ERROR) << "Dense is not supported in fused_embedding_seq_pool_op now";
-#endif
+      EmbeddingBagBackward(slot, combiner, d_output_data, nullptr,
+                           d_table_data);
     }
   }
 };
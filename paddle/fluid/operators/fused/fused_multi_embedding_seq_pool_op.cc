@@ -0,0 +1,315 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/framework/selected_rows_utils.h"
+#include "paddle/fluid/framework/var_type_inference.h"
+#include "paddle/fluid/operators/fused/embedding_bag_functor.h"
+
+namespace paddle {
+namespace operators {
+
+using LoDTensor = framework::LoDTensor;
+
+class FusedMultiEmbeddingSeqPoolOp : public framework::OperatorWithKernel {
+ public:
+  using framework::OperatorWithKernel::OperatorWithKernel;
+
+  void InferShape(framework::InferShapeContext* ctx) const override {
+    OP_INOUT_CHECK(ctx->HasInputs("W"), "Input", "W",
+                   "FusedMultiEmbeddingSeqPool");
+    OP_INOUT_CHECK(ctx->HasInputs("Ids"), "Input", "Ids",
+                   "FusedMultiEmbeddingSeqPool");
+    OP_INOUT_CHECK(ctx->HasOutputs("Out"), "Output", "Out",
+                   "FusedMultiEmbeddingSeqPool");
+    auto table_dims = ctx->GetInputsDim("W");
+    auto ids_dims = ctx->GetInputsDim("Ids");
+    GetEmbeddingBagCombiner(ctx->Attrs().Get<std::string>("combiner"));
+
+    const size_t num_slots = ids_dims.size();
+    PADDLE_ENFORCE_EQ(table_dims.size(), num_slots,
+                      platform::errors::InvalidArgument(
+                          "The number of Input(W) should be equal to the "
+                          "number of Input(Ids). But received %d tables and "
+                          "%d id tensors.",
+                          table_dims.size(), num_slots));
+    PADDLE_ENFORCE_EQ(ctx->Outputs("Out").size(), num_slots,
+                      platform::errors::InvalidArgument(
+                          "The number of Output(Out) should be equal to the "
+                          "number of Input(Ids). But received %d outputs and "
+                          "%d id tensors.",
+                          ctx->Outputs("Out").size(), num_slots));
+    if (ctx->HasInputs("PerSampleWeight")) {
+      auto weight_dims = ctx->GetInputsDim("PerSampleWeight");
+      PADDLE_ENFORCE_EQ(weight_dims.size(), num_slots,
+                        platform::errors::InvalidArgument(
+                            "The number of Input(PerSampleWeight) should be "
+                            "equal to the number of Input(Ids). But received "
+                            "%d weights and %d id tensors.",
+                            weight_dims.size(), num_slots));
+      for (size_t i = 0; i < num_slots; ++i) {
+        PADDLE_ENFORCE_EQ(
+            weight_dims[i], ids_dims[i],
+            platform::errors::InvalidArgument(
+                "Input(PerSampleWeight)[%d] should have the same shape as "
+                "Input(Ids)[%d]. But received [%s] and [%s].",
+                i, i, weight_dims[i], ids_dims[i]));
+      }
+    }
+
+    std::vector<framework::DDim> out_dims;
+    out_dims.reserve(num_slots);
+    for (size_t i = 0; i < num_slots; ++i) {
+      PADDLE_ENFORCE_EQ(table_dims[i].size(), 2,
+                        platform::errors::InvalidArgument(
+                            "The dim size of Input(W)[%d] should be 2. But "
+                            "received %d.",
+                            i, table_dims[i].size()));
+      const auto& dims = ids_dims[i];
+      PADDLE_ENFORCE_EQ(
+          dims[dims.size() - 1], 1,
+          platform::errors::InvalidArgument(
+              "The last dimension of Input(Ids)[%d] should be 1. But "
+              "received %d.",
+              i, dims[dims.size() - 1]));
+      int64_t last_dim = table_dims[i][1];
+      for (int j = 1; j != dims.size(); ++j) {
+        last_dim *= dims[j];
+      }
+      out_dims.push_back(phi::make_ddim({-1, last_dim}));
+    }
+    ctx->SetOutputsDim("Out", out_dims);
+  }
+
+ protected:
+  framework::OpKernelType GetExpectedKernelType(
+      const framework::ExecutionContext& ctx) const override {
+    auto data_type = OperatorWithKernel::IndicateVarDataType(ctx, "W");
+    return framework::OpKernelType(data_type, ctx.device_context());
+  }
+};
+
+class FusedMultiEmbeddingSeqPoolOpMaker
+    : public framework::OpProtoAndCheckerMaker {
+ public:
+  void Make() override {
+    AddInput("W",
+             "(vector<Tensor>) The embedding tables, one per slot, which are "
+             "learnable parameters.")
+        .AsDuplicable();
+    AddInput("Ids",
+             "(vector<LoDTensor>) The int64 ids of every slot, looked up in "
+             "the W of the same position. The last dimension size must be 1 "
+             "and the LoD level must be 1.")
+        .AsDuplicable();
+    AddInput("PerSampleWeight",
+             "(vector<LoDTensor>, optional) A weight for every id, with the "
+             "same shape and LoD as the Ids of the same position.")
+        .AsDuplicable()
+        .AsDispensable();
+    AddOutput("Out", "(vector<LoDTensor>) The pooled embeddings of every slot.")
+        .AsDuplicable();
+    AddAttr<std::string>("combiner",
+                         "(string, default sum) "
+                         "The pooling of every slot: sum, mean or sqrt.")
+        .SetDefault("sum")
+        .InEnum({"sum", "mean", "sqrt"});
+    AddAttr<int64_t>("padding_idx",
+                     "(int64, default -1) "
+                     "If the value is -1, it makes no effect to lookup. "
+                     "Otherwise the given id is skipped by the pooling.")
+        .SetDefault(-1);
+    AddAttr<bool>("is_sparse",
+                  "(boolean, default false) "
+                  "Sparse update.")
+        .SetDefault(false);
+    AddAttr<bool>(framework::kAllKernelsMustComputeRuntimeShape,
+                  "Skip calling InferShape() function in the runtime.")
+        .SetDefault(true);
+    AddComment(R"DOC(
+FusedMultiEmbeddingSeqPool Operator.
+
+Runs fused_embedding_seq_pool on several (W, Ids) slots at once. The slots
+are independent and are spread across the CPU threads, in both the forward
+and the backward pass.
+
+)DOC");
+  }
+};
+
+class FusedMultiEmbeddingSeqPoolOpGrad
+    : public framework::OperatorWithKernel {
+ public:
+  using framework::OperatorWithKernel::OperatorWithKernel;
+
+  void InferShape(framework::InferShapeContext* ctx) const override {
+    ctx->SetOutputsDim(framework::GradVarName("W"), ctx->GetInputsDim("W"));
+  }
+
+ protected:
+  framework::OpKernelType GetExpectedKernelType(
+      const framework::ExecutionContext& ctx) const override {
+    auto data_type = OperatorWithKernel::IndicateVarDataType(ctx, "W");
+    return framework::OpKernelType(data_type, ctx.device_context());
+  }
+};
+
+class FusedMultiEmbeddingSeqPoolOpGradVarTypeInference
+    : public framework::VarTypeInference {
+ public:
+  void operator()(framework::InferVarTypeContext* ctx) const override {
+    auto out_var_name = framework::GradVarName("W");
+    bool is_sparse = BOOST_GET(bool, ctx->GetAttr("is_sparse"));
+    auto var_type = is_sparse ? framework::proto::VarType::SELECTED_ROWS
+                              : framework::proto::VarType::LOD_TENSOR;
+    ctx->SetOutputType(out_var_name, var_type, framework::ALL_ELEMENTS);
+    ctx->SetOutputDataType(out_var_name, ctx->GetInputDataType("W"),
+                           framework::ALL_ELEMENTS);
+  }
+};
+
+template <typename T>
+class FusedMultiEmbeddingSeqPoolGradOpMaker
+    : public framework::SingleGradOpMaker<T> {
+ public:
+  using framework::SingleGradOpMaker<T>::SingleGradOpMaker;
+
+ protected:
+  void Apply(GradOpPtr<T> op) const override {
+    op->SetType("fused_multi_embedding_seq_pool_grad");
+    op->SetInput("Ids", this->Input("Ids"));
+    op->SetInput("W", this->Input("W"));
+    op->SetInput("PerSampleWeight", this->Input("PerSampleWeight"));
+    op->SetInput(framework::GradVarName("Out"), this->OutputGrad("Out"));
+    op->SetOutput(framework::GradVarName("W"), this->InputGrad("W", false));
+    op->SetAttrMap(this->Attrs());
+  }
+};
+
+template <typename T>
+std::vector<EmbeddingBagSlot<T>> MakeEmbeddingBagSlots(
+    const framework::ExecutionContext& context) {
+  auto tables = context.MultiInput<LoDTensor>("W");
+  auto ids = context.MultiInput<LoDTensor>("Ids");
+  auto weights = context.MultiInput<LoDTensor>("PerSampleWeight");
+  int64_t padding_idx = context.Attr<int64_t>("padding_idx");
+  PADDLE_ENFORCE_EQ(tables.size(), ids.size(),
+                    platform::errors::InvalidArgument(
+                        "The number of Input(W) should be equal to the number "
+                        "of Input(Ids). But received %d and %d.",
+                        tables.size(), ids.size()));
+  std::vector<EmbeddingBagSlot<T>> slots;
+  slots.reserve(ids.size());
+  for (size_t i = 0; i < ids.size(); ++i) {
+    const LoDTensor* weight = weights.empty() ? nullptr : weights[i];
+    slots.push_back(MakeEmbeddingBagSlot<T>(tables[i]->dims(),
+                                            tables[i]->data<T>(), *ids[i],
+                                            weight, padding_idx));
+    CheckEmbeddingBagIds(slots.back());
+  }
+  return slots;
+}
+
+template <typename T>
+class FusedMultiEmbeddingSeqPoolKernel : public framework::OpKernel<T> {
+ public:
+  void Compute(const framework::ExecutionContext& context) const override {
+    auto outs = context.MultiOutput<LoDTensor>("Out");
+    auto combiner =
+        GetEmbeddingBagCombiner(context.Attr<std::string>("combiner"));
+    auto slots = MakeEmbeddingBagSlots<T>(context);
+
+    std::vector<T*> out_data(slots.size());
+    for (size_t i = 0; i < slots.size(); ++i) {
+      outs[i]->Resize({static_cast<int64_t>(slots[i].num_seqs()),
+                       slots[i].out_width()});
+      out_data[i] = outs[i]->mutable_data<T>(context.GetPlace());
+    }
+    ParallelForEmbeddingBagSlots(slots.size(), [&](size_t i) {
+      EmbeddingBagForward(slots[i], combiner, out_data[i]);
+    });
+  }
+};
+
+template <typename T>
+class FusedMultiEmbeddingSeqPoolGradKernel : public framework::OpKernel<T> {
+ public:
+  void Compute(const framework::ExecutionContext& context) const override {
+    auto d_outs = context.MultiInput<LoDTensor>(framework::GradVarName("Out"));
+    auto combiner =
+        GetEmbeddingBagCombiner(context.Attr<std::string>("combiner"));
+    bool is_sparse = context.Attr<bool>("is_sparse");
+    auto slots = MakeEmbeddingBagSlots<T>(context);
+    const size_t num_slots = slots.size();
+
+    // Everything that allocates or may throw happens here, so the parallel
+    // region below only scatters gradients.
+    std::vector<EmbeddingBagGradRows> grad_rows(is_sparse ? num_slots : 0);
+    std::vector<T*> d_data(num_slots);
+    if (is_sparse) {
+      auto d_tables = context.MultiOutput<phi::SelectedRows>(
+          framework::GradVarName("W"));
+      for (size_t i = 0; i < num_slots; ++i) {
+        BuildEmbeddingBagGradRows(slots[i], &grad_rows[i]);
+        if (d_tables[i] == nullptr) continue;
+        d_tables[i]->set_height(slots[i].table_height);
+        d_tables[i]->set_rows(grad_rows[i].rows);
+        auto* d_value = d_tables[i]->mutable_value();
+        d_value->Resize(
+            {static_cast<int64_t>(grad_rows[i].rows.size()),
+             slots[i].table_width});
+        d_data[i] = d_value->mutable_data<T>(context.GetPlace());
+      }
+    } else {
+      auto d_tables =
+          context.MultiOutput<LoDTensor>(framework::GradVarName("W"));
+      for (size_t i = 0; i < num_slots; ++i) {
+        if (d_tables[i] == nullptr) continue;
+        d_tables[i]->Resize({slots[i].table_height, slots[i].table_width});
+        d_data[i] = d_tables[i]->mutable_data<T>(context.GetPlace());
+      }
+    }
+
+    ParallelForEmbeddingBagSlots(num_slots, [&](size_t i) {
+      if (d_data[i] == nullptr) return;
+      EmbeddingBagBackward(slots[i], combiner, d_outs[i]->data<T>(),
+                           is_sparse ? &grad_rows[i] : nullptr, d_data[i]);
+    });
+  }
+};
+
+}  // namespace operators
+}  // namespace paddle
+
+namespace ops = paddle::operators;
+
+REGISTER_OPERATOR(
+    fused_multi_embedding_seq_pool, ops::FusedMultiEmbeddingSeqPoolOp,
+    ops::FusedMultiEmbeddingSeqPoolGradOpMaker<paddle::framework::OpDesc>,
+    ops::FusedMultiEmbeddingSeqPoolGradOpMaker<paddle::imperative::OpBase>,
+    ops::FusedMultiEmbeddingSeqPoolOpMaker);
+REGISTER_OPERATOR(fused_multi_embedding_seq_pool_grad,
+                  ops::FusedMultiEmbeddingSeqPoolOpGrad,
+                  ops::FusedMultiEmbeddingSeqPoolOpGradVarTypeInference);
+
+REGISTER_OP_CPU_KERNEL(fused_multi_embedding_seq_pool,
+                       ops::FusedMultiEmbeddingSeqPoolKernel<float>,
+                       ops::FusedMultiEmbeddingSeqPoolKernel<double>);
+REGISTER_OP_CPU_KERNEL(fused_multi_embedding_seq_pool_grad,
+                       ops::FusedMultiEmbeddingSeqPoolGradKernel<float>,
+                       ops::FusedMultiEmbeddingSeqPoolGradKernel<double>);
@@ -0,0 +1,196 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/fluid/operators/fused/weight_only_fc_op.h"
+#include <string>
+#include <vector>
+#include "paddle/fluid/operators/jit/kernels.h"
+
+namespace paddle {
+namespace operators {
+
+static framework::DDim WeightOnlyFCOutputDims(const framework::DDim& in_dims,
+                                              const framework::DDim& w_dims,
+                                              const framework::DDim& s_dims,
+                                              int in_num_col_dims,
+                                              int weight_bits,
+                                              int group_size) {
+  PADDLE_ENFORCE_EQ(
+      weight_bits == 8 || weight_bits == 4, true,
+      platform::errors::InvalidArgument(
+          "The weight_bits of weight_only_fc should be 8 or 4, but received "
+          "%d.",
+          weight_bits));
+  PADDLE_ENFORCE_GT(group_size, 0,
+                    platform::errors::InvalidArgument(
+                        "The group_size of weight_only_fc should be greater "
+                        "than 0, but received %d.",
+                        group_size));
+  PADDLE_ENFORCE_EQ(w_dims.size(), 2,
+                    platform::errors::InvalidArgument(
+                        "The weight of weight_only_fc should be a 2-D tensor, "
+                        "but received its shape %s.",
+                        w_dims));
+  auto in_mat_dims = phi::flatten_to_2d(in_dims, in_num_col_dims);
+  int64_t k = in_mat_dims[1];
+  int64_t packed_k = weight_bits == 8 ? k : (k + 1) / 2;
+  PADDLE_ENFORCE_EQ(
+      w_dims[1], packed_k,
+      platform::errors::InvalidArgument(
+          "The weight of weight_only_fc should have %d columns for the "
+          "input's shape %s and %d bits, but received its shape %s.",
+          packed_k, in_mat_dims, weight_bits, w_dims));
+  int64_t num_groups = (k + group_size - 1) / group_size;
+  PADDLE_ENFORCE_EQ(
+      s_dims, phi::make_ddim({w_dims[0], num_groups}),
+      platform::errors::InvalidArgument(
+          "The shape of WScale of weight_only_fc should be [%d, %d], but "
+          "received %s.",
+          w_dims[0], num_groups, s_dims));
+
+  std::vector<int64_t> out_dims;
+  for (int i = 0; i < in_num_col_dims; ++i) {
+    out_dims.push_back(in_dims[i]);
+  }
+  out_dims.push_back(w_dims[0]);
+  return phi::make_ddim(out_dims);
+}
+
+void WeightOnlyFCOp::InferShape(framework::InferShapeContext* ctx) const {
+  OP_INOUT_CHECK(ctx->HasInput("Input"), "Input", "Input", "WeightOnlyFC");
+  OP_INOUT_CHECK(ctx->HasInput("W"), "Input", "W", "WeightOnlyFC");
+  OP_INOUT_CHECK(ctx->HasInput("WScale"), "Input", "WScale", "WeightOnlyFC");
+  OP_INOUT_CHECK(ctx->HasOutput("Out"), "Output", "Out", "WeightOnlyFC");
+
+  auto w_dims = ctx->GetInputDim("W");
+  if (ctx->HasInput("Bias")) {
+    auto bias_dims = ctx->GetInputDim("Bias");
+    PADDLE_ENFORCE_EQ(phi::product(bias_dims), w_dims[0],
+                      platform::errors::InvalidArgument(
+                          "The Bias of weight_only_fc should have %d "
+                          "elements, but received its shape %s.",
+                          w_dims[0], bias_dims));
+  }
+  auto out_dims = WeightOnlyFCOutputDims(
+      ctx->GetInputDim("Input"), w_dims, ctx->GetInputDim("WScale"),
+      ctx->Attrs().Get<int>("in_num_col_dims"),
+      ctx->Attrs().Get<int>("weight_bits"),
+      ctx->Attrs().Get<int>("group_size"));
+  ctx->SetOutputDim("Out", out_dims);
+  ctx->ShareLoD("Input", "Out");
+}
+
+framework::OpKernelType WeightOnlyFCOp::GetExpectedKernelType(
+    const framework::ExecutionContext& ctx) const {
+  return framework::OpKernelType(
+      OperatorWithKernel::IndicateVarDataType(ctx, "Input"), ctx.GetPlace());
+}
+
+void WeightOnlyFCOpMaker::Make() {
+  AddInput("Input", "(LoDTensor) The input tensor of this operator.");
+  AddInput("W",
+           "(Tensor) The quantized weight in int8 with shape (O, I), or "
+           "(O, (I + 1) / 2) with two int4 values in a byte, the lower "
+           "nibble first.");
+  AddInput("WScale",
+           "(Tensor) The scales to dequantize the weight with shape "
+           "(O, ceil(I / group_size)).");
+  AddInput("Bias", "(Tensor, optional) Bias vector with shape (1 x O).")
+      .AsDispensable();
+  AddOutput("Out", "(LoDTensor) The output tensor of this operator.");
+  AddAttr<int>("in_num_col_dims",
+               "(int, default 1), The dimensions of the input flattened to "
+               "the rows of the matrix multiplication.")
+      .SetDefault(1)
+      .EqualGreaterThan(1);
+  AddAttr<std::string>("activation_type", "The activation, relu or none.")
+      .SetDefault("")
+      .InEnum({"", "relu"});
+  AddAttr<int>("weight_bits", "(int, default 8), 8 or 4.").SetDefault(8);
+  AddAttr<int>("group_size",
+               "(int, default 1), The input channels sharing a scale, as "
+               "many as the input channels for a scale per output channel.")
+      .SetDefault(1);
+  AddAttr<bool>(framework::kAllKernelsMustComputeRuntimeShape,
+                "Skip calling InferShape() function in the runtime.")
+      .SetDefault(true);
+  AddComment(R"DOC(
+Weight Only FC Operator.
+
+Out = Act(Input * dequantize(W)^T + Bias), with the weight quantized to int8
+or int4 ahead of time and dequantized on the fly while multiplying, for
+memory-bound fc layers on CPU.
+)DOC");
+}
+
+template <typename T>
+class WeightOnlyFCKernel : public framework::OpKernel<T> {
+ public:
+  void Compute(const framework::ExecutionContext& ctx) const override {
+    auto* input = ctx.Input<LoDTensor>("Input");
+    auto* w = ctx.Input<Tensor>("W");
+    auto* w_scale = ctx.Input<Tensor>("WScale");
+    auto* bias = ctx.Input<Tensor>("Bias");
+    auto* out = ctx.Output<LoDTensor>("Out");
+    int in_num_col_dims = ctx.Attr<int>("in_num_col_dims");
+    int weight_bits = ctx.Attr<int>("weight_bits");
+    int group_size = ctx.Attr<int>("group_size");
+
+    out->Resize(WeightOnlyFCOutputDims(input->dims(), w->dims(),
+                                       w_scale->dims(), in_num_col_dims,
+                                       weight_bits, group_size));
+    out->set_lod(input->lod());
+    auto in_mat_dims = phi::flatten_to_2d(input->dims(), in_num_col_dims);
+    const jit::weight_only_matmul_attr_t attr(
+        in_mat_dims[0], w->dims()[0], in_mat_dims[1], weight_bits,
+        group_size);
+    T* out_data = out->mutable_data<T>(ctx.GetPlace());
+    auto matmul =
+        jit::KernelFuncs<jit::WeightOnlyMatMulTuple<T>,
+                         platform::CPUPlace>::Cache()
+            .At(attr);
+    matmul(input->data<T>(), w->data<int8_t>(), w_scale->data<T>(), out_data,
+           &attr);
+
+    bool with_relu = ctx.Attr<std::string>("activation_type") == "relu";
+    if (bias) {
+      auto add_bias =
+          with_relu ? jit::KernelFuncs<jit::VAddReluTuple<T>,
+                                       platform::CPUPlace>::Cache()
+                          .At(attr.n)
+                    : jit::KernelFuncs<jit::VAddTuple<T>,
+                                       platform::CPUPlace>::Cache()
+                          .At(attr.n);
+      const T* bias_data = bias->data<T>();
+      for (int i = 0; i < attr.m; ++i) {
+        T* dst = out_data + i * attr.n;
+        add_bias(bias_data, dst, dst, attr.n);
+      }
+    } else if (with_relu) {
+      auto relu =
+          jit::KernelFuncs<jit::VReluTuple<T>, platform::CPUPlace>::Cache()
+              .At(attr.m * attr.n);
+      relu(out_data, out_data, attr.m * attr.n);
+    }
+  }
+};
+
+}  // namespace operators
+}  // namespace paddle
+
+namespace ops = paddle::operators;
+REGISTER_OPERATOR(weight_only_fc, ops::WeightOnlyFCOp,
+                  ops::WeightOnlyFCOpMaker);
+
+REGISTER_OP_CPU_KERNEL(weight_only_fc, ops::WeightOnlyFCKernel<float>);
@@ -361,6 +361,42 @@ void BenchKernelSgd() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void BenchKernelSparseAdaGrad() {
+  using T = typename KernelTuple::data_type;
+  // the embeddings pushed to a sparse table in a batch
+  const int64_t num = 1024;
+  for (bool std_adagrad : {false, true}) {
+    for (int dim : {8, 9, 16, 64, 128}) {
+      const int g2sum_dim = std_adagrad ? dim : 1;
+      Tensor w, g2sum, grad, scale;
+      w.Resize({num * dim});
+      g2sum.Resize({num * g2sum_dim});
+      grad.Resize({num * dim});
+      scale.Resize({num});
+      T* w_data = w.mutable_data<T>(PlaceType());
+      T* g2sum_data = g2sum.mutable_data<T>(PlaceType());
+      T* grad_data = grad.mutable_data<T>(PlaceType());
+      RandomVec<T>(num * dim, w_data, -2.f, 2.f);
+      RandomVec<T>(num * g2sum_dim, g2sum_data, 0.f, 2.f);
+      RandomVec<T>(num * dim, grad_data, -2.f, 2.f);
+      RandomVec<T>(num, scale.mutable_data<T>(PlaceType()), 1.f, 3.f);
+      std::vector<T*> w_ptrs, g2sum_ptrs;
+      std::vector<const T*> grad_ptrs;
+      for (int64_t n = 0; n < num; ++n) {
+        w_ptrs.push_back(w_data + n * dim);
+        g2sum_ptrs.push_back(g2sum_data + n * g2sum_dim);
+        grad_ptrs.push_back(grad_data + n * dim);
+      }
+      const jit::sparse_adagrad_attr_t attr(dim, std_adagrad, 0.05f, 3.f,
+                                            -10.f, 10.f);
+      BenchAllImpls<KernelTuple, PlaceType>(
+          attr, w_ptrs.data(), g2sum_ptrs.data(), grad_ptrs.data(),
+          scale.data<T>(), num, &attr);
+    }
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void BenchKernelMatMul() {
   using T = typename KernelTuple::data_type;
@@ -384,6 +420,45 @@ void BenchKernelMatMul() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void BenchKernelWeightOnlyMatMul() {
+  using T = typename KernelTuple::data_type;
+  // Shapes of large fc layers, where the weight dominates the memory traffic.
+  const std::vector<std::pair<int, int>> nk = {
+      {1024, 1024}, {4096, 4096}, {11008, 4096}, {4096, 11008}};
+  for (int bits : {8, 4}) {
+    for (int m : {1, 4, 16}) {
+      for (auto& shape : nk) {
+        int n = shape.first;
+        int k = shape.second;
+        int group = bits == 8 ? k : 64;
+        int ldb = bits == 8 ? k : (k + 1) / 2;
+        int num_groups = (k + group - 1) / group;
+        Tensor a, b, scale, c;
+        a.Resize({m * k});
+        b.Resize({n * ldb});
+        scale.Resize({n * num_groups});
+        c.Resize({m * n});
+        RandomVec<T>(m * k, a.mutable_data<T>(PlaceType()), -2.f, 2.f);
+        RandomVec<T>(n * num_groups, scale.mutable_data<T>(PlaceType()),
+                     0.001f, 0.02f);
+        int8_t* b_data = b.mutable_data<int8_t>(PlaceType());
+        std::mt19937 rng(100);
+        for (int i = 0; i < n * ldb; ++i) {
+          b_data[i] = static_cast<int8_t>(rng());
+        }
+        const T* a_data = a.data<T>();
+        const T* scale_data = scale.data<T>();
+        T* c_data = c.mutable_data<T>(PlaceType());
+        const jit::weight_only_matmul_attr_t attr{m, n, k, bits, group};
+        BenchAllImpls<KernelTuple, PlaceType>(attr, a_data,
+                                              b.data<int8_t>(), scale_data,
+                                              c_data, &attr);
+      }
+    }
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void BenchKernelSoftmax() {
   using T = typename KernelTuple::data_type;
@@ -556,8 +631,10 @@ BENCH_FP32_CPU(CRFDecoding);
 BENCH_FP32_CPU(SeqPool);
 BENCH_FP32_CPU(EmbSeqPool);
 BENCH_FP32_CPU(MatMul);
+BENCH_FP32_CPU(WeightOnlyMatMul);
 BENCH_FP32_CPU(Softmax);
 BENCH_FP32_CPU(Sgd);
+BENCH_FP32_CPU(SparseAdaGrad);
 BENCH_FP32_CPU(VBroadcast);
 
 // Benchmark all jit kernels including jitcode, mkl and refer.
@@ -288,11 +288,28 @@ inline std::ostream& operator<<(std::ostream& os, const sgd_attr_t& attr) {
   return os;
 }
 
+inline std::ostream& operator<<(std::ostream& os,
+                                const sparse_adagrad_attr_t& attr) {
+  os << "dim[" << attr.dim << "],std_adagrad[" << attr.std_adagrad
+     << "],learning_rate[" << attr.learning_rate << "],initial_g2sum["
+     << attr.initial_g2sum << "],bounds[" << attr.min_bound << ","
+     << attr.max_bound << "]";
+  return os;
+}
+
 inline std::ostream& operator<<(std::ostream& os, const matmul_attr_t& attr) {
   os << "M[" << attr.m << "],N[" << attr.n << "],K[" << attr.k << "]";
   return os;
 }
 
+inline std::ostream& operator<<(std::ostream& os,
+                                const weight_only_matmul_attr_t& attr) {
+  os << "M[" << attr.m << "],N[" << attr.n << "],K[" << attr.k
+     << "],weight_bits[" << attr.weight_bits << "],group_size["
+     << attr.group_size << "]";
+  return os;
+}
+
 // expose the method to pack matmul weight
 template <typename T>
 void pack_weights(const T* src, T* dst, int n, int k);
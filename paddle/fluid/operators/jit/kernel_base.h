@@ -39,6 +39,7 @@ typedef enum {
   kNCHW16CMulNC,
   kSeqPool,
   kSoftmax,
+  kSparseAdaGrad,
   kStrideASum,
   kStrideScal,
   kVAdd,
@@ -56,6 +57,7 @@ typedef enum {
   kVSquare,
   kVSub,
   kVTanh,
+  kWeightOnlyMatMul,
 } KernelType;
 
 typedef enum {
@@ -301,6 +303,64 @@ struct MatMulTuple {
   typedef void (*func_type)(const T*, const T*, T*, const matmul_attr_t*);
 };
 
+// The weight is quantized to int8 per row, or to int4 with two values
+// packed in a byte, the lower nibble first, and a scale for every
+// group_size columns of each row.
+typedef struct weight_only_matmul_attr_s {
+  int m, n, k;
+  int weight_bits;
+  int group_size;
+  weight_only_matmul_attr_s() = default;
+  explicit weight_only_matmul_attr_s(int m_, int n_, int k_, int weight_bits_,
+                                     int group_size_)
+      : m(m_),
+        n(n_),
+        k(k_),
+        weight_bits(weight_bits_),
+        group_size(group_size_) {}
+} weight_only_matmul_attr_t;
+
+// A(M,K) * dequantized B(N,K)^T = C(M,N), with the scales of B in
+// (N, ceil(K/group_size)).
+template <typename T>
+struct WeightOnlyMatMulTuple {
+  static constexpr KernelType kernel_type = kWeightOnlyMatMul;
+  typedef T data_type;
+  typedef weight_only_matmul_attr_t attr_type;
+  typedef void (*func_type)(const T*, const int8_t*, const T*, T*,
+                            const weight_only_matmul_attr_t*);
+};
+
+// The AdaGrad of the sparse embeddings, with a g2sum per embedding, or per
+// dimension of the embedding with std_adagrad.
+typedef struct sparse_adagrad_attr_s {
+  int dim;
+  bool std_adagrad;
+  float learning_rate, initial_g2sum;
+  float min_bound, max_bound;
+  sparse_adagrad_attr_s() = default;
+  explicit sparse_adagrad_attr_s(int dim_, bool std_adagrad_,
+                                 float learning_rate_, float initial_g2sum_,
+                                 float min_bound_, float max_bound_)
+      : dim(dim_),
+        std_adagrad(std_adagrad_),
+        learning_rate(learning_rate_),
+        initial_g2sum(initial_g2sum_),
+        min_bound(min_bound_),
+        max_bound(max_bound_) {}
+} sparse_adagrad_attr_t;
+
+// Updates num embeddings w[i] in place with their grads grad[i] divided by
+// scale[i], and their g2sums g2sum[i].
+template <typename T>
+struct SparseAdaGradTuple {
+  static constexpr KernelType kernel_type = kSparseAdaGrad;
+  typedef T data_type;
+  typedef sparse_adagrad_attr_t attr_type;
+  typedef void (*func_type)(T**, T**, const T**, const T*, int64_t,
+                            const sparse_adagrad_attr_t*);
+};
+
 template <typename T>
 struct CRFDecodingTuple {
   static constexpr KernelType kernel_type = kCRFDecoding;
@@ -53,6 +53,18 @@ int64_t JitCodeKey<matmul_attr_t>(const matmul_attr_t& attr) {
   return XXH64(&attr, sizeof(int) * 3, 0);  // m, n, k
 }
 
+template <>
+int64_t JitCodeKey<weight_only_matmul_attr_t>(
+    const weight_only_matmul_attr_t& attr) {
+  int keys[3] = {attr.k, attr.weight_bits, attr.group_size};
+  return XXH64(keys, sizeof(int) * 3, 0);
+}
+
+template <>
+int64_t JitCodeKey<sparse_adagrad_attr_t>(const sparse_adagrad_attr_t& attr) {
+  return (static_cast<int64_t>(attr.dim) << 1) + attr.std_adagrad;
+}
+
 template <>
 int64_t JitCodeKey<emb_seq_pool_attr_t>(const emb_seq_pool_attr_t& attr) {
   return attr.table_width;
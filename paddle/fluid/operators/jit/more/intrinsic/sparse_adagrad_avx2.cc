@@ -0,0 +1,132 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/fluid/operators/jit/more/intrinsic/sparse_adagrad.h"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include <cmath>
+#include "paddle/fluid/platform/cpu_info.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace more {
+namespace intrinsic {
+
+#ifdef __AVX2__
+namespace {
+
+inline float HSum(__m256 x) {
+  __m128 sum =
+      _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+  return _mm_cvtss_f32(sum);
+}
+
+// max_ps returns its second operand for a NaN, so a NaN weight is bounded
+// to the min bound as by the rules.
+inline __m256 Bound(__m256 w, __m256 min_bound, __m256 max_bound) {
+  return _mm256_min_ps(_mm256_max_ps(w, min_bound), max_bound);
+}
+
+inline float Bound(float w, const sparse_adagrad_attr_t* attr) {
+  if (!(w >= attr->min_bound)) {
+    return attr->min_bound;
+  } else if (!(w <= attr->max_bound)) {
+    return attr->max_bound;
+  }
+  return w;
+}
+
+}  // namespace
+
+void SparseAdaGradAVX2(float** w, float** g2sum, const float** grad,
+                       const float* scale, int64_t num,
+                       const sparse_adagrad_attr_t* attr) {
+  const int dim = attr->dim;
+  const int end = dim & ~7;
+  const float lr = attr->learning_rate;
+  const float initial_g2sum = attr->initial_g2sum;
+  const __m256 min_bound = _mm256_set1_ps(attr->min_bound);
+  const __m256 max_bound = _mm256_set1_ps(attr->max_bound);
+  const __m256 initial = _mm256_set1_ps(initial_g2sum);
+  for (int64_t n = 0; n < num; ++n) {
+    float* pw = w[n];
+    float* pg2sum = g2sum[n];
+    const float* pgrad = grad[n];
+    const __m256 grad_scale = _mm256_set1_ps(scale[n]);
+    if (attr->std_adagrad) {
+      const __m256 rate = _mm256_set1_ps(lr);
+      for (int i = 0; i < end; i += 8) {
+        __m256 g = _mm256_div_ps(_mm256_loadu_ps(pgrad + i), grad_scale);
+        __m256 g2 = _mm256_loadu_ps(pg2sum + i);
+        __m256 decay = _mm256_sqrt_ps(
+            _mm256_div_ps(initial, _mm256_add_ps(initial, g2)));
+        __m256 x = _mm256_sub_ps(_mm256_loadu_ps(pw + i),
+                                 _mm256_mul_ps(_mm256_mul_ps(rate, g), decay));
+        _mm256_storeu_ps(pw + i, Bound(x, min_bound, max_bound));
+        _mm256_storeu_ps(pg2sum + i, _mm256_add_ps(g2, _mm256_mul_ps(g, g)));
+      }
+      for (int i = end; i < dim; ++i) {
+        float g = pgrad[i] / scale[n];
+        float decay = std::sqrt(initial_g2sum / (initial_g2sum + pg2sum[i]));
+        pw[i] = Bound(pw[i] - lr * g * decay, attr);
+        pg2sum[i] += g * g;
+      }
+    } else {
+      // the g2sum of the embedding is updated after all its dimensions
+      const float decayed_lr =
+          lr * std::sqrt(initial_g2sum / (initial_g2sum + pg2sum[0]));
+      const __m256 rate = _mm256_set1_ps(decayed_lr);
+      __m256 sum = _mm256_setzero_ps();
+      for (int i = 0; i < end; i += 8) {
+        __m256 g = _mm256_div_ps(_mm256_loadu_ps(pgrad + i), grad_scale);
+        __m256 x =
+            _mm256_sub_ps(_mm256_loadu_ps(pw + i), _mm256_mul_ps(rate, g));
+        _mm256_storeu_ps(pw + i, Bound(x, min_bound, max_bound));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(g, g));
+      }
+      float add_g2sum = HSum(sum);
+      for (int i = end; i < dim; ++i) {
+        float g = pgrad[i] / scale[n];
+        pw[i] = Bound(pw[i] - decayed_lr * g, attr);
+        add_g2sum += g * g;
+      }
+      pg2sum[0] += add_g2sum / dim;
+    }
+  }
+}
+
+bool SparseAdaGradAVX2Kernel::CanBeUsed(
+    const sparse_adagrad_attr_t& attr) const {
+  return platform::MayIUse(platform::avx2);
+}
+#else
+void SparseAdaGradAVX2(float** w, float** g2sum, const float** grad,
+                       const float* scale, int64_t num,
+                       const sparse_adagrad_attr_t* attr) {}
+
+bool SparseAdaGradAVX2Kernel::CanBeUsed(
+    const sparse_adagrad_attr_t& attr) const {
+  return false;
+}
+#endif
+
+}  // namespace intrinsic
+}  // namespace more
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
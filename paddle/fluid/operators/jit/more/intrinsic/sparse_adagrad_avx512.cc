@@ -0,0 +1,103 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/fluid/operators/jit/more/intrinsic/sparse_adagrad.h"
+#ifdef __AVX512F__
+#include <immintrin.h>
+#endif
+#include <cmath>
+#include "paddle/fluid/platform/cpu_info.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace more {
+namespace intrinsic {
+
+#ifdef __AVX512F__
+namespace {
+
+// max_ps returns its second operand for a NaN, so a NaN weight is bounded
+// to the min bound as by the rules.
+inline __m512 Bound(__m512 w, __m512 min_bound, __m512 max_bound) {
+  return _mm512_min_ps(_mm512_max_ps(w, min_bound), max_bound);
+}
+
+}  // namespace
+
+void SparseAdaGradAVX512(float** w, float** g2sum, const float** grad,
+                         const float* scale, int64_t num,
+                         const sparse_adagrad_attr_t* attr) {
+  const int dim = attr->dim;
+  const float lr = attr->learning_rate;
+  const float initial_g2sum = attr->initial_g2sum;
+  const __m512 min_bound = _mm512_set1_ps(attr->min_bound);
+  const __m512 max_bound = _mm512_set1_ps(attr->max_bound);
+  const __m512 initial = _mm512_set1_ps(initial_g2sum);
+  for (int64_t n = 0; n < num; ++n) {
+    float* pw = w[n];
+    float* pg2sum = g2sum[n];
+    const float* pgrad = grad[n];
+    const __m512 grad_scale = _mm512_set1_ps(scale[n]);
+    if (attr->std_adagrad) {
+      const __m512 rate = _mm512_set1_ps(lr);
+      for (int i = 0; i < dim; i += 16) {
+        __m512 g = _mm512_div_ps(_mm512_loadu_ps(pgrad + i), grad_scale);
+        __m512 g2 = _mm512_loadu_ps(pg2sum + i);
+        __m512 decay = _mm512_sqrt_ps(
+            _mm512_div_ps(initial, _mm512_add_ps(initial, g2)));
+        __m512 x = _mm512_sub_ps(_mm512_loadu_ps(pw + i),
+                                 _mm512_mul_ps(_mm512_mul_ps(rate, g), decay));
+        _mm512_storeu_ps(pw + i, Bound(x, min_bound, max_bound));
+        _mm512_storeu_ps(pg2sum + i, _mm512_add_ps(g2, _mm512_mul_ps(g, g)));
+      }
+    } else {
+      // the g2sum of the embedding is updated after all its dimensions
+      const __m512 rate = _mm512_set1_ps(
+          lr * std::sqrt(initial_g2sum / (initial_g2sum + pg2sum[0])));
+      __m512 sum = _mm512_setzero_ps();
+      for (int i = 0; i < dim; i += 16) {
+        __m512 g = _mm512_div_ps(_mm512_loadu_ps(pgrad + i), grad_scale);
+        __m512 x =
+            _mm512_sub_ps(_mm512_loadu_ps(pw + i), _mm512_mul_ps(rate, g));
+        _mm512_storeu_ps(pw + i, Bound(x, min_bound, max_bound));
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(g, g));
+      }
+      pg2sum[0] += _mm512_reduce_add_ps(sum) / dim;
+    }
+  }
+}
+
+bool SparseAdaGradAVX512Kernel::CanBeUsed(
+    const sparse_adagrad_attr_t& attr) const {
+  // The masked stores of a tail stall the loads of the next embedding, the
+  // AVX2 kernel is faster on the dims of partial vectors.
+  return platform::MayIUse(platform::avx512f) && attr.dim % 16 == 0;
+}
+#else
+void SparseAdaGradAVX512(float** w, float** g2sum, const float** grad,
+                         const float* scale, int64_t num,
+                         const sparse_adagrad_attr_t* attr) {}
+
+bool SparseAdaGradAVX512Kernel::CanBeUsed(
+    const sparse_adagrad_attr_t& attr) const {
+  return false;
+}
+#endif
+
+}  // namespace intrinsic
+}  // namespace more
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
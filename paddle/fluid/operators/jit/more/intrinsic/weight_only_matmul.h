@@ -0,0 +1,55 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#pragma once
+
+#include <cstdint>
+
+#include "paddle/fluid/operators/jit/kernel_base.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace more {
+namespace intrinsic {
+
+// Each of them lives in its own file built with the instruction set, if the
+// compiler supports it, and can not be used otherwise.
+void WeightOnlyMatMulAVX2(const float* a, const int8_t* b, const float* scale,
+                          float* c, const weight_only_matmul_attr_t* attr);
+void WeightOnlyMatMulAVX512(const float* a, const int8_t* b,
+                            const float* scale, float* c,
+                            const weight_only_matmul_attr_t* attr);
+
+class WeightOnlyMatMulAVX512Kernel
+    : public KernelMore<WeightOnlyMatMulTuple<float>> {
+ public:
+  WeightOnlyMatMulAVX512Kernel() { this->func = WeightOnlyMatMulAVX512; }
+  bool CanBeUsed(const weight_only_matmul_attr_t& attr) const override;
+  const char* ImplType() const override { return "IntrinsicAVX512"; }
+};
+
+class WeightOnlyMatMulAVX2Kernel
+    : public KernelMore<WeightOnlyMatMulTuple<float>> {
+ public:
+  WeightOnlyMatMulAVX2Kernel() { this->func = WeightOnlyMatMulAVX2; }
+  bool CanBeUsed(const weight_only_matmul_attr_t& attr) const override;
+  const char* ImplType() const override { return "IntrinsicAVX2"; }
+};
+
+}  // namespace intrinsic
+}  // namespace more
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
@@ -0,0 +1,180 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/fluid/operators/jit/more/intrinsic/weight_only_matmul.h"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "paddle/fluid/platform/cpu_info.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace more {
+namespace intrinsic {
+
+#ifdef __AVX2__
+namespace {
+
+// Rows of A multiplied with each dequantized vector of B.
+constexpr int kRowBlock = 4;
+// Bytes of B, in rows, all the rows of A go over before the next ones.
+constexpr int kColBlockBytes = 128 * 1024;
+
+// Columns [k, k + 16) of a row of B.
+template <int BITS>
+inline void Dequantize16(const int8_t* b, int k, __m256* lo, __m256* hi) {
+  if (BITS == 8) {
+    __m128i q = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + k));
+    *lo = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(q));
+    *hi = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(q, 8)));
+  } else {
+    __m128i q = _mm_cvtepu8_epi16(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + k / 2)));
+    __m128i even = _mm_srai_epi16(_mm_slli_epi16(q, 12), 12);
+    __m128i odd = _mm_srai_epi16(_mm_slli_epi16(q, 8), 12);
+    *lo = _mm256_cvtepi32_ps(
+        _mm256_cvtepi16_epi32(_mm_unpacklo_epi16(even, odd)));
+    *hi = _mm256_cvtepi32_ps(
+        _mm256_cvtepi16_epi32(_mm_unpackhi_epi16(even, odd)));
+  }
+}
+
+template <int BITS>
+inline int QuantizedAt(const int8_t* b, int k) {
+  if (BITS == 8) return b[k];
+  int8_t byte = b[k >> 1];
+  return (k & 1) ? (byte >> 4) : (static_cast<int8_t>(byte << 4) >> 4);
+}
+
+inline float HSum(__m256 v) {
+  __m128 s =
+      _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+}
+
+// ROWS rows of C at column n, from ROWS rows of A and row n of B.
+template <int BITS, int ROWS>
+void RowsDotColumn(const float* a, const int8_t* b, const float* scale,
+                   float* c, int n, const weight_only_matmul_attr_t* attr) {
+  const int k = attr->k;
+  const int group = attr->group_size;
+  __m256 total[ROWS];
+  for (int r = 0; r < ROWS; ++r) total[r] = _mm256_setzero_ps();
+  float rest[ROWS] = {0};
+  for (int begin = 0, g = 0; begin < k; begin += group, ++g) {
+    const int end = begin + group < k ? begin + group : k;
+    __m256 acc[ROWS];
+    for (int r = 0; r < ROWS; ++r) acc[r] = _mm256_setzero_ps();
+    int j = begin;
+    for (; j + 16 <= end; j += 16) {
+      __m256 lo, hi;
+      Dequantize16<BITS>(b, j, &lo, &hi);
+      for (int r = 0; r < ROWS; ++r) {
+        const float* pa = a + r * k + j;
+        acc[r] = _mm256_add_ps(acc[r], _mm256_mul_ps(_mm256_loadu_ps(pa), lo));
+        acc[r] =
+            _mm256_add_ps(acc[r], _mm256_mul_ps(_mm256_loadu_ps(pa + 8), hi));
+      }
+    }
+    for (; j < end; ++j) {
+      float q = static_cast<float>(QuantizedAt<BITS>(b, j)) * scale[g];
+      for (int r = 0; r < ROWS; ++r) rest[r] += a[r * k + j] * q;
+    }
+    __m256 s = _mm256_set1_ps(scale[g]);
+    for (int r = 0; r < ROWS; ++r) {
+      total[r] = _mm256_add_ps(total[r], _mm256_mul_ps(acc[r], s));
+    }
+  }
+  for (int r = 0; r < ROWS; ++r) {
+    c[r * attr->n + n] = HSum(total[r]) + rest[r];
+  }
+}
+
+template <int BITS>
+void WeightOnlyMatMulImpl(const float* a, const int8_t* b, const float* scale,
+                          float* c, const weight_only_matmul_attr_t* attr) {
+  const int m = attr->m;
+  const int n = attr->n;
+  const int k = attr->k;
+  const int ldb = BITS == 4 ? (k + 1) / 2 : k;
+  const int num_groups = (k + attr->group_size - 1) / attr->group_size;
+  int col_block = kColBlockBytes / ldb;
+  col_block = col_block < 1 ? 1 : col_block;
+  const int num_col_blocks = (n + col_block - 1) / col_block;
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for
+#endif
+  for (int cb = 0; cb < num_col_blocks; ++cb) {
+    const int col_begin = cb * col_block;
+    const int col_end = col_begin + col_block < n ? col_begin + col_block : n;
+    for (int i = 0; i < m; i += kRowBlock) {
+      const float* pa = a + i * k;
+      float* pc = c + i * n;
+      for (int j = col_begin; j < col_end; ++j) {
+        const int8_t* pb = b + j * ldb;
+        const float* ps = scale + j * num_groups;
+        switch (m - i < kRowBlock ? m - i : kRowBlock) {
+          case 1:
+            RowsDotColumn<BITS, 1>(pa, pb, ps, pc, j, attr);
+            break;
+          case 2:
+            RowsDotColumn<BITS, 2>(pa, pb, ps, pc, j, attr);
+            break;
+          case 3:
+            RowsDotColumn<BITS, 3>(pa, pb, ps, pc, j, attr);
+            break;
+          default:
+            RowsDotColumn<BITS, 4>(pa, pb, ps, pc, j, attr);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+void WeightOnlyMatMulAVX2(const float* a, const int8_t* b, const float* scale,
+                          float* c, const weight_only_matmul_attr_t* attr) {
+  if (attr->weight_bits == 4) {
+    WeightOnlyMatMulImpl<4>(a, b, scale, c, attr);
+  } else {
+    WeightOnlyMatMulImpl<8>(a, b, scale, c, attr);
+  }
+}
+
+bool WeightOnlyMatMulAVX2Kernel::CanBeUsed(
+    const weight_only_matmul_attr_t& attr) const {
+  // The groups should start at whole vectors.
+  return platform::MayIUse(platform::avx2) &&
+         (attr.weight_bits == 8 || attr.weight_bits == 4) &&
+         (attr.group_size >= attr.k || attr.group_size % 16 == 0);
+}
+#else
+void WeightOnlyMatMulAVX2(const float* a, const int8_t* b, const float* scale,
+                          float* c, const weight_only_matmul_attr_t* attr) {}
+
+bool WeightOnlyMatMulAVX2Kernel::CanBeUsed(
+    const weight_only_matmul_attr_t& attr) const {
+  return false;
+}
+#endif
+
+}  // namespace intrinsic
+}  // namespace more
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
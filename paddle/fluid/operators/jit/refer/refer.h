@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <string>
@@ -397,6 +398,43 @@ void MatMul(const T* A, const T* B, T* C, const matmul_attr_t* attr) {
   }
 }
 
+// The signed int4 at column k of a packed row.
+inline int Int4At(const int8_t* row, int k) {
+  int8_t byte = row[k >> 1];
+  return (k & 1) ? (byte >> 4) : (static_cast<int8_t>(byte << 4) >> 4);
+}
+
+// A(M,K) * dequantized B(N,K)^T = C(M,N)
+template <typename T>
+void WeightOnlyMatMul(const T* A, const int8_t* B, const T* scale, T* C,
+                      const weight_only_matmul_attr_t* attr) {
+  int M = attr->m;
+  int N = attr->n;
+  int K = attr->k;
+  int group = attr->group_size;
+  int num_groups = (K + group - 1) / group;
+  int ldb = attr->weight_bits == 4 ? (K + 1) / 2 : K;
+  for (int m = 0; m < M; ++m) {
+    const T* pa = A + m * K;
+    T* pc = C + m * N;
+    for (int n = 0; n < N; ++n) {
+      const int8_t* pb = B + n * ldb;
+      const T* ps = scale + n * num_groups;
+      T sum = static_cast<T>(0);
+      for (int g = 0; g < num_groups; ++g) {
+        int end = std::min(K, (g + 1) * group);
+        T group_sum = static_cast<T>(0);
+        for (int k = g * group; k < end; ++k) {
+          int q = attr->weight_bits == 4 ? Int4At(pb, k) : pb[k];
+          group_sum += pa[k] * static_cast<T>(q);
+        }
+        sum += group_sum * ps[g];
+      }
+      pc[n] = sum;
+    }
+  }
+}
+
 template <typename T>
 void HMax(const T* x, T* res, int n) {
   res[0] = x[0];
@@ -565,6 +603,40 @@ void Adam(T beta1, T beta2, T lr, T eps, int64_t numel, const T* grad_ptr,
   }
 }
 
+// The g2sum is read before the update of each dimension, and a shared g2sum
+// adds the mean of the squared grads after the whole embedding.
+template <typename T>
+void SparseAdaGrad(T** w, T** g2sum, const T** grad, const T* scale,
+                   int64_t num, const sparse_adagrad_attr_t* attr) {
+  const T lr = attr->learning_rate;
+  const T initial_g2sum = attr->initial_g2sum;
+  for (int64_t n = 0; n < num; ++n) {
+    T* pw = w[n];
+    T* pg2sum = g2sum[n];
+    const T* pgrad = grad[n];
+    double add_g2sum = 0;
+    for (int i = 0; i < attr->dim; ++i) {
+      T& g2 = attr->std_adagrad ? pg2sum[i] : pg2sum[0];
+      double scaled_grad = pgrad[i] / scale[n];
+      pw[i] -=
+          lr * scaled_grad * std::sqrt(initial_g2sum / (initial_g2sum + g2));
+      if (!(pw[i] >= attr->min_bound)) {
+        pw[i] = attr->min_bound;
+      } else if (!(pw[i] <= attr->max_bound)) {
+        pw[i] = attr->max_bound;
+      }
+      if (attr->std_adagrad) {
+        g2 += scaled_grad * scaled_grad;
+      } else {
+        add_g2sum += scaled_grad * scaled_grad;
+      }
+    }
+    if (!attr->std_adagrad) {
+      pg2sum[0] += add_g2sum / attr->dim;
+    }
+  }
+}
+
 #define DECLARE_REFER_KERNEL(name)                          \
   template <typename T>                                     \
   class name##Kernel : public ReferKernel<name##Tuple<T>> { \
@@ -614,10 +686,12 @@ DECLARE_REFER_KERNEL(LayerNorm);
 DECLARE_REFER_KERNEL(NCHW16CMulNC);
 DECLARE_REFER_KERNEL(SeqPool);
 DECLARE_REFER_KERNEL(MatMul);
+DECLARE_REFER_KERNEL(WeightOnlyMatMul);
 DECLARE_REFER_KERNEL(Softmax);
 DECLARE_REFER_KERNEL(EmbSeqPool);
 DECLARE_REFER_KERNEL(Adam);
 DECLARE_REFER_KERNEL(Sgd);
+DECLARE_REFER_KERNEL(SparseAdaGrad);
 DECLARE_REFER_KERNEL(VBroadcast);
 
 #undef DECLARE_REFER_KERNEL
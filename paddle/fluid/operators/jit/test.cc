@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include <iostream>
+#include <limits>
 #include <random>
 
 #include "gflags/gflags.h"
@@ -715,6 +716,78 @@ void TestKernelMatMul() {
   FLAGS_acc = last_acc;
 }
 
+template <typename KernelTuple, typename PlaceType>
+void TestKernelWeightOnlyMatMul() {
+  using T = typename KernelTuple::data_type;
+  VLOG(10) << "Test JITKernel: " << jit::to_string(KernelTuple::kernel_type);
+  auto last_acc = FLAGS_acc;
+  FLAGS_acc = 1e-3;
+  std::mt19937 rng(100);
+  for (int bits : {8, 4}) {
+    std::uniform_int_distribution<int> dist(bits == 8 ? -127 : -8,
+                                            bits == 8 ? 127 : 7);
+    for (int m : {1, 3, 4, 5}) {
+      for (int n : {1, 7, 16}) {
+        for (int k : {1, 15, 16, 33, 100, 256}) {
+          for (int group : {k, 16, 32}) {
+            if (group > k) continue;
+            const int ldb = bits == 8 ? k : (k + 1) / 2;
+            const int num_groups = (k + group - 1) / group;
+            std::vector<T> a(m * k), scale(n * num_groups), c(m * n);
+            std::vector<int> q(n * k);
+            std::vector<int8_t> b(n * ldb, 0);
+            RandomVec<T>(m * k, a.data());
+            RandomVec<T>(n * num_groups, scale.data(), 0.001, 0.02);
+            for (int j = 0; j < n * k; ++j) q[j] = dist(rng);
+            for (int j = 0; j < n; ++j) {
+              for (int l = 0; l < k; ++l) {
+                int v = q[j * k + l];
+                if (bits == 8) {
+                  b[j * ldb + l] = static_cast<int8_t>(v);
+                } else {
+                  b[j * ldb + l / 2] |=
+                      static_cast<int8_t>((v & 0xf) << (l % 2 * 4));
+                }
+              }
+            }
+            // C from the dequantized B.
+            std::vector<T> cref(m * n, static_cast<T>(0));
+            for (int i = 0; i < m; ++i) {
+              for (int j = 0; j < n; ++j) {
+                for (int l = 0; l < k; ++l) {
+                  cref[i * n + j] += a[i * k + l] *
+                                     static_cast<T>(q[j * k + l]) *
+                                     scale[j * num_groups + l / group];
+                }
+              }
+            }
+            auto ref = jit::GetReferFunc<KernelTuple>();
+            EXPECT_TRUE(ref != nullptr);
+            const jit::weight_only_matmul_attr_t attr{m, n, k, bits, group};
+            ref(a.data(), b.data(), scale.data(), c.data(), &attr);
+            ExpectEQ<T>(c.data(), cref.data(), m * n);
+
+            auto verifier = [](const typename KernelTuple::func_type tgt,
+                               const std::vector<T>& a,
+                               const std::vector<int8_t>& b,
+                               const std::vector<T>& scale,
+                               const std::vector<T>& cref,
+                               const typename KernelTuple::attr_type& attr) {
+              EXPECT_TRUE(tgt != nullptr);
+              std::vector<T> c(cref.size());
+              tgt(a.data(), b.data(), scale.data(), c.data(), &attr);
+              ExpectEQ<T>(c.data(), cref.data(), attr.m * attr.n);
+            };
+            TestAllImpls<KernelTuple, PlaceType>(attr, verifier, a, b, scale,
+                                                 c, attr);
+          }
+        }
+      }
+    }
+  }
+  FLAGS_acc = last_acc;
+}
+
 template <typename KernelTuple, typename PlaceType>
 void TestKernelSoftmax() {
   using T = typename KernelTuple::data_type;
@@ -1005,6 +1078,73 @@ void TestKernelSgd() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void TestKernelSparseAdaGrad() {
+  using T = typename KernelTuple::data_type;
+  VLOG(10) << "Test JITKernel: " << jit::to_string(KernelTuple::kernel_type);
+  // the vector kernels sum the squared grads in float
+  auto last_acc = FLAGS_acc;
+  FLAGS_acc = 1e-4;
+  const int64_t num = 5;
+  for (bool std_adagrad : {false, true}) {
+    for (int dim : {1, 7, 8, 9, 16, 17, 33, 64}) {
+      const int g2sum_dim = std_adagrad ? dim : 1;
+      std::vector<T> w(num * dim), g2sum(num * g2sum_dim), grad(num * dim);
+      std::vector<T> scale(num);
+      RandomVec<T>(num * dim, w.data(), -0.6f, 0.6f);
+      RandomVec<T>(num * g2sum_dim, g2sum.data(), 0.f, 2.f);
+      RandomVec<T>(num * dim, grad.data());
+      RandomVec<T>(num, scale.data(), 1.f, 3.f);
+      // the weights out of the bounds and NaN are bounded
+      w[0] = std::numeric_limits<T>::quiet_NaN();
+      const jit::sparse_adagrad_attr_t attr(dim, std_adagrad, 0.05f, 3.f,
+                                            -0.5f, 0.5f);
+
+      auto update = [num, dim, g2sum_dim](
+          const typename KernelTuple::func_type func,
+          const jit::sparse_adagrad_attr_t& attr, std::vector<T>* w,
+          std::vector<T>* g2sum, const std::vector<T>& grad,
+          const std::vector<T>& scale) {
+        std::vector<T*> w_ptrs, g2sum_ptrs;
+        std::vector<const T*> grad_ptrs;
+        for (int64_t n = 0; n < num; ++n) {
+          w_ptrs.push_back(w->data() + n * dim);
+          g2sum_ptrs.push_back(g2sum->data() + n * g2sum_dim);
+          grad_ptrs.push_back(grad.data() + n * dim);
+        }
+        func(w_ptrs.data(), g2sum_ptrs.data(), grad_ptrs.data(), scale.data(),
+             num, &attr);
+      };
+      auto ref = jit::GetReferFunc<KernelTuple>();
+      EXPECT_TRUE(ref != nullptr);
+      std::vector<T> wref(w), g2sumref(g2sum);
+      update(ref, attr, &wref, &g2sumref, grad, scale);
+      EXPECT_EQ(wref[0], static_cast<T>(-0.5));
+      for (auto v : wref) {
+        EXPECT_TRUE(v >= static_cast<T>(-0.5) && v <= static_cast<T>(0.5));
+      }
+
+      auto verifier = [update](const typename KernelTuple::func_type tgt,
+                               const std::vector<T>& w,
+                               const std::vector<T>& g2sum,
+                               const std::vector<T>& grad,
+                               const std::vector<T>& scale,
+                               const std::vector<T>& wref,
+                               const std::vector<T>& g2sumref,
+                               const jit::sparse_adagrad_attr_t& attr) {
+        EXPECT_TRUE(tgt != nullptr);
+        std::vector<T> wtgt(w), g2sumtgt(g2sum);
+        update(tgt, attr, &wtgt, &g2sumtgt, grad, scale);
+        ExpectEQ<T>(wtgt.data(), wref.data(), wref.size());
+        ExpectEQ<T>(g2sumtgt.data(), g2sumref.data(), g2sumref.size());
+      };
+      TestAllImpls<KernelTuple, PlaceType>(attr, verifier, w, g2sum, grad,
+                                           scale, wref, g2sumref, attr);
+    }
+  }
+  FLAGS_acc = last_acc;
+}
+
 template <typename KernelTuple, typename PlaceType>
 void TestKernelVBroadcast() {
   using T = typename KernelTuple::data_type;
@@ -1462,9 +1602,11 @@ TEST_CPU_KERNEL(CRFDecoding);
 TEST_CPU_KERNEL(SeqPool);
 TEST_CPU_KERNEL(EmbSeqPool);
 TEST_CPU_KERNEL(MatMul);
+TEST_CPU_KERNEL(WeightOnlyMatMul);
 TEST_CPU_KERNEL(Softmax);
 TEST_CPU_KERNEL(Adam);
 TEST_CPU_KERNEL(Sgd);
+TEST_CPU_KERNEL(SparseAdaGrad);
 TEST_CPU_KERNEL(VBroadcast);
 
 TEST_CPU_KERNEL(StrideASum);
@@ -21,6 +21,7 @@ limitations under the License. */
 #include "paddle/fluid/framework/convert_utils.h"
 #include "paddle/fluid/framework/data_type.h"
 #include "paddle/fluid/framework/data_type_transform.h"
+#include "paddle/fluid/framework/mapped_params_file.h"
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/framework/string_array.h"
 #include "paddle/fluid/framework/tensor_util.h"
@@ -43,7 +44,9 @@ class LoadCombineOpKernel : public framework::OpKernel<T> {
                           "The number of variables to be loaded is %d, expect "
                           "it to be greater than 0.",
                           out_var_names.size()));
-    if (!model_from_memory) {
+    if (!model_from_memory && framework::IsMappedParamsFile(filename)) {
+      LoadMappedParams(ctx, place, filename, load_as_fp16, out_var_names);
+    } else if (!model_from_memory) {
       std::ifstream fin(filename, std::ios::binary);
       PADDLE_ENFORCE_EQ(
           static_cast<bool>(fin), true,
@@ -64,6 +67,52 @@ class LoadCombineOpKernel : public framework::OpKernel<T> {
     }
   }
 
+  // CPU tensors point into the mapped file instead of being copied, unless
+  // they are converted to float16.
+  void LoadMappedParams(const framework::ExecutionContext &context,
+                        const platform::Place &place,
+                        const std::string &filename, bool load_as_fp16,
+                        const std::vector<std::string> &out_var_names) const {
+    framework::MappedParamsFile file(filename);
+    auto out_vars = context.MultiOutputVar("Out");
+    for (size_t i = 0; i < out_var_names.size(); i++) {
+      VLOG(4) << "loading mapped tensor: " << out_var_names[i];
+      PADDLE_ENFORCE_NOT_NULL(
+          out_vars[i], platform::errors::InvalidArgument(
+                           "The variable %s to be loaded cannot be found.",
+                           out_var_names[i]));
+      PADDLE_ENFORCE_EQ(
+          out_vars[i]->IsType<framework::Vocab>(), false,
+          platform::errors::Unimplemented(
+              "Variable %s is a Vocab, which can not be loaded from the "
+              "mapped parameters file %s.",
+              out_var_names[i], filename));
+      auto *tensor = out_vars[i]->GetMutable<framework::LoDTensor>();
+      framework::LoDTensor mapped;
+      file.ShareTo(out_var_names[i], &mapped);
+      auto in_dtype = framework::TransToProtoVarType(mapped.dtype());
+      auto out_dtype =
+          load_as_fp16 ? framework::proto::VarType::FP16 : in_dtype;
+      if (in_dtype != out_dtype) {
+        auto in_kernel_type =
+            framework::OpKernelType(in_dtype, platform::CPUPlace());
+        auto out_kernel_type =
+            framework::OpKernelType(out_dtype, platform::CPUPlace());
+        framework::LoDTensor fp16_tensor;
+        fp16_tensor.set_lod(mapped.lod());
+        framework::TransDataType(in_kernel_type, out_kernel_type, mapped,
+                                 &fp16_tensor);
+        mapped = fp16_tensor;
+      }
+      if (platform::is_cpu_place(place)) {
+        tensor->ShareDataWith(mapped);
+        tensor->set_lod(mapped.lod());
+      } else {
+        framework::TensorCopySync(mapped, place, tensor);
+      }
+    }
+  }
+
   void LoadParamsFromBuffer(
       const framework::ExecutionContext &context, const platform::Place &place,
       std::istream *buffer, bool load_as_fp16,
@@ -13,12 +13,21 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include "paddle/fluid/operators/math/selected_rows_functor.h"
+
+#include <cstring>
+#include <numeric>
+
 #include "paddle/fluid/framework/mixed_vector.h"
+#include "paddle/fluid/operators/jit/kernels.h"
 #include "paddle/fluid/platform/device/device_wrapper.h"
+#include "paddle/phi/kernels/funcs/flat_hash_map.h"
 
 #ifdef PADDLE_WITH_MKLDNN
 #include "paddle/fluid/operators/mkldnn/axpy_handler.h"
 #endif
+#ifdef PADDLE_WITH_MKLML
+#include <omp.h>
+#endif
 
 namespace paddle {
 namespace operators {
@@ -356,15 +365,165 @@ typename std::enable_if<std::is_integral<T>::value>::type elementwise_add_to(
   }
 }
 
+// Where every input row goes in the merged output. Input rows are numbered
+// by their position in the concatenation of all inputs.
+struct MergedRowsIndex {
+  // The distinct rows, i.e. the rows of the merged output.
+  std::vector<int64_t> merged_rows;
+  // For every input row, the index of its row in merged_rows.
+  std::vector<int64_t> out_ids;
+  // For every merged row, the position of its first input row.
+  std::vector<int64_t> first_pos;
+};
+
+// Deduplicates the input rows with a flat hash map sized from the total
+// number of input rows. Without duplicates the rows keep their input order
+// unless sorted_result is set. Otherwise the distinct rows are sorted and the
+// ids are remapped, as the optimizers merging their gradients binary search
+// the merged rows.
+static void BuildMergedRowsIndex(
+    const std::vector<const phi::SelectedRows*>& inputs, size_t row_num,
+    bool sorted_result, MergedRowsIndex* index) {
+  phi::funcs::FlatHashMap<int64_t, int64_t> row_to_id(row_num);
+  auto& merged_rows = index->merged_rows;
+  auto& out_ids = index->out_ids;
+  auto& first_pos = index->first_pos;
+  merged_rows.clear();
+  first_pos.clear();
+  out_ids.resize(row_num);
+
+  int64_t pos = 0;
+  for (auto* input : inputs) {
+    for (int64_t row : input->rows()) {
+      bool inserted = false;
+      int64_t id = *row_to_id.Insert(
+          row, static_cast<int64_t>(merged_rows.size()), &inserted);
+      if (inserted) {
+        merged_rows.push_back(row);
+        first_pos.push_back(pos);
+      }
+      out_ids[pos++] = id;
+    }
+  }
+
+  if (sorted_result || merged_rows.size() != row_num) {
+    std::vector<int64_t> order(merged_rows.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&merged_rows](int64_t a, int64_t b) {
+                return merged_rows[a] < merged_rows[b];
+              });
+    std::vector<int64_t> new_id(order.size());
+    std::vector<int64_t> sorted_rows(order.size());
+    std::vector<int64_t> sorted_first_pos(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      new_id[order[i]] = static_cast<int64_t>(i);
+      sorted_rows[i] = merged_rows[order[i]];
+      sorted_first_pos[i] = first_pos[order[i]];
+    }
+    for (auto& id : out_ids) {
+      id = new_id[id];
+    }
+    merged_rows.swap(sorted_rows);
+    first_pos.swap(sorted_first_pos);
+  }
+}
+
+// out += in for one row of width elements.
+template <typename T>
+struct RowAdder {
+  explicit RowAdder(int64_t width) : width_(width) {}
+  void operator()(const T* in, T* out) const {
+    for (int64_t i = 0; i < width_; ++i) {
+      out[i] += in[i];
+    }
+  }
+  int64_t width_;
+};
+
+template <typename T>
+struct JitRowAdder {
+  explicit JitRowAdder(int64_t width)
+      : width_(static_cast<int>(width)),
+        vadd_(jit::KernelFuncs<jit::VAddTuple<T>, platform::CPUPlace>::Cache()
+                  .At(width_)) {}
+  void operator()(const T* in, T* out) const { vadd_(in, out, out, width_); }
+  int width_;
+  typename jit::VAddTuple<T>::func_type vadd_;
+};
+
+template <>
+struct RowAdder<float> : public JitRowAdder<float> {
+  explicit RowAdder(int64_t width) : JitRowAdder<float>(width) {}
+};
+
+template <>
+struct RowAdder<double> : public JitRowAdder<double> {
+  explicit RowAdder(int64_t width) : JitRowAdder<double>(width) {}
+};
+
+// Below this many input elements the merge runs on the calling thread.
+constexpr int64_t kParallelMergeNumel = 1 << 16;
+
+// Writes the sum of the input rows of every merged row to out_data. The first
+// input row of a merged row is copied instead of added, so out_data does not
+// need to be initialized. Merged rows are partitioned across threads by id,
+// and each thread visits the input rows in order, so the result does not
+// depend on the number of threads.
+template <typename T>
+void AccumulateMergedRows(const std::vector<const phi::SelectedRows*>& inputs,
+                          const MergedRowsIndex& index, int64_t input_width,
+                          T* out_data) {
+  std::vector<const T*> in_rows;
+  in_rows.reserve(index.out_ids.size());
+  for (auto* input : inputs) {
+    if (input->rows().size() == 0) {
+      continue;
+    }
+    auto* input_data = input->value().data<T>();
+    for (size_t i = 0; i < input->rows().size(); ++i) {
+      in_rows.push_back(input_data + i * input_width);
+    }
+  }
+
+  RowAdder<T> add_row(input_width);
+  const int64_t row_num = static_cast<int64_t>(in_rows.size());
+  const size_t row_bytes = input_width * sizeof(T);
+  int num_threads = 1;
+#ifdef PADDLE_WITH_MKLML
+  if (row_num * input_width >= kParallelMergeNumel) {
+    num_threads = std::min<int64_t>(omp_get_max_threads(),
+                                    index.merged_rows.size());
+  }
+#pragma omp parallel for num_threads(num_threads)
+#endif
+  for (int t = 0; t < num_threads; ++t) {
+    for (int64_t pos = 0; pos < row_num; ++pos) {
+      int64_t id = index.out_ids[pos];
+      if (id % num_threads != t) {
+        continue;
+      }
+      T* out_row = out_data + id * input_width;
+      if (index.first_pos[id] == pos) {
+        std::memcpy(out_row, in_rows[pos], row_bytes);
+      } else {
+        add_row(in_rows[pos], out_row);
+      }
+    }
+  }
+}
+
 template <typename T, typename DeviceContext>
 typename std::enable_if<std::is_same<T, platform::bfloat16>::value>::type
 add_sparse_inputs(const std::vector<const phi::SelectedRows*>& inputs,
-                  const std::unordered_map<int64_t, size_t>& rows_to_id,
-                  int64_t input_width, const DeviceContext& context,
-                  T* out_data) {
+                  const MergedRowsIndex& index, int64_t input_width,
+                  const DeviceContext& context, T* out_data) {
+  std::memset(out_data, 0,
+              index.merged_rows.size() * input_width * sizeof(T));
 #ifndef PADDLE_WITH_MKLDNN
   auto blas = phi::funcs::GetBlas<DeviceContext, T>(context);
 #endif
+  int64_t pos = 0;
   for (auto* input : inputs) {
     if (input->rows().size() == 0) {
       continue;
@@ -375,13 +534,13 @@ add_sparse_inputs(const std::vector<const phi::SelectedRows*>& inputs,
 #ifdef PADDLE_WITH_MKLDNN
     OneDNNAXPYHandler<T> axpy_handler(input_width, T(1.f));
     for (size_t i = 0; i < input_rows.size(); i++) {
-      size_t out_i = rows_to_id.at(input_rows[i]);
+      size_t out_i = index.out_ids[pos++];
       axpy_handler(&input_data[i * input_width],
                    &out_data[out_i * input_width]);
     }
 #else
     for (size_t i = 0; i < input_rows.size(); i++) {
-      size_t out_i = rows_to_id.at(input_rows[i]);
+      size_t out_i = index.out_ids[pos++];
       elementwise_add_to<T, DeviceContext>(
           &blas, static_cast<size_t>(input_width), &input_data[i * input_width],
           &out_data[out_i * input_width]);
@@ -393,25 +552,10 @@ add_sparse_inputs(const std::vector<const phi::SelectedRows*>& inputs,
 template <typename T, typename DeviceContext>
 typename std::enable_if<!std::is_same<T, platform::bfloat16>::value>::type
 add_sparse_inputs(const std::vector<const phi::SelectedRows*>& inputs,
-                  const std::unordered_map<int64_t, size_t>& rows_to_id,
-                  int64_t input_width, const DeviceContext& context,
-                  T* out_data) {
+                  const MergedRowsIndex& index, int64_t input_width,
+                  const DeviceContext& context, T* out_data) {
   VLOG(4) << "[CPU] add_sparse_inputs <" << typeid(T).name();
-  auto blas = phi::funcs::GetBlas<DeviceContext, T>(context);
-  for (auto* input : inputs) {
-    if (input->rows().size() == 0) {
-      continue;
-    }
-    auto* input_data = input->value().data<T>();
-    auto& input_rows = input->rows();
-
-    for (size_t i = 0; i < input_rows.size(); i++) {
-      size_t out_i = rows_to_id.at(input_rows[i]);
-      elementwise_add_to<T, DeviceContext>(
-          &blas, static_cast<size_t>(input_width), &input_data[i * input_width],
-          &out_data[out_i * input_width]);
-    }
-  }
+  AccumulateMergedRows<T>(inputs, index, input_width, out_data);
 }
 
 template <typename DeviceContext, typename T>
@@ -452,7 +596,6 @@ struct MergeAddImpl {
     auto input_width = has_value_input->value().dims()[1];
     auto input_height = has_value_input->height();
     phi::SelectedRows& out = *output;
-    std::set<int64_t> merged_row_set;
     size_t row_num = 0;
     for (auto* input : inputs) {
       if (input->rows().size() == 0) {
@@ -466,30 +609,28 @@ struct MergeAddImpl {
                         platform::errors::InvalidArgument(
                             "All inputs should have same height."));
       row_num += input->rows().size();
-      merged_row_set.insert(input->rows().begin(), input->rows().end());
     }
 
+    MergedRowsIndex index;
+    BuildMergedRowsIndex(inputs, row_num, sorted_result, &index);
+
     out.set_height(input_height);
     out.mutable_value()->mutable_data<T>(
         phi::make_ddim(
-            {static_cast<int64_t>(merged_row_set.size()), input_width}),
+            {static_cast<int64_t>(index.merged_rows.size()), input_width}),
         context.GetPlace());
     auto* out_data = out.mutable_value()->data<T>();
 
-    if (merged_row_set.size() == row_num && !sorted_result) {
+    if (index.merged_rows.size() == row_num && !sorted_result) {
       // no duplicated ids, just concat the result together
-      std::vector<int64_t> merge_rows;
-      merge_rows.reserve(row_num);
-      // concat rows
-      for (auto* in : inputs) {
-        merge_rows.insert(merge_rows.end(), in->rows().begin(),
-                          in->rows().end());
-      }
-      out.set_rows(merge_rows);
+      out.set_rows(index.merged_rows);
       auto in_place = inputs[0]->place();
       auto out_place = out.place();
       int64_t copied_numel = 0;
       for (auto* in : inputs) {
+        if (in->rows().size() == 0) {
+          continue;
+        }
         auto* in_data = in->value().data<T>();
         auto in_numel = in->rows().size() * input_width;
         memory::Copy(out_place, out_data + copied_numel, in_place, in_data,
@@ -497,25 +638,9 @@ struct MergeAddImpl {
         copied_numel += in_numel;
       }
     } else {
-      std::vector<int64_t> merge_rows(merged_row_set.begin(),
-                                      merged_row_set.end());
-
-      if (sorted_result) {
-        std::sort(merge_rows.begin(), merge_rows.end());
-      }
-
-      out.set_rows(merge_rows);
-
-      phi::funcs::SetConstant<DeviceContext, T> constant_functor;
-      constant_functor(context, out.mutable_value(), static_cast<T>(0.f));
-
-      std::unordered_map<int64_t, size_t> rows_to_id;
-      for (size_t i = 0; i < merge_rows.size(); ++i) {
-        rows_to_id[merge_rows[i]] = i;
-      }
-
-      add_sparse_inputs<T, DeviceContext>(inputs, rows_to_id, input_width,
-                                          context, out_data);
+      out.set_rows(index.merged_rows);
+      add_sparse_inputs<T, DeviceContext>(inputs, index, input_width, context,
+                                          out_data);
     }
   }
 };
@@ -760,7 +885,6 @@ struct MergeAverage<platform::CPUDeviceContext, T> {
     auto input_width = has_value_input->value().dims()[1];
     auto input_height = has_value_input->height();
     phi::SelectedRows& out = *output;
-    std::set<int64_t> merged_row_set;
     size_t row_num = 0;
     for (auto* input : inputs) {
       if (input->rows().size() == 0) {
@@ -774,45 +898,22 @@ struct MergeAverage<platform::CPUDeviceContext, T> {
                         platform::errors::InvalidArgument(
                             "All input should have same height."));
       row_num += input->rows().size();
-      merged_row_set.insert(input->rows().begin(), input->rows().end());
     }
 
+    MergedRowsIndex index;
+    BuildMergedRowsIndex(inputs, row_num, true, &index);
+    const auto& merge_rows = index.merged_rows;
+
     out.set_height(input_height);
     out.mutable_value()->mutable_data<T>(
-        phi::make_ddim(
-            {static_cast<int64_t>(merged_row_set.size()), input_width}),
+        phi::make_ddim({static_cast<int64_t>(merge_rows.size()), input_width}),
         context.GetPlace());
     auto* out_data = out.mutable_value()->data<T>();
 
-    std::vector<int64_t> merge_rows(merged_row_set.begin(),
-                                    merged_row_set.end());
-    std::sort(merge_rows.begin(), merge_rows.end());
-
     out.set_rows(merge_rows);
 
-    phi::funcs::SetConstant<platform::CPUDeviceContext, T> constant_functor;
-    constant_functor(context, out.mutable_value(), 0.0);
+    AccumulateMergedRows<T>(inputs, index, input_width, out_data);
 
-    std::unordered_map<int64_t, size_t> rows_to_id;
-    for (size_t i = 0; i < merge_rows.size(); ++i) {
-      rows_to_id[merge_rows[i]] = i;
-    }
-
-    auto blas = phi::funcs::GetBlas<platform::CPUDeviceContext, T>(context);
-    for (auto* input : inputs) {
-      if (input->rows().size() == 0) {
-        continue;
-      }
-      auto* input_data = input->value().data<T>();
-      auto& input_rows = input->rows();
-
-      for (size_t i = 0; i < input_rows.size(); i++) {
-        size_t out_i = rows_to_id[input_rows[i]];
-        elementwise_add_to<T>(&blas, static_cast<size_t>(input_width),
-                              &input_data[i * input_width],
-                              &out_data[out_i * input_width]);
-      }
-    }
     size_t input_width_cast = static_cast<size_t>(input_width);
     T count = static_cast<T>(inputs.size());
     for (size_t i = 0; i < merge_rows.size(); i++) {
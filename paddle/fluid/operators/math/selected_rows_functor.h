@@ -75,6 +75,8 @@ template <typename DeviceContext, typename T>
 struct MergeAdd {
   // unary functor, merge by adding duplicated rows in
   // the input SelectedRows object.
+  // On CPU the merged rows keep the order of their first occurrence in the
+  // inputs; set sorted_result if the consumer needs them in ascending order.
   phi::SelectedRows operator()(const DeviceContext& context,
                                const phi::SelectedRows& input,
                                const bool sorted_result = false);
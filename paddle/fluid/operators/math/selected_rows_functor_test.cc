@@ -14,6 +14,8 @@ limitations under the License. */
 
 #include "paddle/fluid/operators/math/selected_rows_functor.h"
 
+#include <set>
+
 #include "gtest/gtest.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
 
@@ -368,6 +370,60 @@ TEST(selected_rows_functor, cpu_merge_add_multi) {
   }
 }
 
+TEST(selected_rows_functor, cpu_merge_add_multi_unsorted) {
+  paddle::platform::CPUPlace cpu_place;
+  paddle::platform::CPUDeviceContext ctx(cpu_place);
+
+  int64_t height = 1000;
+  int64_t row_numel = 37;
+
+  // Enough rows to take the multi-threaded path.
+  std::vector<int64_t> rows1;
+  std::vector<int64_t> rows2;
+  for (int64_t i = 0; i < 4000; ++i) {
+    rows1.push_back((i * 7919) % height);
+    rows2.push_back((i * 104729 + 13) % height);
+  }
+  std::vector<std::unique_ptr<phi::SelectedRows>> selected_rows;
+  std::vector<const phi::SelectedRows*> inputs;
+  std::vector<float> expected(height * row_numel, 0.f);
+  for (auto* rows : {&rows1, &rows2}) {
+    selected_rows.emplace_back(new phi::SelectedRows(*rows, height));
+    auto* value = selected_rows.back()->mutable_value();
+    auto* data = value->mutable_data<float>(
+        phi::make_ddim({static_cast<int64_t>(rows->size()), row_numel}),
+        cpu_place);
+    for (size_t i = 0; i < rows->size(); ++i) {
+      for (int64_t j = 0; j < row_numel; ++j) {
+        data[i * row_numel + j] = static_cast<float>((i + j) % 5);
+        expected[(*rows)[i] * row_numel + j] += data[i * row_numel + j];
+      }
+    }
+    inputs.push_back(selected_rows.back().get());
+  }
+
+  std::unique_ptr<phi::SelectedRows> output{new phi::SelectedRows()};
+  paddle::operators::math::scatter::MergeAdd<paddle::platform::CPUDeviceContext,
+                                             float>
+      merge_add_functor;
+  merge_add_functor(ctx, inputs, output.get());
+
+  // Duplicated rows are merged into ascending rows, as the sparse optimizers
+  // binary search them.
+  std::set<int64_t> row_set(rows1.begin(), rows1.end());
+  row_set.insert(rows2.begin(), rows2.end());
+  std::vector<int64_t> merged_rows(row_set.begin(), row_set.end());
+  EXPECT_EQ(output->rows(), merged_rows);
+
+  auto* out_data = output->value().data<float>();
+  for (size_t i = 0; i < merged_rows.size(); ++i) {
+    for (int64_t j = 0; j < row_numel; ++j) {
+      EXPECT_EQ(out_data[i * row_numel + j],
+                expected[merged_rows[i] * row_numel + j]);
+    }
+  }
+}
+
 TEST(selected_rows_functor, cpu_merge_add_multi_noduplicated) {
   paddle::platform::CPUPlace cpu_place;
   paddle::platform::CPUDeviceContext ctx(cpu_place);
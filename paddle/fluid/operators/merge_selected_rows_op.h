@@ -27,8 +27,10 @@ class MergeSelectedRowsKernel : public framework::OpKernel<T> {
     auto* x = context.Input<phi::SelectedRows>("X");
     auto* out = context.Output<phi::SelectedRows>("Out");
 
+    // The op documents its output rows as incremental.
     math::scatter::MergeAdd<DeviceContext, T> merge_func;
-    merge_func(context.template device_context<DeviceContext>(), *x, out);
+    merge_func(context.template device_context<DeviceContext>(), *x, out,
+               true);
   }
 };
 
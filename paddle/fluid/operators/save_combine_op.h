@@ -25,11 +25,14 @@ limitations under the License. */
 #include "paddle/fluid/framework/data_type.h"
 #include "paddle/fluid/framework/data_type_transform.h"
 #include "paddle/fluid/framework/lod_tensor.h"
+#include "paddle/fluid/framework/mapped_params_file.h"
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/framework/string_array.h"
 #include "paddle/fluid/platform/device_context.h"
 #include "paddle/phi/backends/dynload/port.h"
 
+DECLARE_bool(save_indexed_params);
+
 namespace paddle {
 namespace operators {
 template <typename DeviceContext, typename T>
@@ -64,6 +67,15 @@ class SaveCombineOpKernel : public framework::OpKernel<T> {
     platform::DeviceContextPool &pool = platform::DeviceContextPool::Instance();
     auto &dev_ctx = *pool.Get(place);
 
+    bool indexed = FLAGS_save_indexed_params && !save_to_memory;
+    for (auto *var : inp_vars) {
+      indexed = indexed && var && var->IsType<framework::LoDTensor>();
+    }
+    if (indexed) {
+      SaveIndexed(ctx, filename, save_as_fp16);
+      return;
+    }
+
     for (size_t i = 0; i < inp_var_names.size(); i++) {
       PADDLE_ENFORCE_NOT_NULL(
           inp_vars[i],
@@ -128,6 +140,40 @@ class SaveCombineOpKernel : public framework::OpKernel<T> {
       fout.close();
     }
   }
+
+ private:
+  // Saves the tensors in the indexed parameters file, written by several
+  // threads.
+  void SaveIndexed(const framework::ExecutionContext &ctx,
+                   const std::string &filename, bool save_as_fp16) const {
+    auto inp_var_names = ctx.InputNames("X");
+    auto &inp_vars = ctx.MultiInputVar("X");
+    std::vector<framework::LoDTensor> converted(inp_vars.size());
+    std::vector<const framework::LoDTensor *> tensors(inp_vars.size());
+    for (size_t i = 0; i < inp_vars.size(); i++) {
+      auto &tensor = inp_vars[i]->Get<framework::LoDTensor>();
+      PADDLE_ENFORCE_EQ(
+          tensor.IsInitialized(), true,
+          platform::errors::InvalidArgument(
+              "The Tensor of Variable(%s) to be saved is not initialized.",
+              inp_var_names[i]));
+      auto in_dtype = framework::TransToProtoVarType(tensor.dtype());
+      auto out_dtype =
+          save_as_fp16 ? framework::proto::VarType::FP16 : in_dtype;
+      tensors[i] = &tensor;
+      if (in_dtype != out_dtype) {
+        auto in_kernel_type = framework::OpKernelType(in_dtype, ctx.GetPlace());
+        auto out_kernel_type =
+            framework::OpKernelType(out_dtype, ctx.GetPlace());
+        converted[i].set_lod(tensor.lod());
+        framework::TransDataType(in_kernel_type, out_kernel_type, tensor,
+                                 &converted[i]);
+        tensors[i] = &converted[i];
+      }
+    }
+    MkDirRecursively(DirName(filename).c_str());
+    framework::SaveMappedParams(filename, inp_var_names, tensors);
+  }
 };
 
 }  // namespace operators
@@ -15,11 +15,15 @@ limitations under the License. */
 #include <iostream>
 #include <string>
 #include <vector>
+#include "gflags/gflags.h"
 #include "gtest/gtest.h"
+#include "paddle/fluid/framework/mapped_params_file.h"
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/platform/bfloat16.h"
 #include "paddle/fluid/platform/float16.h"
 
+DECLARE_bool(save_indexed_params);
+
 USE_CPU_ONLY_OP(save_combine);
 USE_CPU_ONLY_OP(load_combine);
 
@@ -352,3 +356,78 @@ TEST(SaveLoadTestWithCombineOp, CPU) {
     }
   }
 }
+
+TEST(LoadCombineOp, MappedParams) {
+  paddle::framework::Scope scope;
+  paddle::platform::CPUPlace place;
+  paddle::framework::LoD expect_lod1, expect_lod2;
+  float* expect1 = CreateForSaveCombineOp<float, float>(
+      10, 10, {0, 1, 10}, "test_var1", place, &scope, &expect_lod1);
+  float* expect2 = CreateForSaveCombineOp<float, float>(
+      20, 50, {0, 5, 20}, "test_var2", place, &scope, &expect_lod2);
+  std::string filename = "check_tensor.mapped";
+  paddle::framework::SaveMappedParams(filename, {"test_var1", "test_var2"},
+                                      scope);
+
+  // The names in the file are matched to the outputs, not their order.
+  paddle::framework::Scope load_scope;
+  auto target2 = GeneratePlaceholderBeforeLoad("test_var2", &load_scope);
+  auto target1 = GeneratePlaceholderBeforeLoad("test_var1", &load_scope);
+  paddle::framework::AttributeMap attrs;
+  attrs.insert({"file_path", filename});
+  auto load_combine_op = paddle::framework::OpRegistry::CreateOp(
+      "load_combine", {}, {{"Out", {"test_var2", "test_var1"}}}, attrs);
+  load_combine_op->Run(load_scope, place);
+
+  paddle::framework::LoD actual_lod1, actual_lod2;
+  float* actual1 =
+      GetValuesAfterLoadCombineOp<float>(target1, load_scope, &actual_lod1);
+  float* actual2 =
+      GetValuesAfterLoadCombineOp<float>(target2, load_scope, &actual_lod2);
+  CheckValues<float, float>(expect1, actual1, expect_lod1, actual_lod1, 100);
+  CheckValues<float, float>(expect2, actual2, expect_lod2, actual_lod2, 1000);
+
+  // load_as_fp16 converts the mapped tensors.
+  attrs["load_as_fp16"] = true;
+  auto load_fp16_op = paddle::framework::OpRegistry::CreateOp(
+      "load_combine", {}, {{"Out", {"test_var1"}}}, attrs);
+  load_fp16_op->Run(load_scope, place);
+  auto* actual_fp16 = target1->data<paddle::platform::float16>();
+  CheckValues<float, paddle::platform::float16>(expect1, actual_fp16,
+                                                expect_lod1, target1->lod(),
+                                                100);
+}
+
+TEST(SaveCombineOp, Indexed) {
+  paddle::framework::Scope scope;
+  paddle::platform::CPUPlace place;
+  paddle::framework::LoD expect_lod1, expect_lod2;
+  float* expect1 = CreateForSaveCombineOp<float, float>(
+      10, 10, {0, 1, 10}, "test_var1", place, &scope, &expect_lod1);
+  float* expect2 = CreateForSaveCombineOp<float, float>(
+      20, 50, {0, 5, 20}, "test_var2", place, &scope, &expect_lod2);
+  std::string filename = "check_tensor.indexed";
+  paddle::framework::AttributeMap attrs;
+  attrs.insert({"file_path", filename});
+  FLAGS_save_indexed_params = true;
+  auto save_combine_op = paddle::framework::OpRegistry::CreateOp(
+      "save_combine", {{"X", {"test_var1", "test_var2"}}}, {}, attrs);
+  save_combine_op->Run(scope, place);
+  FLAGS_save_indexed_params = false;
+  ASSERT_TRUE(paddle::framework::IsMappedParamsFile(filename));
+
+  paddle::framework::Scope load_scope;
+  auto target1 = GeneratePlaceholderBeforeLoad("test_var1", &load_scope);
+  auto target2 = GeneratePlaceholderBeforeLoad("test_var2", &load_scope);
+  auto load_combine_op = paddle::framework::OpRegistry::CreateOp(
+      "load_combine", {}, {{"Out", {"test_var1", "test_var2"}}}, attrs);
+  load_combine_op->Run(load_scope, place);
+
+  paddle::framework::LoD actual_lod1, actual_lod2;
+  float* actual1 =
+      GetValuesAfterLoadCombineOp<float>(target1, load_scope, &actual_lod1);
+  float* actual2 =
+      GetValuesAfterLoadCombineOp<float>(target2, load_scope, &actual_lod2);
+  CheckValues<float, float>(expect1, actual1, expect_lod1, actual_lod1, 100);
+  CheckValues<float, float>(expect2, actual2, expect_lod2, actual_lod2, 1000);
+}
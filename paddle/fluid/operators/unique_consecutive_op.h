@@ -33,50 +33,27 @@ static void UniqueConsecutiveFlattendTensor(
     const framework::ExecutionContext& context, const framework::Tensor& in,
     framework::Tensor* out, bool return_inverse, bool return_counts) {
   const InT* in_data = in.data<InT>();
-  std::vector<InT> out_vec(in.numel());
-  std::vector<IndexT> inverse_vec(in.numel());
-  std::vector<IndexT> counts_vec(in.numel());
-  memcpy(out_vec.data(), in_data, in.numel() * sizeof(InT));
-  InT* p = out_vec.data();
-  int64_t last = 0;
-  IndexT* q = counts_vec.data();
-  for (int64_t i = 0; i < in.numel(); i++) {
-    if (in_data[i] != *p) {
-      *(++p) = in_data[i];
-      if (return_counts) {
-        *(q++) = i - last;
-        last = i;
-      }
-    }
-    if (return_inverse) {
-      inverse_vec[i] = p - out_vec.data();
-    }
-  }
-
-  int64_t output_size = p - out_vec.data() + 1;
-  if (return_counts) {
-    *q = in.numel() - last;
-    counts_vec.resize(output_size);
-  }
-  out_vec.resize(output_size);
+  const int64_t numel = in.numel();
+  std::vector<int64_t> starts =
+      phi::funcs::ConsecutiveRunStarts(in_data, numel);
+  const int64_t output_size = starts.size();
 
   out->Resize(phi::make_ddim({output_size}));
   auto* out_data = out->mutable_data<InT>(context.GetPlace());
-  std::copy(out_vec.begin(), out_vec.end(), out_data);
-
+  IndexT* inverse_data = nullptr;
   if (return_inverse) {
     auto* inverse = context.Output<framework::Tensor>("Index");
-    inverse->Resize(phi::make_ddim({in.numel()}));
-    auto* inverse_data = inverse->mutable_data<IndexT>(context.GetPlace());
-    std::copy(inverse_vec.begin(), inverse_vec.end(), inverse_data);
+    inverse->Resize(phi::make_ddim({numel}));
+    inverse_data = inverse->mutable_data<IndexT>(context.GetPlace());
   }
-
+  IndexT* counts_data = nullptr;
   if (return_counts) {
     auto* count = context.Output<framework::Tensor>("Counts");
-    count->Resize(phi::make_ddim({out->numel()}));
-    auto* counts_data = count->mutable_data<IndexT>(context.GetPlace());
-    std::copy(counts_vec.begin(), counts_vec.end(), counts_data);
+    count->Resize(phi::make_ddim({output_size}));
+    counts_data = count->mutable_data<IndexT>(context.GetPlace());
   }
+  phi::funcs::UniqueConsecutiveFromRuns(in_data, numel, starts, out_data,
+                                        inverse_data, counts_data);
 }
 
 template <class ForwardIt, typename InT, typename IndexT>
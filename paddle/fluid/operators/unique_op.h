@@ -23,6 +23,7 @@ limitations under the License. */
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/operators/math/concat_and_split.h"
 #include "paddle/fluid/operators/transpose_op.h"
+#include "paddle/phi/kernels/funcs/cpu_unique.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
 
 namespace paddle {
@@ -45,12 +46,6 @@ struct UniqueOpFunctor {
     auto* in_data = in_->data<InT>();
     auto* index_data = index_->mutable_data<IndexT>(platform::CPUPlace());
 
-    int64_t j = 0;
-
-    // TODO(fangzeyang): Should optimize performance here.
-    std::unordered_map<InT, int64_t> dict;
-    std::vector<InT> uniq;
-
     PADDLE_ENFORCE_LT(
         in_->numel(), pow(2, 31),
         platform::errors::InvalidArgument(
@@ -58,25 +53,11 @@ struct UniqueOpFunctor {
             "but received num is %d.",
             in_->numel()));
 
-    for (auto i = 0; i < in_->numel(); i++) {
-      auto it = dict.find(in_data[i]);
-      if (it == dict.end()) {
-        dict.emplace(std::make_pair(in_data[i], j));
-        uniq.emplace_back(in_data[i]);
-        index_data[i] = static_cast<IndexT>(j);
-        j++;
-      } else {
-        index_data[i] = static_cast<IndexT>(it->second);
-      }
-    }
+    phi::funcs::CPUUniqueResult<InT> uniq;
+    phi::funcs::UniqueFirstOccurrence(in_data, in_->numel(), false,
+                                      count_ != nullptr, index_data, &uniq);
 
     if (count_ != nullptr) {
-      // Resize the count tensor dims to allocate the memory
-      count_->Resize(phi::make_ddim({static_cast<int64_t>(uniq.size())}));
-      IndexT* count_data = count_->mutable_data<IndexT>(platform::CPUPlace());
-      // init count_data to 0
-      memset(count_data, 0, uniq.size() * sizeof(IndexT));
-
       const auto& index_type = framework::TransToProtoVarType(index_->dtype());
       bool index_type_match = index_type == framework::proto::VarType::INT32 ||
                               index_type == framework::proto::VarType::INT64;
@@ -90,22 +71,17 @@ struct UniqueOpFunctor {
                             paddle::framework::DataTypeToString(
                                 framework::proto::VarType::INT64)));
 
-      if (index_type == framework::proto::VarType::INT32) {
-        for (auto i = 0; i < in_->numel(); ++i) {
-          const IndexT& index = index_data[i];
-          count_data[static_cast<int32_t>(index)] += static_cast<IndexT>(1);
-        }
-      } else {
-        for (auto i = 0; i < in_->numel(); ++i) {
-          const IndexT& index = index_data[i];
-          count_data[static_cast<int64_t>(index)] += static_cast<IndexT>(1);
-        }
+      count_->Resize(
+          phi::make_ddim({static_cast<int64_t>(uniq.counts.size())}));
+      IndexT* count_data = count_->mutable_data<IndexT>(platform::CPUPlace());
+      for (size_t i = 0; i < uniq.counts.size(); ++i) {
+        count_data[i] = static_cast<IndexT>(uniq.counts[i]);
       }
     }
 
-    out_->Resize(phi::make_ddim({static_cast<int64_t>(uniq.size())}));
+    out_->Resize(phi::make_ddim({static_cast<int64_t>(uniq.values.size())}));
     auto out_data = out_->mutable_data<InT>(platform::CPUPlace());
-    std::memcpy(out_data, uniq.data(), uniq.size() * sizeof(InT));
+    std::copy(uniq.values.begin(), uniq.values.end(), out_data);
   }
 };
 
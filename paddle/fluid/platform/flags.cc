@@ -379,6 +379,23 @@ PADDLE_DEFINE_EXPORTED_string(
     "on the same GPU card but may lead to more memory fragmentation "
     "(i.e., maximum batch size of models may be smaller).");
 
+/**
+ * Allocator related FLAG
+ * Name: FLAGS_cpu_allocator_strategy
+ * Since Version: 2.3
+ * Value Range: string, {naive_best_fit, thread_cache},
+ * default=naive_best_fit
+ * Example: FLAGS_cpu_allocator_strategy=thread_cache
+ * Note: For selecting the CPU allocator, whatever FLAGS_allocator_strategy
+ *       is. thread_cache caches freed blocks per thread in size classes,
+ *       which scales better when many threads allocate small tensors.
+ */
+PADDLE_DEFINE_EXPORTED_string(
+    cpu_allocator_strategy, "naive_best_fit",
+    "The CPU allocation strategy, enum in [naive_best_fit, thread_cache]. "
+    "naive_best_fit means the buddy allocator shared by all threads. "
+    "thread_cache means the size-class allocator with per-thread caches.");
+
 /**
  * Memory related FLAG
  * Name: FLAGS_fraction_of_cpu_memory_to_use
@@ -716,6 +733,79 @@ PADDLE_DEFINE_EXPORTED_bool(allreduce_record_one_event, false,
                             "events. Currently, only fuse allreduce supports "
                             "this. Otherwise, the precision may be wrong.");
 
+/**
+ * Eager backward related FLAG
+ * Name: FLAGS_eager_backward_num_threads
+ * Since Version: 2.4
+ * Value Range: int32, default=0
+ * Example: FLAGS_eager_backward_num_threads=8 runs the grad nodes of the
+ *          eager backward whose grads are ready at the same time on 8 threads.
+ * Note: 0 or 1 runs the backward on the calling thread. Only the backward of
+ *       CPU tensors without create_graph runs on the threads.
+ */
+PADDLE_DEFINE_EXPORTED_int32(
+    eager_backward_num_threads, 0,
+    "The number of threads to run the eager backward on CPU, 0 or 1 to run "
+    "it on the calling thread.");
+
+/**
+ * Eager backward related FLAG
+ * Name: FLAGS_eager_backward_deterministic
+ * Since Version: 2.4
+ * Value Range: bool, default=false
+ * Example: FLAGS_eager_backward_deterministic=true sums the grads of a node
+ *          in the same order in every run of the eager backward on threads.
+ * Note: The grads of a node are kept until all of them are computed.
+ */
+PADDLE_DEFINE_EXPORTED_bool(
+    eager_backward_deterministic, false,
+    "Whether the eager backward on threads sums the grads of a node in a "
+    "fixed order.");
+
+/**
+ * Profiler related FLAG
+ * Name: FLAGS_enable_op_metrics
+ * Since Version: 2.4
+ * Value Range: bool, default=false
+ * Example: FLAGS_enable_op_metrics=true counts the calls, latency and
+ *          allocated bytes of each op type, read by ExportOpMetrics.
+ * Note: Unlike the profiler, the metrics are collected continuously, at a
+ *       cost low enough to keep them on in production.
+ */
+PADDLE_DEFINE_EXPORTED_bool(
+    enable_op_metrics, false,
+    "Whether to collect the metrics of the ops run by the executors.");
+
+/**
+ * Profiler related FLAG
+ * Name: FLAGS_op_metrics_sample_rate
+ * Since Version: 2.4
+ * Value Range: int32, default=8
+ * Example: FLAGS_op_metrics_sample_rate=8 times one in 8 ops run by a thread.
+ * Note: The calls are always counted, the latency, allocated bytes and busy
+ *       time are measured on the sampled calls only. 1 times every call.
+ */
+PADDLE_DEFINE_EXPORTED_int32(
+    op_metrics_sample_rate, 8,
+    "One in how many ops run by a thread are timed for the op metrics.");
+
+/**
+ * Save/Load related FLAG
+ * Name: FLAGS_save_indexed_params
+ * Since Version: 2.4
+ * Value Range: bool, default=false
+ * Example: FLAGS_save_indexed_params=true makes save_combine and
+ *          SaveTensorToDisk write the indexed parameters file.
+ * Note: The indexed file is written and read by several threads, and a
+ *       subset of its tensors can be loaded without reading the others.
+ *       The loaders read both formats. Vocab variables and saving to memory
+ *       keep the stream format.
+ */
+PADDLE_DEFINE_EXPORTED_bool(
+    save_indexed_params, false,
+    "Whether to save the parameters in the indexed file, written and read "
+    "by several threads.");
+
 #ifdef PADDLE_WITH_CINN
 /*
  * CINN related FLAG
@@ -0,0 +1,326 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/platform/profiler/op_metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "paddle/fluid/framework/new_executor/workqueue/thread_data_registry.h"
+#include "paddle/fluid/memory/stats.h"
+#include "paddle/fluid/platform/enforce.h"
+
+DECLARE_int32(op_metrics_sample_rate);
+
+namespace paddle {
+namespace platform {
+
+// The counters of an op type in a thread. Only the thread writes them, the
+// readers may load them at any time.
+struct OpCounters {
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> sampled_calls{0};
+  std::atomic<uint64_t> total_ns{0};
+  std::atomic<uint64_t> latency_buckets[kNumOpLatencyBuckets];
+  std::atomic<uint64_t> allocated_bytes{0};
+
+  OpCounters() {
+    for (auto& bucket : latency_buckets) bucket.store(0);
+  }
+
+  void MergeTo(OpMetrics* metrics) const {
+    OpMetrics m;
+    m.calls = calls.load(std::memory_order_relaxed);
+    m.sampled_calls = sampled_calls.load(std::memory_order_relaxed);
+    m.total_ns = total_ns.load(std::memory_order_relaxed);
+    for (int i = 0; i < kNumOpLatencyBuckets; ++i) {
+      m.latency_buckets[i] = latency_buckets[i].load(std::memory_order_relaxed);
+    }
+    m.allocated_bytes = allocated_bytes.load(std::memory_order_relaxed);
+    metrics->Merge(m);
+  }
+};
+
+namespace {
+
+// The counters have a single writer, so they are added to without the
+// locked read-modify-write of fetch_add.
+inline void Add(std::atomic<uint64_t>* counter, uint64_t value) {
+  counter->store(counter->load(std::memory_order_relaxed) + value,
+                 std::memory_order_relaxed);
+}
+
+int LatencyBucket(uint64_t ns) {
+  uint64_t us = (ns + 999) / 1000;
+  int bucket = 0;
+  while (bucket < kNumOpLatencyBuckets - 1 && (uint64_t(1) << bucket) < us) {
+    ++bucket;
+  }
+  return bucket;
+}
+
+// The metrics of the exited threads.
+struct RetiredOpMetrics {
+  std::mutex mutex;
+  OpMetricsSnapshot metrics;
+};
+
+RetiredOpMetrics& Retired() {
+  // Leaked, the threads may exit after the static objects are destroyed.
+  static auto* retired = new RetiredOpMetrics();
+  return *retired;
+}
+
+}  // namespace
+
+void OpMetrics::Merge(const OpMetrics& other) {
+  calls += other.calls;
+  sampled_calls += other.sampled_calls;
+  total_ns += other.total_ns;
+  for (int i = 0; i < kNumOpLatencyBuckets; ++i) {
+    latency_buckets[i] += other.latency_buckets[i];
+  }
+  allocated_bytes += other.allocated_bytes;
+}
+
+// The metrics of the ops run by a thread, registered in the
+// ThreadDataRegistry and merged into the retired metrics when the thread
+// exits.
+class ThreadOpMetrics {
+ public:
+  ThreadOpMetrics()
+      : tid_(std::hash<std::thread::id>()(std::this_thread::get_id())) {}
+
+  ~ThreadOpMetrics() {
+    auto& retired = Retired();
+    std::lock_guard<std::mutex> guard(retired.mutex);
+    MergeTo(&retired.metrics);
+  }
+
+  OpCounters* GetCounters(const std::string& type) {
+    // Only this thread inserts, so it finds without the lock.
+    auto it = ops_.find(type);
+    if (it != ops_.end()) return it->second.get();
+    std::lock_guard<std::mutex> guard(mutex_);
+    return ops_.emplace(type, std::unique_ptr<OpCounters>(new OpCounters()))
+        .first->second.get();
+  }
+
+  void MergeTo(OpMetricsSnapshot* snapshot) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto& kv : ops_) kv.second->MergeTo(&snapshot->ops[kv.first]);
+    snapshot->thread_busy_ns[tid_] += busy_ns.load(std::memory_order_relaxed);
+  }
+
+  // The op being recorded and the sampling, used by this thread only.
+  const void* current_op = nullptr;
+  int depth = 0;
+  uint64_t tick = 0;
+  std::atomic<uint64_t> busy_ns{0};
+
+ private:
+  uint64_t tid_;
+  // Guards the insertion into ops_ against the readers.
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::unique_ptr<OpCounters>> ops_;
+};
+
+void RecordOpMetrics::Begin(const void* op, const std::string& type,
+                            const Place& place) {
+  auto* thread = framework::ThreadDataRegistry<ThreadOpMetrics>::GetInstance()
+                     .GetMutableCurrentThreadData();
+  if (thread->current_op == op) return;
+  thread_ = thread;
+  parent_op_ = thread->current_op;
+  thread->current_op = op;
+  outermost_ = thread->depth++ == 0;
+  counters_ = thread->GetCounters(type);
+  Add(&counters_->calls, 1);
+
+  int rate = FLAGS_op_metrics_sample_rate;
+  sample_rate_ = rate > 1 ? rate : 1;
+  if (++thread->tick % sample_rate_ != 0) return;
+  sampled_ = true;
+  if (is_cpu_place(place)) {
+    stat_type_ = "HostAllocated";
+  } else if (is_gpu_place(place) && place.GetDeviceId() < 16) {
+    stat_type_ = "Allocated";
+    dev_id_ = place.GetDeviceId();
+  }
+  if (stat_type_ != nullptr) {
+    allocated_ = memory::StatGetThreadLocalTotalIncrement(stat_type_, dev_id_);
+  }
+  start_ = std::chrono::steady_clock::now();
+}
+
+void RecordOpMetrics::End() {
+  if (sampled_) {
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - start_)
+                      .count();
+    Add(&counters_->sampled_calls, 1);
+    Add(&counters_->total_ns, ns);
+    Add(&counters_->latency_buckets[LatencyBucket(ns)], 1);
+    if (stat_type_ != nullptr) {
+      Add(&counters_->allocated_bytes,
+          memory::StatGetThreadLocalTotalIncrement(stat_type_, dev_id_) -
+              allocated_);
+    }
+    if (outermost_) Add(&thread_->busy_ns, ns * sample_rate_);
+  }
+  thread_->current_op = parent_op_;
+  --thread_->depth;
+}
+
+OpMetricsSnapshot GetOpMetrics() {
+  OpMetricsSnapshot snapshot;
+  {
+    auto& retired = Retired();
+    std::lock_guard<std::mutex> guard(retired.mutex);
+    snapshot = retired.metrics;
+  }
+  framework::ThreadDataRegistry<ThreadOpMetrics>::GetInstance()
+      .VisitAllThreadData([&snapshot](uint64_t, ThreadOpMetrics& thread) {
+        thread.MergeTo(&snapshot);
+      });
+  return snapshot;
+}
+
+namespace {
+
+double UpperBoundSeconds(int bucket) {
+  return static_cast<double>(uint64_t(1) << bucket) * 1e-6;
+}
+
+// The upper bound of the bucket holding the quantile q of the latency, in
+// microseconds, 0 for the last bucket.
+uint64_t QuantileUs(const OpMetrics& metrics, double q) {
+  uint64_t rank = static_cast<uint64_t>(q * metrics.sampled_calls);
+  uint64_t count = 0;
+  for (int i = 0; i < kNumOpLatencyBuckets - 1; ++i) {
+    count += metrics.latency_buckets[i];
+    if (count > rank) return uint64_t(1) << i;
+  }
+  return 0;
+}
+
+std::string ToText(const OpMetricsSnapshot& snapshot) {
+  // The op types by their estimated total time.
+  std::vector<std::pair<double, std::string>> order;
+  for (auto& kv : snapshot.ops) {
+    auto& m = kv.second;
+    double avg_ns =
+        m.sampled_calls ? static_cast<double>(m.total_ns) / m.sampled_calls
+                        : 0.;
+    order.emplace_back(-avg_ns * m.calls, kv.first);
+  }
+  std::sort(order.begin(), order.end());
+
+  std::ostringstream os;
+  os << std::left << std::setw(32) << "op_type" << std::right << std::setw(12)
+     << "calls" << std::setw(12) << "sampled" << std::setw(14) << "total_ms"
+     << std::setw(12) << "avg_us" << std::setw(10) << "p50_us"
+     << std::setw(10) << "p99_us" << std::setw(16) << "bytes_per_call"
+     << "\n";
+  os << std::fixed << std::setprecision(3);
+  for (auto& item : order) {
+    auto& m = snapshot.ops.at(item.second);
+    double avg_us =
+        m.sampled_calls ? m.total_ns / 1e3 / m.sampled_calls : 0.;
+    uint64_t bytes = m.sampled_calls ? m.allocated_bytes / m.sampled_calls : 0;
+    os << std::left << std::setw(32) << item.second << std::right
+       << std::setw(12) << m.calls << std::setw(12) << m.sampled_calls
+       << std::setw(14) << -item.first / 1e6 << std::setw(12) << avg_us
+       << std::setw(10) << QuantileUs(m, 0.5) << std::setw(10)
+       << QuantileUs(m, 0.99) << std::setw(16) << bytes << "\n";
+  }
+  for (auto& kv : snapshot.thread_busy_ns) {
+    os << "thread " << kv.first << " busy_ms " << kv.second / 1e6 << "\n";
+  }
+  return os.str();
+}
+
+std::string ToPrometheus(const OpMetricsSnapshot& snapshot) {
+  std::ostringstream os;
+  os << std::setprecision(12);
+  auto header = [&os](const char* name, const char* type, const char* help) {
+    os << "# HELP " << name << " " << help << "\n";
+    os << "# TYPE " << name << " " << type << "\n";
+  };
+
+  header("paddle_op_calls_total", "counter", "The number of calls of the op.");
+  for (auto& kv : snapshot.ops) {
+    os << "paddle_op_calls_total{op_type=\"" << kv.first << "\"} "
+       << kv.second.calls << "\n";
+  }
+  header("paddle_op_latency_seconds", "histogram",
+         "The host latency of the sampled calls of the op.");
+  for (auto& kv : snapshot.ops) {
+    auto& m = kv.second;
+    const std::string labels = "op_type=\"" + kv.first + "\"";
+    uint64_t count = 0;
+    for (int i = 0; i < kNumOpLatencyBuckets; ++i) {
+      count += m.latency_buckets[i];
+      os << "paddle_op_latency_seconds_bucket{" << labels << ",le=\"";
+      if (i == kNumOpLatencyBuckets - 1) {
+        os << "+Inf";
+      } else {
+        os << UpperBoundSeconds(i);
+      }
+      os << "\"} " << count << "\n";
+    }
+    os << "paddle_op_latency_seconds_sum{" << labels << "} "
+       << m.total_ns / 1e9 << "\n";
+    os << "paddle_op_latency_seconds_count{" << labels << "} "
+       << m.sampled_calls << "\n";
+  }
+  header("paddle_op_allocated_bytes_total", "counter",
+         "The bytes allocated by the sampled calls of the op.");
+  for (auto& kv : snapshot.ops) {
+    os << "paddle_op_allocated_bytes_total{op_type=\"" << kv.first << "\"} "
+       << kv.second.allocated_bytes << "\n";
+  }
+  header("paddle_thread_busy_seconds_total", "counter",
+         "The estimated time the thread spent running ops.");
+  for (auto& kv : snapshot.thread_busy_ns) {
+    os << "paddle_thread_busy_seconds_total{thread=\"" << kv.first << "\"} "
+       << kv.second / 1e9 << "\n";
+  }
+  return os.str();
+}
+
+}  // namespace
+
+std::string ExportOpMetrics(const std::string& format) {
+  PADDLE_ENFORCE_EQ(
+      format == "text" || format == "prometheus", true,
+      platform::errors::InvalidArgument(
+          "The format of the op metrics should be text or prometheus, but "
+          "received %s.",
+          format));
+  auto snapshot = GetOpMetrics();
+  return format == "text" ? ToText(snapshot) : ToPrometheus(snapshot);
+}
+
+}  // namespace platform
+}  // namespace paddle
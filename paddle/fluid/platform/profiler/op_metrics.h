@@ -0,0 +1,100 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "gflags/gflags.h"
+#include "paddle/fluid/platform/place.h"
+
+DECLARE_bool(enable_op_metrics);
+
+namespace paddle {
+namespace platform {
+
+// The upper bounds of the latency buckets are 1us, 2us, 4us, ...,
+// 2^(kNumOpLatencyBuckets - 2)us and +Inf.
+constexpr int kNumOpLatencyBuckets = 26;
+
+struct OpMetrics {
+  uint64_t calls = 0;
+  // The latency and the allocated bytes are measured on the sampled calls.
+  uint64_t sampled_calls = 0;
+  uint64_t total_ns = 0;
+  // The number of the sampled calls in each latency bucket.
+  uint64_t latency_buckets[kNumOpLatencyBuckets] = {0};
+  uint64_t allocated_bytes = 0;
+
+  void Merge(const OpMetrics& other);
+};
+
+struct OpMetricsSnapshot {
+  // By op type.
+  std::map<std::string, OpMetrics> ops;
+  // The time each thread spent in the outermost ops it ran, estimated from
+  // the sampled calls, by thread id.
+  std::map<uint64_t, uint64_t> thread_busy_ns;
+};
+
+struct OpCounters;
+class ThreadOpMetrics;
+
+// Records a run of an op in the metrics of the current thread when
+// FLAGS_enable_op_metrics is set, from its construction to its destruction.
+// The calls are counted in thread local counters without locks, one in
+// FLAGS_op_metrics_sample_rate calls is timed as well. The latency is the one
+// on the host, the kernels launched on a device may still be running.
+//
+// A run of the op recorded already by an enclosing RecordOpMetrics, e.g. the
+// OperatorWithKernel::RunImpl of an OperatorBase::Run, is not counted again.
+class RecordOpMetrics {
+ public:
+  // op identifies the op run, type is kept by reference.
+  RecordOpMetrics(const void* op, const std::string& type, const Place& place) {
+    if (FLAGS_enable_op_metrics) Begin(op, type, place);
+  }
+
+  ~RecordOpMetrics() {
+    if (thread_ != nullptr) End();
+  }
+
+ private:
+  void Begin(const void* op, const std::string& type, const Place& place);
+  void End();
+
+  ThreadOpMetrics* thread_ = nullptr;
+  OpCounters* counters_ = nullptr;
+  const void* parent_op_ = nullptr;
+  bool outermost_ = false;
+  bool sampled_ = false;
+  uint64_t sample_rate_ = 1;
+  const char* stat_type_ = nullptr;
+  int dev_id_ = 0;
+  int64_t allocated_ = 0;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// The metrics of the ops run by all threads, including the exited ones.
+OpMetricsSnapshot GetOpMetrics();
+
+// The metrics in format "text", a table of the op types, or "prometheus", the
+// text exposition format of Prometheus.
+std::string ExportOpMetrics(const std::string& format = "text");
+
+}  // namespace platform
+}  // namespace paddle
@@ -0,0 +1,94 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/platform/profiler/op_metrics.h"
+
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/memory/stats.h"
+
+DECLARE_int32(op_metrics_sample_rate);
+
+namespace paddle {
+namespace platform {
+
+TEST(OpMetrics, CountCalls) {
+  FLAGS_enable_op_metrics = true;
+  FLAGS_op_metrics_sample_rate = 1;
+  const std::string outer = "op_metrics_test_outer";
+  const std::string inner = "op_metrics_test_inner";
+  int op0 = 0, op1 = 0;
+
+  for (int i = 0; i < 3; ++i) {
+    RecordOpMetrics record_outer(&op0, outer, CPUPlace());
+    // Recorded by the enclosing one already.
+    RecordOpMetrics record_again(&op0, outer, CPUPlace());
+    RecordOpMetrics record_inner(&op1, inner, CPUPlace());
+    memory::StatUpdate("HostAllocated", 0, 64);
+    memory::StatUpdate("HostAllocated", 0, -64);
+  }
+  // A thread exited still counts.
+  std::thread([&]() {
+    RecordOpMetrics record(&op0, outer, CPUPlace());
+  }).join();
+  FLAGS_enable_op_metrics = false;
+  { RecordOpMetrics record(&op0, outer, CPUPlace()); }
+
+  auto snapshot = GetOpMetrics();
+  auto& m = snapshot.ops.at(outer);
+  EXPECT_EQ(m.calls, 4UL);
+  EXPECT_EQ(m.sampled_calls, 4UL);
+  uint64_t count = 0;
+  for (auto c : m.latency_buckets) count += c;
+  EXPECT_EQ(count, 4UL);
+  EXPECT_EQ(m.allocated_bytes, 3 * 64UL);
+  EXPECT_EQ(snapshot.ops.at(inner).calls, 3UL);
+  EXPECT_EQ(snapshot.ops.at(inner).allocated_bytes, 3 * 64UL);
+  EXPECT_GE(snapshot.thread_busy_ns.size(), 2UL);
+
+  std::string text = ExportOpMetrics("text");
+  EXPECT_NE(text.find(outer), std::string::npos);
+  std::string prometheus = ExportOpMetrics("prometheus");
+  EXPECT_NE(prometheus.find("# TYPE paddle_op_calls_total counter"),
+            std::string::npos);
+  EXPECT_NE(prometheus.find("paddle_op_calls_total{op_type=\"" + outer +
+                            "\"} 4"),
+            std::string::npos);
+  EXPECT_NE(prometheus.find("paddle_op_latency_seconds_count{op_type=\"" +
+                            outer + "\"} 4"),
+            std::string::npos);
+  EXPECT_NE(prometheus.find("le=\"+Inf\"} 4"), std::string::npos);
+  EXPECT_ANY_THROW(ExportOpMetrics("json"));
+}
+
+TEST(OpMetrics, Sampling) {
+  FLAGS_enable_op_metrics = true;
+  FLAGS_op_metrics_sample_rate = 4;
+  const std::string type = "op_metrics_test_sampled";
+  int op = 0;
+  for (int i = 0; i < 100; ++i) {
+    RecordOpMetrics record(&op, type, CPUPlace());
+  }
+  FLAGS_enable_op_metrics = false;
+  FLAGS_op_metrics_sample_rate = 8;
+
+  auto m = GetOpMetrics().ops.at(type);
+  EXPECT_EQ(m.calls, 100UL);
+  EXPECT_EQ(m.sampled_calls, 25UL);
+}
+
+}  // namespace platform
+}  // namespace paddle
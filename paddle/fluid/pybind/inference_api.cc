@@ -582,10 +582,39 @@ void BindAnalysisConfig(py::module *m) {
       .def("ir_optim", &AnalysisConfig::ir_optim)
       .def("enable_memory_optim", &AnalysisConfig::EnableMemoryOptim,
            py::arg("x") = true)
+      .def("enable_static_memory_plan",
+           &AnalysisConfig::EnableStaticMemoryPlan, py::arg("x") = true)
+      .def("static_memory_plan_enabled",
+           &AnalysisConfig::static_memory_plan_enabled)
+      .def("enable_parallel_execution",
+           &AnalysisConfig::EnableParallelExecution, py::arg("x") = true)
+      .def("parallel_execution_enabled",
+           &AnalysisConfig::parallel_execution_enabled)
+      .def("set_parallel_execution_threads",
+           &AnalysisConfig::SetParallelExecutionThreads)
+      .def("parallel_execution_threads",
+           &AnalysisConfig::parallel_execution_threads)
+      .def("enable_shape_plan_cache", &AnalysisConfig::EnableShapePlanCache,
+           py::arg("capacity") = 32)
+      .def("shape_plan_cache_enabled",
+           &AnalysisConfig::shape_plan_cache_enabled)
+      .def("shape_plan_cache_capacity",
+           &AnalysisConfig::shape_plan_cache_capacity)
+      .def("enable_weight_only_quant", &AnalysisConfig::EnableWeightOnlyQuant,
+           py::arg("weight_bits") = 8, py::arg("group_size") = 0)
+      .def("weight_only_quant_enabled",
+           &AnalysisConfig::weight_only_quant_enabled)
+      .def("weight_only_quant_bits", &AnalysisConfig::weight_only_quant_bits)
+      .def("weight_only_quant_group_size",
+           &AnalysisConfig::weight_only_quant_group_size)
       .def("enable_profile", &AnalysisConfig::EnableProfile)
       .def("disable_glog_info", &AnalysisConfig::DisableGlogInfo)
       .def("glog_info_disabled", &AnalysisConfig::glog_info_disabled)
       .def("set_optim_cache_dir", &AnalysisConfig::SetOptimCacheDir)
+      .def("enable_optim_model_cache", &AnalysisConfig::EnableOptimModelCache,
+           py::arg("x") = true)
+      .def("optim_model_cache_enabled",
+           &AnalysisConfig::optim_model_cache_enabled)
       .def("switch_use_feed_fetch_ops", &AnalysisConfig::SwitchUseFeedFetchOps,
            py::arg("x") = true)
       .def("use_feed_fetch_ops_enabled",
@@ -764,7 +793,9 @@ void BindAnalysisPredictor(py::module *m) {
       .def("get_serialized_program", &AnalysisPredictor::GetSerializedProgram)
       .def("mkldnn_quantize", &AnalysisPredictor::MkldnnQuantize)
       .def("SaveOptimModel", &AnalysisPredictor::SaveOptimModel,
-           py::arg("dir"));
+           py::arg("dir"))
+      .def("save_mapped_params", &AnalysisPredictor::SaveMappedParams,
+           py::arg("path"));
 }
 
 void BindPaddleInferPredictor(py::module *m) {
@@ -0,0 +1,486 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+#ifdef PADDLE_WITH_MKLML
+#include <omp.h>
+#endif
+
+// CPU selection and sorting primitives shared by the top_k, argsort,
+// kthvalue and mode kernels. All routines work row-wise on a contiguous
+// [rows, cols] buffer.
+//
+// Values are first mapped to unsigned radix keys whose natural order matches
+// the kernels' comparator: NaN compares greater than every number and
+// -0.0 compares equal to +0.0. Descending order is obtained by inverting the
+// keys, so every routine below only has to deal with "smallest first".
+//
+// Top-k and kth-value use an MSD radix select that shrinks the candidate set
+// in place by one byte per pass; argsort and mode use a stable LSD radix sort
+// on (key, index) pairs. Scratch memory is kept per thread and reused across
+// rows and calls.
+
+namespace phi {
+namespace funcs {
+namespace sort_select {
+
+template <typename T>
+struct RadixKeyTraits;
+
+template <>
+struct RadixKeyTraits<float> {
+  using KeyT = uint32_t;
+  static inline KeyT Encode(float v) {
+    if (std::isnan(v)) return std::numeric_limits<KeyT>::max();
+    if (v == 0.0f) return 0x80000000u;
+    KeyT bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+  }
+};
+
+template <>
+struct RadixKeyTraits<double> {
+  using KeyT = uint64_t;
+  static inline KeyT Encode(double v) {
+    if (std::isnan(v)) return std::numeric_limits<KeyT>::max();
+    if (v == 0.0) return 0x8000000000000000ull;
+    KeyT bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return (bits & 0x8000000000000000ull) ? ~bits
+                                          : (bits | 0x8000000000000000ull);
+  }
+};
+
+template <>
+struct RadixKeyTraits<int32_t> {
+  using KeyT = uint32_t;
+  static inline KeyT Encode(int32_t v) {
+    return static_cast<KeyT>(v) ^ 0x80000000u;
+  }
+};
+
+template <>
+struct RadixKeyTraits<int64_t> {
+  using KeyT = uint64_t;
+  static inline KeyT Encode(int64_t v) {
+    return static_cast<KeyT>(v) ^ 0x8000000000000000ull;
+  }
+};
+
+constexpr int kRadixBits = 8;
+constexpr int kRadixBins = 1 << kRadixBits;
+// Below these sizes the comparison based std algorithms win over radix.
+constexpr int64_t kSmallSelectSize = 64;
+constexpr int64_t kSmallSortSize = 64;
+// Rows at least this wide are split across threads when there are too few
+// rows to keep all threads busy.
+constexpr int64_t kParallelRowWidth = 1 << 18;
+
+template <typename T>
+inline typename RadixKeyTraits<T>::KeyT EncodeKey(T v, bool descending) {
+  auto key = RadixKeyTraits<T>::Encode(v);
+  return descending ? ~key : key;
+}
+
+template <typename KeyT>
+struct SortScratch {
+  std::vector<KeyT> keys;
+  std::vector<KeyT> keys_alt;
+  std::vector<int64_t> idx;
+  std::vector<int64_t> idx_alt;
+
+  void Reserve(int64_t n, bool with_alt) {
+    size_t size = static_cast<size_t>(n);
+    if (keys.size() < size) keys.resize(size);
+    if (idx.size() < size) idx.resize(size);
+    if (with_alt) {
+      if (keys_alt.size() < size) keys_alt.resize(size);
+      if (idx_alt.size() < size) idx_alt.resize(size);
+    }
+  }
+};
+
+template <typename KeyT>
+inline SortScratch<KeyT>* GetThreadLocalScratch() {
+  thread_local SortScratch<KeyT> scratch;
+  return &scratch;
+}
+
+inline int GetMaxThreads() {
+#ifdef PADDLE_WITH_MKLML
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+// Finds the key of the given 0-based rank among keys[0, n). The buffer is
+// used as working memory and is clobbered. *num_less receives the number of
+// keys strictly smaller than the returned one.
+template <typename KeyT>
+KeyT RadixSelect(KeyT* keys, int64_t n, int64_t rank, int64_t* num_less) {
+  int64_t less = 0;
+  int64_t m = n;
+  for (int shift = static_cast<int>(sizeof(KeyT) * 8) - kRadixBits;
+       shift >= 0;
+       shift -= kRadixBits) {
+    if (m <= kSmallSelectSize) {
+      std::nth_element(keys, keys + rank, keys + m);
+      KeyT kth = keys[rank];
+      for (int64_t i = 0; i < rank; ++i) {
+        less += keys[i] < kth;
+      }
+      *num_less = less;
+      return kth;
+    }
+    int64_t hist[kRadixBins] = {0};
+    for (int64_t i = 0; i < m; ++i) {
+      ++hist[(keys[i] >> shift) & (kRadixBins - 1)];
+    }
+    KeyT digit = 0;
+    while (rank >= hist[digit]) {
+      rank -= hist[digit];
+      less += hist[digit];
+      ++digit;
+    }
+    if (hist[digit] != m) {
+      int64_t w = 0;
+      for (int64_t i = 0; i < m; ++i) {
+        if (((keys[i] >> shift) & (kRadixBins - 1)) == digit) {
+          keys[w++] = keys[i];
+        }
+      }
+      m = w;
+    }
+  }
+  // Every remaining candidate shares all digits, so they are all equal.
+  *num_less = less;
+  return keys[0];
+}
+
+// Stable LSD radix sort of (keys, idx) in place, using the alt buffers as
+// ping-pong storage. Digits on which all keys agree are skipped.
+template <typename KeyT>
+void RadixSortPairs(
+    KeyT* keys, int64_t* idx, KeyT* keys_alt, int64_t* idx_alt, int64_t n) {
+  constexpr int kPasses = sizeof(KeyT) * 8 / kRadixBits;
+  int64_t hist[kPasses][kRadixBins];
+  std::memset(hist, 0, sizeof(hist));
+  for (int64_t i = 0; i < n; ++i) {
+    KeyT key = keys[i];
+    for (int p = 0; p < kPasses; ++p) {
+      ++hist[p][(key >> (p * kRadixBits)) & (kRadixBins - 1)];
+    }
+  }
+
+  KeyT* src_keys = keys;
+  int64_t* src_idx = idx;
+  KeyT* dst_keys = keys_alt;
+  int64_t* dst_idx = idx_alt;
+  for (int p = 0; p < kPasses; ++p) {
+    int shift = p * kRadixBits;
+    if (hist[p][(src_keys[0] >> shift) & (kRadixBins - 1)] == n) continue;
+    int64_t offset = 0;
+    for (int b = 0; b < kRadixBins; ++b) {
+      int64_t count = hist[p][b];
+      hist[p][b] = offset;
+      offset += count;
+    }
+    for (int64_t i = 0; i < n; ++i) {
+      int64_t pos = hist[p][(src_keys[i] >> shift) & (kRadixBins - 1)]++;
+      dst_keys[pos] = src_keys[i];
+      dst_idx[pos] = src_idx[i];
+    }
+    std::swap(src_keys, dst_keys);
+    std::swap(src_idx, dst_idx);
+  }
+  if (src_keys != keys) {
+    std::memcpy(keys, src_keys, n * sizeof(KeyT));
+    std::memcpy(idx, src_idx, n * sizeof(int64_t));
+  }
+}
+
+// Sorts (keys, idx) by key, breaking ties by index.
+template <typename KeyT>
+void SortPairs(SortScratch<KeyT>* scratch, int64_t n) {
+  KeyT* keys = scratch->keys.data();
+  int64_t* idx = scratch->idx.data();
+  if (n < kSmallSortSize) {
+    // Insertion sort keeps small rows free of the radix pass overhead.
+    for (int64_t i = 1; i < n; ++i) {
+      KeyT key = keys[i];
+      int64_t id = idx[i];
+      int64_t j = i - 1;
+      while (j >= 0 && (keys[j] > key || (keys[j] == key && idx[j] > id))) {
+        keys[j + 1] = keys[j];
+        idx[j + 1] = idx[j];
+        --j;
+      }
+      keys[j + 1] = key;
+      idx[j + 1] = id;
+    }
+    return;
+  }
+  scratch->Reserve(n, true);
+  RadixSortPairs(
+      keys, idx, scratch->keys_alt.data(), scratch->idx_alt.data(), n);
+}
+
+// Selects the k smallest keys of one row into scratch->keys/idx[0, k), in
+// index order unless `sorted` is set. `in` is only read.
+template <typename T>
+void SelectRow(const T* in,
+               int64_t n,
+               int64_t k,
+               bool descending,
+               bool sorted,
+               SortScratch<typename RadixKeyTraits<T>::KeyT>* scratch) {
+  using KeyT = typename RadixKeyTraits<T>::KeyT;
+  scratch->Reserve(n, false);
+  KeyT* keys = scratch->keys.data();
+  int64_t* idx = scratch->idx.data();
+  for (int64_t i = 0; i < n; ++i) {
+    keys[i] = EncodeKey(in[i], descending);
+  }
+
+  if (k < n) {
+    int64_t num_less = 0;
+    KeyT kth = RadixSelect(keys, n, k - 1, &num_less);
+    int64_t num_equal = k - num_less;
+    int64_t w = 0;
+    for (int64_t i = 0; i < n && w < k; ++i) {
+      KeyT key = EncodeKey(in[i], descending);
+      if (key < kth || (key == kth && num_equal-- > 0)) {
+        keys[w] = key;
+        idx[w] = i;
+        ++w;
+      }
+    }
+  } else {
+    for (int64_t i = 0; i < n; ++i) {
+      idx[i] = i;
+    }
+  }
+
+  if (sorted) {
+    SortPairs(scratch, k);
+  }
+}
+
+template <typename T>
+void TopKRow(const T* in,
+             int64_t n,
+             int64_t k,
+             bool largest,
+             bool sorted,
+             T* out,
+             int64_t* indices) {
+  auto* scratch = GetThreadLocalScratch<typename RadixKeyTraits<T>::KeyT>();
+  SelectRow(in, n, k, largest, sorted, scratch);
+  const int64_t* idx = scratch->idx.data();
+  for (int64_t j = 0; j < k; ++j) {
+    out[j] = in[idx[j]];
+    indices[j] = idx[j];
+  }
+}
+
+// Top-k of a single very wide row: every thread selects the top-k of one
+// chunk, then the chunk winners are reduced by a final select.
+template <typename T>
+void TopKWideRow(const T* in,
+                 int64_t n,
+                 int64_t k,
+                 bool largest,
+                 bool sorted,
+                 int num_chunks,
+                 T* out,
+                 int64_t* indices) {
+  int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  std::vector<T> cand_values(num_chunks * k);
+  std::vector<int64_t> cand_indices(num_chunks * k);
+  std::vector<int64_t> cand_counts(num_chunks, 0);
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for num_threads(num_chunks)
+#endif
+  for (int c = 0; c < num_chunks; ++c) {
+    int64_t begin = c * chunk_size;
+    int64_t end = std::min(n, begin + chunk_size);
+    if (begin >= end) continue;
+    int64_t chunk_k = std::min(k, end - begin);
+    TopKRow(in + begin,
+            end - begin,
+            chunk_k,
+            largest,
+            false,
+            cand_values.data() + c * k,
+            cand_indices.data() + c * k);
+    for (int64_t j = 0; j < chunk_k; ++j) {
+      cand_indices[c * k + j] += begin;
+    }
+    cand_counts[c] = chunk_k;
+  }
+
+  int64_t num_cand = 0;
+  for (int c = 0; c < num_chunks; ++c) {
+    for (int64_t j = 0; j < cand_counts[c]; ++j) {
+      cand_values[num_cand] = cand_values[c * k + j];
+      cand_indices[num_cand] = cand_indices[c * k + j];
+      ++num_cand;
+    }
+  }
+  std::vector<int64_t> pos(k);
+  TopKRow(cand_values.data(), num_cand, k, largest, sorted, out, pos.data());
+  for (int64_t j = 0; j < k; ++j) {
+    indices[j] = cand_indices[pos[j]];
+  }
+}
+
+template <typename T>
+void TopKRows(const T* in,
+              int64_t rows,
+              int64_t cols,
+              int64_t k,
+              bool largest,
+              bool sorted,
+              T* out,
+              int64_t* indices) {
+  if (k <= 0) return;
+  int max_threads = GetMaxThreads();
+  if (rows < max_threads && cols >= kParallelRowWidth &&
+      k * max_threads * 4 <= cols) {
+    for (int64_t i = 0; i < rows; ++i) {
+      TopKWideRow(in + i * cols,
+                  cols,
+                  k,
+                  largest,
+                  sorted,
+                  max_threads,
+                  out + i * k,
+                  indices + i * k);
+    }
+    return;
+  }
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for
+#endif
+  for (int64_t i = 0; i < rows; ++i) {
+    TopKRow(in + i * cols,
+            cols,
+            k,
+            largest,
+            sorted,
+            out + i * k,
+            indices + i * k);
+  }
+}
+
+template <typename T>
+void ArgsortRows(const T* in,
+                 int64_t rows,
+                 int64_t cols,
+                 bool descending,
+                 T* out,
+                 int64_t* indices) {
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for
+#endif
+  for (int64_t i = 0; i < rows; ++i) {
+    const T* row = in + i * cols;
+    auto* scratch =
+        GetThreadLocalScratch<typename RadixKeyTraits<T>::KeyT>();
+    SelectRow(row, cols, cols, descending, true, scratch);
+    const int64_t* idx = scratch->idx.data();
+    for (int64_t j = 0; j < cols; ++j) {
+      out[i * cols + j] = row[idx[j]];
+      indices[i * cols + j] = idx[j];
+    }
+  }
+}
+
+// k is 1-based, as in the kthvalue op.
+template <typename T>
+void KthValueRows(const T* in,
+                  int64_t rows,
+                  int64_t cols,
+                  int64_t k,
+                  T* out,
+                  int64_t* indices) {
+  using KeyT = typename RadixKeyTraits<T>::KeyT;
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for
+#endif
+  for (int64_t i = 0; i < rows; ++i) {
+    const T* row = in + i * cols;
+    auto* scratch = GetThreadLocalScratch<KeyT>();
+    scratch->Reserve(cols, false);
+    KeyT* keys = scratch->keys.data();
+    for (int64_t j = 0; j < cols; ++j) {
+      keys[j] = EncodeKey(row[j], false);
+    }
+    int64_t num_less = 0;
+    KeyT kth = RadixSelect(keys, cols, k - 1, &num_less);
+    int64_t pos = 0;
+    while (EncodeKey(row[pos], false) != kth) {
+      ++pos;
+    }
+    out[i] = row[pos];
+    indices[i] = pos;
+  }
+}
+
+// Most frequent value of every row. Ties in frequency go to the smallest
+// value; the reported index is the last occurrence of that value.
+template <typename T>
+void ModeRows(
+    const T* in, int64_t rows, int64_t cols, T* out, int64_t* indices) {
+  using KeyT = typename RadixKeyTraits<T>::KeyT;
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for
+#endif
+  for (int64_t i = 0; i < rows; ++i) {
+    const T* row = in + i * cols;
+    auto* scratch = GetThreadLocalScratch<KeyT>();
+    SelectRow(row, cols, cols, false, true, scratch);
+    const KeyT* keys = scratch->keys.data();
+    const int64_t* idx = scratch->idx.data();
+    int64_t mode_pos = 0;
+    int64_t cur_freq = 0;
+    int64_t max_freq = 0;
+    for (int64_t j = 0; j < cols; ++j) {
+      ++cur_freq;
+      if (j == cols - 1 || keys[j + 1] != keys[j]) {
+        if (cur_freq > max_freq) {
+          max_freq = cur_freq;
+          mode_pos = j;
+        }
+        cur_freq = 0;
+      }
+    }
+    out[i] = row[idx[mode_pos]];
+    indices[i] = idx[mode_pos];
+  }
+}
+
+}  // namespace sort_select
+}  // namespace funcs
+}  // namespace phi
@@ -0,0 +1,431 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+namespace phi {
+namespace funcs {
+
+// A CPU transpose engine. A transpose is first simplified by dropping unit
+// dims and merging input dims that stay adjacent in the output. If the
+// innermost dim does not move, the result is a gather of contiguous rows.
+// Otherwise it is a batch of 2D transposes between the innermost input dim
+// and the input dim that becomes innermost in the output, which are done in
+// L1-sized tiles made of SIMD micro-tiles. Swapping the last two dims of a
+// [..., M, N] tensor, NCHW <-> NHWC and plain matrix transposes all take
+// that path. Tiles (or rows) are spread across threads.
+
+namespace detail {
+
+// Transposes one kSize x kSize micro-tile: dst[c * ld_dst + r] =
+// src[r * ld_src + c]. Strides are in elements.
+template <int kBytes>
+struct SimdTranspose {
+  static constexpr bool kEnabled = false;
+  static constexpr int kSize = 8;
+  static void Run(const void*, int64_t, void*, int64_t) {}
+};
+
+#ifdef __AVX__
+template <>
+struct SimdTranspose<4> {
+  static constexpr bool kEnabled = true;
+  static constexpr int kSize = 8;
+  static void Run(const void* src_ptr,
+                  int64_t ld_src,
+                  void* dst_ptr,
+                  int64_t ld_dst) {
+    const float* src = static_cast<const float*>(src_ptr);
+    float* dst = static_cast<float*>(dst_ptr);
+    __m256 r0 = _mm256_loadu_ps(src);
+    __m256 r1 = _mm256_loadu_ps(src + ld_src);
+    __m256 r2 = _mm256_loadu_ps(src + 2 * ld_src);
+    __m256 r3 = _mm256_loadu_ps(src + 3 * ld_src);
+    __m256 r4 = _mm256_loadu_ps(src + 4 * ld_src);
+    __m256 r5 = _mm256_loadu_ps(src + 5 * ld_src);
+    __m256 r6 = _mm256_loadu_ps(src + 6 * ld_src);
+    __m256 r7 = _mm256_loadu_ps(src + 7 * ld_src);
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+    __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+    __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+    __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+    r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    r4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    r5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    r6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    r7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm256_storeu_ps(dst, _mm256_permute2f128_ps(r0, r4, 0x20));
+    _mm256_storeu_ps(dst + ld_dst, _mm256_permute2f128_ps(r1, r5, 0x20));
+    _mm256_storeu_ps(dst + 2 * ld_dst, _mm256_permute2f128_ps(r2, r6, 0x20));
+    _mm256_storeu_ps(dst + 3 * ld_dst, _mm256_permute2f128_ps(r3, r7, 0x20));
+    _mm256_storeu_ps(dst + 4 * ld_dst, _mm256_permute2f128_ps(r0, r4, 0x31));
+    _mm256_storeu_ps(dst + 5 * ld_dst, _mm256_permute2f128_ps(r1, r5, 0x31));
+    _mm256_storeu_ps(dst + 6 * ld_dst, _mm256_permute2f128_ps(r2, r6, 0x31));
+    _mm256_storeu_ps(dst + 7 * ld_dst, _mm256_permute2f128_ps(r3, r7, 0x31));
+  }
+};
+
+template <>
+struct SimdTranspose<8> {
+  static constexpr bool kEnabled = true;
+  static constexpr int kSize = 8;
+
+  static void Run4x4(const double* src,
+                     int64_t ld_src,
+                     double* dst,
+                     int64_t ld_dst) {
+    __m256d r0 = _mm256_loadu_pd(src);
+    __m256d r1 = _mm256_loadu_pd(src + ld_src);
+    __m256d r2 = _mm256_loadu_pd(src + 2 * ld_src);
+    __m256d r3 = _mm256_loadu_pd(src + 3 * ld_src);
+    __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+    __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+    __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+    __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+    _mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(dst + ld_dst, _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(dst + 2 * ld_dst, _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(dst + 3 * ld_dst, _mm256_permute2f128_pd(t1, t3, 0x31));
+  }
+
+  static void Run(const void* src_ptr,
+                  int64_t ld_src,
+                  void* dst_ptr,
+                  int64_t ld_dst) {
+    const double* src = static_cast<const double*>(src_ptr);
+    double* dst = static_cast<double*>(dst_ptr);
+    Run4x4(src, ld_src, dst, ld_dst);
+    Run4x4(src + 4, ld_src, dst + 4 * ld_dst, ld_dst);
+    Run4x4(src + 4 * ld_src, ld_src, dst + 4, ld_dst);
+    Run4x4(src + 4 * ld_src + 4, ld_src, dst + 4 * ld_dst + 4, ld_dst);
+  }
+};
+#endif  // __AVX__
+
+#if defined(__SSE2__) || defined(_M_X64)
+template <>
+struct SimdTranspose<2> {
+  static constexpr bool kEnabled = true;
+  static constexpr int kSize = 8;
+  static void Run(const void* src_ptr,
+                  int64_t ld_src,
+                  void* dst_ptr,
+                  int64_t ld_dst) {
+    const int16_t* src = static_cast<const int16_t*>(src_ptr);
+    int16_t* dst = static_cast<int16_t*>(dst_ptr);
+    __m128i a[8], b[8];
+    for (int i = 0; i < 8; ++i) {
+      a[i] =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * ld_src));
+    }
+    for (int i = 0; i < 4; ++i) {
+      b[i] = _mm_unpacklo_epi16(a[2 * i], a[2 * i + 1]);
+      b[i + 4] = _mm_unpackhi_epi16(a[2 * i], a[2 * i + 1]);
+    }
+    // b[i]: rows 2i, 2i+1 of cols 0-3; b[i + 4]: the same rows of cols 4-7.
+    for (int g = 0; g < 8; g += 4) {
+      a[g] = _mm_unpacklo_epi32(b[g], b[g + 1]);
+      a[g + 1] = _mm_unpackhi_epi32(b[g], b[g + 1]);
+      a[g + 2] = _mm_unpacklo_epi32(b[g + 2], b[g + 3]);
+      a[g + 3] = _mm_unpackhi_epi32(b[g + 2], b[g + 3]);
+    }
+    // a[g], a[g + 1]: rows 0-3 of cols g..g+3; a[g + 2], a[g + 3]: rows 4-7.
+    for (int g = 0; g < 8; g += 4) {
+      b[g] = _mm_unpacklo_epi64(a[g], a[g + 2]);
+      b[g + 1] = _mm_unpackhi_epi64(a[g], a[g + 2]);
+      b[g + 2] = _mm_unpacklo_epi64(a[g + 1], a[g + 3]);
+      b[g + 3] = _mm_unpackhi_epi64(a[g + 1], a[g + 3]);
+    }
+    for (int i = 0; i < 8; ++i) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * ld_dst), b[i]);
+    }
+  }
+};
+
+template <>
+struct SimdTranspose<1> {
+  static constexpr bool kEnabled = true;
+  static constexpr int kSize = 16;
+  static void Run(const void* src_ptr,
+                  int64_t ld_src,
+                  void* dst_ptr,
+                  int64_t ld_dst) {
+    const int8_t* src = static_cast<const int8_t*>(src_ptr);
+    int8_t* dst = static_cast<int8_t*>(dst_ptr);
+    __m128i a[16], b[16];
+    for (int i = 0; i < 16; ++i) {
+      a[i] =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * ld_src));
+    }
+    for (int i = 0; i < 8; ++i) {
+      b[i] = _mm_unpacklo_epi8(a[2 * i], a[2 * i + 1]);
+      b[i + 8] = _mm_unpackhi_epi8(a[2 * i], a[2 * i + 1]);
+    }
+    // b[i]: rows 2i, 2i+1 of cols 0-7; b[i + 8]: the same rows of cols 8-15.
+    for (int h = 0; h < 16; h += 8) {
+      for (int i = 0; i < 4; ++i) {
+        a[h + i] = _mm_unpacklo_epi16(b[h + 2 * i], b[h + 2 * i + 1]);
+        a[h + i + 4] = _mm_unpackhi_epi16(b[h + 2 * i], b[h + 2 * i + 1]);
+      }
+    }
+    // a[g..g+3] for g in {0, 4, 8, 12}: rows 0-3, 4-7, 8-11, 12-15 of cols
+    // g..g+3.
+    for (int g = 0; g < 16; g += 4) {
+      b[g] = _mm_unpacklo_epi32(a[g], a[g + 1]);
+      b[g + 1] = _mm_unpackhi_epi32(a[g], a[g + 1]);
+      b[g + 2] = _mm_unpacklo_epi32(a[g + 2], a[g + 3]);
+      b[g + 3] = _mm_unpackhi_epi32(a[g + 2], a[g + 3]);
+    }
+    for (int g = 0; g < 16; g += 4) {
+      a[g] = _mm_unpacklo_epi64(b[g], b[g + 2]);
+      a[g + 1] = _mm_unpackhi_epi64(b[g], b[g + 2]);
+      a[g + 2] = _mm_unpacklo_epi64(b[g + 1], b[g + 3]);
+      a[g + 3] = _mm_unpackhi_epi64(b[g + 1], b[g + 3]);
+    }
+    for (int i = 0; i < 16; ++i) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * ld_dst), a[i]);
+    }
+  }
+};
+#endif  // __SSE2__
+
+template <typename T>
+struct TransposeMicroKernel {
+  using Simd = SimdTranspose<sizeof(T)>;
+  static constexpr bool kUseSimd =
+      Simd::kEnabled && std::is_trivially_copyable<T>::value;
+  static constexpr int kSize = kUseSimd ? Simd::kSize : 8;
+
+  static void Run(const T* src, int64_t ld_src, T* dst, int64_t ld_dst) {
+    if (kUseSimd) {
+      Simd::Run(src, ld_src, dst, ld_dst);
+      return;
+    }
+    for (int r = 0; r < kSize; ++r) {
+      for (int c = 0; c < kSize; ++c) {
+        dst[c * ld_dst + r] = src[r * ld_src + c];
+      }
+    }
+  }
+};
+
+// Side of the square tiles handed to one thread: two tiles (source and
+// destination) of 64 x 64 four-byte elements fit in a 48KB L1.
+template <typename T>
+constexpr int64_t TransposeTileSize() {
+  return sizeof(T) <= 2 ? 128 : (sizeof(T) <= 4 ? 64 : 32);
+}
+
+// Work below this many elements stays on the calling thread.
+constexpr int64_t kParallelTransposeNumel = 1 << 15;
+
+template <typename T>
+void TransposeTile(const T* src,
+                   int64_t ld_src,
+                   T* dst,
+                   int64_t ld_dst,
+                   int64_t rows,
+                   int64_t cols) {
+  using Micro = TransposeMicroKernel<T>;
+  const int64_t k = Micro::kSize;
+  const int64_t full_rows = rows / k * k;
+  const int64_t full_cols = cols / k * k;
+  for (int64_t r = 0; r < full_rows; r += k) {
+    for (int64_t c = 0; c < full_cols; c += k) {
+      Micro::Run(src + r * ld_src + c, ld_src, dst + c * ld_dst + r, ld_dst);
+    }
+  }
+  for (int64_t r = 0; r < rows; ++r) {
+    const int64_t c_begin = r < full_rows ? full_cols : 0;
+    for (int64_t c = c_begin; c < cols; ++c) {
+      dst[c * ld_dst + r] = src[r * ld_src + c];
+    }
+  }
+}
+
+}  // namespace detail
+
+// Drops unit dims and merges input dims that stay adjacent and in order in
+// the output. The simplified transpose has the same memory effect as the
+// original one. A transpose of only unit dims becomes {1} / {0}.
+inline void SimplifyTransposeDims(const std::vector<int64_t>& dims,
+                                  const std::vector<int>& axis,
+                                  std::vector<int64_t>* new_dims,
+                                  std::vector<int>* new_axis) {
+  const int rank = static_cast<int>(dims.size());
+  std::vector<int> kept_index(rank, -1);
+  std::vector<int64_t> kept_dims;
+  for (int i = 0; i < rank; ++i) {
+    if (dims[i] != 1) {
+      kept_index[i] = static_cast<int>(kept_dims.size());
+      kept_dims.push_back(dims[i]);
+    }
+  }
+  std::vector<int> kept_axis;
+  for (int i = 0; i < rank; ++i) {
+    if (kept_index[axis[i]] >= 0) kept_axis.push_back(kept_index[axis[i]]);
+  }
+  new_dims->clear();
+  new_axis->clear();
+  if (kept_axis.empty()) {
+    new_dims->push_back(1);
+    new_axis->push_back(0);
+    return;
+  }
+
+  // Groups of consecutive input dims, in output order.
+  std::vector<int> group_start;
+  std::vector<int> group_end;
+  for (size_t i = 0; i < kept_axis.size(); ++i) {
+    if (i > 0 && kept_axis[i] == group_end.back()) {
+      ++group_end.back();
+    } else {
+      group_start.push_back(kept_axis[i]);
+      group_end.push_back(kept_axis[i] + 1);
+    }
+  }
+  // Number the groups by their position in the input.
+  const int num_groups = static_cast<int>(group_start.size());
+  std::vector<int> input_order(num_groups);
+  for (int g = 0; g < num_groups; ++g) input_order[g] = g;
+  std::sort(input_order.begin(), input_order.end(), [&](int l, int r) {
+    return group_start[l] < group_start[r];
+  });
+  new_dims->resize(num_groups);
+  new_axis->resize(num_groups);
+  for (int i = 0; i < num_groups; ++i) {
+    const int g = input_order[i];
+    int64_t size = 1;
+    for (int d = group_start[g]; d < group_end[g]; ++d) size *= kept_dims[d];
+    (*new_dims)[i] = size;
+    (*new_axis)[g] = i;
+  }
+}
+
+// out = transpose(in, axis), where in has shape dims and out has shape
+// dims[axis[0]], ..., dims[axis[rank - 1]]. in and out must not overlap.
+template <typename T>
+void TransposeCPU(const T* in,
+                  const std::vector<int64_t>& dims,
+                  const std::vector<int>& axis,
+                  T* out) {
+  std::vector<int64_t> d;
+  std::vector<int> a;
+  SimplifyTransposeDims(dims, axis, &d, &a);
+  const int rank = static_cast<int>(d.size());
+  int64_t numel = 1;
+  for (int i = 0; i < rank; ++i) numel *= d[i];
+  if (numel == 0) return;
+  if (rank == 1) {
+    std::copy(in, in + numel, out);
+    return;
+  }
+
+  std::vector<int64_t> in_stride(rank, 1);
+  std::vector<int64_t> out_stride(rank, 1);
+  for (int i = rank - 2; i >= 0; --i) {
+    in_stride[i] = in_stride[i + 1] * d[i + 1];
+    out_stride[i] = out_stride[i + 1] * d[a[i + 1]];
+  }
+  // The output stride of every input dim.
+  std::vector<int64_t> in_out_stride(rank);
+  for (int i = 0; i < rank; ++i) in_out_stride[a[i]] = out_stride[i];
+  const bool parallel = numel >= detail::kParallelTransposeNumel;
+  (void)parallel;
+
+  if (a[rank - 1] == rank - 1) {
+    // The innermost dim stays innermost: gather contiguous rows.
+    const int64_t row = d[rank - 1];
+    const int64_t num_rows = numel / row;
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for if (parallel)
+#endif
+    for (int64_t r = 0; r < num_rows; ++r) {
+      int64_t rest = r;
+      int64_t in_offset = 0;
+      for (int i = rank - 2; i >= 0; --i) {
+        const int64_t size = d[a[i]];
+        in_offset += (rest % size) * in_stride[a[i]];
+        rest /= size;
+      }
+      std::copy(in + in_offset, in + in_offset + row, out + r * row);
+    }
+    return;
+  }
+
+  // Batches of [rows, cols] -> [cols, rows] transposes, where cols is the
+  // innermost input dim and rows the input dim that becomes innermost.
+  const int row_dim = a[rank - 1];
+  const int col_dim = rank - 1;
+  const int64_t rows = d[row_dim];
+  const int64_t cols = d[col_dim];
+  const int64_t ld_src = in_stride[row_dim];
+  const int64_t ld_dst = in_out_stride[col_dim];
+  std::vector<int> batch_dims;
+  for (int i = 0; i < rank - 1; ++i) {
+    if (i != row_dim) batch_dims.push_back(i);
+  }
+  const int64_t tile = detail::TransposeTileSize<T>();
+  const int64_t row_tiles = (rows + tile - 1) / tile;
+  const int64_t col_tiles = (cols + tile - 1) / tile;
+  const int64_t tiles_per_batch = row_tiles * col_tiles;
+  const int64_t num_work = numel / (rows * cols) * tiles_per_batch;
+
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for if (parallel)
+#endif
+  for (int64_t w = 0; w < num_work; ++w) {
+    int64_t batch = w / tiles_per_batch;
+    const int64_t tile_id = w % tiles_per_batch;
+    const int64_t r0 = tile_id / col_tiles * tile;
+    const int64_t c0 = tile_id % col_tiles * tile;
+    int64_t in_offset = r0 * ld_src + c0;
+    int64_t out_offset = c0 * ld_dst + r0;
+    for (int i = static_cast<int>(batch_dims.size()) - 1; i >= 0; --i) {
+      const int b = batch_dims[i];
+      const int64_t coord = batch % d[b];
+      batch /= d[b];
+      in_offset += coord * in_stride[b];
+      out_offset += coord * in_out_stride[b];
+    }
+    detail::TransposeTile(in + in_offset,
+                          ld_src,
+                          out + out_offset,
+                          ld_dst,
+                          std::min(tile, rows - r0),
+                          std::min(tile, cols - c0));
+  }
+}
+
+}  // namespace funcs
+}  // namespace phi
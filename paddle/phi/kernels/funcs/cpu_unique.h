@@ -0,0 +1,307 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#ifdef PADDLE_WITH_MKLML
+#include <omp.h>
+#endif
+
+#include "paddle/phi/kernels/funcs/cpu_sort_select.h"
+#include "paddle/phi/kernels/funcs/flat_hash_map.h"
+
+namespace phi {
+namespace funcs {
+
+// CPU building blocks of the unique and unique_consecutive kernels. The
+// distinct values, the index of their first occurrence, their counts and
+// the inverse mapping all come out of a single hashing pass over the input.
+
+// Distinct values of a flat input. first_index and counts are only filled
+// when requested.
+template <typename T>
+struct CPUUniqueResult {
+  std::vector<T> values;
+  std::vector<int64_t> first_index;
+  std::vector<int64_t> counts;
+};
+
+// Inputs with fewer elements are deduplicated on the calling thread.
+constexpr int64_t kParallelUniqueNumel = 1 << 20;
+
+namespace detail {
+
+template <typename T, typename IndexT>
+void UniqueSequential(const T* in,
+                      int64_t n,
+                      bool need_index,
+                      bool need_counts,
+                      IndexT* inverse,
+                      CPUUniqueResult<T>* result) {
+  FlatHashMap<T, int64_t> ids(std::min<int64_t>(n, 1 << 16));
+  for (int64_t i = 0; i < n; ++i) {
+    bool inserted = false;
+    const int64_t id = *ids.Insert(
+        in[i], static_cast<int64_t>(result->values.size()), &inserted);
+    if (inserted) {
+      result->values.push_back(in[i]);
+      if (need_index) result->first_index.push_back(i);
+      if (need_counts) result->counts.push_back(0);
+    }
+    if (need_counts) ++result->counts[id];
+    if (inverse) inverse[i] = static_cast<IndexT>(id);
+  }
+}
+
+// Splits the elements into one partition per thread by hash, deduplicates
+// every partition on its own thread, then restores the global
+// first-occurrence order with a radix sort of the first indices.
+template <typename T, typename IndexT>
+void UniqueParallel(const T* in,
+                    int64_t n,
+                    int num_threads,
+                    bool need_index,
+                    bool need_counts,
+                    IndexT* inverse,
+                    CPUUniqueResult<T>* result) {
+  const int parts = num_threads;
+  auto partition_of = [parts](const T& v) {
+    // The high bits, so partitions do not correlate with the table slots.
+    return static_cast<int>((FlatHash<T>()(v) >> 32) % parts);
+  };
+
+  // Stable radix partition of the element positions.
+  std::vector<int64_t> hist(static_cast<size_t>(parts) * parts, 0);
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for num_threads(parts)
+#endif
+  for (int t = 0; t < parts; ++t) {
+    const int64_t begin = n * t / parts;
+    const int64_t end = n * (t + 1) / parts;
+    int64_t* h = hist.data() + static_cast<size_t>(t) * parts;
+    for (int64_t i = begin; i < end; ++i) ++h[partition_of(in[i])];
+  }
+  std::vector<int64_t> part_begin(parts + 1, 0);
+  int64_t offset = 0;
+  for (int p = 0; p < parts; ++p) {
+    part_begin[p] = offset;
+    for (int t = 0; t < parts; ++t) {
+      int64_t count = hist[static_cast<size_t>(t) * parts + p];
+      hist[static_cast<size_t>(t) * parts + p] = offset;
+      offset += count;
+    }
+  }
+  part_begin[parts] = n;
+  std::vector<int64_t> order(n);
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for num_threads(parts)
+#endif
+  for (int t = 0; t < parts; ++t) {
+    const int64_t begin = n * t / parts;
+    const int64_t end = n * (t + 1) / parts;
+    int64_t* h = hist.data() + static_cast<size_t>(t) * parts;
+    for (int64_t i = begin; i < end; ++i) order[h[partition_of(in[i])]++] = i;
+  }
+
+  // Per-partition dedup. local_id[k] is the id of in[order[k]] within its
+  // partition.
+  std::vector<CPUUniqueResult<T>> locals(parts);
+  std::vector<int64_t> local_id(n);
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for num_threads(parts) schedule(dynamic)
+#endif
+  for (int p = 0; p < parts; ++p) {
+    auto* local = &locals[p];
+    const int64_t begin = part_begin[p];
+    const int64_t end = part_begin[p + 1];
+    FlatHashMap<T, int64_t> ids(std::min<int64_t>(end - begin, 1 << 16));
+    for (int64_t k = begin; k < end; ++k) {
+      const int64_t i = order[k];
+      bool inserted = false;
+      const int64_t id = *ids.Insert(
+          in[i], static_cast<int64_t>(local->values.size()), &inserted);
+      if (inserted) {
+        local->values.push_back(in[i]);
+        local->first_index.push_back(i);
+        if (need_counts) local->counts.push_back(0);
+      }
+      if (need_counts) ++local->counts[id];
+      local_id[k] = id;
+    }
+  }
+
+  // Order the partition results by first occurrence.
+  std::vector<int64_t> local_begin(parts + 1, 0);
+  for (int p = 0; p < parts; ++p) {
+    local_begin[p + 1] = local_begin[p] + locals[p].values.size();
+  }
+  const int64_t num_unique = local_begin[parts];
+  std::vector<uint64_t> keys(num_unique), keys_alt(num_unique);
+  std::vector<int64_t> pos(num_unique), pos_alt(num_unique);
+  for (int p = 0; p < parts; ++p) {
+    for (size_t j = 0; j < locals[p].values.size(); ++j) {
+      keys[local_begin[p] + j] = locals[p].first_index[j];
+      pos[local_begin[p] + j] = local_begin[p] + j;
+    }
+  }
+  sort_select::RadixSortPairs(
+      keys.data(), pos.data(), keys_alt.data(), pos_alt.data(), num_unique);
+
+  // pos_alt is reused as the map from concatenated local position to the
+  // global id.
+  result->values.resize(num_unique);
+  if (need_index) result->first_index.resize(num_unique);
+  if (need_counts) result->counts.resize(num_unique);
+  for (int64_t g = 0; g < num_unique; ++g) {
+    const int64_t c = pos[g];
+    const int part = static_cast<int>(
+        std::upper_bound(local_begin.begin(), local_begin.end(), c) -
+        local_begin.begin() - 1);
+    const int64_t j = c - local_begin[part];
+    result->values[g] = locals[part].values[j];
+    if (need_index) result->first_index[g] = static_cast<int64_t>(keys[g]);
+    if (need_counts) result->counts[g] = locals[part].counts[j];
+    pos_alt[c] = g;
+  }
+
+  if (inverse) {
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for num_threads(parts) schedule(dynamic)
+#endif
+    for (int p = 0; p < parts; ++p) {
+      const int64_t* global_id = pos_alt.data() + local_begin[p];
+      for (int64_t k = part_begin[p]; k < part_begin[p + 1]; ++k) {
+        inverse[order[k]] = static_cast<IndexT>(global_id[local_id[k]]);
+      }
+    }
+  }
+}
+
+}  // namespace detail
+
+// Deduplicates in[0, n) keeping the first-occurrence order. inverse, if not
+// null, receives for every element the position of its value in
+// result->values. first_index and counts are filled on request. Large inputs
+// are hashed on all threads; the result does not depend on the thread count.
+template <typename T, typename IndexT>
+void UniqueFirstOccurrence(const T* in,
+                           int64_t n,
+                           bool need_index,
+                           bool need_counts,
+                           IndexT* inverse,
+                           CPUUniqueResult<T>* result) {
+  result->values.clear();
+  result->first_index.clear();
+  result->counts.clear();
+  const int num_threads = sort_select::GetMaxThreads();
+  if (n >= kParallelUniqueNumel && num_threads > 1) {
+    detail::UniqueParallel(
+        in, n, num_threads, need_index, need_counts, inverse, result);
+  } else {
+    detail::UniqueSequential(in, n, need_index, need_counts, inverse, result);
+  }
+}
+
+// Sorts a first-occurrence result in ascending order of value and remaps
+// inverse[0, n) accordingly. Only the distinct values are sorted, with the
+// radix argsort of cpu_sort_select.h.
+template <typename T, typename IndexT>
+void SortUniqueResult(CPUUniqueResult<T>* result,
+                      IndexT* inverse,
+                      int64_t n) {
+  const int64_t num_unique = result->values.size();
+  if (num_unique == 0) return;
+  std::vector<T> sorted(num_unique);
+  std::vector<int64_t> perm(num_unique);
+  sort_select::ArgsortRows<T>(result->values.data(),
+                              1,
+                              num_unique,
+                              false,
+                              sorted.data(),
+                              perm.data());
+  std::vector<int64_t> rank(num_unique);
+  for (int64_t j = 0; j < num_unique; ++j) rank[perm[j]] = j;
+  result->values.swap(sorted);
+  auto permute = [&](std::vector<int64_t>* v) {
+    if (v->empty()) return;
+    std::vector<int64_t> tmp(num_unique);
+    for (int64_t j = 0; j < num_unique; ++j) tmp[j] = (*v)[perm[j]];
+    v->swap(tmp);
+  };
+  permute(&result->first_index);
+  permute(&result->counts);
+  if (inverse) {
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for if (n >= kParallelUniqueNumel)
+#endif
+    for (int64_t i = 0; i < n; ++i) {
+      inverse[i] = static_cast<IndexT>(rank[static_cast<int64_t>(inverse[i])]);
+    }
+  }
+}
+
+// Returns the start of every run of equal consecutive elements of in[0, n),
+// found in parallel for large inputs.
+template <typename T>
+std::vector<int64_t> ConsecutiveRunStarts(const T* in, int64_t n) {
+  const int parts =
+      n >= kParallelUniqueNumel ? sort_select::GetMaxThreads() : 1;
+  std::vector<std::vector<int64_t>> starts(parts);
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for num_threads(parts) if (parts > 1)
+#endif
+  for (int t = 0; t < parts; ++t) {
+    const int64_t begin = n * t / parts;
+    const int64_t end = n * (t + 1) / parts;
+    for (int64_t i = begin; i < end; ++i) {
+      if (i == 0 || in[i] != in[i - 1]) starts[t].push_back(i);
+    }
+  }
+  for (int t = 1; t < parts; ++t) {
+    starts[0].insert(starts[0].end(), starts[t].begin(), starts[t].end());
+  }
+  return std::move(starts[0]);
+}
+
+// Fills unique_consecutive outputs from the run starts. out and counts have
+// room for starts.size() elements and inverse for n; counts and inverse may
+// be null.
+template <typename T, typename IndexT>
+void UniqueConsecutiveFromRuns(const T* in,
+                               int64_t n,
+                               const std::vector<int64_t>& starts,
+                               T* out,
+                               IndexT* inverse,
+                               IndexT* counts) {
+  const int64_t num_runs = starts.size();
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for if (n >= kParallelUniqueNumel)
+#endif
+  for (int64_t r = 0; r < num_runs; ++r) {
+    const int64_t end = r + 1 < num_runs ? starts[r + 1] : n;
+    out[r] = in[starts[r]];
+    if (counts) counts[r] = static_cast<IndexT>(end - starts[r]);
+    if (inverse) {
+      for (int64_t i = starts[r]; i < end; ++i) {
+        inverse[i] = static_cast<IndexT>(r);
+      }
+    }
+  }
+}
+
+}  // namespace funcs
+}  // namespace phi
@@ -0,0 +1,157 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace phi {
+namespace funcs {
+
+// Finalizer of MurmurHash3, good enough to spread sequential ids over the
+// whole table.
+inline uint64_t MixHash64(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+template <typename KeyT, typename Enable = void>
+struct FlatHash {
+  uint64_t operator()(const KeyT& key) const {
+    return MixHash64(static_cast<uint64_t>(std::hash<KeyT>()(key)));
+  }
+};
+
+template <typename KeyT>
+struct FlatHash<KeyT,
+                typename std::enable_if<std::is_integral<KeyT>::value>::type> {
+  uint64_t operator()(KeyT key) const {
+    return MixHash64(static_cast<uint64_t>(key));
+  }
+};
+
+// An insert-only hash map with open addressing and linear probing. Keys and
+// values live in flat arrays, so building a map over N keys costs a handful
+// of allocations instead of one node per key. Callers that know an upper
+// bound of the number of keys should pass it to the constructor (or Reset)
+// so the table never has to grow.
+template <typename KeyT,
+          typename ValueT,
+          typename Hash = FlatHash<KeyT>,
+          typename Equal = std::equal_to<KeyT>>
+class FlatHashMap {
+ public:
+  explicit FlatHashMap(size_t expected_size = 0) { Reset(expected_size); }
+
+  // Clears the map and makes room for expected_size keys, reusing the
+  // existing storage when it is large enough.
+  void Reset(size_t expected_size) {
+    size_t capacity = kMinCapacity;
+    while (capacity < expected_size * 2) {
+      capacity <<= 1;
+    }
+    keys_.resize(capacity);
+    values_.resize(capacity);
+    used_.assign(capacity, 0);
+    mask_ = capacity - 1;
+    size_ = 0;
+  }
+
+  // Returns the value stored for key. If the key is absent, value is stored
+  // first and *inserted is set to true.
+  ValueT* Insert(const KeyT& key, const ValueT& value, bool* inserted) {
+    if ((size_ + 1) * 2 > used_.size()) {
+      Grow();
+    }
+    size_t pos = Hash()(key) & mask_;
+    while (used_[pos]) {
+      if (Equal()(keys_[pos], key)) {
+        *inserted = false;
+        return &values_[pos];
+      }
+      pos = (pos + 1) & mask_;
+    }
+    used_[pos] = 1;
+    keys_[pos] = key;
+    values_[pos] = value;
+    ++size_;
+    *inserted = true;
+    return &values_[pos];
+  }
+
+  // Returns nullptr if key is absent.
+  const ValueT* Find(const KeyT& key) const {
+    size_t pos = Hash()(key) & mask_;
+    while (used_[pos]) {
+      if (Equal()(keys_[pos], key)) {
+        return &values_[pos];
+      }
+      pos = (pos + 1) & mask_;
+    }
+    return nullptr;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Calls fn(key, value) for every entry, in table order.
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    for (size_t i = 0; i < used_.size(); ++i) {
+      if (used_[i]) fn(keys_[i], values_[i]);
+    }
+  }
+
+ private:
+  static constexpr size_t kMinCapacity = 16;
+
+  void Grow() {
+    std::vector<KeyT> old_keys = std::move(keys_);
+    std::vector<ValueT> old_values = std::move(values_);
+    std::vector<uint8_t> old_used = std::move(used_);
+    size_t capacity = old_used.size() * 2;
+    keys_.resize(capacity);
+    values_.resize(capacity);
+    used_.assign(capacity, 0);
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < old_used.size(); ++i) {
+      if (!old_used[i]) continue;
+      size_t pos = Hash()(old_keys[i]) & mask_;
+      while (used_[pos]) {
+        pos = (pos + 1) & mask_;
+      }
+      used_[pos] = 1;
+      keys_[pos] = std::move(old_keys[i]);
+      values_[pos] = std::move(old_values[i]);
+    }
+  }
+
+  std::vector<KeyT> keys_;
+  std::vector<ValueT> values_;
+  std::vector<uint8_t> used_;
+  size_t mask_{0};
+  size_t size_{0};
+};
+
+}  // namespace funcs
+}  // namespace phi
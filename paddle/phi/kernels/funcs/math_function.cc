@@ -29,6 +29,7 @@ limitations under the License. */
 #include "paddle/fluid/platform/bfloat16.h"
 #include "paddle/fluid/platform/float16.h"
 #include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/kernels/funcs/cpu_transpose.h"
 #include "paddle/phi/kernels/funcs/eigen/common.h"
 #include "paddle/phi/kernels/funcs/math_function_impl.h"
 #include "unsupported/Eigen/CXX11/Tensor"
@@ -84,6 +85,39 @@ template struct SetConstant<paddle::platform::XPUDeviceContext,
                             phi::dtype::complex<double>>;
 #endif
 
+template <typename T>
+static void TransposeWithCPUEngine(const paddle::framework::Tensor& in,
+                                   paddle::framework::Tensor* out,
+                                   const std::vector<int>& axis) {
+  PADDLE_ENFORCE_EQ(
+      static_cast<size_t>(in.dims().size()),
+      axis.size(),
+      phi::errors::InvalidArgument("The rank of the input (%d) should be "
+                                   "equal to the size of axis (%d).",
+                                   in.dims().size(),
+                                   axis.size()));
+  TransposeCPU<T>(
+      in.data<T>(), phi::vectorize(in.dims()), axis, out->data<T>());
+}
+
+template <typename T, int Rank>
+void Transpose<phi::CPUContext, T, Rank>::operator()(
+    const phi::CPUContext& context,
+    const paddle::framework::Tensor& in,
+    paddle::framework::Tensor* out,
+    const std::vector<int>& axis) {
+  TransposeWithCPUEngine<T>(in, out, axis);
+}
+
+template <typename T, int Rank>
+void Transpose<paddle::platform::CPUDeviceContext, T, Rank>::operator()(
+    const paddle::platform::CPUDeviceContext& context,
+    const paddle::framework::Tensor& in,
+    paddle::framework::Tensor* out,
+    const std::vector<int>& axis) {
+  TransposeWithCPUEngine<T>(in, out, axis);
+}
+
 #define DEFINE_CPU_TRANS(RANK)                                                 \
   template struct Transpose<paddle::platform::CPUDeviceContext,                \
                             phi::dtype::float16,                               \
@@ -139,26 +173,7 @@ void TransposeNormal<DeviceContext, T>::operator()(
     const paddle::framework::Tensor& in,
     paddle::framework::Tensor* out,
     const std::vector<int>& axis) {
-  const int rank = axis.size();
-  auto in_stride = phi::stride(in.dims());
-  auto out_stride = phi::stride(out->dims());
-  const T* in_ptr = in.data<T>();
-  T* out_ptr = out->data<T>();
-
-  auto transpose_helper = [&](int64_t beg, int64_t end) {
-    for (int64_t out_idx = beg; out_idx < end; ++out_idx) {
-      int64_t in_idx = 0;
-      int64_t tmp_idx = out_idx;
-      // calculate the input index
-      for (int i = 0; i < rank; ++i) {
-        const int64_t coordinate = tmp_idx / out_stride[i];
-        tmp_idx -= coordinate * out_stride[i];
-        in_idx += coordinate * in_stride[axis[i]];
-      }
-      out_ptr[out_idx] = in_ptr[in_idx];
-    }
-  };
-  transpose_helper(0, out->numel());
+  TransposeWithCPUEngine<T>(in, out, axis);
 }
 
 // define transpose normal
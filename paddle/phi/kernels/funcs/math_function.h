@@ -47,6 +47,24 @@ struct Transpose {
                   const std::vector<int>& axis);
 };
 
+// On CPU every rank goes through the blocked engine in cpu_transpose.h
+// instead of an Eigen shuffle.
+template <typename T, int Rank>
+struct Transpose<phi::CPUContext, T, Rank> {
+  void operator()(const phi::CPUContext& context,
+                  const paddle::framework::Tensor& in,
+                  paddle::framework::Tensor* out,
+                  const std::vector<int>& axis);
+};
+
+template <typename T, int Rank>
+struct Transpose<paddle::platform::CPUDeviceContext, T, Rank> {
+  void operator()(const paddle::platform::CPUDeviceContext& context,
+                  const paddle::framework::Tensor& in,
+                  paddle::framework::Tensor* out,
+                  const std::vector<int>& axis);
+};
+
 template <typename DeviceContext, typename T>
 struct SetConstant {
   void operator()(const DeviceContext& context,
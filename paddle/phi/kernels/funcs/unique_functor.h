@@ -16,6 +16,7 @@
 #include "paddle/fluid/framework/convert_utils.h"
 #include "paddle/phi/core/dense_tensor.h"
 #include "paddle/phi/kernels/funcs/concat_and_split_functor.h"
+#include "paddle/phi/kernels/funcs/cpu_unique.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
 
 namespace phi {
@@ -41,12 +42,6 @@ struct UniqueOpFunctor {
     auto* in_data = in_->data<InT>();
     auto* index_data = context_.template Alloc<IndexT>(index_);
 
-    int64_t j = 0;
-
-    // TODO(fangzeyang): Should optimize performance here.
-    std::unordered_map<InT, int64_t> dict;
-    std::vector<InT> uniq;
-
     PADDLE_ENFORCE_LT(
         in_->numel(),
         pow(2, 31),
@@ -55,25 +50,11 @@ struct UniqueOpFunctor {
             "but received num is %d.",
             in_->numel()));
 
-    for (auto i = 0; i < in_->numel(); i++) {
-      auto it = dict.find(in_data[i]);
-      if (it == dict.end()) {
-        dict.emplace(std::make_pair(in_data[i], j));
-        uniq.emplace_back(in_data[i]);
-        index_data[i] = static_cast<IndexT>(j);
-        j++;
-      } else {
-        index_data[i] = static_cast<IndexT>(it->second);
-      }
-    }
+    CPUUniqueResult<InT> uniq;
+    UniqueFirstOccurrence(
+        in_data, in_->numel(), false, count_ != nullptr, index_data, &uniq);
 
     if (count_ != nullptr) {
-      // Resize the count tensor dims to allocate the memory
-      count_->Resize(phi::make_ddim({static_cast<int64_t>(uniq.size())}));
-      IndexT* count_data = context_.template Alloc<IndexT>(count_);
-      // init count_data to 0
-      memset(count_data, 0, uniq.size() * sizeof(IndexT));
-
       const auto& index_type = index_->dtype();
       bool index_type_match =
           index_type == DataType::INT32 || index_type == DataType::INT64;
@@ -90,22 +71,18 @@ struct UniqueOpFunctor {
               paddle::framework::DataTypeToString(
                   paddle::framework::TransToProtoVarType(DataType::INT64))));
 
-      if (index_type == DataType::INT32) {
-        for (auto i = 0; i < in_->numel(); ++i) {
-          const IndexT& index = index_data[i];
-          count_data[static_cast<int32_t>(index)] += static_cast<IndexT>(1);
-        }
-      } else {
-        for (auto i = 0; i < in_->numel(); ++i) {
-          const IndexT& index = index_data[i];
-          count_data[static_cast<int64_t>(index)] += static_cast<IndexT>(1);
-        }
-      }
+      count_->Resize(
+          phi::make_ddim({static_cast<int64_t>(uniq.counts.size())}));
+      IndexT* count_data = context_.template Alloc<IndexT>(count_);
+      std::transform(uniq.counts.begin(),
+                     uniq.counts.end(),
+                     count_data,
+                     [](int64_t c) { return static_cast<IndexT>(c); });
     }
 
-    out_->Resize(phi::make_ddim({static_cast<int64_t>(uniq.size())}));
+    out_->Resize(phi::make_ddim({static_cast<int64_t>(uniq.values.size())}));
     auto* out_data = context_.template Alloc<InT>(out_);
-    std::memcpy(out_data, uniq.data(), uniq.size() * sizeof(InT));
+    std::copy(uniq.values.begin(), uniq.values.end(), out_data);
   }
 };
 
@@ -142,52 +119,37 @@ static void UniqueFlattendTensor(const Context& context,
                                  bool return_inverse,
                                  bool return_counts) {
   const InT* in_data = in.data<InT>();
-  std::set<InT> unique(in_data, in_data + in.numel());
-  out->Resize(phi::make_ddim({static_cast<int64_t>(unique.size())}));
+  const int64_t numel = in.numel();
+  IndexT* inverse_data = nullptr;
+  if (return_inverse) {
+    index->Resize(phi::make_ddim({numel}));
+    inverse_data = context.template Alloc<IndexT>(index);
+  }
+  CPUUniqueResult<InT> uniq;
+  UniqueFirstOccurrence(
+      in_data, numel, return_index, return_counts, inverse_data, &uniq);
+  SortUniqueResult(&uniq, inverse_data, numel);
+
+  const int64_t num_unique = uniq.values.size();
+  out->Resize(phi::make_ddim({num_unique}));
   auto* out_data = context.template Alloc<InT>(out);
-  std::copy(unique.begin(), unique.end(), out_data);
+  std::copy(uniq.values.begin(), uniq.values.end(), out_data);
 
+  auto to_index = [](int64_t v) { return static_cast<IndexT>(v); };
   if (return_index) {
-    indices->Resize(phi::make_ddim({out->numel()}));
-    auto indices_data = context.template Alloc<IndexT>(indices);
-    std::unordered_map<InT, IndexT> indices_map;
-    indices_map.reserve(out->numel());
-    for (int64_t i = 0; i < in.numel(); ++i) {
-      if (indices_map.find(in_data[i]) != indices_map.end()) continue;
-      indices_map[in_data[i]] = i;
-    }
-    for (int64_t i = 0; i < out->numel(); ++i) {
-      indices_data[i] = indices_map[out_data[i]];
-    }
-  }
-
-  if (return_inverse) {
-    index->Resize(phi::make_ddim({in.numel()}));
-    auto inverse_data = context.template Alloc<IndexT>(index);
-    std::unordered_map<InT, IndexT> inverse_map;
-    inverse_map.reserve(out->numel());
-    for (int64_t i = 0; i < out->numel(); ++i) {
-      inverse_map[out_data[i]] = i;
-    }
-    for (int64_t i = 0; i < in.numel(); ++i) {
-      inverse_data[i] = inverse_map[in_data[i]];
-    }
+    indices->Resize(phi::make_ddim({num_unique}));
+    auto* indices_data = context.template Alloc<IndexT>(indices);
+    std::transform(uniq.first_index.begin(),
+                   uniq.first_index.end(),
+                   indices_data,
+                   to_index);
   }
 
   if (return_counts) {
-    count->Resize(phi::make_ddim({out->numel()}));
-    auto count_data = context.template Alloc<IndexT>(count);
-    std::unordered_map<InT, IndexT> counts_map;
-    counts_map.reserve(out->numel());
-    for (int64_t i = 0; i < out->numel(); ++i) {
-      counts_map[out_data[i]] = 0;
-    }
-    for (int64_t i = 0; i < in.numel(); i++) {
-      counts_map[in_data[i]] += 1;
-    }
-    for (int64_t i = 0; i < out->numel(); i++) {
-      count_data[i] = counts_map[out_data[i]];
-    }
+    count->Resize(phi::make_ddim({num_unique}));
+    auto* count_data = context.template Alloc<IndexT>(count);
+    std::transform(
+        uniq.counts.begin(), uniq.counts.end(), count_data, to_index);
   }
 }
 
@@ -0,0 +1,155 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/phi/kernels/funcs/cpu_sort_select.h"
+
+namespace phi {
+namespace tests {
+
+namespace ss = phi::funcs::sort_select;
+
+template <typename T>
+bool RefLess(T l, T r) {
+  return (!std::isnan(static_cast<double>(l)) &&
+          std::isnan(static_cast<double>(r))) ||
+         (l < r);
+}
+
+template <typename T>
+std::vector<T> RandomRow(int64_t n, int range, std::mt19937* gen) {
+  std::uniform_int_distribution<int> dist(-range, range);
+  std::vector<T> row(n);
+  for (auto& v : row) {
+    v = static_cast<T>(dist(*gen)) / static_cast<T>(range > 100 ? 7 : 1);
+  }
+  return row;
+}
+
+template <typename T>
+void CheckTopK(int64_t rows, int64_t cols, int64_t k, bool largest) {
+  std::mt19937 gen(cols + k);
+  std::vector<T> in = RandomRow<T>(rows * cols, 1000, &gen);
+  std::vector<T> out(rows * k);
+  std::vector<int64_t> idx(rows * k);
+  ss::TopKRows<T>(
+      in.data(), rows, cols, k, largest, true, out.data(), idx.data());
+  for (int64_t i = 0; i < rows; ++i) {
+    std::vector<T> ref(in.begin() + i * cols, in.begin() + (i + 1) * cols);
+    std::sort(ref.begin(), ref.end(), [&](T l, T r) {
+      return largest ? RefLess(r, l) : RefLess(l, r);
+    });
+    for (int64_t j = 0; j < k; ++j) {
+      EXPECT_EQ(out[i * k + j], ref[j]);
+      EXPECT_EQ(in[i * cols + idx[i * k + j]], out[i * k + j]);
+    }
+  }
+}
+
+TEST(CpuSortSelect, topk) {
+  CheckTopK<float>(3, 17, 5, true);
+  CheckTopK<float>(2, 5000, 100, false);
+  CheckTopK<double>(4, 1000, 1000, true);
+  CheckTopK<int32_t>(2, 3000, 7, true);
+  CheckTopK<int64_t>(2, 3000, 300, false);
+  CheckTopK<float>(1, 1 << 19, 10, true);
+}
+
+TEST(CpuSortSelect, topk_nan) {
+  std::vector<float> in = {1.f, NAN, -0.f, 3.f, 0.f, -2.f};
+  std::vector<float> out(3);
+  std::vector<int64_t> idx(3);
+  ss::TopKRows<float>(in.data(), 1, 6, 3, true, true, out.data(), idx.data());
+  EXPECT_TRUE(std::isnan(out[0]));
+  EXPECT_EQ(out[1], 3.f);
+  EXPECT_EQ(out[2], 1.f);
+  ss::TopKRows<float>(in.data(), 1, 6, 3, false, true, out.data(), idx.data());
+  EXPECT_EQ(out[0], -2.f);
+  EXPECT_EQ(out[1], 0.f);
+  EXPECT_EQ(out[2], 0.f);
+}
+
+template <typename T>
+void CheckArgsort(int64_t rows, int64_t cols, bool descending) {
+  std::mt19937 gen(cols);
+  std::vector<T> in = RandomRow<T>(rows * cols, 50, &gen);
+  std::vector<T> out(rows * cols);
+  std::vector<int64_t> idx(rows * cols);
+  ss::ArgsortRows<T>(
+      in.data(), rows, cols, descending, out.data(), idx.data());
+  for (int64_t i = 0; i < rows; ++i) {
+    std::vector<int64_t> ref(cols);
+    for (int64_t j = 0; j < cols; ++j) ref[j] = j;
+    const T* row = in.data() + i * cols;
+    std::stable_sort(ref.begin(), ref.end(), [&](int64_t l, int64_t r) {
+      return descending ? RefLess(row[r], row[l]) : RefLess(row[l], row[r]);
+    });
+    for (int64_t j = 0; j < cols; ++j) {
+      EXPECT_EQ(idx[i * cols + j], ref[j]);
+      EXPECT_EQ(out[i * cols + j], row[ref[j]]);
+    }
+  }
+}
+
+TEST(CpuSortSelect, argsort) {
+  CheckArgsort<float>(3, 10, false);
+  CheckArgsort<float>(3, 1000, true);
+  CheckArgsort<double>(2, 777, false);
+  CheckArgsort<int32_t>(2, 2048, true);
+  CheckArgsort<int64_t>(2, 2048, false);
+}
+
+template <typename T>
+void CheckKthValueAndMode(int64_t rows, int64_t cols, int64_t k) {
+  std::mt19937 gen(cols + k);
+  std::vector<T> in = RandomRow<T>(rows * cols, 20, &gen);
+  std::vector<T> out(rows);
+  std::vector<int64_t> idx(rows);
+  ss::KthValueRows<T>(in.data(), rows, cols, k, out.data(), idx.data());
+  for (int64_t i = 0; i < rows; ++i) {
+    std::vector<T> ref(in.begin() + i * cols, in.begin() + (i + 1) * cols);
+    std::sort(ref.begin(), ref.end(), RefLess<T>);
+    EXPECT_EQ(out[i], ref[k - 1]);
+    EXPECT_EQ(in[i * cols + idx[i]], out[i]);
+  }
+
+  ss::ModeRows<T>(in.data(), rows, cols, out.data(), idx.data());
+  for (int64_t i = 0; i < rows; ++i) {
+    std::map<T, int64_t> freq;
+    for (int64_t j = 0; j < cols; ++j) ++freq[in[i * cols + j]];
+    T mode = freq.begin()->first;
+    for (auto& kv : freq) {
+      if (kv.second > freq[mode]) mode = kv.first;
+    }
+    EXPECT_EQ(out[i], mode);
+    EXPECT_EQ(in[i * cols + idx[i]], mode);
+  }
+}
+
+TEST(CpuSortSelect, kthvalue_and_mode) {
+  CheckKthValueAndMode<float>(4, 33, 3);
+  CheckKthValueAndMode<double>(2, 5000, 2500);
+  CheckKthValueAndMode<int32_t>(3, 4096, 1);
+  CheckKthValueAndMode<int64_t>(3, 4096, 4096);
+}
+
+}  // namespace tests
+}  // namespace phi
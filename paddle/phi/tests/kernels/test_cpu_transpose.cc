@@ -0,0 +1,103 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/phi/kernels/funcs/cpu_transpose.h"
+
+namespace phi {
+namespace tests {
+
+template <typename T>
+std::vector<T> RefTranspose(const std::vector<T>& in,
+                            const std::vector<int64_t>& dims,
+                            const std::vector<int>& axis) {
+  const int rank = dims.size();
+  std::vector<int64_t> in_stride(rank, 1), out_dims(rank), out_stride(rank, 1);
+  for (int i = 0; i < rank; ++i) out_dims[i] = dims[axis[i]];
+  for (int i = rank - 2; i >= 0; --i) {
+    in_stride[i] = in_stride[i + 1] * dims[i + 1];
+    out_stride[i] = out_stride[i + 1] * out_dims[i + 1];
+  }
+  std::vector<T> out(in.size());
+  for (int64_t o = 0; o < static_cast<int64_t>(in.size()); ++o) {
+    int64_t rest = o;
+    int64_t i_idx = 0;
+    for (int i = 0; i < rank; ++i) {
+      i_idx += rest / out_stride[i] * in_stride[axis[i]];
+      rest %= out_stride[i];
+    }
+    out[o] = in[i_idx];
+  }
+  return out;
+}
+
+template <typename T>
+void CheckTranspose(const std::vector<int64_t>& dims,
+                    const std::vector<int>& axis) {
+  int64_t numel = 1;
+  for (auto d : dims) numel *= d;
+  std::vector<T> in(numel);
+  for (int64_t i = 0; i < numel; ++i) in[i] = static_cast<T>(i * 7 + 3);
+  std::vector<T> out(numel);
+  funcs::TransposeCPU<T>(in.data(), dims, axis, out.data());
+  EXPECT_EQ(out, RefTranspose(in, dims, axis));
+}
+
+template <typename T>
+void CheckAllShapes() {
+  CheckTranspose<T>({37, 53}, {1, 0});
+  CheckTranspose<T>({256, 129}, {1, 0});
+  CheckTranspose<T>({3, 64, 48}, {0, 2, 1});
+  CheckTranspose<T>({2, 3, 17, 19}, {0, 2, 3, 1});
+  CheckTranspose<T>({2, 17, 19, 3}, {0, 3, 1, 2});
+  CheckTranspose<T>({4, 5, 6, 7}, {1, 0, 2, 3});
+  CheckTranspose<T>({4, 1, 6, 1, 7}, {3, 4, 0, 2, 1});
+  CheckTranspose<T>({2, 3, 4, 5, 2, 3, 2}, {6, 1, 4, 0, 3, 2, 5});
+  CheckTranspose<T>({1, 1}, {1, 0});
+  CheckTranspose<T>({8, 0, 3}, {2, 1, 0});
+}
+
+TEST(CpuTranspose, simplify) {
+  std::vector<int64_t> dims;
+  std::vector<int> axis;
+  funcs::SimplifyTransposeDims({2, 3, 4, 5}, {0, 2, 3, 1}, &dims, &axis);
+  EXPECT_EQ(dims, std::vector<int64_t>({2, 3, 20}));
+  EXPECT_EQ(axis, std::vector<int>({0, 2, 1}));
+  funcs::SimplifyTransposeDims({2, 1, 4, 5}, {1, 0, 2, 3}, &dims, &axis);
+  EXPECT_EQ(dims, std::vector<int64_t>({40}));
+  EXPECT_EQ(axis, std::vector<int>({0}));
+  funcs::SimplifyTransposeDims({6, 2, 3, 4}, {2, 3, 0, 1}, &dims, &axis);
+  EXPECT_EQ(dims, std::vector<int64_t>({12, 12}));
+  EXPECT_EQ(axis, std::vector<int>({1, 0}));
+}
+
+TEST(CpuTranspose, dtypes) {
+  CheckAllShapes<float>();
+  CheckAllShapes<double>();
+  CheckAllShapes<int16_t>();
+  CheckAllShapes<int8_t>();
+  CheckAllShapes<int64_t>();
+}
+
+TEST(CpuTranspose, large) {
+  CheckTranspose<float>({8, 512, 384}, {0, 2, 1});
+  CheckTranspose<float>({2, 64, 56, 56}, {0, 2, 3, 1});
+  CheckTranspose<uint8_t>({1000, 999}, {1, 0});
+}
+
+}  // namespace tests
+}  // namespace phi
@@ -0,0 +1,104 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/phi/kernels/funcs/cpu_unique.h"
+
+namespace phi {
+namespace tests {
+
+template <typename T>
+std::vector<T> RandomInput(int64_t n, int range) {
+  std::mt19937 gen(n + range);
+  std::uniform_int_distribution<int> dist(-range, range);
+  std::vector<T> in(n);
+  for (auto& v : in) v = static_cast<T>(dist(gen));
+  return in;
+}
+
+template <typename T>
+void CheckUnique(int64_t n, int range, bool sorted) {
+  std::vector<T> in = RandomInput<T>(n, range);
+  std::vector<int64_t> inverse(n);
+  funcs::CPUUniqueResult<T> result;
+  funcs::UniqueFirstOccurrence(
+      in.data(), n, true, true, inverse.data(), &result);
+  if (sorted) {
+    funcs::SortUniqueResult(&result, inverse.data(), n);
+  }
+
+  // Reference: first-occurrence order, or ascending order.
+  std::vector<T> ref;
+  std::unordered_map<T, int64_t> first;
+  std::map<T, int64_t> counts;
+  for (int64_t i = 0; i < n; ++i) {
+    if (first.emplace(in[i], i).second) ref.push_back(in[i]);
+    ++counts[in[i]];
+  }
+  if (sorted) std::sort(ref.begin(), ref.end());
+  ASSERT_EQ(result.values, ref);
+  for (size_t j = 0; j < ref.size(); ++j) {
+    EXPECT_EQ(result.first_index[j], first[ref[j]]);
+    EXPECT_EQ(result.counts[j], counts[ref[j]]);
+  }
+  for (int64_t i = 0; i < n; ++i) {
+    ASSERT_EQ(result.values[inverse[i]], in[i]);
+  }
+}
+
+TEST(CpuUnique, first_occurrence) {
+  CheckUnique<int64_t>(1000, 50, false);
+  CheckUnique<int32_t>(1, 5, false);
+  CheckUnique<float>(5000, 300, false);
+  CheckUnique<int64_t>(funcs::kParallelUniqueNumel + 17, 100000, false);
+}
+
+TEST(CpuUnique, sorted) {
+  CheckUnique<int64_t>(1000, 50, true);
+  CheckUnique<double>(3000, 1000, true);
+  CheckUnique<int32_t>(funcs::kParallelUniqueNumel * 2, 1 << 20, true);
+}
+
+TEST(CpuUnique, consecutive) {
+  std::vector<int64_t> in = {1, 1, 2, 2, 2, 1, 3, 3};
+  auto starts = funcs::ConsecutiveRunStarts(in.data(), in.size());
+  ASSERT_EQ(starts, std::vector<int64_t>({0, 2, 5, 6}));
+  std::vector<int64_t> out(starts.size()), counts(starts.size());
+  std::vector<int64_t> inverse(in.size());
+  funcs::UniqueConsecutiveFromRuns(in.data(),
+                                   in.size(),
+                                   starts,
+                                   out.data(),
+                                   inverse.data(),
+                                   counts.data());
+  EXPECT_EQ(out, std::vector<int64_t>({1, 2, 1, 3}));
+  EXPECT_EQ(counts, std::vector<int64_t>({2, 3, 1, 2}));
+  EXPECT_EQ(inverse, std::vector<int64_t>({0, 0, 1, 1, 1, 2, 3, 3}));
+
+  std::vector<int32_t> big =
+      RandomInput<int32_t>(funcs::kParallelUniqueNumel, 1);
+  auto big_starts = funcs::ConsecutiveRunStarts(big.data(), big.size());
+  size_t runs = 1;
+  for (size_t i = 1; i < big.size(); ++i) runs += big[i] != big[i - 1];
+  EXPECT_EQ(big_starts.size(), runs);
+}
+
+}  // namespace tests
+}  // namespace phi
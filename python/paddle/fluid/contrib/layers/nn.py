@@ -41,6 +41,7 @@ from paddle import _C_ops
 __all__ = [
     'fused_elemwise_activation', 'sequence_topk_avg_pooling', 'var_conv_2d',
     'match_matrix_tensor', 'tree_conv', 'fused_embedding_seq_pool',
+    'fused_multi_embedding_seq_pool',
     'multiclass_nms2', 'search_pyramid_hash', 'shuffle_batch', 'partial_concat',
     'sparse_embedding', 'partial_sum', 'tdm_child', 'rank_attention',
     'tdm_sampler', 'batch_fc', '_pull_box_extended_sparse', 'bilateral_slice',
@@ -462,7 +463,8 @@ def fused_embedding_seq_pool(input,
                              padding_idx=None,
                              combiner='sum',
                              param_attr=None,
-                             dtype='float32'):
+                             dtype='float32',
+                             per_sample_weight=None):
     r"""
     **Embedding Sequence pool**
 
@@ -481,11 +483,15 @@ def fused_embedding_seq_pool(input,
             no effect to output. If :math:`padding\_idx < 0`, the :math:`padding\_idx`
             will automatically be converted to :math:`size[0] + padding\_idx` to use.
             Default: None.
-        combiner (str): The pooling type of sequence_pool, and only support `sum`.
-            Default: sum.
+        combiner (str): The pooling type of sequence_pool, one of `sum`, `mean`
+            (divided by the sum of the weights) and `sqrt` (divided by the square
+            root of the sum of the squared weights). Default: sum.
         param_attr (ParamAttr): Parameters for this layer.
         dtype (np.dtype|core.VarDesc.VarType|str): The dtype refers to the data type of output
             tensor. It can be float32, float_16, int etc.
+        per_sample_weight (Variable|None): A Tensor with the same shape and LoD as
+            :attr:`input` holding one weight per id. Default: None, every id has
+            weight 1.
     Returns:
         The sequence pooling variable which is a Tensor.
     Examples:
@@ -510,10 +516,12 @@ def fused_embedding_seq_pool(input,
     out = helper.create_variable_for_type_inference(dtype)
     padding_idx = -1 if padding_idx is None else padding_idx if padding_idx >= 0 else (
         size[0] + padding_idx)
+    inputs = {'Ids': input, 'W': w}
+    if per_sample_weight is not None:
+        inputs['PerSampleWeight'] = per_sample_weight
     helper.append_op(
         type='fused_embedding_seq_pool',
-        inputs={'Ids': input,
-                'W': w},
+        inputs=inputs,
         outputs={'Out': out},
         attrs={
             'is_sparse': is_sparse,
@@ -523,6 +531,91 @@ def fused_embedding_seq_pool(input,
     return out
 
 
+def fused_multi_embedding_seq_pool(input,
+                                   size,
+                                   is_sparse=False,
+                                   padding_idx=None,
+                                   combiner='sum',
+                                   param_attr=None,
+                                   dtype='float32',
+                                   per_sample_weight=None):
+    r"""
+    **Multi-slot Embedding Sequence pool**
+
+    Applies :ref:`fused_embedding_seq_pool` to many slots with a single op.
+    Every slot has its own embedding table, and the slots are processed in
+    parallel on CPU.
+
+    Args:
+        input (list[Variable]): The Tensor<int64> ids of every slot, with LoD
+            level 1 and last dimension 1.
+        size (list[tuple|list]): The shape of the embedding table of every slot.
+        is_sparse (bool): The flag indicating whether to use sparse update.
+            Default: False.
+        padding_idx (int|long|None): An id that is skipped by the pooling. If
+            set :attr:`None`, it makes no effect. A negative padding_idx counts
+            from the end of the tables, which should then have the same
+            height, as in :ref:`fused_embedding_seq_pool`. Default: None.
+        combiner (str): The pooling type, one of `sum`, `mean` and `sqrt`.
+            Default: sum.
+        param_attr (list[ParamAttr]|ParamAttr|None): Parameters of the tables.
+        dtype (np.dtype|core.VarDesc.VarType|str): The dtype of the tables and
+            the outputs. Default: float32.
+        per_sample_weight (list[Variable]|None): One weight Tensor per slot, with
+            the same shape and LoD as the ids. Default: None.
+    Returns:
+        A list with the pooled Tensor of every slot.
+    Examples:
+        .. code-block:: python
+            import paddle.fluid as fluid
+
+            slots = [
+                fluid.layers.data(
+                    name='slot_%d' % i, shape=[1], dtype='int64', lod_level=1)
+                for i in range(3)
+            ]
+            outs = fluid.contrib.fused_multi_embedding_seq_pool(
+                input=slots, size=[[100, 8]] * 3, combiner='mean')
+    """
+    helper = LayerHelper('fused_multi_embedding_seq_pool', **locals())
+    assert len(input) == len(size), \
+        "input and size should have the same length"
+    if padding_idx is None:
+        padding_idx = -1
+    elif padding_idx < 0:
+        heights = set(shape[0] for shape in size)
+        assert len(heights) == 1, \
+            "a negative padding_idx needs tables of the same height"
+        padding_idx = heights.pop() + padding_idx
+    param_attrs = param_attr if isinstance(param_attr, (list, tuple)) else \
+        [param_attr] * len(input)
+    ws = []
+    for attr, shape in zip(param_attrs, size):
+        ws.append(
+            helper.create_parameter(
+                attr=ParamAttr._to_attr(attr),
+                shape=shape,
+                dtype=dtype,
+                is_bias=False))
+    outs = [
+        helper.create_variable_for_type_inference(dtype)
+        for _ in range(len(input))
+    ]
+    inputs = {'Ids': input, 'W': ws}
+    if per_sample_weight is not None:
+        inputs['PerSampleWeight'] = per_sample_weight
+    helper.append_op(
+        type='fused_multi_embedding_seq_pool',
+        inputs=inputs,
+        outputs={'Out': outs},
+        attrs={
+            'is_sparse': is_sparse,
+            'combiner': combiner,
+            'padding_idx': padding_idx
+        })
+    return outs
+
+
 def fused_seqpool_cvm(input,
                       pool_type,
                       cvm,
@@ -355,6 +355,10 @@ class DownpourSGD(DeviceWorker):
         opt_info = self._program._fleet_opt
         program_configs = opt_info["program_configs"]
         downpour = trainer_desc.downpour_param
+        downpour.prefetch_pull_sparse = opt_info.get("prefetch_pull_sparse",
+                                                     False)
+        downpour.prefetch_max_push_staleness = opt_info.get(
+            "prefetch_max_push_staleness", 1)
 
         for pid in program_configs:
             if pid == program_id:
@@ -162,6 +162,9 @@ class DistributedStrategy(object):
                 self.debug_opt.get("dump_converter", ""))
             opt_info["dump_fields"] = self.debug_opt.get("dump_fields", [])
             opt_info["dump_file_num"] = self.debug_opt.get("dump_file_num", 16)
+            opt_info["dump_format"] = self.debug_opt.get("dump_format", "text")
+            opt_info["dump_queue_capacity"] = self.debug_opt.get(
+                "dump_queue_capacity", 1024)
             opt_info["dump_fields_path"] = self.debug_opt.get(
                 "dump_fields_path", "")
             opt_info["dump_param"] = self.debug_opt.get("dump_param", [])
@@ -853,6 +853,10 @@ class DistributedAdam(DistributedOptimizerImplBase):
         opt_info["worker_class"] = strategy.get("worker_class",
                                                 "DownpourWorker")
         opt_info["stat_var_names"] = strategy.get("stat_var_names", [])
+        opt_info["prefetch_pull_sparse"] = strategy.get("prefetch_pull_sparse",
+                                                        False)
+        opt_info["prefetch_max_push_staleness"] = strategy.get(
+            "prefetch_max_push_staleness", 1)
         opt_info["local_tables"] = strategy.get("local_tables", [])
         opt_info["async_tables"] = strategy.get("async_tables", [])
         opt_info["async_tables"] = strategy.get("async_tables", [])
@@ -863,6 +867,9 @@ class DistributedAdam(DistributedOptimizerImplBase):
         opt_info["dump_converter"] = ""
         opt_info["dump_fields"] = strategy.get("dump_fields", [])
         opt_info["dump_file_num"] = strategy.get("dump_file_num", 16)
+        opt_info["dump_format"] = strategy.get("dump_format", "text")
+        opt_info["dump_queue_capacity"] = strategy.get("dump_queue_capacity",
+                                                       1024)
         opt_info["user_define_dump_filename"] = strategy.get(
             "user_define_dump_filename", "")
         opt_info["dump_fields_path"] = strategy.get("dump_fields_path", "")
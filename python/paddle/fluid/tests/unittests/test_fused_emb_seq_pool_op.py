@@ -18,6 +18,7 @@ import unittest
 import platform
 import numpy as np
 from op_test import OpTest, skip_check_grad_ci
+import paddle
 import paddle.fluid.core as core
 import paddle.fluid as fluid
 from paddle.fluid.op import Operator
@@ -92,6 +93,193 @@ class TestLookupTableOpWithPadding(TestFusedEmbeddingSeqPoolOp):
                 ['W'], 'Out', no_grad_set=['Ids'], check_dygraph=False)
 
 
+def emb_seq_pool_ref(table, ids, weights, lod, combiner, padding_idx=-1):
+    ids = ids.reshape([ids.shape[0], -1])
+    weights = np.ones(ids.shape) if weights is None else weights.reshape(
+        ids.shape)
+    emb_size = table.shape[1]
+    out = np.zeros([len(lod[0]), ids.shape[1] * emb_size])
+    start = 0
+    for i, count in enumerate(lod[0]):
+        for col in range(ids.shape[1]):
+            seq_ids = ids[start:start + count, col]
+            seq_w = weights[start:start + count, col] * (seq_ids != padding_idx)
+            if combiner == 'mean':
+                denom = np.sum(seq_w)
+            elif combiner == 'sqrt':
+                denom = np.sqrt(np.sum(seq_w * seq_w))
+            else:
+                denom = 1.0
+            scale = 0.0 if denom == 0 else 1.0 / denom
+            out[i, col * emb_size:(col + 1) * emb_size] = np.sum(
+                table[seq_ids] * (seq_w * scale)[:, None], axis=0)
+        start += count
+    return out
+
+
+class TestFusedEmbeddingSeqPoolOpWeightedMean(OpTest):
+    def setUp(self):
+        self.op_type = "fused_embedding_seq_pool"
+        self.set_combiner()
+        self.table = np.random.random((17, 6)).astype("float64")
+        self.ids = np.array([[[4], [3]], [[4], [3]], [[2], [1]],
+                             [[16], [1]]]).astype("int64")
+        self.weight = np.random.uniform(0.5, 1.5, self.ids.shape).astype(
+            "float64")
+        self.lod = [[3, 1]]
+        self.attrs = {'is_sparse': False, 'combiner': self.combiner}
+        self.inputs = {
+            'W': self.table,
+            'Ids': (self.ids, self.lod),
+            'PerSampleWeight': (self.weight, self.lod)
+        }
+        self.outputs = {
+            'Out': emb_seq_pool_ref(self.table, self.ids, self.weight,
+                                    self.lod, self.combiner)
+        }
+
+    def set_combiner(self):
+        self.combiner = 'mean'
+
+    def test_check_output(self):
+        self.check_output(check_dygraph=False)
+
+    def test_check_grad(self):
+        self.check_grad(
+            ['W'],
+            'Out',
+            no_grad_set=['Ids', 'PerSampleWeight'],
+            check_dygraph=False)
+
+
+class TestFusedEmbeddingSeqPoolOpWeightedSqrt(
+        TestFusedEmbeddingSeqPoolOpWeightedMean):
+    def set_combiner(self):
+        self.combiner = 'sqrt'
+
+
+class TestFusedMultiEmbeddingSeqPoolOp(OpTest):
+    def setUp(self):
+        self.op_type = "fused_multi_embedding_seq_pool"
+        self.set_attrs()
+        tables, ids, weights, outs = [], [], [], []
+        for i, (height, lod) in enumerate([(17, [[3, 1]]), (9, [[1, 2, 2]]),
+                                           (30, [[0, 2]])]):
+            table = np.random.random((height, 5)).astype("float64")
+            slot_ids = np.random.randint(0, height,
+                                         (sum(lod[0]), 1)).astype("int64")
+            weight = np.random.uniform(0.5, 1.5, slot_ids.shape).astype(
+                "float64")
+            tables.append(('w%d' % i, table))
+            ids.append(('ids%d' % i, (slot_ids, lod)))
+            weights.append(('weight%d' % i, (weight, lod)))
+            outs.append(('out%d' % i, emb_seq_pool_ref(
+                table, slot_ids, weight, lod, self.combiner)))
+        self.inputs = {'W': tables, 'Ids': ids, 'PerSampleWeight': weights}
+        self.outputs = {'Out': outs}
+        self.attrs = {'combiner': self.combiner, 'is_sparse': False}
+
+    def set_attrs(self):
+        self.combiner = 'mean'
+
+    def test_check_output(self):
+        self.check_output(check_dygraph=False)
+
+    def test_check_grad(self):
+        self.check_grad(
+            ['w0', 'w1', 'w2'], ['out0', 'out1', 'out2'],
+            no_grad_set=['ids0', 'ids1', 'ids2', 'weight0', 'weight1',
+                         'weight2'],
+            check_dygraph=False)
+
+
+class TestFusedMultiEmbeddingSeqPoolOpSum(TestFusedMultiEmbeddingSeqPoolOp):
+    def set_attrs(self):
+        self.combiner = 'sum'
+
+
+class TestFusedMultiEmbeddingSeqPoolSparseGrad(unittest.TestCase):
+    def test_sparse_grad(self):
+        place = core.CPUPlace()
+        scope = core.Scope()
+        height, width = 10, 3
+        ids = np.array([[3], [7], [3], [1], [7]]).astype("int64")
+        lod = [[2, 3]]
+        table = np.random.random((height, width)).astype("float32")
+        d_out = np.random.random((2, width)).astype("float32")
+
+        scope.var('W').get_tensor().set(table, place)
+        ids_tensor = scope.var('Ids').get_tensor()
+        ids_tensor.set(ids, place)
+        ids_tensor.set_recursive_sequence_lengths(lod)
+        scope.var('Out@GRAD').get_tensor().set(d_out, place)
+        scope.var('W@GRAD').get_selected_rows()
+
+        op = Operator(
+            'fused_multi_embedding_seq_pool_grad',
+            W=['W'],
+            Ids=['Ids'],
+            **{'Out@GRAD': ['Out@GRAD'],
+               'W@GRAD': ['W@GRAD']},
+            combiner='sum',
+            is_sparse=True)
+        op.run(scope, place)
+
+        d_table = scope.var('W@GRAD').get_selected_rows()
+        self.assertEqual(d_table.rows(), [3, 7, 1])
+        self.assertEqual(d_table.height(), height)
+        value = np.array(d_table.get_tensor())
+        np.testing.assert_allclose(value[0], d_out[0] + d_out[1], rtol=1e-6)
+        np.testing.assert_allclose(value[1], d_out[0] + d_out[1], rtol=1e-6)
+        np.testing.assert_allclose(value[2], d_out[1], rtol=1e-6)
+
+
+class TestFusedMultiEmbeddingSeqPoolApiNegativePadding(unittest.TestCase):
+    def test_negative_padding_idx(self):
+        height, width = 10, 4
+        main, startup = fluid.Program(), fluid.Program()
+        with fluid.program_guard(main, startup):
+            slots = [
+                fluid.layers.data(
+                    name='slot_%d' % i, shape=[1], dtype='int64', lod_level=1)
+                for i in range(2)
+            ]
+            outs = fluid.contrib.fused_multi_embedding_seq_pool(
+                input=slots,
+                size=[[height, width]] * 2,
+                param_attr=['w0', 'w1'],
+                padding_idx=-1,
+                combiner='mean')
+        ops = [
+            op for op in main.global_block().ops
+            if op.type == 'fused_multi_embedding_seq_pool'
+        ]
+        self.assertEqual(ops[0].attr('padding_idx'), height - 1)
+
+        place = fluid.CPUPlace()
+        exe = fluid.Executor(place)
+        scope = fluid.Scope()
+        with fluid.scope_guard(scope):
+            exe.run(startup)
+            lod = [[3, 2]]
+            ids = [
+                np.array([[9], [1], [9], [2], [3]]).astype("int64"),
+                np.array([[4], [5], [6], [9], [9]]).astype("int64")
+            ]
+            feed = {}
+            for i, slot_ids in enumerate(ids):
+                tensor = fluid.core.LoDTensor()
+                tensor.set(slot_ids, place)
+                tensor.set_recursive_sequence_lengths(lod)
+                feed['slot_%d' % i] = tensor
+            rets = exe.run(main, feed=feed, fetch_list=outs)
+            for i, ret in enumerate(rets):
+                table = np.array(scope.find_var('w%d' % i).get_tensor())
+                ref = emb_seq_pool_ref(table, ids[i], None, lod, 'mean',
+                                       height - 1)
+                np.testing.assert_allclose(ret, ref, rtol=1e-5, atol=1e-6)
+
+
 class TestFusedEmbeddingSeqPoolApi(unittest.TestCase):
     def test_api(self):
         if ver.mkl() == "ON" and 'Linux' in platform.platform():
@@ -121,4 +309,5 @@ class TestFusedEmbeddingSeqPoolApi(unittest.TestCase):
 
 
 if __name__ == "__main__":
+    paddle.enable_static()
     unittest.main()
@@ -281,10 +281,11 @@ class TestSparseMomentumOp(unittest.TestCase):
 
     def check_with_place(self, place):
         self.init_kernel()
+        self.init_rows()
         scope = core.Scope()
         # create and initialize Grad Variable
         height = 10
-        rows = [0, 4, 7]
+        rows = self.rows
         row_numel = 12
         mu = 1.0
         use_nesterov = self.use_nesterov
@@ -344,7 +345,7 @@ class TestSparseMomentumOp(unittest.TestCase):
         # for sparse update.
         _grad_np_array = np.full((height, row_numel), 0.0).astype("float32")
         for i in range(len(rows)):
-            _grad_np_array[rows[i]] = grad_np_array[i]
+            _grad_np_array[rows[i]] += grad_np_array[i]
 
         _param = param_array
 
@@ -364,6 +365,9 @@ class TestSparseMomentumOp(unittest.TestCase):
     def init_kernel(self):
         pass
 
+    def init_rows(self):
+        self.rows = [0, 4, 7]
+
     def test_sparse_momentum(self):
         places = [core.CPUPlace()]
         if core.is_compiled_with_cuda():
@@ -377,6 +381,12 @@ class TestSparseMomentumOp2(TestSparseMomentumOp):
         self.use_nesterov = True
 
 
+class TestSparseMomentumOpUnsortedDuplicatedRows(TestSparseMomentumOp):
+    def init_rows(self):
+        # merged before the update, which binary searches the merged rows
+        self.rows = [7, 0, 4, 7, 0]
+
+
 class TestSparseMomentumOpWithMultiPrecision(unittest.TestCase):
     def setUp(self):
         self.init_args()
@@ -0,0 +1,122 @@
+#   Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function
+
+import unittest
+import numpy as np
+from op_test import OpTest
+
+
+def weight_only_quantize(w, weight_bits, group_size):
+    """Quantizes w of shape [I, O] to the layout of weight_only_fc."""
+    w = w.T
+    oc, ic = w.shape
+    max_q = 127 if weight_bits == 8 else 7
+    num_groups = (ic + group_size - 1) // group_size
+    scale = np.zeros([oc, num_groups], dtype=np.float32)
+    q = np.zeros([oc, ic], dtype=np.int32)
+    for g in range(num_groups):
+        cols = slice(g * group_size, min(ic, (g + 1) * group_size))
+        s = np.max(np.abs(w[:, cols]), axis=1) / max_q
+        s[s == 0] = 1
+        scale[:, g] = s
+        q[:, cols] = np.clip(
+            np.round(w[:, cols] / s[:, None]), -max_q - 1, max_q)
+    if weight_bits == 4:
+        if ic % 2:
+            q = np.concatenate([q, np.zeros([oc, 1], dtype=np.int32)], 1)
+        packed = (q[:, 0::2] & 0xf) | ((q[:, 1::2] & 0xf) << 4)
+        return packed.astype(np.uint8).view(np.int8), scale, q[:, :ic]
+    return q.astype(np.int8), scale, q
+
+
+class TestWeightOnlyFCOp(OpTest):
+    def setUp(self):
+        self.op_type = 'weight_only_fc'
+        self.m = 3
+        self.ic = 64
+        self.oc = 10
+        self.weight_bits = 8
+        self.group_size = self.ic
+        self.with_bias = True
+        self.activation_type = ''
+        self.set_conf()
+
+        x = np.random.random([self.m, self.ic]).astype('float32') - 0.5
+        w = np.random.random([self.ic, self.oc]).astype('float32') - 0.5
+        b = np.random.random([self.oc]).astype('float32') - 0.5
+        qw, scale, q = weight_only_quantize(w, self.weight_bits,
+                                            self.group_size)
+        groups = np.arange(self.ic) // self.group_size
+        dequantized = q * scale[:, groups]
+        out = np.dot(x, dequantized.T)
+        if self.with_bias:
+            out += b
+        if self.activation_type == 'relu':
+            out = np.maximum(out, 0)
+
+        self.inputs = {'Input': x, 'W': qw, 'WScale': scale}
+        if self.with_bias:
+            self.inputs['Bias'] = b
+        self.attrs = {
+            'weight_bits': self.weight_bits,
+            'group_size': self.group_size,
+            'activation_type': self.activation_type
+        }
+        self.outputs = {'Out': out.astype('float32')}
+
+    def set_conf(self):
+        pass
+
+    def test_check_output(self):
+        self.check_output(atol=1e-4)
+
+
+class TestWeightOnlyFCOpRelu(TestWeightOnlyFCOp):
+    def set_conf(self):
+        self.activation_type = 'relu'
+
+
+class TestWeightOnlyFCOpNoBias(TestWeightOnlyFCOp):
+    def set_conf(self):
+        self.with_bias = False
+        self.activation_type = 'relu'
+
+
+class TestWeightOnlyFCOpInt4(TestWeightOnlyFCOp):
+    def set_conf(self):
+        self.weight_bits = 4
+        self.group_size = 16
+
+
+class TestWeightOnlyFCOpInt4OddChannels(TestWeightOnlyFCOp):
+    def set_conf(self):
+        self.m = 5
+        self.ic = 33
+        self.weight_bits = 4
+        self.group_size = 33
+
+
+class TestWeightOnlyFCOpLarge(TestWeightOnlyFCOp):
+    def set_conf(self):
+        self.m = 9
+        self.ic = 512
+        self.oc = 256
+        self.weight_bits = 4
+        self.group_size = 64
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -167,6 +167,12 @@ class TrainerDesc(object):
     def _set_dump_converter(self, converter):
         self.proto_desc.dump_converter = converter
 
+    def _set_dump_format(self, dump_format):
+        self.proto_desc.dump_format = dump_format
+
+    def _set_dump_queue_capacity(self, dump_queue_capacity):
+        self.proto_desc.dump_queue_capacity = dump_queue_capacity
+
     def _set_enable_random_dump(self, enable_random_dump):
         self.proto_desc.enable_random_dump = enable_random_dump
 
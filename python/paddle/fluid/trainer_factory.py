@@ -76,6 +76,11 @@ class TrainerFactory(object):
                     trainer._set_dump_file_num(opt_info["dump_file_num"])
                 if opt_info.get("dump_converter") is not None:
                     trainer._set_dump_converter(opt_info["dump_converter"])
+                if opt_info.get("dump_format") is not None:
+                    trainer._set_dump_format(opt_info["dump_format"])
+                if opt_info.get("dump_queue_capacity") is not None:
+                    trainer._set_dump_queue_capacity(opt_info[
+                        "dump_queue_capacity"])
                 if opt_info.get("dump_param") is not None and len(
                         opt_info.get("dump_param")) != 0:
                     trainer._set_dump_param(opt_info["dump_param"])